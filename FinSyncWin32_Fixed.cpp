@@ -4,6 +4,7 @@
 
 #include <windows.h>
 #include <commctrl.h>
+#include <commdlg.h>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -12,24 +13,27 @@
 #include <algorithm>
 #include <windowsx.h>
 
+#include "core/CategoryDictionary.h"
+#include "core/CategoryRules.h"
+#include "core/Date.h"
+#include "core/FilterProgram.h"
+#include "core/Ledger.h"
+#include "core/Money.h"
+#include "core/Report.h"
+#include "core/StatementImport.h"
+#include "core/TransactionStore.h"
+#include "core/TransactionTableModel.h"
+
 #pragma comment(lib, "comctl32.lib")
+#pragma comment(lib, "comdlg32.lib")
 #pragma comment(lib, "gdi32.lib")
 
-struct Transaction {
-    std::wstring type;
-    double amount;
-    std::wstring category;
-    std::wstring date;
-
-    Transaction(std::wstring t, double a, std::wstring c, std::wstring d)
-        : type(t), amount(a), category(c), date(d) {}
-};
-
 // Dialog data structure
 struct DialogData {
-    double amount;
-    std::wstring date;
+    Money amount;
+    int32_t day;
     std::wstring category;
+    bool categoryChosen;    // by the user in this dialog, so rules leave it alone
     bool accepted;
 };
 
@@ -41,9 +45,14 @@ private:
     HWND hwndExpenseLabel;
     HWND hwndSavingsLabel;
     HWND hwndStatusBar;
-    
-    std::vector<Transaction> transactions;
-    const std::vector<std::wstring> categories = {
+    bool clearingFilter = false;
+    
+    Ledger ledger;
+    const TransactionStore& transactions;
+    TransactionTableModel tableModel;
+    CategoryRules rules;
+    CategoryRules::Scratch ruleScratch;
+    const std::vector<std::wstring> defaultCategories = {
         L"Food", L"Rent", L"Entertainment", L"Transportation", L"Utilities", L"Other"
     };
 
@@ -51,7 +60,7 @@ private:
     static DialogData dialogData;
 
 public:
-    FinSyncApp() : hwndMain(nullptr), hwndListView(nullptr) {
+    FinSyncApp() : hwndMain(nullptr), hwndListView(nullptr), ledger("transactions.fsnap"), transactions(ledger.Transactions()), tableModel(transactions) {
         instance = this;
     }
 
@@ -65,11 +74,19 @@ public:
     void AddExpense();
     void EditTransaction();
     void DeleteTransaction();
+    void ImportStatementFile();
+    void LoadRules();
+    void SuggestCategory(HWND hwndDlg);
     void GenerateReport();
     void RefreshListView();
+    void SortByColumn(int column);
+    void ApplyFilter();
+    void ClearFilter();
     void UpdateSummary();
     void SaveData();
+    void OnSaveStatus(SaveStatus::State state, int percent);
     void LoadData();
+    std::vector<std::wstring> ExpenseCategories() const;
     std::wstring GetCurrentDate();
 };
 
@@ -84,10 +101,84 @@ DialogData FinSyncApp::dialogData;
 #define ID_BTN_REPORT 1005
 #define ID_BTN_SAVE 1006
 #define ID_LISTVIEW 1007
+#define ID_FILTER_TEXT 1008
+#define ID_FILTER_TYPE 1009
+#define ID_FILTER_MIN 1010
+#define ID_FILTER_MAX 1011
+#define ID_FILTER_FROM 1012
+#define ID_FILTER_TO 1013
+#define ID_BTN_CLEAR_FILTER 1014
+#define ID_BTN_IMPORT 1015
+// Posted by the ledger's writer thread: wParam is the SaveStatus::State,
+// lParam the percentage written
+#define WM_APP_SAVE_STATUS (WM_APP + 1)
+
 #define ID_EDIT_AMOUNT 2001
 #define ID_EDIT_DATE 2002
 #define ID_COMBO_CATEGORY 2003
 
+static std::wstring Widen(std::string_view text) {
+    if (text.empty()) return std::wstring();
+    int length = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0);
+    std::wstring result(length, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), &result[0], length);
+    return result;
+}
+
+static std::string Narrow(const std::wstring& text) {
+    if (text.empty()) return std::string();
+    int length = WideCharToMultiByte(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0, nullptr, nullptr);
+    std::string result(length, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text.data(), (int)text.size(), &result[0], length, nullptr, nullptr);
+    return result;
+}
+
+static std::wstring FormatMoney(Money amount) {
+    wchar_t text[Money::maxFormattedLength];
+    return std::wstring(text, amount.Format(text));
+}
+
+static std::wstring FormatDay(int32_t day) {
+    char text[16];
+    return Widen(std::string_view(text, FormatDate(day, text)));
+}
+
+// Reads and validates the category field
+static bool ReadDialogCategory(HWND hwndDlg, std::wstring& category) {
+    wchar_t buffer[256];
+    GetWindowText(GetDlgItem(hwndDlg, ID_COMBO_CATEGORY), buffer, 256);
+    if (!CategoryDictionary::IsValidName(Narrow(buffer))) {
+        MessageBox(hwndDlg, L"Please enter a category name without commas (up to 64 characters)!", L"Error", MB_OK | MB_ICONERROR);
+        return false;
+    }
+    category = buffer;
+    return true;
+}
+
+// Reads and validates the date field
+static bool ReadDialogDate(HWND hwndDlg, int32_t& day) {
+    wchar_t dateBuffer[256];
+    GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_DATE), dateBuffer, 256);
+    
+    if (!ParseDate(Narrow(dateBuffer), day)) {
+        MessageBox(hwndDlg, L"Please enter a valid date (DD/MM/YYYY)!", L"Invalid Date", MB_OK | MB_ICONERROR);
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::wstring> FinSyncApp::ExpenseCategories() const {
+    // The built-in list first, then names users added, in the order created
+    std::vector<std::wstring> names = defaultCategories;
+    for (size_t id = 0; id < transactions.CategoryCount(); ++id) {
+        std::wstring name = Widen(transactions.CategoryName(static_cast<uint16_t>(id)));
+        if (name != L"N/A" && std::find(names.begin(), names.end(), name) == names.end()) {
+            names.push_back(std::move(name));
+        }
+    }
+    return names;
+}
+
 std::wstring FinSyncApp::GetCurrentDate() {
     SYSTEMTIME st;
     GetLocalTime(&st);
@@ -101,23 +192,20 @@ LRESULT CALLBACK FinSyncApp::IncomeDialogProc(HWND hwndDlg, UINT msg, WPARAM wPa
         case WM_COMMAND:
             if (LOWORD(wParam) == IDOK || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDOK)) {
                 wchar_t buffer[256];
-                wchar_t dateBuffer[256];
+                int32_t day;
                 GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_AMOUNT), buffer, 256);
-                GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_DATE), dateBuffer, 256);
+                if (!ReadDialogDate(hwndDlg, day)) return 0;
                 
-                try {
-                    double amount = std::stod(buffer);
-                    if (amount > 0) {
-                        dialogData.amount = amount;
-                        dialogData.date = dateBuffer;
-                        dialogData.accepted = true;
-                        DestroyWindow(hwndDlg);
-                        return 0;
-                    } else {
-                        MessageBox(hwndDlg, L"Amount must be greater than 0!", L"Error", MB_OK | MB_ICONERROR);
-                    }
-                } catch (...) {
+                Money amount;
+                if (!Money::Parse(Narrow(buffer), amount)) {
                     MessageBox(hwndDlg, L"Please enter a valid number!", L"Error", MB_OK | MB_ICONERROR);
+                } else if (amount > Money()) {
+                    dialogData.amount = amount;
+                    dialogData.day = day;
+                    dialogData.accepted = true;
+                    DestroyWindow(hwndDlg);
+                } else {
+                    MessageBox(hwndDlg, L"Amount must be greater than 0!", L"Error", MB_OK | MB_ICONERROR);
                 }
                 return 0;
             } else if (LOWORD(wParam) == IDCANCEL || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDCANCEL)) {
@@ -142,29 +230,30 @@ LRESULT CALLBACK FinSyncApp::IncomeDialogProc(HWND hwndDlg, UINT msg, WPARAM wPa
 LRESULT CALLBACK FinSyncApp::ExpenseDialogProc(HWND hwndDlg, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
         case WM_COMMAND:
-            if (LOWORD(wParam) == IDOK || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDOK)) {
+            if ((LOWORD(wParam) == ID_EDIT_AMOUNT || LOWORD(wParam) == ID_EDIT_DATE) && HIWORD(wParam) == EN_CHANGE) {
+                instance->SuggestCategory(hwndDlg);
+                return 0;
+            } else if (LOWORD(wParam) == ID_COMBO_CATEGORY &&
+                       (HIWORD(wParam) == CBN_SELCHANGE || HIWORD(wParam) == CBN_EDITCHANGE)) {
+                dialogData.categoryChosen = true;
+                return 0;
+            } else if (LOWORD(wParam) == IDOK || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDOK)) {
                 wchar_t buffer[256];
-                wchar_t dateBuffer[256];
+                int32_t day;
                 GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_AMOUNT), buffer, 256);
-                GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_DATE), dateBuffer, 256);
-                
-                int catIdx = SendMessage(GetDlgItem(hwndDlg, ID_COMBO_CATEGORY), CB_GETCURSEL, 0, 0);
-                if (catIdx < 0) catIdx = 0;
-                dialogData.category = instance->categories[catIdx];
+                if (!ReadDialogDate(hwndDlg, day)) return 0;
+                if (!ReadDialogCategory(hwndDlg, dialogData.category)) return 0;
                 
-                try {
-                    double amount = std::stod(buffer);
-                    if (amount > 0) {
-                        dialogData.amount = amount;
-                        dialogData.date = dateBuffer;
-                        dialogData.accepted = true;
-                        DestroyWindow(hwndDlg);
-                        return 0;
-                    } else {
-                        MessageBox(hwndDlg, L"Amount must be greater than 0!", L"Error", MB_OK | MB_ICONERROR);
-                    }
-                } catch (...) {
+                Money amount;
+                if (!Money::Parse(Narrow(buffer), amount)) {
                     MessageBox(hwndDlg, L"Please enter a valid number!", L"Error", MB_OK | MB_ICONERROR);
+                } else if (amount > Money()) {
+                    dialogData.amount = amount;
+                    dialogData.day = day;
+                    dialogData.accepted = true;
+                    DestroyWindow(hwndDlg);
+                } else {
+                    MessageBox(hwndDlg, L"Amount must be greater than 0!", L"Error", MB_OK | MB_ICONERROR);
                 }
                 return 0;
             } else if (LOWORD(wParam) == IDCANCEL || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDCANCEL)) {
@@ -193,33 +282,31 @@ LRESULT CALLBACK FinSyncApp::EditDialogProc(HWND hwndDlg, UINT msg, WPARAM wPara
             return FALSE;
             
         case WM_COMMAND:
-            if (LOWORD(wParam) == IDOK || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDOK)) {
+            if ((LOWORD(wParam) == ID_EDIT_AMOUNT || LOWORD(wParam) == ID_EDIT_DATE) && HIWORD(wParam) == EN_CHANGE) {
+                instance->SuggestCategory(hwndDlg);
+                return 0;
+            } else if (LOWORD(wParam) == ID_COMBO_CATEGORY &&
+                       (HIWORD(wParam) == CBN_SELCHANGE || HIWORD(wParam) == CBN_EDITCHANGE)) {
+                dialogData.categoryChosen = true;
+                return 0;
+            } else if (LOWORD(wParam) == IDOK || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDOK)) {
                 wchar_t buffer[256];
-                wchar_t dateBuffer[256];
+                int32_t day;
                 GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_AMOUNT), buffer, 256);
-                GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_DATE), dateBuffer, 256);
-                
-                HWND hwndCombo = GetDlgItem(hwndDlg, ID_COMBO_CATEGORY);
-                if (hwndCombo != NULL) {
-                    int catIdx = ComboBox_GetCurSel(hwndCombo);
-                    if (catIdx >= 0) {
-                        dialogData.category = instance->categories[catIdx];
-                    }
-                }
+                if (!ReadDialogDate(hwndDlg, day)) return 0;
+                if (GetDlgItem(hwndDlg, ID_COMBO_CATEGORY) != NULL &&
+                    !ReadDialogCategory(hwndDlg, dialogData.category)) return 0;
                 
-                try {
-                    double amount = std::stod(buffer);
-                    if (amount > 0) {
-                        dialogData.amount = amount;
-                        dialogData.date = dateBuffer;
-                        dialogData.accepted = true;
-                        DestroyWindow(hwndDlg);
-                        return 0;
-                    } else {
-                        MessageBox(hwndDlg, L"Amount must be greater than 0!", L"Error", MB_OK | MB_ICONERROR);
-                    }
-                } catch (...) {
+                Money amount;
+                if (!Money::Parse(Narrow(buffer), amount)) {
                     MessageBox(hwndDlg, L"Please enter a valid amount!", L"Invalid Input", MB_OK | MB_ICONERROR);
+                } else if (amount > Money()) {
+                    dialogData.amount = amount;
+                    dialogData.day = day;
+                    dialogData.accepted = true;
+                    DestroyWindow(hwndDlg);
+                } else {
+                    MessageBox(hwndDlg, L"Amount must be greater than 0!", L"Error", MB_OK | MB_ICONERROR);
                 }
                 return 0;
             } else if (LOWORD(wParam) == IDCANCEL || (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDCANCEL)) {
@@ -284,32 +371,89 @@ void FinSyncApp::CreateMainWindow(HINSTANCE hInstance) {
     // Create buttons with better styling
     CreateWindow(L"BUTTON", L"➕ Add Income",
         WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-        30, 150, 170, 45, hwndMain, (HMENU)ID_BTN_ADD_INCOME, hInstance, nullptr);
+        30, 150, 140, 45, hwndMain, (HMENU)ID_BTN_ADD_INCOME, hInstance, nullptr);
     
     CreateWindow(L"BUTTON", L"➖ Add Expense",
         WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-        210, 150, 170, 45, hwndMain, (HMENU)ID_BTN_ADD_EXPENSE, hInstance, nullptr);
+        180, 150, 140, 45, hwndMain, (HMENU)ID_BTN_ADD_EXPENSE, hInstance, nullptr);
     
     CreateWindow(L"BUTTON", L"✏️ Edit",
         WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-        390, 150, 140, 45, hwndMain, (HMENU)ID_BTN_EDIT, hInstance, nullptr);
+        330, 150, 120, 45, hwndMain, (HMENU)ID_BTN_EDIT, hInstance, nullptr);
     
     CreateWindow(L"BUTTON", L"🗑️ Delete",
         WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-        540, 150, 140, 45, hwndMain, (HMENU)ID_BTN_DELETE, hInstance, nullptr);
+        460, 150, 120, 45, hwndMain, (HMENU)ID_BTN_DELETE, hInstance, nullptr);
+    
+    CreateWindow(L"BUTTON", L"📥 Import",
+        WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+        590, 150, 140, 45, hwndMain, (HMENU)ID_BTN_IMPORT, hInstance, nullptr);
     
     CreateWindow(L"BUTTON", L"📊 Report",
         WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-        690, 150, 170, 45, hwndMain, (HMENU)ID_BTN_REPORT, hInstance, nullptr);
+        740, 150, 140, 45, hwndMain, (HMENU)ID_BTN_REPORT, hInstance, nullptr);
     
     CreateWindow(L"BUTTON", L"💾 Save",
         WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
-        870, 150, 170, 45, hwndMain, (HMENU)ID_BTN_SAVE, hInstance, nullptr);
+        890, 150, 150, 45, hwndMain, (HMENU)ID_BTN_SAVE, hInstance, nullptr);
+    
+    // Filter bar: the table narrows as the fields are typed in
+    CreateWindow(L"STATIC", L"Search:",
+        WS_CHILD | WS_VISIBLE,
+        30, 219, 55, 22, hwndMain, nullptr, hInstance, nullptr);
+    
+    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", L"",
+        WS_CHILD | WS_VISIBLE | ES_AUTOHSCROLL,
+        85, 215, 190, 28, hwndMain, (HMENU)ID_FILTER_TEXT, hInstance, nullptr);
+    
+    HWND hwndType = CreateWindow(L"COMBOBOX", NULL,
+        WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_TABSTOP,
+        285, 215, 110, 200, hwndMain, (HMENU)ID_FILTER_TYPE, hInstance, nullptr);
+    SendMessage(hwndType, CB_ADDSTRING, 0, (LPARAM)L"All types");
+    SendMessage(hwndType, CB_ADDSTRING, 0, (LPARAM)L"Income");
+    SendMessage(hwndType, CB_ADDSTRING, 0, (LPARAM)L"Expense");
+    SendMessage(hwndType, CB_SETCURSEL, 0, 0);
+    
+    CreateWindow(L"STATIC", L"Min ₱",
+        WS_CHILD | WS_VISIBLE,
+        405, 219, 45, 22, hwndMain, nullptr, hInstance, nullptr);
+    
+    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", L"",
+        WS_CHILD | WS_VISIBLE | ES_AUTOHSCROLL,
+        450, 215, 95, 28, hwndMain, (HMENU)ID_FILTER_MIN, hInstance, nullptr);
+    
+    CreateWindow(L"STATIC", L"Max ₱",
+        WS_CHILD | WS_VISIBLE,
+        555, 219, 45, 22, hwndMain, nullptr, hInstance, nullptr);
+    
+    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", L"",
+        WS_CHILD | WS_VISIBLE | ES_AUTOHSCROLL,
+        600, 215, 95, 28, hwndMain, (HMENU)ID_FILTER_MAX, hInstance, nullptr);
+    
+    CreateWindow(L"STATIC", L"From",
+        WS_CHILD | WS_VISIBLE,
+        705, 219, 40, 22, hwndMain, nullptr, hInstance, nullptr);
+    
+    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", L"",
+        WS_CHILD | WS_VISIBLE | ES_AUTOHSCROLL,
+        745, 215, 100, 28, hwndMain, (HMENU)ID_FILTER_FROM, hInstance, nullptr);
+    
+    CreateWindow(L"STATIC", L"To",
+        WS_CHILD | WS_VISIBLE,
+        855, 219, 25, 22, hwndMain, nullptr, hInstance, nullptr);
+    
+    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", L"",
+        WS_CHILD | WS_VISIBLE | ES_AUTOHSCROLL,
+        880, 215, 100, 28, hwndMain, (HMENU)ID_FILTER_TO, hInstance, nullptr);
+    
+    CreateWindow(L"BUTTON", L"Clear",
+        WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+        990, 215, 70, 28, hwndMain, (HMENU)ID_BTN_CLEAR_FILTER, hInstance, nullptr);
     
     // Create ListView
     hwndListView = CreateWindow(WC_LISTVIEW, L"",
-        WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SINGLESEL | WS_BORDER,
-        30, 215, 1030, 450, hwndMain, (HMENU)ID_LISTVIEW, hInstance, nullptr);
+        WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_OWNERDATA | WS_BORDER,
+        30, 255, 1030, 410, hwndMain, (HMENU)ID_LISTVIEW, hInstance, nullptr);
     
     // Setup ListView columns
     LVCOLUMN lvc;
@@ -341,6 +485,11 @@ void FinSyncApp::CreateMainWindow(HINSTANCE hInstance) {
     lvc.cx = 180;
     ListView_InsertColumn(hwndListView, 4, &lvc);
     
+    lvc.iSubItem = 5;
+    lvc.pszText = (LPWSTR)L"Balance (₱)";
+    lvc.cx = 200;
+    ListView_InsertColumn(hwndListView, 5, &lvc);
+    
     ListView_SetExtendedListViewStyle(hwndListView, LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
     
     // Status bar
@@ -348,6 +497,13 @@ void FinSyncApp::CreateMainWindow(HINSTANCE hInstance) {
         WS_CHILD | WS_VISIBLE,
         30, 675, 1030, 25, hwndMain, nullptr, hInstance, nullptr);
     
+    // Save progress arrives on the writer thread; hand it to the UI thread
+    HWND hwnd = hwndMain;
+    ledger.SetSaveListener([hwnd](const SaveStatus& status) {
+        int percent = status.total > 0 ? (int)(status.written * 100 / status.total) : 100;
+        PostMessage(hwnd, WM_APP_SAVE_STATUS, (WPARAM)status.state, (LPARAM)percent);
+    });
+    
     LoadData();
     RefreshListView();
     UpdateSummary();
@@ -428,7 +584,7 @@ void FinSyncApp::AddIncome() {
     SetForegroundWindow(hwndMain);
     
     if (dialogData.accepted) {
-        transactions.emplace_back(L"Income", dialogData.amount, L"N/A", dialogData.date);
+        ledger.Add({ TransactionType::Income, dialogData.amount, ledger.InternCategory("N/A"), dialogData.day });
         RefreshListView();
         UpdateSummary();
         SetWindowText(hwndStatusBar, L"✓ Income added successfully!");
@@ -439,6 +595,7 @@ void FinSyncApp::AddIncome() {
 
 void FinSyncApp::AddExpense() {
     dialogData.accepted = false;
+    dialogData.categoryChosen = true;   // until the fields are filled in
     
     // Register dialog class
     WNDCLASSEX wc = {0};
@@ -470,10 +627,11 @@ void FinSyncApp::AddExpense() {
         25, 25, 400, 22, hwndDlg, NULL, NULL, NULL);
     
     HWND hwndCombo = CreateWindow(L"COMBOBOX", NULL,
-        WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_TABSTOP,
+        WS_CHILD | WS_VISIBLE | CBS_DROPDOWN | CBS_AUTOHSCROLL | WS_TABSTOP,
         25, 52, 400, 200, hwndDlg, (HMENU)ID_COMBO_CATEGORY, NULL, NULL);
     
-    for (const auto& cat : categories) {
+    // Typing a name that is not listed creates a new category
+    for (const auto& cat : ExpenseCategories()) {
         SendMessage(hwndCombo, CB_ADDSTRING, 0, (LPARAM)cat.c_str());
     }
     SendMessage(hwndCombo, CB_SETCURSEL, 0, 0);
@@ -504,6 +662,7 @@ void FinSyncApp::AddExpense() {
     
     SetFocus(GetDlgItem(hwndDlg, ID_EDIT_AMOUNT));
     EnableWindow(hwndMain, FALSE);
+    dialogData.categoryChosen = false;
     
     // Message loop
     MSG msg;
@@ -517,7 +676,8 @@ void FinSyncApp::AddExpense() {
     SetForegroundWindow(hwndMain);
     
     if (dialogData.accepted) {
-        transactions.emplace_back(L"Expense", dialogData.amount, dialogData.category, dialogData.date);
+        ledger.Add({ TransactionType::Expense, dialogData.amount,
+                     ledger.InternCategory(Narrow(dialogData.category)), dialogData.day });
         RefreshListView();
         UpdateSummary();
         SetWindowText(hwndStatusBar, L"✓ Expense added successfully!");
@@ -533,11 +693,15 @@ void FinSyncApp::EditTransaction() {
         return;
     }
     
-    Transaction& trans = transactions[selected];
+    // Rows are held by id; the selected position may move while the dialog is open
+    size_t slot = tableModel.SlotAt(selected);
+    uint64_t id = transactions.Id(slot);
+    TransactionStore::Row trans = transactions.Get(slot);
     dialogData.accepted = false;
     dialogData.amount = trans.amount;
-    dialogData.date = trans.date;
-    dialogData.category = trans.category;
+    dialogData.day = trans.day;
+    dialogData.category = Widen(transactions.CategoryName(trans.category));
+    dialogData.categoryChosen = true;   // until the fields are filled in
     
     // Register dialog class
     WNDCLASSEX wc = {0};
@@ -565,26 +729,27 @@ void FinSyncApp::EditTransaction() {
     );
     
     int yPos = 25;
-    std::wstring typeLabel = L"Type: " + trans.type;
+    std::wstring typeLabel = L"Type: " + Widen(TypeName(trans.type));
     CreateWindow(L"STATIC", typeLabel.c_str(),
         WS_CHILD | WS_VISIBLE,
         25, yPos, 400, 22, hwndDlg, NULL, NULL, NULL);
     yPos += 35;
     
     HWND hwndCombo = NULL;
-    if (trans.type == L"Expense") {
+    if (trans.type == TransactionType::Expense) {
         CreateWindow(L"STATIC", L"Category:",
             WS_CHILD | WS_VISIBLE,
             25, yPos, 400, 22, hwndDlg, NULL, NULL, NULL);
         yPos += 28;
         
         hwndCombo = CreateWindow(L"COMBOBOX", NULL,
-            WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_TABSTOP,
+            WS_CHILD | WS_VISIBLE | CBS_DROPDOWN | CBS_AUTOHSCROLL | WS_TABSTOP,
             25, yPos, 400, 200, hwndDlg, (HMENU)ID_COMBO_CATEGORY, NULL, NULL);
         
-        for (size_t i = 0; i < categories.size(); ++i) {
-            ComboBox_AddString(hwndCombo, categories[i].c_str());
-            if (categories[i] == trans.category) {
+        std::vector<std::wstring> names = ExpenseCategories();
+        for (size_t i = 0; i < names.size(); ++i) {
+            ComboBox_AddString(hwndCombo, names[i].c_str());
+            if (names[i] == dialogData.category) {
                 ComboBox_SetCurSel(hwndCombo, i);
             }
         }
@@ -596,9 +761,7 @@ void FinSyncApp::EditTransaction() {
         25, yPos, 400, 22, hwndDlg, NULL, NULL, NULL);
     yPos += 28;
     
-    wchar_t amountStr[50];
-    swprintf_s(amountStr, L"%.2f", trans.amount);
-    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", amountStr,
+    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", FormatMoney(trans.amount).c_str(),
         WS_CHILD | WS_VISIBLE | WS_TABSTOP | ES_AUTOHSCROLL,
         25, yPos, 400, 30, hwndDlg, (HMENU)ID_EDIT_AMOUNT, NULL, NULL);
     yPos += 45;
@@ -608,7 +771,7 @@ void FinSyncApp::EditTransaction() {
         25, yPos, 400, 22, hwndDlg, NULL, NULL, NULL);
     yPos += 28;
     
-    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", trans.date.c_str(),
+    CreateWindowEx(WS_EX_CLIENTEDGE, L"EDIT", FormatDay(trans.day).c_str(),
         WS_CHILD | WS_VISIBLE | WS_TABSTOP | ES_AUTOHSCROLL,
         25, yPos, 400, 30, hwndDlg, (HMENU)ID_EDIT_DATE, NULL, NULL);
     yPos += 50;
@@ -623,6 +786,7 @@ void FinSyncApp::EditTransaction() {
     
     SetFocus(GetDlgItem(hwndDlg, ID_EDIT_AMOUNT));
     EnableWindow(hwndMain, FALSE);
+    dialogData.categoryChosen = false;
     
     // Message loop
     MSG msg;
@@ -637,10 +801,12 @@ void FinSyncApp::EditTransaction() {
     
     if (dialogData.accepted) {
         trans.amount = dialogData.amount;
-        trans.date = dialogData.date;
-        if (trans.type == L"Expense") {
-            trans.category = dialogData.category;
+        trans.day = dialogData.day;
+        if (trans.type == TransactionType::Expense) {
+            trans.category = ledger.InternCategory(Narrow(dialogData.category));
         }
+        ledger.Update(id, trans);
+        if (transactions.FindId(id, slot)) tableModel.RowChanged(slot);
         RefreshListView();
         UpdateSummary();
         SetWindowText(hwndStatusBar, L"✓ Transaction updated successfully!");
@@ -650,151 +816,264 @@ void FinSyncApp::EditTransaction() {
 }
 
 void FinSyncApp::DeleteTransaction() {
-    int selected = ListView_GetNextItem(hwndListView, -1, LVNI_SELECTED);
-    if (selected < 0) {
+    std::vector<uint64_t> ids;
+    for (int selected = ListView_GetNextItem(hwndListView, -1, LVNI_SELECTED); selected >= 0;
+         selected = ListView_GetNextItem(hwndListView, selected, LVNI_SELECTED)) {
+        ids.push_back(transactions.Id(tableModel.SlotAt(selected)));
+    }
+    if (ids.empty()) {
         MessageBox(hwndMain, L"Please select a transaction to delete!", L"No Selection", MB_OK | MB_ICONINFORMATION);
         return;
     }
     
-    int result = MessageBox(hwndMain, L"Are you sure you want to delete this transaction?", 
-                           L"Confirm Delete", MB_YESNO | MB_ICONQUESTION);
+    std::wstring question = ids.size() == 1
+        ? L"Are you sure you want to delete this transaction?"
+        : L"Are you sure you want to delete these " + std::to_wstring(ids.size()) + L" transactions?";
+    int result = MessageBox(hwndMain, question.c_str(), L"Confirm Delete", MB_YESNO | MB_ICONQUESTION);
     
     if (result == IDYES) {
-        transactions.erase(transactions.begin() + selected);
+        size_t removed = ledger.Erase(ids);
+        ListView_SetItemState(hwndListView, -1, 0, LVIS_SELECTED);
         RefreshListView();
         UpdateSummary();
-        SetWindowText(hwndStatusBar, L"✓ Transaction deleted successfully!");
+        std::wstring status = removed == 1
+            ? L"✓ Transaction deleted successfully!"
+            : L"✓ " + std::to_wstring(removed) + L" transactions deleted successfully!";
+        SetWindowText(hwndStatusBar, status.c_str());
     }
 }
 
-void FinSyncApp::GenerateReport() {
-    double totalIncome = 0, totalExpense = 0;
-    std::vector<double> categoryTotals(categories.size(), 0);
-    
-    for (const auto& t : transactions) {
-        if (t.type == L"Income") {
-            totalIncome += t.amount;
-        } else {
-            totalExpense += t.amount;
-            auto it = std::find(categories.begin(), categories.end(), t.category);
-            if (it != categories.end()) {
-                categoryTotals[std::distance(categories.begin(), it)] += t.amount;
-            }
-        }
+void FinSyncApp::ImportStatementFile() {
+    wchar_t path[MAX_PATH] = L"";
+    OPENFILENAME ofn = {};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwndMain;
+    ofn.lpstrFilter = L"Bank statements (*.csv;*.ofx;*.qfx;*.qif)\0*.csv;*.ofx;*.qfx;*.qif\0All files (*.*)\0*.*\0";
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrTitle = L"Import Bank Statement";
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST | OFN_HIDEREADONLY;
+    if (!GetOpenFileName(&ofn)) return;
+    
+    // Columns come from the statement's header and dates in the format's
+    // usual order; the whole file goes in as one insert, then the table and
+    // totals refresh once
+    std::string file = Narrow(path);
+    LoadRules();
+    StatementOptions options;
+    if (!rules.Empty()) options.rules = &rules;
+    StatementStats stats;
+    size_t before = transactions.Size();
+    bool detected = DetectStatementFormat(file, options.format);
+    options.dates = UsualDateOrder(options.format);
+    if (!detected || !ImportStatement(ledger, file, options, stats)) {
+        std::wstring message = L"Could not import the statement:\n" + Widen(stats.error);
+        MessageBox(hwndMain, message.c_str(), L"Import", MB_OK | MB_ICONERROR);
+        return;
     }
+    RefreshListView();
+    UpdateSummary();
     
-    std::wstringstream report;
-    report << L"💰 FINANCIAL REPORT 💰\n\n";
-    report << L"═══════════════════════════════\n";
-    report << L"Total Income:    ₱" << std::fixed << std::setprecision(2) << totalIncome << L"\n";
-    report << L"Total Expenses:  ₱" << totalExpense << L"\n";
-    report << L"───────────────────────────────\n";
-    report << L"Net Savings:     ₱" << (totalIncome - totalExpense) << L"\n";
-    report << L"═══════════════════════════════\n\n";
-    
-    report << L"📊 EXPENSES BY CATEGORY:\n";
-    for (size_t i = 0; i < categories.size(); ++i) {
-        if (categoryTotals[i] > 0) {
-            double percentage = (totalExpense > 0) ? (categoryTotals[i] / totalExpense * 100) : 0;
-            report << L"\n" << categories[i] << L": ₱" << categoryTotals[i] 
-                   << L" (" << std::setprecision(1) << percentage << L"%)";
-        }
+    std::wstring status = L"✓ Imported " + std::to_wstring(transactions.Size() - before) + L" transactions";
+    if (stats.duplicates > 0) status += L", " + std::to_wstring(stats.duplicates) + L" already imported left out";
+    if (stats.skipped > 0) status += L" (" + std::to_wstring(stats.skipped) + L" rows without a valid date or amount skipped)";
+    SetWindowText(hwndStatusBar, status.c_str());
+}
+
+// Read again before each import, so edits to the rules file apply
+// without restarting; a file that does not compile keeps the rules in use
+void FinSyncApp::LoadRules() {
+    std::string error;
+    if (!CategoryRules::Load(RulesPath(ledger.SnapshotPath()), rules, error)) {
+        std::wstring message = L"The categorization rules were not loaded:\n" + Widen(error);
+        MessageBox(hwndMain, message.c_str(), L"Rules", MB_OK | MB_ICONWARNING);
     }
-    
-    MessageBox(hwndMain, report.str().c_str(), L"Financial Report", MB_OK | MB_ICONINFORMATION);
+}
+
+// Fills in the category of the first rule holding for the amount and date
+// typed so far. The ledger keeps no descriptions, so only rules on amount,
+// day and type can hold here.
+void FinSyncApp::SuggestCategory(HWND hwndDlg) {
+    HWND hwndCombo = GetDlgItem(hwndDlg, ID_COMBO_CATEGORY);
+    if (hwndCombo == NULL || dialogData.categoryChosen || rules.Empty()) return;
+    wchar_t buffer[256];
+    Money amount;
+    int32_t day;
+    GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_AMOUNT), buffer, 256);
+    if (!Money::Parse(Narrow(buffer), amount) || !(amount > Money())) return;
+    GetWindowText(GetDlgItem(hwndDlg, ID_EDIT_DATE), buffer, 256);
+    if (!ParseDate(Narrow(buffer), day)) return;
+    size_t rule = rules.Match("", TransactionType::Expense, amount.Minor(), day, ruleScratch);
+    if (rule != CategoryRules::noRule) SetWindowText(hwndCombo, Widen(rules.Category(rule)).c_str());
+}
+
+void FinSyncApp::GenerateReport() {
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    std::wstring report = Widen(FormatReport(transactions, st.wYear, st.wMonth));
+    MessageBox(hwndMain, report.c_str(), L"Financial Report", MB_OK | MB_ICONINFORMATION);
 }
 
 void FinSyncApp::RefreshListView() {
-    ListView_DeleteAllItems(hwndListView);
-    
-    LVITEM lvi = {0};
-    lvi.mask = LVIF_TEXT;
-    
-    for (size_t i = 0; i < transactions.size(); ++i) {
-        wchar_t index[10];
-        swprintf_s(index, L"%d", i + 1);
-        
-        lvi.iItem = i;
-        lvi.iSubItem = 0;
-        lvi.pszText = index;
-        ListView_InsertItem(hwndListView, &lvi);
-        
-        ListView_SetItemText(hwndListView, i, 1, (LPWSTR)transactions[i].type.c_str());
-        
-        wchar_t amount[50];
-        swprintf_s(amount, L"%.2f", transactions[i].amount);
-        ListView_SetItemText(hwndListView, i, 2, amount);
-        
-        std::wstring category = transactions[i].category.empty() ? L"N/A" : transactions[i].category;
-        ListView_SetItemText(hwndListView, i, 3, (LPWSTR)category.c_str());
-        ListView_SetItemText(hwndListView, i, 4, (LPWSTR)transactions[i].date.c_str());
-    }
+    // The list view is virtual: it only needs the row count, and asks for
+    // the text of visible rows through LVN_GETDISPINFO
+    tableModel.Invalidate();
+    ListView_SetItemCountEx(hwndListView, tableModel.RowCount(), LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL);
+    InvalidateRect(hwndListView, nullptr, FALSE);
     
     wchar_t statusText[256];
-    swprintf_s(statusText, L"Ready | Transactions: %d", transactions.size());
+    if (tableModel.Filtered()) {
+        swprintf_s(statusText, L"Ready | Showing %zu of %zu transactions", tableModel.RowCount(), transactions.Size());
+    } else {
+        swprintf_s(statusText, L"Ready | Transactions: %zu", transactions.Size());
+    }
     SetWindowText(hwndStatusBar, statusText);
 }
 
-void FinSyncApp::UpdateSummary() {
-    double totalIncome = 0, totalExpense = 0;
+void FinSyncApp::ApplyFilter() {
+    if (clearingFilter) return;
+    
+    // Fields that do not parse yet (a half-typed amount or date) are left
+    // out rather than reported, so the table follows the typing
+    SearchQuery query;
+    FilterProgram expression;
+    std::string error;
+    wchar_t buffer[256];
+    GetWindowText(GetDlgItem(hwndMain, ID_FILTER_TEXT), buffer, 256);
+    std::string text = Narrow(buffer);
+    if (text.find_first_of("=<>!(") != std::string::npos) {
+        // An expression such as "category in (Food,Rent) and amount>1000";
+        // until it compiles the rows are not narrowed by it
+        FilterProgram::Compile(text, expression, error);
+    } else {
+        query.text = text;
+    }
+    
+    LRESULT type = SendMessage(GetDlgItem(hwndMain, ID_FILTER_TYPE), CB_GETCURSEL, 0, 0);
+    if (type == 1 || type == 2) {
+        query.byType = true;
+        query.type = type == 1 ? TransactionType::Income : TransactionType::Expense;
+    }
     
-    for (const auto& t : transactions) {
-        if (t.type == L"Income") {
-            totalIncome += t.amount;
-        } else {
-            totalExpense += t.amount;
+    Money amount;
+    GetWindowText(GetDlgItem(hwndMain, ID_FILTER_MIN), buffer, 256);
+    if (Money::Parse(Narrow(buffer), amount)) {
+        query.byAmount = true;
+        query.minAmount = amount.Minor();
+    }
+    GetWindowText(GetDlgItem(hwndMain, ID_FILTER_MAX), buffer, 256);
+    if (Money::Parse(Narrow(buffer), amount)) {
+        query.byAmount = true;
+        query.maxAmount = amount.Minor();
+    }
+    
+    // Rows without a date never match a date range
+    int32_t day;
+    GetWindowText(GetDlgItem(hwndMain, ID_FILTER_FROM), buffer, 256);
+    if (ParseDate(Narrow(buffer), day)) {
+        query.byDate = true;
+        query.firstDay = day;
+    }
+    GetWindowText(GetDlgItem(hwndMain, ID_FILTER_TO), buffer, 256);
+    if (ParseDate(Narrow(buffer), day)) {
+        query.byDate = true;
+        query.lastDay = day;
+    }
+    if (query.byDate && query.firstDay == kNoDate) query.firstDay = kNoDate + 1;
+    
+    tableModel.SetFilter(query, expression);
+    
+    // Positions changed, so the old selection would point at other rows
+    ListView_SetItemState(hwndListView, -1, 0, LVIS_SELECTED);
+    RefreshListView();
+    if (!error.empty()) SetWindowText(hwndStatusBar, (L"Filter: " + Widen(error)).c_str());
+}
+
+void FinSyncApp::ClearFilter() {
+    // Emptying each field would refilter once per field
+    clearingFilter = true;
+    for (int id : { ID_FILTER_TEXT, ID_FILTER_MIN, ID_FILTER_MAX, ID_FILTER_FROM, ID_FILTER_TO }) {
+        SetWindowText(GetDlgItem(hwndMain, id), L"");
+    }
+    SendMessage(GetDlgItem(hwndMain, ID_FILTER_TYPE), CB_SETCURSEL, 0, 0);
+    clearingFilter = false;
+    ApplyFilter();
+}
+
+void FinSyncApp::SortByColumn(int column) {
+    // Clicking the sorted column again flips the direction; "#" restores
+    // insertion order
+    TableColumn clicked = static_cast<TableColumn>(column);
+    bool descending = clicked == tableModel.SortColumn() && !tableModel.SortDescending();
+    tableModel.SortBy(clicked, descending);
+    
+    HWND hwndHeader = ListView_GetHeader(hwndListView);
+    for (int i = 0; i < static_cast<int>(TableColumn::Count); ++i) {
+        HDITEM item = {0};
+        item.mask = HDI_FORMAT;
+        Header_GetItem(hwndHeader, i, &item);
+        item.fmt &= ~(HDF_SORTUP | HDF_SORTDOWN);
+        if (i == static_cast<int>(tableModel.SortColumn()) && tableModel.SortColumn() != TableColumn::Index) {
+            item.fmt |= descending ? HDF_SORTDOWN : HDF_SORTUP;
         }
+        Header_SetItem(hwndHeader, i, &item);
     }
     
-    wchar_t buffer[256];
-    swprintf_s(buffer, L"Total Income: ₱%.2f", totalIncome);
-    SetWindowText(hwndIncomeLabel, buffer);
+    // Positions changed, so the old selection would point at other rows
+    ListView_SetItemState(hwndListView, -1, 0, LVIS_SELECTED);
+    RefreshListView();
+}
+
+void FinSyncApp::UpdateSummary() {
+    // Totals are maintained by the store on every change
+    const LedgerTotals& totals = transactions.Totals();
     
-    swprintf_s(buffer, L"Total Expenses: ₱%.2f", totalExpense);
-    SetWindowText(hwndExpenseLabel, buffer);
+    std::wstring text = L"Total Income: ₱" + FormatMoney(totals.Income());
+    SetWindowText(hwndIncomeLabel, text.c_str());
     
-    swprintf_s(buffer, L"Net Savings: ₱%.2f", totalIncome - totalExpense);
-    SetWindowText(hwndSavingsLabel, buffer);
+    text = L"Total Expenses: ₱" + FormatMoney(totals.Expense());
+    SetWindowText(hwndExpenseLabel, text.c_str());
+    
+    text = L"Net Savings: ₱" + FormatMoney(totals.Net());
+    SetWindowText(hwndSavingsLabel, text.c_str());
 }
 
 void FinSyncApp::SaveData() {
-    std::wofstream file(L"transactions.txt");
-    if (!file.is_open()) {
+    // Saving installs finished row compaction, which moves every slot
+    uint64_t layout = transactions.Layout();
+    bool saved = ledger.Save();
+    if (transactions.Layout() != layout) RefreshListView();
+    if (!saved) {
         MessageBox(hwndMain, L"Failed to save data!", L"Error", MB_OK | MB_ICONERROR);
         return;
     }
-    
-    for (const auto& t : transactions) {
-        file << t.type << L"," << t.amount << L"," 
-             << t.category << L"," << t.date << L"\n";
+    // The snapshot is written in the background; OnSaveStatus reports on it
+    SetWindowText(hwndStatusBar, ledger.IsSaving() ? L"Saving..." : L"✓ Data saved successfully!");
+}
+
+void FinSyncApp::OnSaveStatus(SaveStatus::State state, int percent) {
+    if (state == SaveStatus::State::Saving) {
+        wchar_t statusText[64];
+        swprintf_s(statusText, L"Saving... %d%%", percent);
+        SetWindowText(hwndStatusBar, statusText);
+        return;
     }
     
-    file.close();
-    SetWindowText(hwndStatusBar, L"✓ Data saved successfully!");
+    if (state == SaveStatus::State::Saved) {
+        SetWindowText(hwndStatusBar, L"✓ Data saved successfully!");
+    } else {
+        SetWindowText(hwndStatusBar, L"✗ Save failed; changes are kept in the journal");
+    }
+    ledger.StartQueuedSave();
 }
 
 void FinSyncApp::LoadData() {
-    std::wifstream file(L"transactions.txt");
-    if (!file.is_open()) return;
-    
-    transactions.clear();
-    std::wstring line;
-    
-    while (std::getline(file, line)) {
-        std::wstringstream ss(line);
-        std::wstring type, category, date;
-        double amount;
-        
-        std::getline(ss, type, L',');
-        ss >> amount;
-        ss.ignore();
-        std::getline(ss, category, L',');
-        std::getline(ss, date);
-        
-        transactions.emplace_back(type, amount, category, date);
+    LedgerLoadResult result = ledger.Load("transactions.txt");
+    if (result.damaged) {
+        MessageBox(hwndMain, L"The data file is damaged and was renamed to transactions.fsnap.bad.\n"
+                             L"Loading transactions.txt instead.", L"Error", MB_OK | MB_ICONERROR);
     }
-    
-    file.close();
+    LoadRules();
 }
 
 LRESULT CALLBACK FinSyncApp::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
@@ -813,15 +1092,52 @@ LRESULT CALLBACK FinSyncApp::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPA
                 case ID_BTN_DELETE:
                     instance->DeleteTransaction();
                     break;
+                case ID_BTN_IMPORT:
+                    instance->ImportStatementFile();
+                    break;
                 case ID_BTN_REPORT:
                     instance->GenerateReport();
                     break;
                 case ID_BTN_SAVE:
                     instance->SaveData();
                     break;
+                case ID_FILTER_TEXT:
+                case ID_FILTER_MIN:
+                case ID_FILTER_MAX:
+                case ID_FILTER_FROM:
+                case ID_FILTER_TO:
+                    if (HIWORD(wParam) == EN_CHANGE) instance->ApplyFilter();
+                    break;
+                case ID_FILTER_TYPE:
+                    if (HIWORD(wParam) == CBN_SELCHANGE) instance->ApplyFilter();
+                    break;
+                case ID_BTN_CLEAR_FILTER:
+                    instance->ClearFilter();
+                    break;
             }
             return 0;
             
+        case WM_NOTIFY: {
+            NMHDR* header = (NMHDR*)lParam;
+            if (header->idFrom != ID_LISTVIEW) break;
+            
+            if (header->code == LVN_GETDISPINFO) {
+                LVITEM& item = ((NMLVDISPINFO*)lParam)->item;
+                if (item.mask & LVIF_TEXT) {
+                    instance->tableModel.CellText(item.iItem, item.iSubItem, item.pszText, item.cchTextMax);
+                }
+                return 0;
+            } else if (header->code == LVN_ODCACHEHINT) {
+                NMLVCACHEHINT* hint = (NMLVCACHEHINT*)lParam;
+                instance->tableModel.CacheHint(hint->iFrom, hint->iTo);
+                return 0;
+            } else if (header->code == LVN_COLUMNCLICK) {
+                instance->SortByColumn(((NMLISTVIEW*)lParam)->iSubItem);
+                return 0;
+            }
+            break;
+        }
+            
         case WM_CTLCOLORSTATIC: {
             HDC hdcStatic = (HDC)wParam;
             HWND hwndStatic = (HWND)lParam;
@@ -842,8 +1158,14 @@ LRESULT CALLBACK FinSyncApp::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPA
             break;
         }
         
+        case WM_APP_SAVE_STATUS:
+            instance->OnSaveStatus((SaveStatus::State)wParam, (int)lParam);
+            return 0;
+            
         case WM_DESTROY:
-            instance->SaveData();
+            // Waits for the snapshot being written, if any
+            SetWindowText(instance->hwndStatusBar, L"Saving...");
+            instance->ledger.Close();
             PostQuitMessage(0);
             return 0;
             
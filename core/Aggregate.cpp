@@ -0,0 +1,218 @@
+#include "Aggregate.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FINSYNC_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FINSYNC_TARGET_AVX2
+#else
+#define FINSYNC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Everything is one histogram over slot = type * categoryCount + category.
+// Consecutive rows in the same slot would chain through one memory
+// location, so rows are spread over this many copies that are merged at the
+// end.
+static constexpr size_t histogramCopies = 4;
+
+// The totals and the histogram take the rows a block at a time, so the
+// histogram pass finds the block's types and amounts still in cache
+static constexpr size_t blockRows = 2048;
+
+namespace {
+
+struct Histogram {
+    explicit Histogram(size_t categoryCount)
+        : categoryCount(categoryCount), slots(categoryCount * 2), sums(slots * histogramCopies, 0) {}
+
+    void AddBlock(const uint8_t* types, const uint16_t* categories, const int64_t* amounts, size_t count) {
+        int64_t* h0 = sums.data();
+        int64_t* h1 = h0 + slots;
+        int64_t* h2 = h1 + slots;
+        int64_t* h3 = h2 + slots;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            h0[types[i] * categoryCount + categories[i]] += amounts[i];
+            h1[types[i + 1] * categoryCount + categories[i + 1]] += amounts[i + 1];
+            h2[types[i + 2] * categoryCount + categories[i + 2]] += amounts[i + 2];
+            h3[types[i + 3] * categoryCount + categories[i + 3]] += amounts[i + 3];
+        }
+        for (; i < count; ++i) h0[types[i] * categoryCount + categories[i]] += amounts[i];
+    }
+
+    void MergeInto(std::vector<int64_t>& out) const {
+        out.assign(slots, 0);
+        for (size_t copy = 0; copy < histogramCopies; ++copy) {
+            const int64_t* from = sums.data() + copy * slots;
+            for (size_t slot = 0; slot < slots; ++slot) out[slot] += from[slot];
+        }
+    }
+
+    size_t categoryCount;
+    size_t slots;
+    std::vector<int64_t> sums;
+};
+
+}
+
+// Each kernel adds the block's amounts to total and the expense rows'
+// amounts to expense; income is the difference. An expense row's type is 1,
+// so 0 - type is the all-ones mask that keeps its amount.
+
+static void TotalsScalar(const uint8_t* types, const int64_t* amounts, size_t count,
+                         uint64_t& total, uint64_t& expense) {
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t amount = static_cast<uint64_t>(amounts[i]);
+        total += amount;
+        expense += amount & (0 - static_cast<uint64_t>(types[i]));
+    }
+}
+
+#ifdef FINSYNC_X86
+
+static uint64_t SumLanes(__m128i v) {
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+    return lanes[0] + lanes[1];
+}
+
+static void TotalsSse2(const uint8_t* types, const int64_t* amounts, size_t count,
+                       uint64_t& total, uint64_t& expense) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i totals = zero;
+    __m128i expenses = zero;
+
+    // 8 rows: their type bytes widen to four pairs of 64-bit lanes
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i t16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(types + i)), zero);
+        __m128i t32[2] = { _mm_unpacklo_epi16(t16, zero), _mm_unpackhi_epi16(t16, zero) };
+        for (int half = 0; half < 2; ++half) {
+            __m128i t64[2] = { _mm_unpacklo_epi32(t32[half], zero), _mm_unpackhi_epi32(t32[half], zero) };
+            for (int pair = 0; pair < 2; ++pair) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(amounts + i + half * 4 + pair * 2));
+                totals = _mm_add_epi64(totals, a);
+                expenses = _mm_add_epi64(expenses, _mm_and_si128(_mm_sub_epi64(zero, t64[pair]), a));
+            }
+        }
+    }
+    total += SumLanes(totals);
+    expense += SumLanes(expenses);
+    TotalsScalar(types + i, amounts + i, count - i, total, expense);
+}
+
+FINSYNC_TARGET_AVX2
+static void TotalsAvx2(const uint8_t* types, const int64_t* amounts, size_t count,
+                       uint64_t& total, uint64_t& expense) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i totals[2] = { zero, zero };
+    __m256i expenses[2] = { zero, zero };
+
+    // 16 rows: four groups of 4 type bytes widen to 64-bit lanes; two
+    // accumulators keep consecutive adds independent
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(types + i));
+        __m256i t64[4] = {
+            _mm256_cvtepu8_epi64(t),
+            _mm256_cvtepu8_epi64(_mm_srli_si128(t, 4)),
+            _mm256_cvtepu8_epi64(_mm_srli_si128(t, 8)),
+            _mm256_cvtepu8_epi64(_mm_srli_si128(t, 12)),
+        };
+        for (int group = 0; group < 4; ++group) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(amounts + i + group * 4));
+            totals[group & 1] = _mm256_add_epi64(totals[group & 1], a);
+            expenses[group & 1] = _mm256_add_epi64(expenses[group & 1],
+                                                   _mm256_and_si256(_mm256_sub_epi64(zero, t64[group]), a));
+        }
+    }
+    __m256i sumTotals = _mm256_add_epi64(totals[0], totals[1]);
+    __m256i sumExpenses = _mm256_add_epi64(expenses[0], expenses[1]);
+    total += SumLanes(_mm_add_epi64(_mm256_castsi256_si128(sumTotals), _mm256_extracti128_si256(sumTotals, 1)));
+    expense += SumLanes(_mm_add_epi64(_mm256_castsi256_si128(sumExpenses), _mm256_extracti128_si256(sumExpenses, 1)));
+    TotalsScalar(types + i, amounts + i, count - i, total, expense);
+}
+
+static bool CpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+    if (!osxsave || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+AggregateKernel DetectAggregateKernel() {
+#ifdef FINSYNC_X86
+    static const AggregateKernel best = CpuHasAvx2() ? AggregateKernel::Avx2 : AggregateKernel::Sse2;
+    return best;
+#else
+    return AggregateKernel::Scalar;
+#endif
+}
+
+const char* AggregateKernelName(AggregateKernel kernel) {
+    switch (kernel) {
+        case AggregateKernel::Avx2: return "avx2";
+        case AggregateKernel::Sse2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+using TotalsKernel = void (*)(const uint8_t*, const int64_t*, size_t, uint64_t&, uint64_t&);
+
+static TotalsKernel PickTotals(AggregateKernel kernel) {
+#ifdef FINSYNC_X86
+    AggregateKernel best = DetectAggregateKernel();
+    if (kernel == AggregateKernel::Avx2 && best != AggregateKernel::Avx2) kernel = best;
+    if (kernel == AggregateKernel::Avx2) return TotalsAvx2;
+    if (kernel == AggregateKernel::Sse2) return TotalsSse2;
+#else
+    (void)kernel;
+#endif
+    return TotalsScalar;
+}
+
+// The sums wrap like the unsigned adds they are; a ledger's totals stay far
+// inside int64, so the results are exact
+void SumIncomeExpense(AggregateKernel kernel, size_t rows, const uint8_t* types, const int64_t* amounts,
+                      int64_t& income, int64_t& expense) {
+    uint64_t total = 0, expenses = 0;
+    PickTotals(kernel)(types, amounts, rows, total, expenses);
+    income = static_cast<int64_t>(total - expenses);
+    expense = static_cast<int64_t>(expenses);
+}
+
+void SumIncomeExpense(size_t rows, const uint8_t* types, const int64_t* amounts, int64_t& income, int64_t& expense) {
+    SumIncomeExpense(DetectAggregateKernel(), rows, types, amounts, income, expense);
+}
+
+void AggregateColumns(size_t rows, const uint8_t* types, const uint16_t* categories,
+                      const int64_t* amounts, size_t categoryCount, ColumnSums& out) {
+    AggregateColumns(DetectAggregateKernel(), rows, types, categories, amounts, categoryCount, out);
+}
+
+void AggregateColumns(AggregateKernel kernel, size_t rows, const uint8_t* types, const uint16_t* categories,
+                      const int64_t* amounts, size_t categoryCount, ColumnSums& out) {
+    TotalsKernel totals = PickTotals(kernel);
+    Histogram histogram(categoryCount);
+    uint64_t total = 0, expenses = 0;
+    for (size_t begin = 0; begin < rows; begin += blockRows) {
+        size_t count = rows - begin < blockRows ? rows - begin : blockRows;
+        totals(types + begin, amounts + begin, count, total, expenses);
+        histogram.AddBlock(types + begin, categories + begin, amounts + begin, count);
+    }
+    histogram.MergeInto(out.byCategory);
+    out.income = static_cast<int64_t>(total - expenses);
+    out.expense = static_cast<int64_t>(expenses);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// One-pass aggregation over the store's columns: income and expense totals
+// and every per-type, per-category sum. The income and expense totals are
+// masked 64-bit sums, which the SIMD kernels take 2 (SSE2) or 4 (AVX2) rows
+// per instruction. The per-category sums are a histogram of scattered adds,
+// which SSE2 and AVX2 cannot do without lanes colliding in one slot, so
+// that pass is scalar under every kernel. x86 builds pick the kernel at run
+// time; everything else uses the scalar one. All kernels do the same 64-bit
+// integer adds, so their results match exactly.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class AggregateKernel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+struct ColumnSums {
+    int64_t income = 0;
+    int64_t expense = 0;
+
+    // [type * categoryCount + category], types as in TransactionType
+    std::vector<int64_t> byCategory;
+};
+
+// Category ids must be below categoryCount and types 0 or 1
+void AggregateColumns(size_t rows, const uint8_t* types, const uint16_t* categories,
+                      const int64_t* amounts, size_t categoryCount, ColumnSums& out);
+
+// Same, with a given kernel; one the CPU lacks falls back to the best it has
+void AggregateColumns(AggregateKernel kernel, size_t rows, const uint8_t* types, const uint16_t* categories,
+                      const int64_t* amounts, size_t categoryCount, ColumnSums& out);
+
+// The income and expense totals alone, without the per-category pass;
+// types must be 0 or 1
+void SumIncomeExpense(size_t rows, const uint8_t* types, const int64_t* amounts, int64_t& income, int64_t& expense);
+void SumIncomeExpense(AggregateKernel kernel, size_t rows, const uint8_t* types, const int64_t* amounts,
+                      int64_t& income, int64_t& expense);
+
+// Best kernel this CPU supports
+AggregateKernel DetectAggregateKernel();
+const char* AggregateKernelName(AggregateKernel kernel);
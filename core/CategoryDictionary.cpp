@@ -0,0 +1,50 @@
+#include "CategoryDictionary.h"
+
+bool CategoryDictionary::IsValidName(std::string_view name) {
+    if (name.empty() || name.size() > maxNameLength) return false;
+    for (char c : name) {
+        if (c == ',' || c == '\r' || c == '\n') return false;
+    }
+    return true;
+}
+
+CategoryDictionary::CategoryDictionary(const CategoryDictionary& other) {
+    *this = other;
+}
+
+CategoryDictionary& CategoryDictionary::operator=(const CategoryDictionary& other) {
+    if (this != &other) {
+        Clear();
+        for (const auto& name : other.names) Intern(name);
+    }
+    return *this;
+}
+
+void CategoryDictionary::Clear() {
+    lookup.clear();
+    names.clear();
+}
+
+uint16_t CategoryDictionary::Intern(std::string_view name) {
+    uint16_t id;
+    if (Find(name, id)) return id;
+    if (names.size() >= maxCategories) return UINT16_MAX;
+
+    id = static_cast<uint16_t>(names.size());
+    names.emplace_back(name);
+    lookup.emplace(names.back(), id);
+    return id;
+}
+
+bool CategoryDictionary::Find(std::string_view name, uint16_t& id) const {
+    auto it = lookup.find(name);
+    if (it == lookup.end()) return false;
+    id = it->second;
+    return true;
+}
+
+size_t CategoryDictionary::MemoryUsage() const {
+    size_t bytes = lookup.size() * (sizeof(std::string_view) + sizeof(uint16_t) + 2 * sizeof(void*));
+    for (const auto& name : names) bytes += sizeof(std::string) + name.capacity();
+    return bytes;
+}
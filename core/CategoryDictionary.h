@@ -0,0 +1,46 @@
+#pragma once
+
+// Category names interned to 16-bit ids. Rows and totals only ever carry the
+// id; the name is looked up when it is shown or written out. Names live in a
+// deque so the string_view keys of the lookup table stay valid as it grows,
+// and lookups do not allocate.
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class CategoryDictionary {
+public:
+    // Ids are 16-bit; past that everything shares the last slot
+    static constexpr size_t maxCategories = size_t(UINT16_MAX) + 1;
+
+    // Non-empty, at most maxNameLength bytes, and free of the ledger's
+    // field and line separators
+    static constexpr size_t maxNameLength = 64;
+    static bool IsValidName(std::string_view name);
+
+    CategoryDictionary() = default;
+
+    // Copies rebuild the lookup table over their own names; moves keep the
+    // deque's elements in place
+    CategoryDictionary(const CategoryDictionary& other);
+    CategoryDictionary& operator=(const CategoryDictionary& other);
+    CategoryDictionary(CategoryDictionary&&) = default;
+    CategoryDictionary& operator=(CategoryDictionary&&) = default;
+
+    void Clear();
+
+    uint16_t Intern(std::string_view name);
+    bool Find(std::string_view name, uint16_t& id) const;
+
+    std::string_view Name(uint16_t id) const { return names[id]; }
+    size_t Size() const { return names.size(); }
+
+    size_t MemoryUsage() const;
+
+private:
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, uint16_t> lookup;
+};
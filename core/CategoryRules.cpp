@@ -0,0 +1,453 @@
+#include "CategoryRules.h"
+
+#include "CategoryDictionary.h"
+#include "Date.h"
+#include "Money.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+static std::string Upper(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+    }
+    return out;
+}
+
+static std::string Lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return out;
+}
+
+static std::string_view Trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+enum class RuleOp : uint8_t { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+template <typename T>
+static bool Compare(RuleOp op, T a, T b) {
+    switch (op) {
+        case RuleOp::Equal: return a == b;
+        case RuleOp::NotEqual: return a != b;
+        case RuleOp::Less: return a < b;
+        case RuleOp::LessEqual: return a <= b;
+        case RuleOp::Greater: return a > b;
+        case RuleOp::GreaterEqual: return a >= b;
+    }
+    return false;
+}
+
+// One line: conditions joined by and, ->, the category
+class RuleParser {
+public:
+    RuleParser(std::string_view text, CategoryRules::Rule& rule) : text(text), rule(rule) {}
+
+    bool Parse(std::string& error) {
+        Next();
+        if (!ParseCondition()) {
+            error = message;
+            return false;
+        }
+        while (IsKeyword("and")) {
+            Next();
+            if (!ParseCondition()) {
+                error = message;
+                return false;
+            }
+        }
+
+        if (token.kind != Kind::Arrow) {
+            error = Unexpected("and or ->");
+            return false;
+        }
+        std::string_view category = Trim(text.substr(at));
+        if (category.size() >= 2 && (category.front() == '"' || category.front() == '\'') &&
+            category.back() == category.front()) {
+            category = category.substr(1, category.size() - 2);
+        }
+        if (!CategoryDictionary::IsValidName(category)) {
+            error = "expected a category after -> at " + std::to_string(token.column) +
+                    " (up to 64 characters, without commas)";
+            return false;
+        }
+        rule.category = std::string(category);
+        return true;
+    }
+
+private:
+    enum class Kind { Word, Quoted, Operator, Arrow, End, Bad };
+
+    struct Token {
+        Kind kind = Kind::End;
+        std::string_view text;
+        RuleOp op = RuleOp::Equal;
+        size_t column = 0;
+    };
+
+    bool IsArrow(size_t i) const { return i + 1 < text.size() && text[i] == '-' && text[i + 1] == '>'; }
+
+    bool IsWordChar(size_t i) const {
+        char c = text[i];
+        return c != ' ' && c != '\t' && c != '=' && c != '!' && c != '<' && c != '>' && c != '"' && c != '\'' &&
+               !IsArrow(i);
+    }
+
+    void Next() {
+        while (at < text.size() && (text[at] == ' ' || text[at] == '\t')) ++at;
+        token = Token();
+        token.column = at + 1;
+        if (at >= text.size()) return;
+
+        size_t start = at;
+        char c = text[at];
+        if (IsArrow(at)) {
+            token.kind = Kind::Arrow;
+            at += 2;
+            token.text = text.substr(start, 2);
+        } else if (c == '"' || c == '\'') {
+            size_t end = text.find(c, at + 1);
+            if (end == std::string_view::npos) {
+                token.kind = Kind::Bad;
+                token.text = text.substr(at);
+                at = text.size();
+            } else {
+                token.kind = Kind::Quoted;
+                token.text = text.substr(at + 1, end - at - 1);
+                at = end + 1;
+            }
+        } else if (c == '=' || c == '!' || c == '<' || c == '>') {
+            bool equals = at + 1 < text.size() && text[at + 1] == '=';
+            token.kind = Kind::Operator;
+            switch (c) {
+                case '=': token.op = RuleOp::Equal; break;
+                case '!': token.op = RuleOp::NotEqual; break;
+                case '<': token.op = equals ? RuleOp::LessEqual : RuleOp::Less; break;
+                case '>': token.op = equals ? RuleOp::GreaterEqual : RuleOp::Greater; break;
+            }
+            if (c == '!' && !equals) token.kind = Kind::Bad;
+            at += equals ? 2 : 1;
+            token.text = text.substr(start, at - start);
+        } else {
+            while (at < text.size() && IsWordChar(at)) ++at;
+            token.kind = Kind::Word;
+            token.text = text.substr(start, at - start);
+        }
+    }
+
+    bool IsKeyword(const char* keyword) const {
+        return token.kind == Kind::Word && Lower(token.text) == keyword;
+    }
+
+    std::string Unexpected(const char* expected) const {
+        std::string found = token.kind == Kind::End ? "the end" : "'" + std::string(token.text) + "'";
+        return "expected " + std::string(expected) + " at " + std::to_string(token.column) + ", found " + found;
+    }
+
+    bool Fail(std::string text) {
+        message = std::move(text);
+        return false;
+    }
+
+    std::string Where() const { return "'" + std::string(token.text) + "' at " + std::to_string(token.column); }
+
+    bool ParseCondition() {
+        if (token.kind != Kind::Word) return Fail(Unexpected("a condition (description, amount, day or type)"));
+        std::string field = Lower(token.text);
+        if (field != "description" && field != "amount" && field != "day" && field != "type") {
+            return Fail("unknown field " + Where() + " (description, amount, day or type)");
+        }
+        Next();
+
+        if (field == "description") {
+            if (!IsKeyword("contains")) return Fail(Unexpected("contains"));
+            Next();
+            if (token.kind != Kind::Word && token.kind != Kind::Quoted) return Fail(Unexpected("a text"));
+            if (token.text.empty()) return Fail("empty text at " + std::to_string(token.column));
+            rule.texts.push_back(Upper(token.text));
+            Next();
+            return true;
+        }
+
+        if (token.kind != Kind::Operator) return Fail(Unexpected("=, !=, <, <=, > or >="));
+        RuleOp op = token.op;
+        size_t opColumn = token.column;
+        Next();
+        if (token.kind != Kind::Word && token.kind != Kind::Quoted) return Fail(Unexpected("a value"));
+
+        if (field == "type") {
+            if (op != RuleOp::Equal && op != RuleOp::NotEqual) return Fail("type takes = or != at " + std::to_string(opColumn));
+            std::string type = Lower(token.text);
+            if (type != "income" && type != "expense") return Fail(Where() + " is not a type (Income or Expense)");
+            uint8_t bit = uint8_t(1) << static_cast<unsigned>(type == "income" ? TransactionType::Income : TransactionType::Expense);
+            rule.types &= op == RuleOp::Equal ? bit : static_cast<uint8_t>(~bit & 3);
+        } else if (field == "day") {
+            char* end = nullptr;
+            std::string value(token.text);
+            long n = std::strtol(value.c_str(), &end, 10);
+            if (end == value.c_str() || *end != '\0' || n < 1 || n > 31) return Fail(Where() + " is not a day of the month (1 to 31)");
+            uint32_t days = 0;
+            for (int32_t d = 1; d <= 31; ++d) {
+                if (Compare(op, d, static_cast<int32_t>(n))) days |= uint32_t(1) << d;
+            }
+            rule.days &= days;
+        } else {
+            Money amount;
+            if (!Money::Parse(token.text, amount) || amount < Money()) return Fail(Where() + " is not an amount");
+            int64_t v = amount.Minor();
+            switch (op) {
+                case RuleOp::Equal: rule.minAmount = std::max(rule.minAmount, v); rule.maxAmount = std::min(rule.maxAmount, v); break;
+                case RuleOp::Less: rule.maxAmount = std::min(rule.maxAmount, v - 1); break;
+                case RuleOp::LessEqual: rule.maxAmount = std::min(rule.maxAmount, v); break;
+                case RuleOp::Greater: rule.minAmount = std::max(rule.minAmount, v + 1); break;
+                case RuleOp::GreaterEqual: rule.minAmount = std::max(rule.minAmount, v); break;
+                case RuleOp::NotEqual: return Fail("amount does not take != at " + std::to_string(opColumn) + "; use < and > in two rules");
+            }
+        }
+        Next();
+        return true;
+    }
+
+    std::string_view text;
+    CategoryRules::Rule& rule;
+    Token token;
+    size_t at = 0;
+    std::string message;
+};
+
+bool CategoryRules::Compile(std::string_view text, CategoryRules& out, std::string& error) {
+    CategoryRules compiled;
+    size_t lineNumber = 0;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = Trim(text.substr(0, end));
+        text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+        ++lineNumber;
+        if (line.empty() || line.front() == '#') continue;
+
+        Rule rule;
+        RuleParser parser(line, rule);
+        std::string message;
+        if (!parser.Parse(message)) {
+            error = "line " + std::to_string(lineNumber) + ": " + message;
+            return false;
+        }
+        compiled.rules.push_back(std::move(rule));
+    }
+    compiled.Build();
+    out = std::move(compiled);
+    return true;
+}
+
+bool CategoryRules::Load(const std::string& path, CategoryRules& out, std::string& error) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec)) {
+            error = "cannot read " + path;
+            return false;
+        }
+        out = CategoryRules();
+        return true;
+    }
+    std::string text;
+    char buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) text.append(buffer, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    if (!ok) {
+        error = "cannot read " + path;
+        return false;
+    }
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) text.erase(0, 3);
+    return Compile(text, out, error);
+}
+
+void CategoryRules::Build() {
+    // Distinct texts, and for each rule how many of its own are distinct
+    std::unordered_map<std::string, uint32_t> textIds;
+    std::vector<std::string> texts;
+    std::vector<std::vector<uint32_t>> rulesOfText;
+    for (uint32_t r = 0; r < rules.size(); ++r) {
+        Rule& rule = rules[r];
+        std::sort(rule.texts.begin(), rule.texts.end());
+        rule.texts.erase(std::unique(rule.texts.begin(), rule.texts.end()), rule.texts.end());
+        rule.textCount = static_cast<uint16_t>(rule.texts.size());
+        for (const std::string& text : rule.texts) {
+            auto [it, added] = textIds.emplace(text, static_cast<uint32_t>(texts.size()));
+            if (added) {
+                texts.push_back(text);
+                rulesOfText.emplace_back();
+            }
+            rulesOfText[it->second].push_back(r);
+        }
+        if (rule.texts.empty()) {
+            if (rule.minAmount == rule.maxAmount) byAmount[rule.minAmount].push_back(r);
+            else untexted.push_back(r);
+        }
+    }
+
+    ruleStarts.assign(1, 0);
+    for (const std::vector<uint32_t>& list : rulesOfText) {
+        textRules.insert(textRules.end(), list.begin(), list.end());
+        ruleStarts.push_back(static_cast<uint32_t>(textRules.size()));
+    }
+    if (texts.empty()) return;
+
+    // Byte classes: one per byte the texts use, lower-case letters sharing
+    // their upper-case class, and class 0 for every other byte
+    for (const std::string& text : texts) {
+        for (char c : text) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (classOf[u] == 0) classOf[u] = static_cast<uint8_t>(classCount++);
+        }
+    }
+    for (unsigned char c = 'a'; c <= 'z'; ++c) classOf[c] = classOf[c - 'a' + 'A'];
+
+    // The trie, then the failure moves breadth first, each missing
+    // transition taking the one of the failure state
+    next.assign(classCount, -1);
+    std::vector<std::vector<uint32_t>> ends(1);
+    for (uint32_t id = 0; id < texts.size(); ++id) {
+        int32_t state = 0;
+        for (char c : texts[id]) {
+            int32_t& to = next[state * classCount + classOf[static_cast<unsigned char>(c)]];
+            if (to < 0) {
+                to = static_cast<int32_t>(ends.size());
+                ends.emplace_back();
+                next.resize(next.size() + classCount, -1);
+            }
+            state = next[state * classCount + classOf[static_cast<unsigned char>(c)]];
+        }
+        ends[state].push_back(id);
+    }
+
+    size_t states = ends.size();
+    std::vector<int32_t> fail(states, 0);
+    outputLink.assign(states, -1);
+    std::vector<int32_t> queue;
+    queue.reserve(states);
+    for (size_t c = 0; c < classCount; ++c) {
+        int32_t& to = next[c];
+        if (to < 0) to = 0;
+        else queue.push_back(to);
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int32_t state = queue[head];
+        for (size_t c = 0; c < classCount; ++c) {
+            int32_t& to = next[state * classCount + c];
+            int32_t fallback = next[fail[state] * classCount + c];
+            if (to < 0) {
+                to = fallback;
+            } else {
+                fail[to] = fallback;
+                outputLink[to] = ends[fallback].empty() ? outputLink[fallback] : fallback;
+                queue.push_back(to);
+            }
+        }
+    }
+
+    textStarts.assign(1, 0);
+    for (const std::vector<uint32_t>& list : ends) {
+        stateTexts.insert(stateTexts.end(), list.begin(), list.end());
+        textStarts.push_back(static_cast<uint32_t>(stateTexts.size()));
+    }
+}
+
+bool CategoryRules::Holds(const Rule& rule, TransactionType type, int64_t amount, unsigned dayOfMonth) const {
+    return ((rule.types >> static_cast<unsigned>(type)) & 1) != 0 && amount >= rule.minAmount &&
+           amount <= rule.maxAmount && ((rule.days >> dayOfMonth) & 1) != 0;
+}
+
+size_t CategoryRules::Match(std::string_view description, TransactionType type, int64_t amount, int32_t day,
+                            Scratch& scratch) const {
+    if (rules.empty()) return noRule;
+    int year;
+    unsigned month, dayOfMonth;
+    CivilFromDays(day, year, month, dayOfMonth);
+    size_t best = noRule;
+
+    if (!next.empty()) {
+        size_t textCount = ruleStarts.size() - 1;
+        if (scratch.textSeen.size() != textCount || scratch.ruleSeen.size() != rules.size() || ++scratch.generation == 0) {
+            scratch.textSeen.assign(textCount, 0);
+            scratch.ruleSeen.assign(rules.size(), 0);
+            scratch.ruleTexts.assign(rules.size(), 0);
+            scratch.generation = 1;
+        }
+        uint32_t generation = scratch.generation;
+
+        int32_t state = 0;
+        for (char c : description) {
+            state = next[state * classCount + classOf[static_cast<unsigned char>(c)]];
+            int32_t found = textStarts[state] != textStarts[state + 1] ? state : outputLink[state];
+            for (; found >= 0; found = outputLink[found]) {
+                for (uint32_t i = textStarts[found]; i < textStarts[found + 1]; ++i) {
+                    uint32_t text = stateTexts[i];
+                    if (scratch.textSeen[text] == generation) continue;
+                    scratch.textSeen[text] = generation;
+
+                    // Rules in order, so none past the best so far can win
+                    for (uint32_t j = ruleStarts[text]; j < ruleStarts[text + 1] && textRules[j] < best; ++j) {
+                        uint32_t r = textRules[j];
+                        if (scratch.ruleSeen[r] != generation) {
+                            scratch.ruleSeen[r] = generation;
+                            scratch.ruleTexts[r] = 0;
+                        }
+                        if (++scratch.ruleTexts[r] == rules[r].textCount && Holds(rules[r], type, amount, dayOfMonth)) {
+                            best = r;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto it = byAmount.find(amount);
+    if (it != byAmount.end()) {
+        for (uint32_t r : it->second) {
+            if (r >= best) break;
+            if (Holds(rules[r], type, amount, dayOfMonth)) {
+                best = r;
+                break;
+            }
+        }
+    }
+    for (uint32_t r : untexted) {
+        if (r >= best) break;
+        if (Holds(rules[r], type, amount, dayOfMonth)) {
+            best = r;
+            break;
+        }
+    }
+    return best;
+}
+
+size_t CategoryRules::MatchRuleByRule(std::string_view description, TransactionType type, int64_t amount,
+                                      int32_t day) const {
+    int year;
+    unsigned month, dayOfMonth;
+    CivilFromDays(day, year, month, dayOfMonth);
+    std::string upper = Upper(description);
+    for (size_t r = 0; r < rules.size(); ++r) {
+        const Rule& rule = rules[r];
+        if (!Holds(rule, type, amount, dayOfMonth)) continue;
+        bool all = true;
+        for (const std::string& text : rule.texts) all = all && upper.find(text) != std::string::npos;
+        if (all) return r;
+    }
+    return noRule;
+}
+
+std::string RulesPath(const std::string& snapshotPath) {
+    return std::filesystem::path(snapshotPath).replace_extension(".rules").string();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// Categorization rules, one per line of a text file:
+//
+//   # comments and blank lines are skipped
+//   description contains JOLLIBEE -> Food
+//   amount=15000 and day=1 -> Rent
+//   type=Expense and description contains "GRAB" and amount<500 -> Transportation
+//
+// A rule is conditions joined by and, then -> and the category. Conditions:
+// description contains text (ignoring ASCII case), amount with =, <, <=, >
+// or >= (the amount as the ledger keeps it, without sign), day of the month
+// with the same operators and !=, and type = or != Income or Expense. The
+// first rule that holds, in file order, gives the category.
+//
+// Compiling puts every contains text of every rule into one Aho-Corasick
+// automaton over the byte classes the texts use, with the failure moves
+// folded into the transition table, so a description is read once, a table
+// lookup per byte, whatever the number of rules. A text found counts toward
+// the rules that need it, and a rule is a candidate when all its texts are
+// found. Rules without text are found by amount when they give one, and
+// the rest are tried on every row. A candidate's amount, day and type are
+// then checked, and the lowest-numbered one wins.
+
+#include "LedgerTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class CategoryRules {
+public:
+    static constexpr size_t noRule = SIZE_MAX;
+
+    // Fails with a message giving the line and what is wrong with it
+    static bool Compile(std::string_view text, CategoryRules& out, std::string& error);
+
+    // A missing file is an empty rule set
+    static bool Load(const std::string& path, CategoryRules& out, std::string& error);
+
+    bool Empty() const { return rules.empty(); }
+    size_t Size() const { return rules.size(); }
+    std::string_view Category(size_t rule) const { return rules[rule].category; }
+
+    // Per-caller matching state, so one rule set can serve several threads
+    struct Scratch {
+        uint32_t generation = 0;
+        std::vector<uint32_t> textSeen;     // generation a text was last found in
+        std::vector<uint32_t> ruleSeen;     // and a rule last counted in
+        std::vector<uint16_t> ruleTexts;    // texts of the rule found this time
+    };
+
+    // The first rule holding for the row, or noRule. amount is in minor
+    // units without sign; day is a day number.
+    size_t Match(std::string_view description, TransactionType type, int64_t amount, int32_t day,
+                 Scratch& scratch) const;
+
+    // Reference matching: tries every rule in order, searching for each
+    // text in the description. For checks and benchmarks.
+    size_t MatchRuleByRule(std::string_view description, TransactionType type, int64_t amount, int32_t day) const;
+
+private:
+    friend class RuleParser;
+
+    struct Rule {
+        std::vector<std::string> texts;     // upper-cased
+        uint16_t textCount = 0;             // distinct texts
+        uint8_t types = 3;                  // bit (1 << type)
+        uint32_t days = ~uint32_t(0);       // bit day of month
+        int64_t minAmount = INT64_MIN;
+        int64_t maxAmount = INT64_MAX;
+        std::string category;
+    };
+
+    bool Holds(const Rule& rule, TransactionType type, int64_t amount, unsigned dayOfMonth) const;
+    void Build();
+
+    std::vector<Rule> rules;
+
+    // The automaton: next[state * classCount + classOf[byte]]
+    uint8_t classOf[256] = {};
+    size_t classCount = 1;
+    std::vector<int32_t> next;
+    std::vector<int32_t> outputLink;        // nearest state down the failure chain with texts, or -1
+    std::vector<uint32_t> textStarts;       // texts ending at each state, state count + 1
+    std::vector<uint32_t> stateTexts;
+
+    // Rules needing each text, text count + 1 starts
+    std::vector<uint32_t> ruleStarts;
+    std::vector<uint32_t> textRules;
+
+    // Rules without text: by exact amount, and the rest, in rule order
+    std::unordered_map<int64_t, std::vector<uint32_t>> byAmount;
+    std::vector<uint32_t> untexted;
+};
+
+// Where a ledger's rules are kept: "transactions.fsnap" gives
+// "transactions.rules"
+std::string RulesPath(const std::string& snapshotPath);
@@ -0,0 +1,76 @@
+#include "Date.h"
+
+// Howard Hinnant's days_from_civil / civil_from_days
+int32_t DaysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
+
+void CivilFromDays(int32_t days, int& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int>(yoe) + era * 400 + (month <= 2);
+}
+
+static bool ParseNumber(std::string_view& text, unsigned minDigits, unsigned maxDigits, unsigned& value) {
+    unsigned digits = 0;
+    value = 0;
+    while (digits < text.size() && digits < maxDigits && text[digits] >= '0' && text[digits] <= '9') {
+        value = value * 10 + (text[digits] - '0');
+        ++digits;
+    }
+    text.remove_prefix(digits);
+    return digits >= minDigits;
+}
+
+bool ParseDate(std::string_view text, int32_t& days) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+
+    unsigned day, month, year;
+    if (!ParseNumber(text, 1, 2, day) || text.empty() || text.front() != '/') return false;
+    text.remove_prefix(1);
+    if (!ParseNumber(text, 1, 2, month) || text.empty() || text.front() != '/') return false;
+    text.remove_prefix(1);
+    if (!ParseNumber(text, 4, 4, year) || !text.empty()) return false;
+
+    if (month < 1 || month > 12 || day < 1) return false;
+    static const unsigned char monthDays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    unsigned limit = monthDays[month - 1] + (month == 2 && leap ? 1 : 0);
+    if (day > limit) return false;
+
+    days = DaysFromCivil(static_cast<int>(year), month, day);
+    return true;
+}
+
+size_t FormatDate(int32_t days, char* out) {
+    if (days == kNoDate) return 0;
+
+    int year;
+    unsigned month, day;
+    CivilFromDays(days, year, month, day);
+    if (year < 0 || year > 9999) return 0;
+
+    out[0] = static_cast<char>('0' + day / 10);
+    out[1] = static_cast<char>('0' + day % 10);
+    out[2] = '/';
+    out[3] = static_cast<char>('0' + month / 10);
+    out[4] = static_cast<char>('0' + month % 10);
+    out[5] = '/';
+    out[6] = static_cast<char>('0' + year / 1000);
+    out[7] = static_cast<char>('0' + year / 100 % 10);
+    out[8] = static_cast<char>('0' + year / 10 % 10);
+    out[9] = static_cast<char>('0' + year % 10);
+    return 10;
+}
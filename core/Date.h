@@ -0,0 +1,21 @@
+#pragma once
+
+// Calendar dates as day numbers (days since 1970-01-01), the compact form
+// used by the snapshot columns. Text form is the DD/MM/YYYY of GetCurrentDate.
+
+#include <cstdint>
+#include <string_view>
+
+// Stored for rows whose date text could not be parsed
+constexpr int32_t kNoDate = INT32_MIN;
+
+int32_t DaysFromCivil(int year, unsigned month, unsigned day);
+void CivilFromDays(int32_t days, int& year, unsigned& month, unsigned& day);
+
+// Accepts D/M/YYYY with one- or two-digit day and month. Rejects dates that
+// do not exist, such as 31/02/2025.
+bool ParseDate(std::string_view text, int32_t& days);
+
+// Writes DD/MM/YYYY (10 characters, no terminator) and returns the length
+// written, or 0 for kNoDate.
+size_t FormatDate(int32_t days, char* out);
@@ -0,0 +1,197 @@
+#include "DateIndex.h"
+
+#include "Date.h"
+
+#include <utility>
+
+int32_t DateIndex::MonthKey(int32_t day) {
+    if (day == kNoDate) return INT32_MIN;
+
+    int year;
+    unsigned month, dayOfMonth;
+    CivilFromDays(day, year, month, dayOfMonth);
+    return year * 12 + static_cast<int32_t>(month) - 1;
+}
+
+void DateIndex::AddTotals(PeriodTotals& totals, TransactionType type, Money amount, int sign) {
+    Money delta = sign > 0 ? amount : -amount;
+    if (type == TransactionType::Income) {
+        totals.income += delta;
+    } else {
+        totals.expense += delta;
+    }
+    if (sign > 0) ++totals.rows; else --totals.rows;
+}
+
+void DateIndex::Clear() {
+    months.clear();
+}
+
+void DateIndex::Build(size_t rows, const int32_t* days, const uint8_t* types, const int64_t* amounts,
+                      const LiveSet* live) {
+    Clear();
+
+    // Rows arrive in row order, so each bucket is sorted, and trimmed of
+    // the slack its growth left, once at the end
+    for (size_t row = 0; row < rows; ++row) {
+        if (live != nullptr && !live->Test(row)) continue;
+        Bucket& bucket = months[MonthKey(days[row])];
+        bucket.entries.push_back(Entry{ days[row], static_cast<uint32_t>(row) });
+        AddTotals(bucket.totals, static_cast<TransactionType>(types[row]), Money::FromMinor(amounts[row]), 1);
+    }
+    for (auto& month : months) {
+        std::sort(month.second.entries.begin(), month.second.entries.end());
+        month.second.entries.shrink_to_fit();
+    }
+}
+
+void DateIndex::Insert(size_t row, int32_t day, TransactionType type, Money amount) {
+    Bucket& bucket = months[MonthKey(day)];
+    Entry entry{ day, static_cast<uint32_t>(row) };
+    bucket.entries.insert(std::upper_bound(bucket.entries.begin(), bucket.entries.end(), entry), entry);
+    AddTotals(bucket.totals, type, amount, 1);
+}
+
+void DateIndex::Remove(size_t row, int32_t day, TransactionType type, Money amount) {
+    auto month = months.find(MonthKey(day));
+    if (month != months.end()) {
+        Bucket& bucket = month->second;
+        auto it = std::lower_bound(bucket.entries.begin(), bucket.entries.end(), Entry{ day, static_cast<uint32_t>(row) });
+        if (it != bucket.entries.end() && it->row == row && it->day == day) {
+            bucket.entries.erase(it);
+            AddTotals(bucket.totals, type, amount, -1);
+        }
+        if (bucket.entries.empty()) months.erase(month);
+    }
+}
+
+void DateIndex::Remove(const std::vector<uint32_t>& rows, const int32_t* days, const uint8_t* types,
+                       const int64_t* amounts) {
+    // Month by month, then in entry order, so each bucket is filtered once
+    std::vector<std::pair<int32_t, Entry>> doomed;
+    doomed.reserve(rows.size());
+    for (uint32_t row : rows) doomed.emplace_back(MonthKey(days[row]), Entry{ days[row], row });
+    std::sort(doomed.begin(), doomed.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+
+    for (size_t first = 0; first < doomed.size();) {
+        int32_t key = doomed[first].first;
+        size_t last = first;
+        while (last < doomed.size() && doomed[last].first == key) ++last;
+
+        auto month = months.find(key);
+        if (month != months.end()) {
+            Bucket& bucket = month->second;
+            size_t next = first;
+            auto out = bucket.entries.begin();
+            for (auto e = bucket.entries.begin(); e != bucket.entries.end(); ++e) {
+                while (next < last && doomed[next].second < *e) ++next;
+                if (next < last && doomed[next].second == *e) {
+                    AddTotals(bucket.totals, static_cast<TransactionType>(types[e->row]),
+                              Money::FromMinor(amounts[e->row]), -1);
+                    ++next;
+                } else {
+                    *out++ = *e;
+                }
+            }
+            bucket.entries.erase(out, bucket.entries.end());
+            if (bucket.entries.empty()) months.erase(month);
+        }
+        first = last;
+    }
+}
+
+void DateIndex::Renumber(const std::vector<uint32_t>& newRow) {
+    for (auto& month : months) {
+        for (Entry& e : month.second.entries) e.row = newRow[e.row];
+    }
+}
+
+void DateIndex::Update(size_t row, int32_t oldDay, TransactionType oldType, Money oldAmount,
+                       int32_t newDay, TransactionType newType, Money newAmount) {
+    Bucket& oldBucket = months[MonthKey(oldDay)];
+    AddTotals(oldBucket.totals, oldType, oldAmount, -1);
+
+    if (oldDay != newDay) {
+        auto it = std::lower_bound(oldBucket.entries.begin(), oldBucket.entries.end(), Entry{ oldDay, static_cast<uint32_t>(row) });
+        if (it != oldBucket.entries.end() && it->row == row) oldBucket.entries.erase(it);
+        if (oldBucket.entries.empty()) months.erase(MonthKey(oldDay));
+
+        Bucket& newBucket = months[MonthKey(newDay)];
+        Entry entry{ newDay, static_cast<uint32_t>(row) };
+        newBucket.entries.insert(std::upper_bound(newBucket.entries.begin(), newBucket.entries.end(), entry), entry);
+        AddTotals(newBucket.totals, newType, newAmount, 1);
+    } else {
+        AddTotals(oldBucket.totals, newType, newAmount, 1);
+    }
+}
+
+std::vector<size_t> DateIndex::RowsInRange(int32_t first, int32_t last) const {
+    std::vector<size_t> rows;
+    ForEachInRange(first, last, [&](size_t row, int32_t) { rows.push_back(row); });
+    return rows;
+}
+
+PeriodTotals DateIndex::Totals(int32_t first, int32_t last, const uint8_t* types, const int64_t* amounts) const {
+    PeriodTotals result;
+    if (first > last) return result;
+
+    auto it = months.lower_bound(MonthKey(first));
+    auto end = months.upper_bound(MonthKey(last));
+    for (; it != end; ++it) {
+        const Bucket& bucket = it->second;
+        const std::vector<Entry>& entries = bucket.entries;
+
+        // Months inside the range use their stored totals; only the
+        // boundary months are scanned
+        if (entries.front().day >= first && entries.back().day <= last) {
+            result.income += bucket.totals.income;
+            result.expense += bucket.totals.expense;
+            result.rows += bucket.totals.rows;
+            continue;
+        }
+
+        auto e = std::lower_bound(entries.begin(), entries.end(), Entry{ first, 0 });
+        for (; e != entries.end() && e->day <= last; ++e) {
+            AddTotals(result, static_cast<TransactionType>(types[e->row]), Money::FromMinor(amounts[e->row]), 1);
+        }
+    }
+    return result;
+}
+
+PeriodTotals DateIndex::MonthTotals(int year, unsigned month) const {
+    auto it = months.find(year * 12 + static_cast<int32_t>(month) - 1);
+    return it != months.end() ? it->second.totals : PeriodTotals();
+}
+
+bool DateIndex::DayRange(int32_t& first, int32_t& last) const {
+    // Undated rows sort first under MonthKey(kNoDate)
+    auto begin = months.begin();
+    if (begin != months.end() && begin->first == MonthKey(kNoDate)) ++begin;
+    if (begin == months.end()) return false;
+
+    first = begin->second.entries.front().day;
+    last = months.rbegin()->second.entries.back().day;
+    return true;
+}
+
+size_t DateIndex::MemoryUsage() const {
+    size_t bytes = 0;
+    for (const auto& month : months) {
+        // A map node holds three links and a colour besides the pair
+        bytes += sizeof(month) + 4 * sizeof(void*) + month.second.entries.capacity() * sizeof(Entry);
+    }
+    return bytes;
+}
+
+bool DateIndex::operator==(const DateIndex& other) const {
+    if (months.size() != other.months.size()) return false;
+    for (auto a = months.begin(), b = other.months.begin(); a != months.end(); ++a, ++b) {
+        if (a->first != b->first || !(a->second.totals == b->second.totals) ||
+            a->second.entries != b->second.entries) {
+            return false;
+        }
+    }
+    return true;
+}
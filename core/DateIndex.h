@@ -0,0 +1,125 @@
+#pragma once
+
+// Rows bucketed by calendar month and kept sorted by day inside each bucket.
+// Each bucket also carries its income and expense totals, so a date range
+// is answered with a map lookup, full-month totals and a binary search in
+// the two boundary months: O(log n + k).
+
+#include "LedgerTypes.h"
+#include "LiveSet.h"
+#include "Money.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+struct PeriodTotals {
+    Money income;
+    Money expense;
+    size_t rows = 0;
+
+    Money Net() const { return income - expense; }
+
+    bool operator==(const PeriodTotals& other) const {
+        return income == other.income && expense == other.expense && rows == other.rows;
+    }
+};
+
+class DateIndex {
+public:
+    void Clear();
+
+    // Rows not in live, if given, are left out
+    void Build(size_t rows, const int32_t* days, const uint8_t* types, const int64_t* amounts,
+               const LiveSet* live = nullptr);
+
+    // Row numbers are store slots and stay put when other rows are removed;
+    // only Renumber moves them
+    void Insert(size_t row, int32_t day, TransactionType type, Money amount);
+    void Remove(size_t row, int32_t day, TransactionType type, Money amount);
+    void Update(size_t row, int32_t oldDay, TransactionType oldType, Money oldAmount,
+                int32_t newDay, TransactionType newType, Money newAmount);
+
+    // Removes many rows with one pass over each month they fall in; the
+    // columns must still hold their values
+    void Remove(const std::vector<uint32_t>& rows, const int32_t* days, const uint8_t* types,
+                const int64_t* amounts);
+
+    // Rows moved: newRow[old] for every indexed row. The mapping must keep
+    // the rows' order, as compaction does.
+    void Renumber(const std::vector<uint32_t>& newRow);
+
+    // Calls onRow(size_t row, int32_t day) for rows dated first..last
+    // (inclusive), in date order
+    template <typename Fn>
+    void ForEachInRange(int32_t first, int32_t last, Fn&& onRow) const;
+
+    std::vector<size_t> RowsInRange(int32_t first, int32_t last) const;
+
+    // Calls onRow(size_t row) for the rows dated day that come before row
+    // (day order, then row order), with one lookup and a walk over that day
+    template <typename Fn>
+    void ForEachEarlierOnDay(int32_t day, size_t row, Fn&& onRow) const;
+
+    // Income and expense for first..last; the columns are the store's and
+    // are only read for the two boundary months
+    PeriodTotals Totals(int32_t first, int32_t last, const uint8_t* types, const int64_t* amounts) const;
+    PeriodTotals MonthTotals(int year, unsigned month) const;
+
+    // Earliest and latest dated row; false when no row has a date
+    bool DayRange(int32_t& first, int32_t& last) const;
+
+    static int32_t MonthKey(int32_t day);
+
+    size_t MemoryUsage() const;
+
+    bool operator==(const DateIndex& other) const;
+
+private:
+    struct Entry {
+        int32_t day;
+        uint32_t row;
+
+        bool operator<(const Entry& other) const {
+            return day != other.day ? day < other.day : row < other.row;
+        }
+        bool operator==(const Entry& other) const { return day == other.day && row == other.row; }
+    };
+
+    struct Bucket {
+        std::vector<Entry> entries;
+        PeriodTotals totals;
+    };
+
+    static void AddTotals(PeriodTotals& totals, TransactionType type, Money amount, int sign);
+
+    std::map<int32_t, Bucket> months;
+};
+
+template <typename Fn>
+void DateIndex::ForEachInRange(int32_t first, int32_t last, Fn&& onRow) const {
+    if (first > last) return;
+
+    auto it = months.lower_bound(MonthKey(first));
+    auto end = months.upper_bound(MonthKey(last));
+    for (; it != end; ++it) {
+        const std::vector<Entry>& entries = it->second.entries;
+        auto begin = std::lower_bound(entries.begin(), entries.end(), Entry{ first, 0 });
+        for (auto e = begin; e != entries.end() && e->day <= last; ++e) {
+            onRow(e->row, e->day);
+        }
+    }
+}
+
+template <typename Fn>
+void DateIndex::ForEachEarlierOnDay(int32_t day, size_t row, Fn&& onRow) const {
+    auto month = months.find(MonthKey(day));
+    if (month == months.end()) return;
+
+    const std::vector<Entry>& entries = month->second.entries;
+    for (auto e = std::lower_bound(entries.begin(), entries.end(), Entry{ day, 0 });
+         e != entries.end() && e->day == day && e->row < row; ++e) {
+        onRow(e->row);
+    }
+}
@@ -0,0 +1,437 @@
+#include "FilterProgram.h"
+
+#include "Date.h"
+#include "Money.h"
+
+#include <algorithm>
+
+static std::string Lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return out;
+}
+
+// The table shows unnamed categories as N/A, so that is their name here too
+static std::string CategoryKey(const TransactionStore& store, uint16_t id) {
+    std::string_view name = store.CategoryName(id);
+    return Lower(name.empty() ? std::string_view("N/A") : name);
+}
+
+template <FilterOp op, typename T>
+static inline uint8_t Test(T a, T b) {
+    if constexpr (op == FilterOp::Equal) return a == b;
+    if constexpr (op == FilterOp::NotEqual) return a != b;
+    if constexpr (op == FilterOp::Less) return a < b;
+    if constexpr (op == FilterOp::LessEqual) return a <= b;
+    if constexpr (op == FilterOp::Greater) return a > b;
+    if constexpr (op == FilterOp::GreaterEqual) return a >= b;
+    return 0;
+}
+
+template <typename T>
+static bool Holds(FilterOp op, T a, T b) {
+    switch (op) {
+        case FilterOp::Equal: return Test<FilterOp::Equal>(a, b);
+        case FilterOp::NotEqual: return Test<FilterOp::NotEqual>(a, b);
+        case FilterOp::Less: return Test<FilterOp::Less>(a, b);
+        case FilterOp::LessEqual: return Test<FilterOp::LessEqual>(a, b);
+        case FilterOp::Greater: return Test<FilterOp::Greater>(a, b);
+        case FilterOp::GreaterEqual: return Test<FilterOp::GreaterEqual>(a, b);
+    }
+    return false;
+}
+
+// One branch-free loop per operator, so the compiler can vectorize it
+template <FilterOp op, typename T>
+static void CompareAs(const T* column, size_t n, T value, uint8_t* out) {
+    for (size_t i = 0; i < n; ++i) out[i] = Test<op>(column[i], value);
+}
+
+template <typename T>
+static void Compare(const T* column, size_t n, FilterOp op, T value, uint8_t* out) {
+    switch (op) {
+        case FilterOp::Equal: CompareAs<FilterOp::Equal>(column, n, value, out); break;
+        case FilterOp::NotEqual: CompareAs<FilterOp::NotEqual>(column, n, value, out); break;
+        case FilterOp::Less: CompareAs<FilterOp::Less>(column, n, value, out); break;
+        case FilterOp::LessEqual: CompareAs<FilterOp::LessEqual>(column, n, value, out); break;
+        case FilterOp::Greater: CompareAs<FilterOp::Greater>(column, n, value, out); break;
+        case FilterOp::GreaterEqual: CompareAs<FilterOp::GreaterEqual>(column, n, value, out); break;
+    }
+}
+
+// Recursive descent over
+//
+//   or         := and ("or" and)*
+//   and        := unary ("and" unary)*
+//   unary      := "not" unary | "(" or ")" | comparison
+//   comparison := field op value | field "in" "(" value ("," value)* ")"
+//
+// emitting postfix code as it goes
+class FilterParser {
+public:
+    FilterParser(std::string_view text, FilterProgram& program) : text(text), program(program) {}
+
+    bool Parse(std::string& error) {
+        Next();
+        if (token.kind == Kind::End) return true;
+        if (!ParseOr()) {
+            error = message;
+            return false;
+        }
+        if (token.kind != Kind::End) {
+            error = Unexpected("and, or or the end");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    enum class Kind { Word, Quoted, Open, Close, Comma, Operator, End, Bad };
+    enum class Field { Type, Amount, Category, Date };
+
+    struct Token {
+        Kind kind = Kind::End;
+        std::string_view text;
+        FilterOp op = FilterOp::Equal;
+        size_t column = 0;
+    };
+
+    static bool IsWordChar(char c) {
+        return c != ' ' && c != '\t' && c != '(' && c != ')' && c != ',' && c != '=' && c != '!' &&
+               c != '<' && c != '>' && c != '"' && c != '\'';
+    }
+
+    void Next() {
+        while (at < text.size() && (text[at] == ' ' || text[at] == '\t')) ++at;
+        token = Token();
+        token.column = at + 1;
+        if (at >= text.size()) return;
+
+        size_t start = at;
+        char c = text[at];
+        if (c == '(' || c == ')' || c == ',') {
+            token.kind = c == '(' ? Kind::Open : c == ')' ? Kind::Close : Kind::Comma;
+            token.text = text.substr(at++, 1);
+        } else if (c == '"' || c == '\'') {
+            size_t end = text.find(c, at + 1);
+            if (end == std::string_view::npos) {
+                token.kind = Kind::Bad;
+                token.text = text.substr(at);
+                at = text.size();
+            } else {
+                token.kind = Kind::Quoted;
+                token.text = text.substr(at + 1, end - at - 1);
+                at = end + 1;
+            }
+        } else if (c == '=' || c == '!' || c == '<' || c == '>') {
+            bool equals = at + 1 < text.size() && text[at + 1] == '=';
+            token.kind = Kind::Operator;
+            switch (c) {
+                case '=': token.op = FilterOp::Equal; break;
+                case '!': token.op = FilterOp::NotEqual; break;
+                case '<': token.op = equals ? FilterOp::LessEqual : FilterOp::Less; break;
+                case '>': token.op = equals ? FilterOp::GreaterEqual : FilterOp::Greater; break;
+            }
+            // "==" reads as "=", a lone "!" is an error
+            if (c == '!' && !equals) token.kind = Kind::Bad;
+            at += equals ? 2 : 1;
+            token.text = text.substr(start, at - start);
+        } else {
+            while (at < text.size() && IsWordChar(text[at])) ++at;
+            token.kind = Kind::Word;
+            token.text = text.substr(start, at - start);
+        }
+    }
+
+    bool IsKeyword(const char* keyword) const {
+        return token.kind == Kind::Word && Lower(token.text) == keyword;
+    }
+
+    std::string Unexpected(const char* expected) const {
+        std::string found = token.kind == Kind::End ? "the end" : "'" + std::string(token.text) + "'";
+        return "expected " + std::string(expected) + " at " + std::to_string(token.column) + ", found " + found;
+    }
+
+    bool Fail(std::string text) {
+        message = std::move(text);
+        return false;
+    }
+
+    void Emit(FilterProgram::Code code, FilterOp op, int64_t value) {
+        program.code.push_back(FilterProgram::Instruction{ code, op, value });
+        switch (code) {
+            case FilterProgram::Code::And:
+            case FilterProgram::Code::Or:
+                --depth;
+                break;
+            case FilterProgram::Code::Not:
+                break;
+            default:
+                program.depth = std::max(program.depth, ++depth);
+                break;
+        }
+    }
+
+    bool ParseOr() {
+        if (!ParseAnd()) return false;
+        while (IsKeyword("or")) {
+            Next();
+            if (!ParseAnd()) return false;
+            Emit(FilterProgram::Code::Or, FilterOp::Equal, 0);
+        }
+        return true;
+    }
+
+    bool ParseAnd() {
+        if (!ParseUnary()) return false;
+        while (IsKeyword("and")) {
+            Next();
+            if (!ParseUnary()) return false;
+            Emit(FilterProgram::Code::And, FilterOp::Equal, 0);
+        }
+        return true;
+    }
+
+    bool ParseUnary() {
+        if (IsKeyword("not")) {
+            Next();
+            if (!ParseUnary()) return false;
+            Emit(FilterProgram::Code::Not, FilterOp::Equal, 0);
+            return true;
+        }
+        if (token.kind == Kind::Open) {
+            Next();
+            if (!ParseOr()) return false;
+            if (token.kind != Kind::Close) return Fail(Unexpected("')'"));
+            Next();
+            return true;
+        }
+        return ParseComparison();
+    }
+
+    bool ParseComparison() {
+        if (token.kind != Kind::Word) return Fail(Unexpected("a field (type, amount, category or date)"));
+
+        std::string name = Lower(token.text);
+        Field field;
+        if (name == "type") field = Field::Type;
+        else if (name == "amount") field = Field::Amount;
+        else if (name == "category") field = Field::Category;
+        else if (name == "date") field = Field::Date;
+        else return Fail("unknown field '" + std::string(token.text) + "' at " + std::to_string(token.column) +
+                         " (type, amount, category or date)");
+        Next();
+
+        if (token.kind == Kind::Operator) {
+            FilterOp op = token.op;
+            if ((field == Field::Type || field == Field::Category) && op != FilterOp::Equal && op != FilterOp::NotEqual) {
+                return Fail("'" + std::string(token.text) + "' at " + std::to_string(token.column) + " does not apply to " + name +
+                            "; use =, != or in");
+            }
+            Next();
+            return ParseValues(field, op, false);
+        }
+        if (IsKeyword("in")) {
+            Next();
+            if (token.kind != Kind::Open) return Fail(Unexpected("'(' after in"));
+            Next();
+            if (!ParseValues(field, FilterOp::Equal, true)) return false;
+            if (token.kind != Kind::Close) return Fail(Unexpected("',' or ')'"));
+            Next();
+            return true;
+        }
+        if (token.kind == Kind::Bad) return Fail(Unexpected("an operator"));
+        return Fail(Unexpected("=, !=, <, <=, >, >= or in"));
+    }
+
+    // One value, or with list a comma-separated list of them ORed together
+    bool ParseValues(Field field, FilterOp op, bool list) {
+        uint64_t types = 0;
+        std::vector<std::string> names;
+        size_t values = 0;
+        do {
+            if (values > 0) Next();
+            if (token.kind != Kind::Word && token.kind != Kind::Quoted) return Fail(Unexpected("a value"));
+
+            std::string where = "'" + std::string(token.text) + "' at " + std::to_string(token.column);
+            switch (field) {
+                case Field::Type: {
+                    std::string type = Lower(token.text);
+                    if (type != "income" && type != "expense") return Fail(where + " is not a type (Income or Expense)");
+                    TransactionType value = type == "income" ? TransactionType::Income : TransactionType::Expense;
+                    types |= uint64_t(1) << static_cast<unsigned>(value);
+                    break;
+                }
+                case Field::Category:
+                    names.push_back(Lower(token.text));
+                    break;
+                case Field::Amount: {
+                    Money amount;
+                    if (!Money::Parse(token.text, amount)) return Fail(where + " is not an amount");
+                    Emit(FilterProgram::Code::Amount, op, amount.Minor());
+                    if (values > 0) Emit(FilterProgram::Code::Or, FilterOp::Equal, 0);
+                    break;
+                }
+                case Field::Date: {
+                    int32_t day;
+                    if (!ParseDate(token.text, day)) return Fail(where + " is not a date (DD/MM/YYYY)");
+                    Emit(FilterProgram::Code::Date, op, day);
+                    if (values > 0) Emit(FilterProgram::Code::Or, FilterOp::Equal, 0);
+                    break;
+                }
+            }
+            ++values;
+            Next();
+        } while (list && token.kind == Kind::Comma);
+
+        if (field == Field::Type) {
+            if (op == FilterOp::NotEqual) types = ~types & 3;
+            Emit(FilterProgram::Code::Type, FilterOp::Equal, static_cast<int64_t>(types));
+        } else if (field == Field::Category) {
+            Emit(FilterProgram::Code::Category, FilterOp::Equal, static_cast<int64_t>(program.categorySets.size()));
+            program.categorySets.push_back(std::move(names));
+            if (op == FilterOp::NotEqual) Emit(FilterProgram::Code::Not, FilterOp::Equal, 0);
+        }
+        return true;
+    }
+
+    std::string_view text;
+    FilterProgram& program;
+    Token token;
+    size_t at = 0;
+    size_t depth = 0;
+    std::string message;
+};
+
+bool FilterProgram::Compile(std::string_view text, FilterProgram& out, std::string& error) {
+    FilterProgram program;
+    FilterParser parser(text, program);
+    if (!parser.Parse(error)) return false;
+    out = std::move(program);
+    return true;
+}
+
+RowSet FilterProgram::Evaluate(const TransactionStore& store) const {
+    size_t slots = store.SlotCount();
+    RowSet result;
+    result.Assign(slots, code.empty());
+    if (code.empty()) {
+        result.And(store.Live().Words());
+        return result;
+    }
+
+    // Category names resolve to a yes/no table by id, once
+    std::vector<std::vector<uint8_t>> categoryTables(categorySets.size(), std::vector<uint8_t>(store.CategoryCount(), 0));
+    for (size_t id = 0; id < store.CategoryCount(); ++id) {
+        std::string name = CategoryKey(store, static_cast<uint16_t>(id));
+        for (size_t set = 0; set < categorySets.size(); ++set) {
+            const std::vector<std::string>& names = categorySets[set];
+            if (std::find(names.begin(), names.end(), name) != names.end()) categoryTables[set][id] = 1;
+        }
+    }
+
+    const int64_t* amounts = store.Amounts();
+    const uint8_t* types = store.Types();
+    const uint16_t* categories = store.Categories();
+    const int32_t* days = store.Days();
+    const uint64_t* live = store.Live().Words();
+    uint64_t* words = result.Words();
+
+    std::vector<uint8_t> masks(depth * blockRows);
+    for (size_t first = 0; first < slots; first += blockRows) {
+        size_t n = std::min(blockRows, slots - first);
+        size_t used = 0;
+        for (const Instruction& instruction : code) {
+            switch (instruction.code) {
+                case Code::Amount:
+                    Compare(amounts + first, n, instruction.op, instruction.value, &masks[used++ * blockRows]);
+                    break;
+                case Code::Date: {
+                    uint8_t* out = &masks[used++ * blockRows];
+                    Compare(days + first, n, instruction.op, static_cast<int32_t>(instruction.value), out);
+                    for (size_t i = 0; i < n; ++i) out[i] &= days[first + i] != kNoDate;
+                    break;
+                }
+                case Code::Type: {
+                    uint8_t match[2] = { static_cast<uint8_t>(instruction.value & 1), static_cast<uint8_t>((instruction.value >> 1) & 1) };
+                    uint8_t* out = &masks[used++ * blockRows];
+                    for (size_t i = 0; i < n; ++i) out[i] = match[types[first + i] & 1];
+                    break;
+                }
+                case Code::Category: {
+                    const uint8_t* match = categoryTables[static_cast<size_t>(instruction.value)].data();
+                    uint8_t* out = &masks[used++ * blockRows];
+                    for (size_t i = 0; i < n; ++i) out[i] = match[categories[first + i]];
+                    break;
+                }
+                case Code::And:
+                case Code::Or: {
+                    --used;
+                    uint8_t* a = &masks[(used - 1) * blockRows];
+                    const uint8_t* b = &masks[used * blockRows];
+                    if (instruction.code == Code::And) {
+                        for (size_t i = 0; i < n; ++i) a[i] &= b[i];
+                    } else {
+                        for (size_t i = 0; i < n; ++i) a[i] |= b[i];
+                    }
+                    break;
+                }
+                case Code::Not: {
+                    uint8_t* a = &masks[(used - 1) * blockRows];
+                    for (size_t i = 0; i < n; ++i) a[i] ^= 1;
+                    break;
+                }
+            }
+        }
+
+        // Blocks start on a word boundary, so the mask packs word by word
+        const uint8_t* mask = masks.data();
+        for (size_t lane = 0; lane < n; lane += 64) {
+            size_t count = std::min<size_t>(64, n - lane);
+            uint64_t word = 0;
+            for (size_t j = 0; j < count; ++j) word |= uint64_t(mask[lane + j]) << j;
+            size_t w = (first + lane) >> 6;
+            words[w] = word & live[w];
+        }
+    }
+    return result;
+}
+
+bool FilterProgram::MatchesRow(const TransactionStore& store, size_t slot) const {
+    if (slot >= store.SlotCount() || !store.IsLive(slot)) return false;
+    if (code.empty()) return true;
+
+    TransactionStore::Row row = store.Get(slot);
+    std::vector<bool> stack;
+    for (const Instruction& instruction : code) {
+        switch (instruction.code) {
+            case Code::Amount:
+                stack.push_back(Holds(instruction.op, row.amount.Minor(), instruction.value));
+                break;
+            case Code::Date:
+                stack.push_back(row.day != kNoDate && Holds(instruction.op, int64_t(row.day), instruction.value));
+                break;
+            case Code::Type:
+                stack.push_back((instruction.value >> static_cast<unsigned>(row.type)) & 1);
+                break;
+            case Code::Category: {
+                const std::vector<std::string>& names = categorySets[static_cast<size_t>(instruction.value)];
+                stack.push_back(std::find(names.begin(), names.end(), CategoryKey(store, row.category)) != names.end());
+                break;
+            }
+            case Code::And:
+            case Code::Or: {
+                bool b = stack.back();
+                stack.pop_back();
+                stack.back() = instruction.code == Code::And ? stack.back() && b : stack.back() || b;
+                break;
+            }
+            case Code::Not:
+                stack.back() = !stack.back();
+                break;
+        }
+    }
+    return stack.back();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Ad-hoc row filters written as expressions, such as
+//
+//   type=Expense and category in (Food,Transportation) and date>=01/01/2026 and amount>1000
+//
+// Comparisons on type, amount, category and date are combined with and, or,
+// not and parentheses. Type and category take = and != and in (...); amount
+// and date also take <, <=, > and >=. Amounts are written as Money::Parse
+// reads them, dates as DD/MM/YYYY; names with spaces or commas go in quotes.
+// Keywords, field names, types and category names ignore ASCII case. Rows
+// without a date fail every date comparison.
+//
+// Compiling turns the expression into a postfix program. Evaluate runs it a
+// block of rows at a time straight over the store's columns: each
+// comparison fills a byte mask for the block in one tight loop over a
+// column, and/or/not combine masks, and the result is packed into a RowSet.
+// Category names are looked up once per evaluation into a table by
+// category id, so no row's name is compared.
+
+#include "RowSet.h"
+#include "TransactionStore.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class FilterOp : uint8_t {
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual
+};
+
+class FilterProgram {
+public:
+    // Fails with a message giving the offending text and its column
+    static bool Compile(std::string_view text, FilterProgram& out, std::string& error);
+
+    // An empty program (from blank text) matches every row
+    bool Empty() const { return code.empty(); }
+
+    // Live slots the expression holds for
+    RowSet Evaluate(const TransactionStore& store) const;
+
+    // Reference evaluation of one slot: interprets the program for a single
+    // row and compares category names as text. For checks and benchmarks.
+    bool MatchesRow(const TransactionStore& store, size_t slot) const;
+
+    // Rows each block of the evaluation covers; a multiple of 64
+    static constexpr size_t blockRows = 1024;
+
+private:
+    friend class FilterParser;
+
+    enum class Code : uint8_t {
+        Amount,      // column op value
+        Date,        // column op value, and dated
+        Type,        // bit (1 << type) set in value
+        Category,    // category named in categorySets[value]
+        And,
+        Or,
+        Not
+    };
+
+    struct Instruction {
+        Code code;
+        FilterOp op;
+        int64_t value;
+    };
+
+    std::vector<Instruction> code;
+    std::vector<std::vector<std::string>> categorySets;    // lower-cased names
+    size_t depth = 0;                                       // masks in use at most
+};
@@ -0,0 +1,95 @@
+#include "IdIndex.h"
+
+static constexpr size_t minCapacity = 16;
+
+size_t IdIndex::Home(uint64_t id) const {
+    // Ids are sequential; mix them so runs spread over the table
+    id ^= id >> 30;
+    id *= 0xBF58476D1CE4E5B9ull;
+    id ^= id >> 27;
+    id *= 0x94D049BB133111EBull;
+    id ^= id >> 31;
+    return static_cast<size_t>(id) & (table.size() - 1);
+}
+
+void IdIndex::Clear() {
+    table.clear();
+    count = 0;
+}
+
+void IdIndex::Place(size_t slot, const uint64_t* ids) {
+    size_t mask = table.size() - 1;
+    size_t i = Home(ids[slot]);
+    while (table[i] != emptySlot) i = (i + 1) & mask;
+    table[i] = static_cast<uint32_t>(slot);
+    ++count;
+}
+
+void IdIndex::Resize(size_t capacity, const uint64_t* ids) {
+    std::vector<uint32_t> old;
+    old.swap(table);
+    table.assign(capacity, emptySlot);
+    count = 0;
+    for (uint32_t slot : old) {
+        if (slot != emptySlot) Place(slot, ids);
+    }
+}
+
+void IdIndex::Build(const uint64_t* ids, const LiveSet& live) {
+    size_t capacity = minCapacity;
+    while (capacity < live.Count() * 2) capacity *= 2;
+    table.assign(capacity, emptySlot);
+    count = 0;
+    for (size_t slot = 0; slot < live.Slots(); ++slot) {
+        if (live.Test(slot)) Place(slot, ids);
+    }
+}
+
+void IdIndex::Insert(size_t slot, const uint64_t* ids) {
+    if ((count + 1) * 2 > table.size()) {
+        Resize(table.empty() ? minCapacity : table.size() * 2, ids);
+    }
+    Place(slot, ids);
+}
+
+bool IdIndex::Find(uint64_t id, const uint64_t* ids, size_t& slot) const {
+    if (table.empty()) return false;
+    size_t mask = table.size() - 1;
+    for (size_t i = Home(id); table[i] != emptySlot; i = (i + 1) & mask) {
+        if (ids[table[i]] == id) {
+            slot = table[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+void IdIndex::Erase(uint64_t id, const uint64_t* ids) {
+    if (table.empty()) return;
+    size_t mask = table.size() - 1;
+    size_t hole = Home(id);
+    while (table[hole] != emptySlot && ids[table[hole]] != id) hole = (hole + 1) & mask;
+    if (table[hole] == emptySlot) return;
+
+    // Pull back later entries of the run that may not sit past the hole
+    for (size_t i = (hole + 1) & mask; table[i] != emptySlot; i = (i + 1) & mask) {
+        size_t home = Home(ids[table[i]]);
+        bool reachable = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!reachable) {
+            table[hole] = table[i];
+            hole = i;
+        }
+    }
+    table[hole] = emptySlot;
+    --count;
+}
+
+void IdIndex::Renumber(const std::vector<uint32_t>& newSlot) {
+    for (uint32_t& slot : table) {
+        if (slot != emptySlot) slot = newSlot[slot];
+    }
+}
+
+size_t IdIndex::MemoryUsage() const {
+    return table.capacity() * sizeof(uint32_t);
+}
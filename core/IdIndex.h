@@ -0,0 +1,46 @@
+#pragma once
+
+// Hash index from a transaction's stable id to its store slot. The table
+// holds only slot numbers and compares against the store's id column, so
+// an entry is 4 bytes. Open addressing with linear probing, at most half
+// full. Removal shifts the rest of the probe run back instead of leaving
+// markers, so lookups never slow down with deletes, and compaction
+// renumbers the slots in place without rehashing.
+
+#include "LiveSet.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class IdIndex {
+public:
+    void Clear();
+
+    // Indexes every live slot
+    void Build(const uint64_t* ids, const LiveSet& live);
+
+    // ids[slot] must already hold the new id
+    void Insert(size_t slot, const uint64_t* ids);
+
+    bool Find(uint64_t id, const uint64_t* ids, size_t& slot) const;
+
+    // ids must still hold id at its slot
+    void Erase(uint64_t id, const uint64_t* ids);
+
+    // Slots moved: newSlot[old] for every indexed slot
+    void Renumber(const std::vector<uint32_t>& newSlot);
+
+    size_t Size() const { return count; }
+    size_t MemoryUsage() const;
+
+private:
+    static constexpr uint32_t emptySlot = UINT32_MAX;
+
+    size_t Home(uint64_t id) const;
+    void Place(size_t slot, const uint64_t* ids);
+    void Resize(size_t capacity, const uint64_t* ids);
+
+    std::vector<uint32_t> table;
+    size_t count = 0;
+};
@@ -0,0 +1,307 @@
+#include "ImportIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+static constexpr char baseMagic[8] = { 'F', 'S', 'I', 'M', 'P', 'T', '0', '1' };
+static constexpr char logMagic[8] = { 'F', 'S', 'I', 'M', 'P', 'L', '0', '1' };
+
+struct ImportIndexHeader {
+    char magic[8];
+    uint64_t entryCount;
+    uint64_t slotCount;
+    uint64_t bloomBlocks;
+};
+
+// Bloom filter: 512-bit blocks, each key setting bloomProbes bits of one
+static constexpr uint64_t bloomBlockWords = 8;
+static constexpr uint64_t bloomBitsPerEntry = 10;
+static constexpr unsigned bloomProbes = 7;
+
+// The log is folded once it holds this many entries or a quarter of the base
+static constexpr size_t minFoldEntries = 65536;
+
+static constexpr uint64_t dayMask = (uint64_t(1) << 24) - 1;
+
+static uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+static int32_t Bucket(int32_t day) {
+    int32_t bucket = day / ImportIndex::bucketDays;
+    return day % ImportIndex::bucketDays < 0 ? bucket - 1 : bucket;
+}
+
+static uint64_t BucketKey(uint64_t description, int64_t amount, int32_t bucket) {
+    uint64_t key = Mix(description ^ Mix(static_cast<uint64_t>(amount) ^ Mix(static_cast<uint32_t>(bucket))));
+    return key != 0 ? key : 1;
+}
+
+static ImportIndex::Slot Pack(const ImportEntry& entry) {
+    return ImportIndex::Slot{ entry.key, (entry.id << 24) | (static_cast<uint32_t>(entry.day) & dayMask) };
+}
+
+static ImportEntry Unpack(const ImportIndex::Slot& slot) {
+    // The day comes back sign-extended from 24 bits
+    int32_t day = static_cast<int32_t>(static_cast<uint32_t>(slot.place & dayMask) << 8) >> 8;
+    return ImportEntry{ slot.key, slot.place >> 24, day };
+}
+
+// A slot from the high half of the key, scaled to the table without a
+// division; the Bloom filter uses other bits
+static uint64_t Home(uint64_t key, uint64_t slotCount) {
+    return ((key >> 32) * slotCount) >> 32;
+}
+
+// The block from the low half of the key; the bits in it, 9 per probe,
+// from the key mixed again
+static uint64_t BloomBlock(uint64_t key, uint64_t blocks) {
+    return (key & 0xffffffffu) % blocks;
+}
+
+static uint64_t BloomBits(uint64_t key) {
+    return Mix(key ^ 0x9e3779b97f4a7c15ull);
+}
+
+static void BloomSet(uint64_t* words, uint64_t blocks, uint64_t key) {
+    uint64_t* w = words + BloomBlock(key, blocks) * bloomBlockWords;
+    uint64_t h = BloomBits(key);
+    for (unsigned i = 0; i < bloomProbes; ++i, h >>= 9) w[(h >> 6) & 7] |= uint64_t(1) << (h & 63);
+}
+
+uint64_t DescriptionHash(std::string_view description) {
+    // FNV-1a over the words, upper-cased and joined by single spaces;
+    // bytes of UTF-8 sequences count as letters
+    uint64_t hash = 0xcbf29ce484222325ull;
+    bool started = false, gap = false;
+    for (char c : description) {
+        unsigned char u = static_cast<unsigned char>(c);
+        bool letter = (u >= '0' && u <= '9') || (u >= 'A' && u <= 'Z') || (u >= 'a' && u <= 'z') || u >= 0x80;
+        if (!letter) {
+            gap = started;
+            continue;
+        }
+        if (gap) hash = (hash ^ ' ') * 0x100000001b3ull;
+        if (u >= 'a' && u <= 'z') u = static_cast<unsigned char>(u - 'a' + 'A');
+        hash = (hash ^ u) * 0x100000001b3ull;
+        started = true;
+        gap = false;
+    }
+    return hash;
+}
+
+uint64_t ImportIndex::Key(uint64_t description, int64_t amount, int32_t day) {
+    return BucketKey(description, amount, Bucket(day));
+}
+
+static std::string BasePath(const std::string& snapshotPath) {
+    return snapshotPath + ".imported";
+}
+
+static std::string LogPath(const std::string& snapshotPath) {
+    return snapshotPath + ".imported.log";
+}
+
+bool ImportIndex::OpenBase(const std::string& path) {
+    if (!file.Open(path)) return false;
+
+    ImportIndexHeader header;
+    bool ok = file.Size() >= sizeof(header);
+    if (ok) {
+        std::memcpy(&header, file.Data(), sizeof(header));
+        ok = std::memcmp(header.magic, baseMagic, sizeof(baseMagic)) == 0 && header.slotCount < (uint64_t(1) << 32) &&
+             header.bloomBlocks > 0 && header.bloomBlocks < (uint64_t(1) << 32) &&
+             header.entryCount < header.slotCount &&
+             file.Size() == sizeof(header) + header.bloomBlocks * bloomBlockWords * 8 + header.slotCount * sizeof(Slot);
+    }
+    if (!ok) {
+        file.Close();
+        return false;
+    }
+
+    baseCount = header.entryCount;
+    slotCount = header.slotCount;
+    bloomBlocks = header.bloomBlocks;
+    bloom = reinterpret_cast<const uint64_t*>(file.Data() + sizeof(header));
+    slots = reinterpret_cast<const Slot*>(bloom + bloomBlocks * bloomBlockWords);
+    return true;
+}
+
+bool ImportIndex::Open(const std::string& path) {
+    Close();
+    snapshotPath = path;
+
+    std::error_code ec;
+    bool ok = true;
+    if (fs::exists(BasePath(path), ec)) ok = OpenBase(BasePath(path));
+
+    // The log: its magic, then whole entries; a torn last append is cut off
+    std::string logPath = LogPath(path);
+    if (std::FILE* f = std::fopen(logPath.c_str(), "rb")) {
+        char magic[sizeof(logMagic)];
+        bool valid = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                     std::memcmp(magic, logMagic, sizeof(logMagic)) == 0;
+        Slot buffer[4096];
+        size_t n;
+        while (valid && (n = std::fread(buffer, sizeof(Slot), 4096, f)) > 0) {
+            for (size_t i = 0; i < n; ++i) {
+                if (buffer[i].key != 0) log.push_back(buffer[i]);
+            }
+        }
+        std::fclose(f);
+
+        uint64_t whole = sizeof(logMagic) + log.size() * sizeof(Slot);
+        if (!valid) {
+            fs::remove(logPath, ec);
+            log.clear();
+            ok = false;
+        } else if (fs::file_size(logPath, ec) != whole) {
+            fs::resize_file(logPath, whole, ec);
+        }
+        std::sort(log.begin(), log.end(), [](const Slot& a, const Slot& b) { return a.key < b.key; });
+    }
+    return ok;
+}
+
+void ImportIndex::Close() {
+    file.Close();
+    baseCount = slotCount = bloomBlocks = 0;
+    bloom = nullptr;
+    slots = nullptr;
+    log.clear();
+}
+
+bool ImportIndex::MayContain(uint64_t key) const {
+    const uint64_t* w = bloom + BloomBlock(key, bloomBlocks) * bloomBlockWords;
+    uint64_t h = BloomBits(key);
+    for (unsigned i = 0; i < bloomProbes; ++i, h >>= 9) {
+        if ((w[(h >> 6) & 7] & (uint64_t(1) << (h & 63))) == 0) return false;
+    }
+    return true;
+}
+
+void ImportIndex::FindKey(uint64_t key, int32_t first, int32_t last, std::vector<ImportEntry>& out) const {
+    auto take = [&](const Slot& slot) {
+        ImportEntry entry = Unpack(slot);
+        if (entry.day >= first && entry.day <= last) out.push_back(entry);
+    };
+    if (baseCount > 0 && MayContain(key)) {
+        for (uint64_t i = Home(key, slotCount); slots[i].key != 0; i = i + 1 == slotCount ? 0 : i + 1) {
+            if (slots[i].key == key) take(slots[i]);
+        }
+    }
+    auto it = std::lower_bound(log.begin(), log.end(), key, [](const Slot& slot, uint64_t k) { return slot.key < k; });
+    for (; it != log.end() && it->key == key; ++it) take(*it);
+}
+
+void ImportIndex::Find(uint64_t description, int64_t amount, int32_t day, int32_t window,
+                       std::vector<ImportEntry>& out) const {
+    window = std::clamp(window, 0, maxWindowDays);
+    int32_t first = day - window, last = day + window;
+    for (int32_t bucket = Bucket(first); bucket <= Bucket(last); ++bucket) {
+        FindKey(BucketKey(description, amount, bucket), first, last, out);
+    }
+}
+
+// Writes entries as a new base under a temporary name and renames it over
+// path
+static bool WriteBase(const std::string& path, const std::vector<ImportEntry>& entries) {
+    uint64_t slotCount = std::max<uint64_t>(16, entries.size() + entries.size() / 2 + 1);
+    uint64_t blocks = std::max<uint64_t>(1, (entries.size() * bloomBitsPerEntry + 511) / 512);
+    std::vector<uint64_t> bloom(blocks * bloomBlockWords, 0);
+    std::vector<ImportIndex::Slot> slots(slotCount, ImportIndex::Slot{ 0, 0 });
+    for (const ImportEntry& entry : entries) {
+        BloomSet(bloom.data(), blocks, entry.key);
+        uint64_t i = Home(entry.key, slotCount);
+        while (slots[i].key != 0) i = i + 1 == slotCount ? 0 : i + 1;
+        slots[i] = Pack(entry);
+    }
+
+    ImportIndexHeader header;
+    std::memcpy(header.magic, baseMagic, sizeof(baseMagic));
+    header.entryCount = entries.size();
+    header.slotCount = slotCount;
+    header.bloomBlocks = blocks;
+
+    std::string temp = path + ".tmp";
+    std::FILE* f = std::fopen(temp.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+              std::fwrite(bloom.data(), 8, bloom.size(), f) == bloom.size() &&
+              std::fwrite(slots.data(), sizeof(ImportIndex::Slot), slots.size(), f) == slots.size() && SyncFile(f);
+    ok = std::fclose(f) == 0 && ok;
+
+    std::error_code ec;
+    if (ok) fs::rename(temp, path, ec);
+    if (!ok || ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ImportIndex::Add(const std::vector<ImportEntry>& entries, const TransactionStore& store) {
+    if (entries.empty()) return true;
+    if (snapshotPath.empty()) return false;
+
+    std::vector<Slot> added;
+    added.reserve(entries.size());
+    for (const ImportEntry& entry : entries) added.push_back(Pack(entry));
+    auto byKey = [](const Slot& a, const Slot& b) { return a.key < b.key; };
+    std::sort(added.begin(), added.end(), byKey);
+    size_t middle = log.size();
+    log.insert(log.end(), added.begin(), added.end());
+    std::inplace_merge(log.begin(), log.begin() + middle, log.end(), byKey);
+
+    // The entries go to the log file even when a fold follows, so they are
+    // on disk whether or not the fold manages to write a new base
+    bool ok = false;
+    if (std::FILE* f = std::fopen(LogPath(snapshotPath).c_str(), "ab")) {
+        std::fseek(f, 0, SEEK_END);
+        ok = (std::ftell(f) > 0 || std::fwrite(logMagic, sizeof(logMagic), 1, f) == 1) &&
+             std::fwrite(added.data(), sizeof(Slot), added.size(), f) == added.size() && SyncFile(f);
+        ok = std::fclose(f) == 0 && ok;
+    }
+
+    if (log.size() > std::max<uint64_t>(minFoldEntries, baseCount / 4)) return Fold(store);
+    return ok;
+}
+
+bool ImportIndex::Fold(const TransactionStore& store) {
+    if (snapshotPath.empty()) return false;
+
+    std::vector<ImportEntry> entries;
+    entries.reserve(baseCount + log.size());
+    auto keep = [&](const Slot& slot) {
+        ImportEntry entry = Unpack(slot);
+        size_t at;
+        if (store.FindId(entry.id, at)) entries.push_back(entry);
+    };
+    for (uint64_t i = 0; i < slotCount; ++i) {
+        if (slots[i].key != 0) keep(slots[i]);
+    }
+    for (const Slot& slot : log) keep(slot);
+
+    // The mapping must go before the file is replaced on Windows; a failed
+    // write leaves the old base and the log to be read again, and the
+    // entries in memory, some perhaps never logged, are kept as they were
+    std::string path = snapshotPath;
+    std::vector<Slot> unfolded = log;
+    Close();
+    bool ok = WriteBase(BasePath(path), entries);
+    std::error_code ec;
+    if (ok) fs::remove(LogPath(path), ec);
+    bool reopened = Open(path);
+    if (!ok) log = std::move(unfolded);
+    return reopened && ok;
+}
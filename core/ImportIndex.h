@@ -0,0 +1,92 @@
+#pragma once
+
+// Fingerprints of the statement rows already imported into a ledger, so an
+// overlapping statement imported again only adds its new rows. A row's
+// fingerprint is its day, its signed amount and its description normalized
+// (letters upper-cased, runs of spaces and punctuation made one space), and
+// it remembers the ledger id the row became.
+//
+// Entries are found by key: a hash of the description, the amount and the
+// day's bucket of bucketDays days. Looking for a row within a few days of
+// its date looks at the one or two buckets the window covers, and each key
+// holds only the rows of one merchant, amount and week, so a lookup does a
+// bounded amount of work however large the ledger is.
+//
+// The index is two files next to the snapshot. The base is memory-mapped:
+// a blocked Bloom filter over the keys (about 10 bits per entry, one cache
+// line per test) that turns away most new rows before the table is touched,
+// then an open-addressing table of 16-byte entries, at most two thirds
+// full. Entries added since are appended to a log, held in memory, and
+// folded into a new base once they make up a quarter of it, dropping those
+// whose ledger row is gone; like the journal, each entry is rewritten a
+// bounded number of times.
+//
+//   transactions.fsnap.imported       the base
+//   transactions.fsnap.imported.log   entries added since
+
+#include "MappedFile.h"
+#include "TransactionStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ImportEntry {
+    uint64_t key;               // ImportIndex::Key; never 0
+    uint64_t id;                // the ledger row
+    int32_t day;
+};
+
+// Hash of the normalized description
+uint64_t DescriptionHash(std::string_view description);
+
+class ImportIndex {
+public:
+    static constexpr int32_t bucketDays = 8;
+    static constexpr int32_t maxWindowDays = 31;
+
+    static uint64_t Key(uint64_t description, int64_t amount, int32_t day);
+
+    // Maps the base and reads the log. Missing files are an empty index;
+    // false if a file is malformed, which is then ignored.
+    bool Open(const std::string& snapshotPath);
+    void Close();
+
+    uint64_t Size() const { return baseCount + log.size(); }
+    uint64_t LogSize() const { return log.size(); }
+
+    // Appends the entries whose rows have the same description and amount
+    // and a day at most window days from day
+    void Find(uint64_t description, int64_t amount, int32_t day, int32_t window, std::vector<ImportEntry>& out) const;
+
+    // Logs new entries, folding the log into the base when it has grown;
+    // store says which rows are still there. False if a file cannot be
+    // written, and the entries are then only remembered until Close.
+    bool Add(const std::vector<ImportEntry>& entries, const TransactionStore& store);
+
+    // Writes every entry still in store into a new base and empties the log
+    bool Fold(const TransactionStore& store);
+
+    // An entry as the files keep it: the id in the high 40 bits of place
+    // and the day in the low 24
+    struct Slot {
+        uint64_t key;
+        uint64_t place;
+    };
+
+private:
+    bool OpenBase(const std::string& path);
+    bool MayContain(uint64_t key) const;
+    void FindKey(uint64_t key, int32_t first, int32_t last, std::vector<ImportEntry>& out) const;
+
+    std::string snapshotPath;
+    MappedFile file;
+    uint64_t baseCount = 0;
+    uint64_t slotCount = 0;
+    uint64_t bloomBlocks = 0;
+    const uint64_t* bloom = nullptr;
+    const Slot* slots = nullptr;
+    std::vector<Slot> log;      // sorted by key
+};
@@ -0,0 +1,398 @@
+#include "Journal.h"
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+static constexpr size_t minCompactRecords = 4096;
+
+static bool WriteAndSync(const std::string& path, const char* mode, const std::string& text) {
+    std::FILE* f = std::fopen(path.c_str(), mode);
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(text.data(), 1, text.size(), f) == text.size() && SyncFile(f);
+    return std::fclose(f) == 0 && ok;
+}
+
+static const char* TrimLine(const char* begin, const char* end) {
+    return (end > begin && end[-1] == '\r') ? end - 1 : end;
+}
+
+template <typename T>
+static bool ParseNumber(const char*& p, const char* end, T& value) {
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+}
+
+bool IsJournalCheckpoint(const char* begin, const char* end) {
+    end = TrimLine(begin, end);
+    return end - begin == 1 && *begin == 'C';
+}
+
+bool ParseJournalLine(const char* begin, const char* end, JournalRecord& record) {
+    end = TrimLine(begin, end);
+    if (end - begin < 2 || begin[1] != ',') return false;
+
+    const char* p = begin + 2;
+    switch (*begin) {
+        case 'I':
+        case 'E':
+            record.op = static_cast<JournalOp>(*begin);
+            record.index = 0;
+            if (!ParseNumber(p, end, record.id) || p == end || *p != ',') return false;
+            return ParseLedgerLine(p + 1, end, record.row);
+
+        case 'X':
+            record.op = JournalOp::Remove;
+            record.index = 0;
+            record.row = LedgerRow();
+            return ParseNumber(p, end, record.id) && p == end;
+
+        case 'A':
+            record.op = JournalOp::Add;
+            record.id = 0;
+            record.index = 0;
+            return ParseLedgerLine(p, end, record.row);
+
+        case 'U':
+            record.op = JournalOp::Update;
+            record.id = 0;
+            if (!ParseNumber(p, end, record.index) || p == end || *p != ',') return false;
+            return ParseLedgerLine(p + 1, end, record.row);
+
+        case 'D':
+            record.op = JournalOp::Delete;
+            record.id = 0;
+            record.row = LedgerRow();
+            return ParseNumber(p, end, record.index) && p == end;
+    }
+    return false;
+}
+
+static bool EndsWithCheckpoint(const std::string& path) {
+    LedgerLoader loader;
+    if (!loader.Open(path)) return false;
+
+    const char* data = loader.Data();
+    const char* end = data + loader.Size();
+    while (end > data && (end[-1] == '\n' || end[-1] == '\r')) --end;
+
+    const char* begin = end;
+    while (begin > data && begin[-1] != '\n') --begin;
+    return IsJournalCheckpoint(begin, end);
+}
+
+Journal::Journal(std::string snapshotPath) : snapshotPath(std::move(snapshotPath)) {}
+
+Journal::~Journal() {
+    Close();
+}
+
+std::vector<std::string> Journal::RotatedJournals() const {
+    fs::path journal = fs::path(JournalPath());
+    fs::path dir = journal.parent_path().empty() ? fs::path(".") : journal.parent_path();
+    std::string prefix = journal.filename().string() + ".";
+
+    std::vector<std::pair<unsigned long long, std::string>> found;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), last; !ec && it != last; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+
+        unsigned long long generation = 0;
+        const char* first = name.data() + prefix.size();
+        const char* end = name.data() + name.size();
+        auto result = std::from_chars(first, end, generation);
+        if (result.ec == std::errc() && result.ptr == end) {
+            found.emplace_back(generation, it->path().string());
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    std::vector<std::string> paths;
+    for (auto& entry : found) paths.push_back(std::move(entry.second));
+    return paths;
+}
+
+void Journal::Recover() {
+    std::vector<std::string> rotated = RotatedJournals();
+    std::error_code ec;
+
+    // The newest checkpointed journal marks a snapshot that was fully written
+    size_t folded = rotated.size();
+    for (size_t i = rotated.size(); i-- > 0;) {
+        if (EndsWithCheckpoint(rotated[i])) {
+            folded = i;
+            break;
+        }
+    }
+
+    if (folded == rotated.size()) {
+        fs::remove(TempPath(), ec);
+        return;
+    }
+
+    if (fs::exists(TempPath(), ec)) {
+        fs::rename(TempPath(), snapshotPath, ec);
+        if (ec) return;
+    }
+
+    // Delete the checkpointed journal last so a crash here stays recoverable
+    bool removed = true;
+    for (size_t i = 0; removed && i < folded; ++i) {
+        removed = fs::remove(rotated[i], ec) && !ec;
+    }
+    if (removed) fs::remove(rotated[folded], ec);
+}
+
+bool Journal::Open() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (file == nullptr) {
+        file = std::fopen(JournalPath().c_str(), "ab");
+    }
+    healthy = file != nullptr;
+
+    if (!flusher.joinable()) {
+        stopping = false;
+        flusher = std::thread(&Journal::FlushLoop, this);
+    }
+    return healthy;
+}
+
+void Journal::Close() {
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        stopping = true;
+    }
+    bufferReady.notify_all();
+    if (flusher.joinable()) flusher.join();
+
+    Flush();
+    if (compactor.joinable()) compactor.join();
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void Journal::Append(const std::string& line) {
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        pending += line;
+        ++pendingRecords;
+        ++recordCount;
+        notify = pendingRecords >= batchSize;
+    }
+    if (notify) bufferReady.notify_one();
+}
+
+void Journal::AppendInsert(std::string& out, uint64_t id, std::string_view type, Money amount,
+                           std::string_view category, std::string_view date) {
+    out += "I,";
+    out += std::to_string(id);
+    out += ',';
+    AppendLedgerRow(out, type, amount, category, date);
+}
+
+void Journal::LogInsert(uint64_t id, std::string_view type, Money amount, std::string_view category, std::string_view date) {
+    std::string line;
+    AppendInsert(line, id, type, amount, category, date);
+    Append(line);
+}
+
+void Journal::LogLines(const std::string& lines, size_t records) {
+    if (records == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        pending += lines;
+        pendingRecords += records;
+        recordCount += records;
+    }
+    bufferReady.notify_one();
+}
+
+void Journal::LogEdit(uint64_t id, std::string_view type, Money amount, std::string_view category, std::string_view date) {
+    std::string line = "E," + std::to_string(id) + ",";
+    AppendLedgerRow(line, type, amount, category, date);
+    Append(line);
+}
+
+void Journal::LogRemove(uint64_t id) {
+    Append("X," + std::to_string(id) + "\n");
+}
+
+bool Journal::WritePending() {
+    std::string batch;
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        if (pending.empty()) return healthy;
+        batch.swap(pending);
+        pendingRecords = 0;
+    }
+
+    // One write and one fsync for the whole group
+    bool ok = file != nullptr &&
+              std::fwrite(batch.data(), 1, batch.size(), file) == batch.size() &&
+              SyncFile(file);
+    if (!ok) healthy = false;
+    return ok;
+}
+
+void Journal::FlushLoop() {
+    std::unique_lock<std::mutex> lock(bufferMutex);
+    while (!stopping) {
+        bufferReady.wait_for(lock, std::chrono::milliseconds(commitWindowMs),
+                             [this] { return stopping || pendingRecords >= batchSize; });
+        if (pending.empty()) continue;
+
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> fileLock(fileMutex);
+            WritePending();
+        }
+        lock.lock();
+    }
+}
+
+bool Journal::Flush() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    WritePending();
+    return healthy;
+}
+
+size_t Journal::RecordCount() const {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    return recordCount;
+}
+
+bool Journal::ShouldCompact(size_t liveRows) const {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    return !compacting && recordCount >= std::max(minCompactRecords, liveRows / 2);
+}
+
+bool Journal::LastCompactionFailed() const {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    return compactionFailed;
+}
+
+bool Journal::IsCompacting() const {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    return compacting;
+}
+
+bool Journal::Healthy() const {
+    return healthy;
+}
+
+void Journal::WaitForCompaction() {
+    if (compactor.joinable()) compactor.join();
+}
+
+bool Journal::StartCompaction(SnapshotWriter writeSnapshot, std::function<void(bool ok)> onFinished) {
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        if (compacting || checkpointStranded) return false;
+    }
+    if (compactor.joinable()) compactor.join();
+
+    std::vector<std::string> folded;
+    {
+        // Rotate the active journal; later records go to a fresh file
+        std::lock_guard<std::mutex> lock(fileMutex);
+        WritePending();
+        if (file != nullptr) {
+            std::fclose(file);
+            file = nullptr;
+        }
+
+        folded = RotatedJournals();
+        unsigned long long generation = 1;
+        if (!folded.empty()) {
+            std::string last = folded.back();
+            generation = std::stoull(last.substr(last.rfind('.') + 1)) + 1;
+        }
+        std::string rotated = JournalPath() + "." + std::to_string(generation);
+
+        std::error_code ec;
+        if (fs::exists(JournalPath(), ec)) {
+            fs::rename(JournalPath(), rotated, ec);
+        } else {
+            WriteAndSync(rotated, "wb", std::string());
+        }
+        if (!ec) folded.push_back(rotated);
+
+        file = std::fopen(JournalPath().c_str(), "ab");
+        if (file == nullptr) healthy = false;
+        if (ec) return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        // The folded records stay counted until the snapshot is in place
+        compacting = true;
+        foldingRecords = recordCount;
+    }
+    compactor = std::thread(&Journal::Compact, this, std::move(writeSnapshot), std::move(onFinished), std::move(folded));
+    return true;
+}
+
+void Journal::Compact(SnapshotWriter writeSnapshot, std::function<void(bool ok)> onFinished,
+                      std::vector<std::string> folded) {
+    std::error_code ec;
+    bool ok = writeSnapshot(TempPath());
+    uintmax_t uncheckpointed = 0;
+    if (ok) {
+        uncheckpointed = fs::file_size(folded.back(), ec);
+        ok = !ec;
+    }
+    bool checkpointing = ok;
+    if (ok) ok = WriteAndSync(folded.back(), "ab", "C\n");
+    if (ok) {
+        fs::rename(TempPath(), snapshotPath, ec);
+        ok = !ec;
+    }
+
+    // A checkpoint vouches for the tmp file. Without the rename behind it,
+    // it comes off again (a failed append may have left part of it), or a
+    // later attempt would replace the tmp file and Recover would then drop
+    // journals whose records never reached the snapshot.
+    bool stranded = false;
+    if (checkpointing && !ok) {
+        fs::resize_file(folded.back(), uncheckpointed, ec);
+        stranded = static_cast<bool>(ec);
+    }
+
+    if (ok) {
+        // The checkpointed journal goes last, and only once the older
+        // ones are gone, so a leftover journal is never replayed twice
+        bool removed = true;
+        for (size_t i = 0; removed && i + 1 < folded.size(); ++i) {
+            removed = fs::remove(folded[i], ec) && !ec;
+        }
+        if (removed) fs::remove(folded.back(), ec);
+    } else if (!stranded) {
+        // Leave the rotated journals in place; they are replayed next start
+        fs::remove(TempPath(), ec);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        compacting = false;
+        // A stranded checkpoint keeps its tmp file for Recover; no later
+        // compaction may write over it
+        checkpointStranded = checkpointStranded || stranded;
+        compactionFailed = !ok;
+        if (ok) recordCount -= foldingRecords;
+        foldingRecords = 0;
+    }
+    if (onFinished) onFinished(ok);
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+// Append-only journal of ledger mutations kept next to the snapshot file.
+//
+// Files, for a snapshot "transactions.txt":
+//   transactions.txt.journal      active journal, appended to
+//   transactions.txt.journal.<n>  rotated journals waiting to be folded
+//   transactions.txt.tmp          snapshot being written by compaction
+//
+// Compaction rotates the active journal, has the caller's writer stream a
+// full snapshot to the tmp file on the compaction thread, appends a
+// checkpoint record to the newest rotated journal, renames the tmp file
+// over the snapshot and finally deletes the rotated journals.
+// A rotated journal ending in a checkpoint is therefore known to be folded
+// into the snapshot, which makes every crash point recoverable.
+
+#include "LedgerLoader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Records name rows by their stable id. Add, Update and Delete name them
+// by position instead; they are only read, from journals written before ids.
+enum class JournalOp : char {
+    Insert = 'I',
+    Edit = 'E',
+    Remove = 'X',
+    Add = 'A',
+    Update = 'U',
+    Delete = 'D'
+};
+
+struct JournalRecord {
+    JournalOp op;
+    uint64_t id;        // Insert / Edit / Remove
+    size_t index;       // Update / Delete
+    LedgerRow row;      // Insert / Edit / Add / Update
+};
+
+class Journal {
+public:
+    explicit Journal(std::string snapshotPath);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    const std::string& SnapshotPath() const { return snapshotPath; }
+
+    // Finishes or rolls back a compaction interrupted by a crash. Call before
+    // loading the snapshot.
+    void Recover();
+
+    // Calls onRecord(const JournalRecord&) for every record not yet folded
+    // into the snapshot, oldest first. Call after loading the snapshot.
+    template <typename Fn>
+    void Replay(Fn&& onRecord);
+
+    // Opens the active journal for appending and starts the group-commit thread
+    bool Open();
+    void Close();
+
+    void LogInsert(uint64_t id, std::string_view type, Money amount, std::string_view category, std::string_view date);
+    void LogEdit(uint64_t id, std::string_view type, Money amount, std::string_view category, std::string_view date);
+    void LogRemove(uint64_t id);
+
+    // Appends records already in journal form, one per line, as one group;
+    // bulk inserts log through this rather than a record at a time
+    void LogLines(const std::string& lines, size_t records);
+
+    // The journal line of an insert, for LogLines
+    static void AppendInsert(std::string& out, uint64_t id, std::string_view type, Money amount,
+                             std::string_view category, std::string_view date);
+
+    // Writes and syncs every pending record. Returns false on I/O failure.
+    bool Flush();
+
+    // Records not yet folded into the snapshot; those of a running or failed
+    // compaction still count
+    size_t RecordCount() const;
+    bool ShouldCompact(size_t liveRows) const;
+
+    // Writes the full ledger as of the last logged record to the given path
+    // and syncs it; runs on the compaction thread
+    using SnapshotWriter = std::function<bool(const std::string& path)>;
+
+    // Starts folding the journal into a new snapshot on a background thread.
+    // onFinished, if set, is called on that thread with the outcome once the
+    // snapshot is in place (or the attempt was abandoned).
+    bool StartCompaction(SnapshotWriter writeSnapshot, std::function<void(bool ok)> onFinished = nullptr);
+    bool IsCompacting() const;
+
+    // The last compaction did not get its snapshot in place
+    bool LastCompactionFailed() const;
+
+    // Blocks until a running compaction has finished
+    void WaitForCompaction();
+
+    bool Healthy() const;
+
+    // Records are grouped into one fsync when this many are pending, or
+    // after commitWindowMs milliseconds, whichever comes first
+    static constexpr size_t batchSize = 256;
+    static constexpr int commitWindowMs = 50;
+
+private:
+    std::string JournalPath() const { return snapshotPath + ".journal"; }
+    std::string TempPath() const { return snapshotPath + ".tmp"; }
+    std::vector<std::string> RotatedJournals() const;
+
+    void Append(const std::string& line);
+    bool WritePending();   // requires fileMutex
+    void FlushLoop();
+    void Compact(SnapshotWriter writeSnapshot, std::function<void(bool ok)> onFinished,
+                 std::vector<std::string> folded);
+
+    template <typename Fn>
+    static void ReplayFile(const std::string& path, Fn& onRecord);
+
+    std::string snapshotPath;
+
+    mutable std::mutex bufferMutex;
+    std::condition_variable bufferReady;
+    std::string pending;
+    size_t pendingRecords = 0;
+    size_t recordCount = 0;
+    size_t foldingRecords = 0;
+    bool compactionFailed = false;
+    bool checkpointStranded = false;   // a checkpoint outlived a failed rename
+    bool stopping = false;
+
+    std::mutex fileMutex;
+    std::FILE* file = nullptr;
+    std::atomic<bool> healthy{true};
+
+    std::thread flusher;
+    std::thread compactor;
+    bool compacting = false;
+};
+
+// Parses one journal line. Returns false for checkpoints and malformed lines.
+bool ParseJournalLine(const char* begin, const char* end, JournalRecord& record);
+bool IsJournalCheckpoint(const char* begin, const char* end);
+
+template <typename Fn>
+void Journal::ReplayFile(const std::string& path, Fn& onRecord) {
+    LedgerLoader loader;
+    if (!loader.Open(path)) return;
+
+    // Only records after the last checkpoint still need replaying
+    const char* data = loader.Data();
+    const char* end = data + loader.Size();
+    const char* start = data;
+    for (const char* p = data; p < end;) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+        if (IsJournalCheckpoint(p, eol)) start = eol + 1;
+        p = eol + 1;
+    }
+
+    JournalRecord record;
+    for (const char* p = start; p < end;) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+        if (ParseJournalLine(p, eol, record)) onRecord(record);
+        p = eol + 1;
+    }
+}
+
+template <typename Fn>
+void Journal::Replay(Fn&& onRecord) {
+    size_t count = 0;
+    auto counted = [&](const JournalRecord& record) {
+        onRecord(record);
+        ++count;
+    };
+
+    for (const auto& path : RotatedJournals()) {
+        ReplayFile(path, counted);
+    }
+    ReplayFile(JournalPath(), counted);
+
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    recordCount = count;
+}
@@ -0,0 +1,274 @@
+#include "Ledger.h"
+
+#include "Date.h"
+#include "ParallelLoader.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+// Dead slots are compacted away once they make up a quarter of the store
+static constexpr size_t minCompactDeadRows = 1024;
+
+Ledger::Ledger(std::string snapshotPath) : journal(std::move(snapshotPath)) {}
+
+Ledger::~Ledger() {
+    if (rowCompactor.joinable()) rowCompactor.join();
+}
+
+LedgerLoadResult Ledger::Load(const std::string& legacyPath) {
+    LedgerLoadResult result;
+    FinishRowCompaction();
+    transactions.Clear();
+    journal.Recover();
+
+    SnapshotReader snapshot;
+    result.fromSnapshot = snapshot.Open(SnapshotPath());
+
+    if (result.fromSnapshot) {
+        transactions.LoadSnapshot(snapshot);
+    } else {
+        // Keep a damaged snapshot aside instead of overwriting it
+        std::error_code ec;
+        if (fs::exists(SnapshotPath(), ec)) {
+            result.damaged = true;
+            result.damagedPath = SnapshotPath() + ".bad";
+            fs::rename(SnapshotPath(), result.damagedPath, ec);
+        }
+        if (!legacyPath.empty()) LoadLegacy(legacyPath);
+        result.imported = !transactions.Empty();
+    }
+
+    // Apply the changes made since the snapshot was written
+    journal.Replay([this](const JournalRecord& record) { Apply(record); });
+    journal.Open();
+
+    // Write the first binary snapshot right away after an import
+    if (result.imported) Compact(true);
+    return result;
+}
+
+void Ledger::LoadLegacy(const std::string& legacyPath) {
+    // transactions.txt and its journal from before the binary snapshot
+    Journal legacy(legacyPath);
+    legacy.Recover();
+
+    LedgerLoader loader;
+    if (loader.Open(legacy.SnapshotPath())) {
+        ParallelLoad(loader.Data(), loader.Size(), transactions);
+    }
+
+    legacy.Replay([this](const JournalRecord& record) { Apply(record); });
+}
+
+void Ledger::Apply(const JournalRecord& record) {
+    size_t slot;
+    switch (record.op) {
+        case JournalOp::Insert:
+            if (!transactions.FindId(record.id, slot)) {
+                transactions.Append(transactions.MakeRow(record.row), record.id);
+            }
+            break;
+        case JournalOp::Edit:
+            if (transactions.FindId(record.id, slot)) {
+                transactions.Update(slot, transactions.MakeRow(record.row));
+            }
+            break;
+        case JournalOp::Remove:
+            if (transactions.FindId(record.id, slot)) {
+                transactions.Erase(slot);
+            }
+            break;
+
+        // Positions count live rows, as the table showed them
+        case JournalOp::Add:
+            transactions.Append(transactions.MakeRow(record.row));
+            break;
+        case JournalOp::Update:
+            if (record.index < transactions.Size()) {
+                transactions.Update(transactions.SlotAt(record.index), transactions.MakeRow(record.row));
+            }
+            break;
+        case JournalOp::Delete:
+            if (record.index < transactions.Size()) {
+                transactions.Erase(transactions.SlotAt(record.index));
+            }
+            break;
+    }
+}
+
+uint64_t Ledger::Add(const TransactionStore::Row& row) {
+    FinishRowCompaction();
+    size_t slot = transactions.Append(row);
+    LogRow(JournalOp::Insert, slot);
+    Compact();
+    return transactions.Id(slot);
+}
+
+void Ledger::AddColumns(TransactionColumns&& columns) {
+    FinishRowCompaction();
+    size_t first = transactions.SlotCount();
+    transactions.AppendColumns(std::move(columns));
+
+    std::string lines;
+    char date[16];
+    for (size_t slot = first; slot < transactions.SlotCount(); ++slot) {
+        TransactionStore::Row row = transactions.Get(slot);
+        Journal::AppendInsert(lines, transactions.Id(slot), TypeName(row.type), row.amount,
+                              transactions.CategoryName(row.category),
+                              std::string_view(date, FormatDate(row.day, date)));
+    }
+    journal.LogLines(lines, transactions.SlotCount() - first);
+    Compact();
+}
+
+bool Ledger::Update(uint64_t id, const TransactionStore::Row& row) {
+    FinishRowCompaction();
+    size_t slot;
+    if (!transactions.FindId(id, slot)) return false;
+    transactions.Update(slot, row);
+    LogRow(JournalOp::Edit, slot);
+    Compact();
+    return true;
+}
+
+void Ledger::Put(uint64_t id, const TransactionStore::Row& row) {
+    FinishRowCompaction();
+    size_t slot;
+    if (transactions.FindId(id, slot)) {
+        transactions.Update(slot, row);
+        LogRow(JournalOp::Edit, slot);
+    } else {
+        slot = transactions.Append(row, id);
+        LogRow(JournalOp::Insert, slot);
+    }
+    Compact();
+}
+
+bool Ledger::Erase(uint64_t id) {
+    return Erase(std::vector<uint64_t>{ id }) == 1;
+}
+
+size_t Ledger::Erase(const std::vector<uint64_t>& ids) {
+    FinishRowCompaction();
+    std::vector<size_t> slots;
+    slots.reserve(ids.size());
+    for (uint64_t id : ids) {
+        size_t slot;
+        if (transactions.FindId(id, slot)) slots.push_back(slot);
+    }
+
+    size_t removed = transactions.Erase(slots);
+    for (size_t slot : slots) journal.LogRemove(transactions.Id(slot));
+    CompactRows();
+    Compact();
+    return removed;
+}
+
+void Ledger::LogRow(JournalOp op, size_t slot) {
+    TransactionStore::Row row = transactions.Get(slot);
+    char date[16];
+    std::string_view dateText(date, FormatDate(row.day, date));
+    std::string_view category = transactions.CategoryName(row.category);
+
+    if (op == JournalOp::Insert) {
+        journal.LogInsert(transactions.Id(slot), TypeName(row.type), row.amount, category, dateText);
+    } else {
+        journal.LogEdit(transactions.Id(slot), TypeName(row.type), row.amount, category, dateText);
+    }
+}
+
+void Ledger::CompactRows() {
+    size_t threshold = std::max(minCompactDeadRows, transactions.SlotCount() / 4);
+    if (rowCompactor.joinable() || transactions.DeadCount() < threshold) return;
+
+    // Only reads the store; every change waits for it in FinishRowCompaction
+    rowsCompacted = false;
+    rowCompactor = std::thread([this] {
+        compactedRows = transactions.PrepareCompaction();
+        rowsCompacted = true;
+    });
+}
+
+void Ledger::FinishRowCompaction() {
+    if (!rowCompactor.joinable()) return;
+    rowCompactor.join();
+    transactions.InstallCompaction(std::move(compactedRows));
+    compactedRows = TransactionStore::Compaction();
+}
+
+void Ledger::InstallCompactedRows() {
+    if (rowsCompacted) FinishRowCompaction();
+}
+
+bool Ledger::Save() {
+    // Changes are journaled as they happen, so once the last group is
+    // committed they are safe; the snapshot only saves replaying them.
+    // After a failed compaction the snapshot is stale, so always retry.
+    if (!journal.Flush()) return false;
+    InstallCompactedRows();
+    if (journal.RecordCount() == 0 && !journal.LastCompactionFailed()) return true;
+    return Compact(true);
+}
+
+void Ledger::StartQueuedSave() {
+    if (saveQueued && !journal.IsCompacting()) Compact(true);
+}
+
+bool Ledger::Compact(bool force) {
+    if (journal.IsCompacting()) {
+        saveQueued = saveQueued || force;
+        return true;
+    }
+    if (!force && !journal.ShouldCompact(transactions.Size())) return true;
+    saveQueued = false;
+
+#ifdef _WIN32
+    // Windows will not rename over a file that is mapped
+    transactions.OwnColumns();
+#endif
+
+    // The writer thread works from its own copy; the store keeps changing
+    auto image = std::make_shared<const TransactionStore::Image>(transactions.CopyImage());
+    auto write = [this, image](const std::string& path) {
+        const TransactionColumns& columns = image->columns;
+        return WriteSnapshotFile(path, columns.Size(), columns.types.data(), columns.amounts.data(),
+                                 columns.categories.data(), columns.days.data(), columns.ids.data(),
+                                 image->nextId, image->categories, image->rollups,
+                                 [this](uint64_t written, uint64_t total) {
+                                     Notify(SaveStatus::State::Saving, written, total);
+                                 });
+    };
+    auto finished = [this](bool ok) {
+        Notify(ok ? SaveStatus::State::Saved : SaveStatus::State::Failed, 0, 0);
+    };
+
+    return journal.StartCompaction(std::move(write), std::move(finished));
+}
+
+void Ledger::Notify(SaveStatus::State state, uint64_t written, uint64_t total) const {
+    if (!saveListener) return;
+    SaveStatus status;
+    status.state = state;
+    status.written = written;
+    status.total = total;
+    saveListener(status);
+}
+
+void Ledger::WaitForSave() {
+    journal.WaitForCompaction();
+    if (saveQueued) {
+        Compact(true);
+        journal.WaitForCompaction();
+    }
+}
+
+void Ledger::Close() {
+    FinishRowCompaction();
+    Save();
+    WaitForSave();
+    journal.Close();
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+// A ledger on disk: the transaction store together with its snapshot and
+// journal files. Loading recovers from an interrupted compaction, maps the
+// snapshot (or imports a legacy transactions.txt) and replays the journal;
+// every change afterwards is journaled as it is made. Saving writes a fresh
+// snapshot on the journal's compaction thread from a copy of the rows, so
+// the caller's thread only pays for the copy.
+//
+// Rows are addressed by their stable id. Deletes leave dead slots behind;
+// once enough pile up they are compacted away on a worker thread, and the
+// result is swapped in before the next change is made.
+
+#include "Journal.h"
+#include "TransactionStore.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct LedgerLoadResult {
+    bool fromSnapshot = false;  // the snapshot opened and verified
+    bool damaged = false;       // a snapshot existed but failed to verify
+    std::string damagedPath;    // where the damaged snapshot was moved
+    bool imported = false;      // rows came from the legacy CSV ledger
+};
+
+struct SaveStatus {
+    enum class State {
+        Saving,
+        Saved,
+        Failed
+    };
+
+    State state = State::Saving;
+    uint64_t written = 0;       // snapshot bytes written so far
+    uint64_t total = 0;
+};
+
+class Ledger {
+public:
+    explicit Ledger(std::string snapshotPath);
+    ~Ledger();
+
+    Ledger(const Ledger&) = delete;
+    Ledger& operator=(const Ledger&) = delete;
+
+    const std::string& SnapshotPath() const { return journal.SnapshotPath(); }
+
+    // Loads the ledger and opens its journal. A damaged snapshot is renamed
+    // to <snapshot>.bad instead of being overwritten. When there is no usable
+    // snapshot, legacyPath (if given) and its journal are imported and
+    // written out as the first snapshot.
+    LedgerLoadResult Load(const std::string& legacyPath = std::string());
+
+    const TransactionStore& Transactions() const { return transactions; }
+    TransactionStore::Row MakeRow(const LedgerRow& row) { return transactions.MakeRow(row); }
+    uint16_t InternCategory(std::string_view name) { return transactions.InternCategory(name); }
+
+    // Returns the new row's id
+    uint64_t Add(const TransactionStore::Row& row);
+
+    // Adds the rows in one bulk insert, numbering them if they carry no ids,
+    // and journals them as one group
+    void AddColumns(TransactionColumns&& columns);
+
+    // False, or 0 rows, when no live row has the id
+    bool Update(uint64_t id, const TransactionStore::Row& row);
+    bool Erase(uint64_t id);
+    size_t Erase(const std::vector<uint64_t>& ids);
+
+    // Replaces the live row with the id, or adds row under it; how sync
+    // takes a peer's rows
+    void Put(uint64_t id, const TransactionStore::Row& row);
+
+    // Called on the writer thread while a snapshot is written and once when
+    // it is done. It must not touch the ledger; hand the status over to the
+    // owning thread instead. Set it before Load.
+    using SaveListener = std::function<void(const SaveStatus&)>;
+    void SetSaveListener(SaveListener listener) { saveListener = std::move(listener); }
+
+    // Commits pending journal records and, if there are any since the last
+    // snapshot, starts writing a new one in the background. A save requested
+    // while one is running is queued, and any number of them collapse into
+    // one. Returns false on I/O failure.
+    bool Save();
+
+    // A snapshot is being written or one is queued
+    bool IsSaving() const { return saveQueued || journal.IsCompacting(); }
+
+    // Starts the queued save, if any, once the running one has finished.
+    // Call on the owning thread after a Saved or Failed status.
+    void StartQueuedSave();
+
+    // Blocks until the running save and the queued one, if any, are done
+    void WaitForSave();
+
+    // Folds the journal into a fresh snapshot in the background; forced
+    // requests made during a running compaction are queued. Returns false
+    // if the journal could not be rotated.
+    bool Compact(bool force = false);
+
+    // Swaps in compacted rows if the worker has finished; changes call
+    // this too, waiting for the worker if needed
+    void InstallCompactedRows();
+
+    // Saves, waits for the last snapshot to be written and stops the
+    // journal threads
+    void Close();
+
+private:
+    void LogRow(JournalOp op, size_t slot);
+    void Apply(const JournalRecord& record);
+    void FinishRowCompaction();
+    void CompactRows();
+    void LoadLegacy(const std::string& legacyPath);
+
+    void Notify(SaveStatus::State state, uint64_t written, uint64_t total) const;
+
+    TransactionStore transactions;
+    SaveListener saveListener;
+    bool saveQueued = false;
+
+    std::thread rowCompactor;
+    TransactionStore::Compaction compactedRows;
+    std::atomic<bool> rowsCompacted{false};
+
+    // Last, so it is destroyed first and its threads stop before anything
+    // they call into goes away
+    Journal journal;
+};
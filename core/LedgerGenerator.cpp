@@ -0,0 +1,91 @@
+#include "LedgerGenerator.h"
+
+#include "Date.h"
+
+GeneratorOptions::GeneratorOptions()
+    : firstDay(DaysFromCivil(2020, 1, 1)), lastDay(DaysFromCivil(2025, 12, 31)),
+      categories{ { "Food", 35 }, { "Rent", 5 }, { "Entertainment", 15 },
+                  { "Transportation", 20 }, { "Utilities", 10 }, { "Other", 15 } } {}
+
+LedgerGenerator::LedgerGenerator(const GeneratorOptions& options) : options(options) {
+    categories.Intern("N/A");
+
+    uint64_t total = 0;
+    for (const GeneratorCategory& category : options.categories) {
+        categories.Intern(category.name);
+        total += category.weight;
+        cumulativeWeights.push_back(total);
+    }
+    if (this->options.lastDay < this->options.firstDay) this->options.lastDay = this->options.firstDay;
+    Reset();
+}
+
+void LedgerGenerator::Reset() {
+    state = options.seed;
+    produced = 0;
+}
+
+uint64_t LedgerGenerator::Random() {
+    // splitmix64
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t LedgerGenerator::Below(uint64_t bound) {
+    // The modulo bias is far below anything a benchmark can notice
+    return bound == 0 ? 0 : Random() % bound;
+}
+
+bool LedgerGenerator::Next(TransactionStore::Row& row) {
+    if (produced >= options.rows) return false;
+
+    uint64_t span = static_cast<uint64_t>(options.lastDay - options.firstDay) + 1;
+    uint64_t offset = options.randomDates ? Below(span) : produced * span / options.rows;
+    row.day = options.firstDay + static_cast<int32_t>(offset);
+
+    if (Below(100) < options.incomePercent || cumulativeWeights.empty() || cumulativeWeights.back() == 0) {
+        // Salary-sized: 5,000.00 to 60,000.00
+        row.type = TransactionType::Income;
+        row.category = 0;
+        row.amount = Money::FromMinor(500000 + static_cast<int64_t>(Below(5500001)));
+    } else {
+        // Expenses spread evenly over magnitudes, from 1.00 up to 9,999.99
+        row.type = TransactionType::Expense;
+        uint64_t pick = Below(cumulativeWeights.back());
+        size_t index = 0;
+        while (cumulativeWeights[index] <= pick) ++index;
+        row.category = static_cast<uint16_t>(index + 1);
+
+        static const int64_t magnitudes[] = { 100, 1000, 10000, 100000 };
+        int64_t low = magnitudes[Below(4)];
+        row.amount = Money::FromMinor(low + static_cast<int64_t>(Below(static_cast<uint64_t>(low * 9))));
+    }
+
+    ++produced;
+    return true;
+}
+
+void LedgerGenerator::Fill(TransactionStore& store) {
+    std::vector<uint16_t> remap(categories.Size());
+    for (size_t id = 0; id < remap.size(); ++id) {
+        remap[id] = store.InternCategory(categories.Name(static_cast<uint16_t>(id)));
+    }
+
+    TransactionColumns columns;
+    size_t rows = static_cast<size_t>(options.rows - produced);
+    columns.types.reserve(rows);
+    columns.amounts.reserve(rows);
+    columns.categories.reserve(rows);
+    columns.days.reserve(rows);
+
+    TransactionStore::Row row;
+    while (Next(row)) {
+        columns.types.push_back(static_cast<uint8_t>(row.type));
+        columns.amounts.push_back(row.amount.Minor());
+        columns.categories.push_back(remap[row.category]);
+        columns.days.push_back(row.day);
+    }
+    store.AppendColumns(std::move(columns));
+}
@@ -0,0 +1,70 @@
+#include "LedgerLoader.h"
+
+#include <cstdio>
+
+static const char* FindComma(const char* p, const char* end) {
+    const char* comma = static_cast<const char*>(std::memchr(p, ',', end - p));
+    return comma != nullptr ? comma : end;
+}
+
+bool ParseLedgerLine(const char* begin, const char* end, LedgerRow& row) {
+    if (end > begin && end[-1] == '\r') --end;
+    if (begin == end) return false;
+
+    const char* typeEnd = FindComma(begin, end);
+    if (typeEnd == end) return false;
+
+    const char* amountBegin = typeEnd + 1;
+    const char* amountEnd = FindComma(amountBegin, end);
+    if (amountEnd == end) return false;
+
+    const char* categoryBegin = amountEnd + 1;
+    const char* categoryEnd = FindComma(categoryBegin, end);
+    if (categoryEnd == end) return false;
+
+    // Amount: plain or exponent-form decimal (the default wofstream
+    // formatting of old versions switched to 1.5e+06 for large values)
+    Money amount;
+    if (!Money::Parse(std::string_view(amountBegin, amountEnd - amountBegin), amount)) return false;
+
+    row.type = std::string_view(begin, typeEnd - begin);
+    row.amount = amount;
+    row.category = std::string_view(categoryBegin, categoryEnd - categoryBegin);
+    row.date = std::string_view(categoryEnd + 1, end - (categoryEnd + 1));
+    return true;
+}
+
+void AppendLedgerRow(std::string& out, std::string_view type, Money amount,
+                     std::string_view category, std::string_view date) {
+    char number[Money::maxFormattedLength];
+    size_t length = amount.Format(number);
+
+    out.append(type);
+    out += ',';
+    out.append(number, length);
+    out += ',';
+    out.append(category);
+    out += ',';
+    out.append(date);
+    out += '\n';
+}
+
+bool LedgerLoader::Open(const std::string& path) {
+    buffer.clear();
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+
+    // One allocation sized to the file, one read
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        long size = std::ftell(file);
+        if (size > 0) {
+            buffer.resize(static_cast<size_t>(size));
+            std::rewind(file);
+            buffer.resize(std::fread(buffer.data(), 1, buffer.size(), file));
+        }
+    }
+
+    std::fclose(file);
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// Portable loader for transactions.txt. Reads the whole file with a single
+// buffered read and parses the "Type,Amount,Category,Date" rows in place,
+// without any per-row heap allocation. No Win32 dependencies.
+
+#include "Money.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// One parsed ledger row. The views point into the loader's buffer and stay
+// valid until the loader is destroyed or re-opened.
+struct LedgerRow {
+    std::string_view type;
+    Money amount;
+    std::string_view category;
+    std::string_view date;
+};
+
+struct LedgerLoadStats {
+    size_t rows = 0;
+    size_t skipped = 0;   // blank or malformed lines
+    size_t bytes = 0;
+};
+
+// Parses a single line (without its terminating '\n'). Accepts a trailing
+// '\r' and surrounding blanks around the amount, like the old stream parser.
+bool ParseLedgerLine(const char* begin, const char* end, LedgerRow& row);
+
+// Appends one row in the transactions.txt format, including the newline
+void AppendLedgerRow(std::string& out, std::string_view type, Money amount,
+                     std::string_view category, std::string_view date);
+
+// Skips a UTF-8 byte order mark if an editor added one
+inline const char* SkipByteOrderMark(const char* data, size_t size) {
+    if (size >= 3 && (unsigned char)data[0] == 0xEF && (unsigned char)data[1] == 0xBB && (unsigned char)data[2] == 0xBF) {
+        return data + 3;
+    }
+    return data;
+}
+
+// Calls onRow(const LedgerRow&) for every well-formed line in [begin, end)
+template <typename Fn>
+LedgerLoadStats ParseLedgerLines(const char* begin, const char* end, Fn&& onRow) {
+    LedgerLoadStats stats;
+    stats.bytes = end - begin;
+
+    LedgerRow row;
+    for (const char* p = begin; p < end;) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+
+        if (ParseLedgerLine(p, eol, row)) {
+            onRow(row);
+            ++stats.rows;
+        } else if (eol != p && !(eol - p == 1 && *p == '\r')) {
+            ++stats.skipped;
+        }
+
+        p = eol + 1;
+    }
+    return stats;
+}
+
+// Same, for a whole file's contents
+template <typename Fn>
+LedgerLoadStats ParseLedger(const char* data, size_t size, Fn&& onRow) {
+    LedgerLoadStats stats = ParseLedgerLines(SkipByteOrderMark(data, size), data + size, std::forward<Fn>(onRow));
+    stats.bytes = size;
+    return stats;
+}
+
+class LedgerLoader {
+public:
+    // Reads the whole file into memory. Returns false if it cannot be opened.
+    bool Open(const std::string& path);
+
+    template <typename Fn>
+    LedgerLoadStats ForEachRow(Fn&& onRow) const {
+        return ParseLedger(buffer.data(), buffer.size(), std::forward<Fn>(onRow));
+    }
+
+    const char* Data() const { return buffer.data(); }
+    size_t Size() const { return buffer.size(); }
+
+private:
+    std::vector<char> buffer;
+};
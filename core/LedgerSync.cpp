@@ -0,0 +1,784 @@
+#include "LedgerSync.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <system_error>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+static constexpr uint32_t protocolVersion = 1;
+
+// Parents per Nodes request and chunks per Rows request, which keep any one
+// message to a few megabytes
+static constexpr size_t nodesPerRequest = 4096;
+static constexpr size_t chunksPerRequest = 1024;
+
+static constexpr char baseMagic[8] = { 'F', 'S', 'S', 'Y', 'N', 'C', '0', '1' };
+
+struct SyncBaseHeader {
+    char magic[8];
+    uint64_t chunkCount;
+    uint64_t rowCount;
+};
+
+enum class SyncMessage : uint8_t {
+    Hello = 1,      // protocol, replica -> replica, next id, chunk count
+    Nodes,          // depth, level, parents -> fanout child hashes each
+    Rows,           // chunks -> their rows
+    Apply,          // depth, rows to put, ids to remove -> root, chunk count
+    Commit,         // replica -> ok; the peer records its base
+    Error           // -> message
+};
+
+// A row as it crosses the wire, category by name
+struct SyncRow {
+    uint64_t id;
+    uint8_t type;
+    int64_t amount;
+    int32_t day;
+    std::string category;
+
+    bool operator==(const SyncRow& other) const {
+        return id == other.id && type == other.type && amount == other.amount && day == other.day &&
+               category == other.category;
+    }
+};
+
+// Hashing
+
+static uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t HashName(std::string_view name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static SyncHash RowHash(uint64_t id, uint8_t type, int64_t amount, int32_t day, uint64_t name) {
+    uint64_t h = Mix(id ^ 0x6a09e667f3bcc908ull);
+    h = Mix(h ^ static_cast<uint64_t>(amount));
+    h = Mix(h ^ ((static_cast<uint64_t>(type) << 32) | static_cast<uint32_t>(day)));
+    h = Mix(h ^ name);
+    return SyncHash{ h, Mix(h ^ 0xbb67ae8584caa73bull) };
+}
+
+static SyncHash RowHash(const SyncRow& row) {
+    return RowHash(row.id, row.type, row.amount, row.day, HashName(row.category));
+}
+
+SyncHash HashSyncRow(uint64_t id, TransactionType type, int64_t amount, int32_t day, std::string_view category) {
+    return RowHash(id, static_cast<uint8_t>(type), amount, day, HashName(category));
+}
+
+static std::vector<uint64_t> NameHashes(const TransactionStore& store) {
+    std::vector<uint64_t> names(store.CategoryCount());
+    for (size_t id = 0; id < names.size(); ++id) names[id] = HashName(store.CategoryName(static_cast<uint16_t>(id)));
+    return names;
+}
+
+// Calls onRow(slot, hash) for every live row
+template <typename Fn>
+static void ForEachRowHash(const TransactionStore& store, Fn&& onRow) {
+    std::vector<uint64_t> names = NameHashes(store);
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (!store.IsLive(slot)) continue;
+        onRow(slot, RowHash(store.Ids()[slot], store.Types()[slot], store.Amounts()[slot], store.Days()[slot],
+                            names[store.Categories()[slot]]));
+    }
+}
+
+// Merkle tree
+
+void SyncTree::Build(const TransactionStore& store) {
+    chunks.clear();
+    levels.clear();
+    depth = 0;
+
+    ForEachRowHash(store, [&](size_t slot, const SyncHash& hash) {
+        uint64_t chunk = store.Ids()[slot] / chunkIds;
+        if (chunk >= chunks.size()) chunks.resize(chunk + 1);
+        chunks[chunk].low += hash.low;
+        chunks[chunk].high += hash.high;
+    });
+}
+
+unsigned SyncTree::DepthFor(uint64_t chunkCount) {
+    unsigned depth = 1;
+    for (uint64_t leaves = fanout; leaves < chunkCount; leaves *= fanout) ++depth;
+    return depth;
+}
+
+// A node over no rows stays empty, so padding never needs to be stored
+static SyncHash Combine(const SyncHash* children, size_t count) {
+    bool empty = true;
+    for (size_t k = 0; k < count; ++k) empty = empty && children[k].Empty();
+    if (empty) return SyncHash();
+
+    uint64_t low = 0x510e527fade682d1ull;
+    uint64_t high = 0x9b05688c2b3e6c1full;
+    for (size_t k = 0; k < SyncTree::fanout; ++k) {
+        SyncHash child = k < count ? children[k] : SyncHash();
+        low = Mix(low ^ child.low);
+        high = Mix(high ^ child.high ^ low);
+    }
+    return SyncHash{ low, high };
+}
+
+void SyncTree::Shape(unsigned newDepth) {
+    depth = newDepth;
+    levels.assign(depth + 1, std::vector<SyncHash>());
+    levels[depth] = chunks;
+    for (unsigned level = depth; level-- > 0;) {
+        const std::vector<SyncHash>& below = levels[level + 1];
+        std::vector<SyncHash>& nodes = levels[level];
+        nodes.resize((below.size() + fanout - 1) / fanout);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            nodes[i] = Combine(&below[i * fanout], std::min(fanout, below.size() - i * fanout));
+        }
+    }
+}
+
+SyncHash SyncTree::Node(unsigned level, uint64_t index) const {
+    if (level >= levels.size() || index >= levels[level].size()) return SyncHash();
+    return levels[level][index];
+}
+
+// Base file
+
+bool SyncBase::Open(const std::string& path) {
+    Close();
+    if (!file.Open(path)) return false;
+
+    SyncBaseHeader header;
+    bool ok = file.Size() >= sizeof(header);
+    if (ok) {
+        std::memcpy(&header, file.Data(), sizeof(header));
+        ok = std::memcmp(header.magic, baseMagic, sizeof(baseMagic)) == 0 && header.chunkCount < (uint64_t(1) << 40) &&
+             header.rowCount < (uint64_t(1) << 40) &&
+             file.Size() == sizeof(header) + (header.chunkCount + 1) * 8 + header.rowCount * 9;
+    }
+    if (ok) {
+        const uint64_t* rowStarts = reinterpret_cast<const uint64_t*>(file.Data() + sizeof(header));
+        ok = rowStarts[0] == 0 && rowStarts[header.chunkCount] == header.rowCount;
+        for (uint64_t chunk = 0; ok && chunk < header.chunkCount; ++chunk) ok = rowStarts[chunk] <= rowStarts[chunk + 1];
+    }
+    if (!ok) {
+        file.Close();
+        return false;
+    }
+
+    chunkCount = header.chunkCount;
+    rowCount = header.rowCount;
+    starts = reinterpret_cast<const uint64_t*>(file.Data() + sizeof(header));
+    hashes = starts + chunkCount + 1;
+    offsets = reinterpret_cast<const uint8_t*>(hashes + rowCount);
+    return true;
+}
+
+void SyncBase::Close() {
+    file.Close();
+    chunkCount = rowCount = 0;
+    starts = hashes = nullptr;
+    offsets = nullptr;
+}
+
+bool SyncBase::Find(uint64_t id, uint64_t& hash) const {
+    uint64_t chunk = id / SyncTree::chunkIds;
+    if (chunk >= chunkCount) return false;
+
+    uint8_t offset = static_cast<uint8_t>(id % SyncTree::chunkIds);
+    const uint8_t* first = offsets + starts[chunk];
+    const uint8_t* last = offsets + starts[chunk + 1];
+    const uint8_t* it = std::lower_bound(first, last, offset);
+    if (it == last || *it != offset) return false;
+    hash = hashes[it - offsets];
+    return true;
+}
+
+bool SyncBase::Write(const std::string& path, const TransactionStore& store) {
+    static_assert(SyncTree::chunkIds <= 256, "id offsets are saved as bytes");
+
+    // Counting sort by chunk; slots are mostly in id order already, so each
+    // chunk is usually sorted as it comes
+    uint64_t chunkCount = 0;
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (store.IsLive(slot)) chunkCount = std::max(chunkCount, store.Ids()[slot] / SyncTree::chunkIds + 1);
+    }
+    std::vector<uint64_t> starts(chunkCount + 1, 0);
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (store.IsLive(slot)) ++starts[store.Ids()[slot] / SyncTree::chunkIds + 1];
+    }
+    for (uint64_t chunk = 0; chunk < chunkCount; ++chunk) starts[chunk + 1] += starts[chunk];
+
+    uint64_t rowCount = starts[chunkCount];
+    std::vector<uint64_t> hashes(rowCount);
+    std::vector<uint8_t> offsets(rowCount);
+    std::vector<uint64_t> next(starts.begin(), starts.end() - 1);
+    ForEachRowHash(store, [&](size_t slot, const SyncHash& hash) {
+        uint64_t id = store.Ids()[slot];
+        uint64_t at = next[id / SyncTree::chunkIds]++;
+        hashes[at] = hash.low;
+        offsets[at] = static_cast<uint8_t>(id % SyncTree::chunkIds);
+    });
+    for (uint64_t chunk = 0; chunk < chunkCount; ++chunk) {
+        auto first = offsets.begin() + starts[chunk], last = offsets.begin() + starts[chunk + 1];
+        if (std::is_sorted(first, last)) continue;
+
+        std::vector<std::pair<uint8_t, uint64_t>> rows;
+        for (uint64_t at = starts[chunk]; at < starts[chunk + 1]; ++at) rows.emplace_back(offsets[at], hashes[at]);
+        std::sort(rows.begin(), rows.end());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            offsets[starts[chunk] + i] = rows[i].first;
+            hashes[starts[chunk] + i] = rows[i].second;
+        }
+    }
+
+    SyncBaseHeader header;
+    std::memcpy(header.magic, baseMagic, sizeof(baseMagic));
+    header.chunkCount = chunkCount;
+    header.rowCount = rowCount;
+
+    std::string temp = path + ".tmp";
+    std::FILE* f = std::fopen(temp.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+              std::fwrite(starts.data(), 8, starts.size(), f) == starts.size() &&
+              std::fwrite(hashes.data(), 8, hashes.size(), f) == hashes.size() &&
+              std::fwrite(offsets.data(), 1, offsets.size(), f) == offsets.size() && SyncFile(f);
+    ok = std::fclose(f) == 0 && ok;
+
+    std::error_code ec;
+    if (ok) fs::rename(temp, path, ec);
+    if (!ok || ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+// Wire format: native little-endian fields, strings as a 16-bit length and
+// their bytes
+
+class WireWriter {
+public:
+    explicit WireWriter(SyncMessage kind) { Put(static_cast<uint8_t>(kind)); }
+
+    template <typename T>
+    void Put(T value) { bytes.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+    void PutString(std::string_view text) {
+        Put(static_cast<uint16_t>(text.size()));
+        bytes.append(text.data(), text.size());
+    }
+
+    void PutHash(const SyncHash& hash) {
+        Put(hash.low);
+        Put(hash.high);
+    }
+
+    std::string bytes;
+};
+
+class WireReader {
+public:
+    explicit WireReader(std::string_view bytes) : p(bytes.data()), end(bytes.data() + bytes.size()) {}
+
+    template <typename T>
+    T Get() {
+        T value{};
+        if (static_cast<size_t>(end - p) < sizeof(value)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    }
+
+    std::string_view GetString() {
+        uint16_t length = Get<uint16_t>();
+        if (static_cast<size_t>(end - p) < length) {
+            ok = false;
+            return std::string_view();
+        }
+        std::string_view text(p, length);
+        p += length;
+        return text;
+    }
+
+    SyncHash GetHash() {
+        SyncHash hash;
+        hash.low = Get<uint64_t>();
+        hash.high = Get<uint64_t>();
+        return hash;
+    }
+
+    // Room for count more items of size bytes, so a count can be trusted
+    // before reserving for it
+    bool Has(uint64_t count, size_t size) const { return ok && count <= static_cast<uint64_t>(end - p) / size; }
+
+    bool Ok() const { return ok; }
+
+private:
+    const char* p;
+    const char* end;
+    bool ok = true;
+};
+
+// Rows share one table of category names per message
+static void PutRows(WireWriter& out, const std::vector<SyncRow>& rows) {
+    std::unordered_map<std::string_view, uint16_t> index;
+    std::vector<std::string_view> names;
+    for (const SyncRow& row : rows) {
+        if (index.emplace(row.category, static_cast<uint16_t>(names.size())).second) names.push_back(row.category);
+    }
+    out.Put(static_cast<uint16_t>(names.size()));
+    for (std::string_view name : names) out.PutString(name);
+
+    out.Put(static_cast<uint32_t>(rows.size()));
+    for (const SyncRow& row : rows) {
+        out.Put(row.id);
+        out.Put(row.type);
+        out.Put(row.amount);
+        out.Put(row.day);
+        out.Put(index[row.category]);
+    }
+}
+
+static bool GetRows(WireReader& in, std::vector<SyncRow>& rows) {
+    std::vector<std::string> names(in.Get<uint16_t>());
+    for (std::string& name : names) name = std::string(in.GetString());
+
+    uint32_t count = in.Get<uint32_t>();
+    constexpr size_t rowBytes = 8 + 1 + 8 + 4 + 2;
+    if (!in.Has(count, rowBytes)) return false;
+    rows.reserve(rows.size() + count);
+    for (uint32_t i = 0; i < count; ++i) {
+        SyncRow row;
+        row.id = in.Get<uint64_t>();
+        row.type = in.Get<uint8_t>();
+        row.amount = in.Get<int64_t>();
+        row.day = in.Get<int32_t>();
+        uint16_t name = in.Get<uint16_t>();
+        if (row.type > 1 || name >= names.size()) return false;
+        row.category = names[name];
+        rows.push_back(std::move(row));
+    }
+    return in.Ok();
+}
+
+static SyncRow RowAt(const TransactionStore& store, size_t slot) {
+    return SyncRow{ store.Ids()[slot], store.Types()[slot], store.Amounts()[slot], store.Days()[slot],
+                    std::string(store.CategoryName(store.Categories()[slot])) };
+}
+
+// Live rows with ids in the chunk, by id
+static void ChunkRows(const TransactionStore& store, uint64_t chunk, std::vector<SyncRow>& out) {
+    for (uint64_t id = chunk * SyncTree::chunkIds; id < (chunk + 1) * SyncTree::chunkIds; ++id) {
+        size_t slot;
+        if (store.FindId(id, slot)) out.push_back(RowAt(store, slot));
+    }
+}
+
+static void ApplyRows(Ledger& ledger, const std::vector<SyncRow>& puts, const std::vector<uint64_t>& removes) {
+    for (const SyncRow& row : puts) {
+        ledger.Put(row.id, TransactionStore::Row{ static_cast<TransactionType>(row.type), Money::FromMinor(row.amount),
+                                                  ledger.InternCategory(row.category), row.day });
+    }
+    if (!removes.empty()) ledger.Erase(removes);
+}
+
+static std::string ErrorReply(std::string_view message) {
+    WireWriter out(SyncMessage::Error);
+    out.PutString(message);
+    return out.bytes;
+}
+
+// Replica ids
+
+std::string SyncBasePath(const std::string& snapshotPath, uint64_t peer) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(peer));
+    return snapshotPath + ".sync-" + text;
+}
+
+uint64_t ReplicaId(const std::string& snapshotPath) {
+    std::string path = snapshotPath + ".replica";
+    uint64_t id = 0;
+    if (std::FILE* f = std::fopen(path.c_str(), "rb")) {
+        char text[32] = {};
+        size_t length = std::fread(text, 1, sizeof(text) - 1, f);
+        std::fclose(f);
+        text[length] = '\0';
+        id = std::strtoull(text, nullptr, 16);
+    }
+    if (id != 0) return id;
+
+    std::random_device device;
+    while (id == 0) {
+        id = Mix((static_cast<uint64_t>(device()) << 32) ^ device() ^
+                 static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+    }
+    if (std::FILE* f = std::fopen(path.c_str(), "wb")) {
+        std::fprintf(f, "%016llx\n", static_cast<unsigned long long>(id));
+        SyncFile(f);
+        std::fclose(f);
+    }
+    return id;
+}
+
+// Answering side
+
+const SyncTree& SyncServer::Tree(unsigned depth) {
+    const TransactionStore& store = ledger.Transactions();
+    if (treeVersion != store.Version()) {
+        tree.Build(store);
+        tree.Shape(SyncTree::DepthFor(tree.ChunkCount()));
+        treeVersion = store.Version();
+    }
+    if (depth != 0 && depth != tree.Depth()) tree.Shape(depth);
+    return tree;
+}
+
+std::string SyncServer::Handle(const std::string& request) {
+    const TransactionStore& store = ledger.Transactions();
+    WireReader in(request);
+
+    switch (static_cast<SyncMessage>(in.Get<uint8_t>())) {
+        case SyncMessage::Hello: {
+            uint32_t version = in.Get<uint32_t>();
+            if (!in.Ok() || version != protocolVersion) return ErrorReply("unsupported sync protocol");
+            WireWriter out(SyncMessage::Hello);
+            out.Put(ReplicaId(ledger.SnapshotPath()));
+            out.Put(store.NextId());
+            out.Put(Tree(0).ChunkCount());
+            return out.bytes;
+        }
+
+        case SyncMessage::Nodes: {
+            uint8_t depth = in.Get<uint8_t>();
+            uint8_t level = in.Get<uint8_t>();
+            uint32_t count = in.Get<uint32_t>();
+            if (!in.Has(count, 8) || depth == 0 || depth > 16 || level >= depth) return ErrorReply("malformed node request");
+
+            const SyncTree& nodes = Tree(depth);
+            WireWriter out(SyncMessage::Nodes);
+            for (uint32_t i = 0; i < count; ++i) {
+                uint64_t parent = in.Get<uint64_t>();
+                for (size_t k = 0; k < SyncTree::fanout; ++k) out.PutHash(nodes.Node(level + 1, parent * SyncTree::fanout + k));
+            }
+            return out.bytes;
+        }
+
+        case SyncMessage::Rows: {
+            uint32_t count = in.Get<uint32_t>();
+            if (!in.Has(count, 8)) return ErrorReply("malformed row request");
+            std::vector<SyncRow> rows;
+            for (uint32_t i = 0; i < count; ++i) ChunkRows(store, in.Get<uint64_t>(), rows);
+            WireWriter out(SyncMessage::Rows);
+            PutRows(out, rows);
+            return out.bytes;
+        }
+
+        case SyncMessage::Apply: {
+            uint8_t depth = in.Get<uint8_t>();
+            std::vector<SyncRow> puts;
+            bool ok = GetRows(in, puts);
+            uint32_t count = in.Get<uint32_t>();
+            if (!ok || !in.Has(count, 8) || depth == 0 || depth > 16) return ErrorReply("malformed changes");
+            std::vector<uint64_t> removes(count);
+            for (uint64_t& id : removes) id = in.Get<uint64_t>();
+            ApplyRows(ledger, puts, removes);
+
+            const SyncTree& after = Tree(depth);
+            WireWriter out(SyncMessage::Apply);
+            out.PutHash(after.Root());
+            out.Put(after.ChunkCount());
+            return out.bytes;
+        }
+
+        case SyncMessage::Commit: {
+            uint64_t peer = in.Get<uint64_t>();
+            if (!in.Ok()) return ErrorReply("malformed commit");
+            WireWriter out(SyncMessage::Commit);
+            out.Put(static_cast<uint8_t>(SyncBase::Write(SyncBasePath(ledger.SnapshotPath(), peer), store)));
+            return out.bytes;
+        }
+
+        default:
+            return ErrorReply("unknown request");
+    }
+}
+
+// Starting side
+
+namespace {
+
+class SyncSession {
+public:
+    SyncSession(Ledger& ledger, SyncTransport& transport, SyncStats& stats, std::string& error)
+        : ledger(ledger), store(ledger.Transactions()), transport(transport), stats(stats), error(error) {}
+
+    bool Run();
+
+private:
+    bool Exchange(const WireWriter& request, SyncMessage expected, WireReader& reply);
+    bool FindDifferingChunks(const SyncTree& local, unsigned depth, std::vector<uint64_t>& chunks);
+    bool FetchRows(const std::vector<uint64_t>& chunks, std::vector<SyncRow>& rows);
+    void Merge(const std::vector<uint64_t>& chunks, const std::vector<SyncRow>& peerRows, uint64_t peerNextId);
+    bool Commit(uint64_t self, uint64_t peer);
+
+    Ledger& ledger;
+    const TransactionStore& store;
+    SyncTransport& transport;
+    SyncStats& stats;
+    std::string& error;
+
+    std::string buffer;
+    SyncBase base;
+
+    std::vector<SyncRow> localPuts, peerPuts;
+    std::vector<uint64_t> localRemoves, peerRemoves;
+};
+
+}  // namespace
+
+bool SyncSession::Exchange(const WireWriter& request, SyncMessage expected, WireReader& reply) {
+    if (!transport.Request(request.bytes, buffer)) {
+        error = "the peer did not answer";
+        return false;
+    }
+    reply = WireReader(buffer);
+    SyncMessage kind = static_cast<SyncMessage>(reply.Get<uint8_t>());
+    if (kind == SyncMessage::Error) {
+        error = "the peer refused: " + std::string(reply.GetString());
+        return false;
+    }
+    if (kind != expected || !reply.Ok()) {
+        error = "the peer sent an unexpected reply";
+        return false;
+    }
+    return true;
+}
+
+bool SyncSession::FindDifferingChunks(const SyncTree& local, unsigned depth, std::vector<uint64_t>& chunks) {
+    // Level by level, asking only for the children of nodes that differ
+    std::vector<uint64_t> frontier = { 0 };
+    for (unsigned level = 0; level < depth && !frontier.empty(); ++level) {
+        std::vector<uint64_t> next;
+        for (size_t first = 0; first < frontier.size(); first += nodesPerRequest) {
+            size_t count = std::min(nodesPerRequest, frontier.size() - first);
+            WireWriter request(SyncMessage::Nodes);
+            request.Put(static_cast<uint8_t>(depth));
+            request.Put(static_cast<uint8_t>(level));
+            request.Put(static_cast<uint32_t>(count));
+            for (size_t i = first; i < first + count; ++i) request.Put(frontier[i]);
+
+            WireReader reply(std::string_view{});
+            if (!Exchange(request, SyncMessage::Nodes, reply)) return false;
+            for (size_t i = first; i < first + count; ++i) {
+                for (size_t k = 0; k < SyncTree::fanout; ++k) {
+                    uint64_t child = frontier[i] * SyncTree::fanout + k;
+                    if (reply.GetHash() != local.Node(level + 1, child)) next.push_back(child);
+                }
+            }
+            if (!reply.Ok()) {
+                error = "the peer sent too few node hashes";
+                return false;
+            }
+        }
+        frontier.swap(next);
+    }
+    chunks = std::move(frontier);
+    return true;
+}
+
+bool SyncSession::FetchRows(const std::vector<uint64_t>& chunks, std::vector<SyncRow>& rows) {
+    for (size_t first = 0; first < chunks.size(); first += chunksPerRequest) {
+        size_t count = std::min(chunksPerRequest, chunks.size() - first);
+        WireWriter request(SyncMessage::Rows);
+        request.Put(static_cast<uint32_t>(count));
+        for (size_t i = first; i < first + count; ++i) request.Put(chunks[i]);
+
+        WireReader reply(std::string_view{});
+        if (!Exchange(request, SyncMessage::Rows, reply)) return false;
+        if (!GetRows(reply, rows)) {
+            error = "the peer sent malformed rows";
+            return false;
+        }
+    }
+    return true;
+}
+
+void SyncSession::Merge(const std::vector<uint64_t>& chunks, const std::vector<SyncRow>& peerRows, uint64_t peerNextId) {
+    // Two different rows added under one id: the larger hash moves
+    std::vector<std::pair<uint64_t, SyncRow>> moved;
+
+    size_t p = 0;
+    std::vector<SyncRow> localRows;
+    for (uint64_t chunk : chunks) {
+        localRows.clear();
+        ChunkRows(store, chunk, localRows);
+        size_t peerFirst = p;
+        while (p < peerRows.size() && peerRows[p].id / SyncTree::chunkIds == chunk) ++p;
+
+        size_t l = 0, r = peerFirst;
+        while (l < localRows.size() || r < p) {
+            uint64_t id = std::min(l < localRows.size() ? localRows[l].id : UINT64_MAX,
+                                   r < p ? peerRows[r].id : UINT64_MAX);
+            const SyncRow* mine = l < localRows.size() && localRows[l].id == id ? &localRows[l++] : nullptr;
+            const SyncRow* theirs = r < p && peerRows[r].id == id ? &peerRows[r++] : nullptr;
+            if (mine != nullptr && theirs != nullptr && *mine == *theirs) continue;
+
+            uint64_t mineHash = mine != nullptr ? RowHash(*mine).low : 0;
+            uint64_t theirHash = theirs != nullptr ? RowHash(*theirs).low : 0;
+            uint64_t baseHash = 0;
+            bool synced = base.Find(id, baseHash);
+
+            // A side kept the row as synced, or never had it if it is new
+            bool mineKept = synced ? mine != nullptr && mineHash == baseHash : mine == nullptr;
+            bool theirsKept = synced ? theirs != nullptr && theirHash == baseHash : theirs == nullptr;
+            const SyncRow* winner;
+            if (mineKept) {
+                winner = theirs;
+            } else if (theirsKept) {
+                winner = mine;
+            } else {
+                ++stats.conflicts;
+                if (mine == nullptr || theirs == nullptr) {
+                    winner = mine != nullptr ? mine : theirs;
+                } else if (!synced) {
+                    winner = mineHash < theirHash ? mine : theirs;
+                    const SyncRow* loser = winner == mine ? theirs : mine;
+                    moved.emplace_back(std::max(mineHash, theirHash), *loser);
+                } else {
+                    winner = mineHash > theirHash ? mine : theirs;
+                }
+            }
+
+            if (winner == nullptr) {
+                (mine != nullptr ? localRemoves : peerRemoves).push_back(id);
+            } else {
+                if (winner != mine) localPuts.push_back(*winner);
+                if (winner != theirs) peerPuts.push_back(*winner);
+            }
+        }
+    }
+
+    // Fresh ids above both sides' counters, in hash order so a rerun agrees
+    std::sort(moved.begin(), moved.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second.id < b.second.id;
+    });
+    uint64_t nextId = std::max(store.NextId(), peerNextId);
+    for (auto& [hash, row] : moved) {
+        row.id = nextId++;
+        localPuts.push_back(row);
+        peerPuts.push_back(row);
+    }
+    stats.localChanges = localPuts.size() + localRemoves.size();
+    stats.peerChanges = peerPuts.size() + peerRemoves.size();
+}
+
+bool SyncSession::Commit(uint64_t self, uint64_t peer) {
+    WireWriter request(SyncMessage::Commit);
+    request.Put(self);
+    WireReader reply(std::string_view{});
+    if (!Exchange(request, SyncMessage::Commit, reply)) return false;
+    if (reply.Get<uint8_t>() != 1 || !SyncBase::Write(SyncBasePath(ledger.SnapshotPath(), peer), store)) {
+        error = "the sync state could not be saved";
+        return false;
+    }
+    return true;
+}
+
+bool SyncSession::Run() {
+    uint64_t self = ReplicaId(ledger.SnapshotPath());
+
+    WireWriter hello(SyncMessage::Hello);
+    hello.Put(protocolVersion);
+    WireReader reply(std::string_view{});
+    if (!Exchange(hello, SyncMessage::Hello, reply)) return false;
+    uint64_t peer = reply.Get<uint64_t>();
+    uint64_t peerNextId = reply.Get<uint64_t>();
+    uint64_t peerChunks = reply.Get<uint64_t>();
+    if (!reply.Ok()) {
+        error = "the peer sent a malformed greeting";
+        return false;
+    }
+    if (peer == self) {
+        error = "both copies have the same replica id; delete the .replica file next to one of them";
+        return false;
+    }
+
+    SyncTree local;
+    local.Build(store);
+    unsigned depth = SyncTree::DepthFor(std::max(local.ChunkCount(), peerChunks));
+    local.Shape(depth);
+
+    std::vector<uint64_t> chunks;
+    if (!FindDifferingChunks(local, depth, chunks)) return false;
+    stats.chunksDiffering = chunks.size();
+
+    // Without a base every difference counts as new on both sides
+    std::string basePath = SyncBasePath(ledger.SnapshotPath(), peer);
+    bool hasBase = base.Open(basePath);
+    if (chunks.empty()) {
+        base.Close();
+        return hasBase || Commit(self, peer);
+    }
+
+    std::vector<SyncRow> peerRows;
+    if (!FetchRows(chunks, peerRows)) return false;
+    stats.rowsReceived = peerRows.size();
+    Merge(chunks, peerRows, peerNextId);
+    base.Close();
+
+    ApplyRows(ledger, localPuts, localRemoves);
+    local.Build(store);
+    depth = SyncTree::DepthFor(local.ChunkCount());
+    local.Shape(depth);
+
+    WireWriter changes(SyncMessage::Apply);
+    changes.Put(static_cast<uint8_t>(depth));
+    PutRows(changes, peerPuts);
+    changes.Put(static_cast<uint32_t>(peerRemoves.size()));
+    for (uint64_t id : peerRemoves) changes.Put(id);
+    if (!Exchange(changes, SyncMessage::Apply, reply)) return false;
+
+    SyncHash peerRoot = reply.GetHash();
+    uint64_t peerChunksAfter = reply.Get<uint64_t>();
+    if (!reply.Ok() || peerRoot != local.Root() || peerChunksAfter != local.ChunkCount()) {
+        error = "the copies still differ after the merge; the peer may have changed meanwhile, sync again";
+        return false;
+    }
+    return Commit(self, peer);
+}
+
+bool SyncLedger(Ledger& ledger, SyncTransport& transport, SyncStats& stats, std::string& error) {
+    stats = SyncStats();
+    error.clear();
+    uint64_t sent = transport.BytesSent(), received = transport.BytesReceived();
+    size_t exchanges = transport.Exchanges();
+
+    bool ok = SyncSession(ledger, transport, stats, error).Run();
+    stats.bytesSent = transport.BytesSent() - sent;
+    stats.bytesReceived = transport.BytesReceived() - received;
+    stats.exchanges = transport.Exchanges() - exchanges;
+    return ok;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+// Delta sync between two copies of a ledger. Rows are grouped into chunks
+// by id (chunkIds ids each) and every chunk is hashed from its rows: id,
+// type, amount, date and category name, since each copy numbers its
+// categories itself. A Merkle tree of fanout 16 over the chunk hashes lets
+// the two copies find the chunks they disagree on by comparing a few nodes
+// per level, and only those chunks' rows cross the transport. A handful of
+// new rows on a 10M-row ledger touch one or two chunks and move kilobytes.
+//
+// The merge is three-way. After a sync both copies keep the hash of every
+// row as synced (the base, one file per peer), so a row that differs is
+// taken from the side that changed it. When both did: an edit beats a
+// delete, of two edits the one with the larger hash is kept, and two
+// different rows added under one id are both kept, the one with the larger
+// hash moving to a fresh id. The side that starts the sync works the merge
+// out, applies its share and sends the peer the rest; once both report the
+// same root hash they record the merged rows as their new base.
+//
+// Files next to a snapshot "transactions.fsnap":
+//   transactions.fsnap.replica         this copy's id, made on first sync
+//   transactions.fsnap.sync-<peer id>  the base for one peer
+
+#include "Ledger.h"
+#include "MappedFile.h"
+#include "SyncTransport.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SyncHash {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool Empty() const { return low == 0 && high == 0; }
+    bool operator==(const SyncHash& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const SyncHash& other) const { return !(*this == other); }
+};
+
+// One row's hash; the chunk hash is the sum of its rows' hashes
+SyncHash HashSyncRow(uint64_t id, TransactionType type, int64_t amount, int32_t day, std::string_view category);
+
+class SyncTree {
+public:
+    static constexpr uint64_t chunkIds = 256;
+    static constexpr size_t fanout = 16;
+
+    // Hashes the live rows of store into chunks
+    void Build(const TransactionStore& store);
+    uint64_t ChunkCount() const { return chunks.size(); }
+
+    // Smallest depth (at least 1) whose fanout^depth leaves hold chunkCount
+    static unsigned DepthFor(uint64_t chunkCount);
+
+    // Lays the tree over fanout^depth leaves, the chunks first; both sides
+    // must use the same depth for their nodes to compare
+    void Shape(unsigned depth);
+    unsigned Depth() const { return depth; }
+
+    // Node index at level, 0 being the root and Depth() the chunks. Nodes
+    // with no rows below them are empty.
+    SyncHash Node(unsigned level, uint64_t index) const;
+    SyncHash Root() const { return Node(0, 0); }
+
+private:
+    std::vector<SyncHash> chunks;
+    std::vector<std::vector<SyncHash>> levels;
+    unsigned depth = 0;
+};
+
+// The row hashes (low half) of a ledger as of its last sync with one peer,
+// read from a memory-mapped file: per chunk, its rows' id offsets and
+// hashes, sorted by id
+class SyncBase {
+public:
+    // False, leaving the base empty, when the file is missing or malformed
+    bool Open(const std::string& path);
+    bool Empty() const { return rowCount == 0; }
+
+    // Unmaps the file, which on Windows must happen before it is replaced
+    void Close();
+
+    // False when the row did not exist at the last sync
+    bool Find(uint64_t id, uint64_t& hash) const;
+
+    // Records the live rows of store, replacing the file atomically
+    static bool Write(const std::string& path, const TransactionStore& store);
+
+private:
+    MappedFile file;
+    uint64_t chunkCount = 0;
+    uint64_t rowCount = 0;
+    const uint64_t* starts = nullptr;       // chunkCount + 1 row indexes
+    const uint64_t* hashes = nullptr;
+    const uint8_t* offsets = nullptr;       // id - chunk * chunkIds
+};
+
+// What one sync did
+struct SyncStats {
+    uint64_t chunksDiffering = 0;
+    size_t rowsReceived = 0;        // peer rows of the differing chunks
+    size_t localChanges = 0;        // rows added, replaced or removed here
+    size_t peerChanges = 0;         // and sent to the peer to do the same
+    size_t conflicts = 0;           // rows both sides had changed
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    size_t exchanges = 0;
+};
+
+// Answers sync requests from a peer over ledger; give a transport
+// [&server](const std::string& request) { return server.Handle(request); }
+class SyncServer {
+public:
+    explicit SyncServer(Ledger& ledger) : ledger(ledger) {}
+
+    std::string Handle(const std::string& request);
+
+private:
+    const SyncTree& Tree(unsigned depth);
+
+    Ledger& ledger;
+    SyncTree tree;
+    uint64_t treeVersion = UINT64_MAX;
+};
+
+// Brings ledger and the copy behind transport to the same rows. False, with
+// error set, if the transport fails or the peer sends something malformed;
+// whatever was applied on either side stays and the next sync carries on.
+bool SyncLedger(Ledger& ledger, SyncTransport& transport, SyncStats& stats, std::string& error);
+
+// This copy's id, read from next to the snapshot or made and saved there
+uint64_t ReplicaId(const std::string& snapshotPath);
+std::string SyncBasePath(const std::string& snapshotPath, uint64_t peer);
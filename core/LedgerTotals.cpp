@@ -0,0 +1,60 @@
+#include "LedgerTotals.h"
+
+#include "Aggregate.h"
+
+void LedgerTotals::Clear() {
+    income = 0;
+    expense = 0;
+    byCategory[0].clear();
+    byCategory[1].clear();
+}
+
+void LedgerTotals::Add(TransactionType type, uint16_t category, Money amount) {
+    int64_t cents = amount.Minor();
+    if (type == TransactionType::Income) {
+        income += cents;
+    } else {
+        expense += cents;
+    }
+
+    std::vector<int64_t>& totals = byCategory[static_cast<size_t>(type)];
+    if (category >= totals.size()) totals.resize(category + 1, 0);
+    totals[category] += cents;
+}
+
+void LedgerTotals::Remove(TransactionType type, uint16_t category, Money amount) {
+    Add(type, category, -amount);
+}
+
+void LedgerTotals::Rebuild(size_t rows, const uint8_t* types, const uint16_t* categories, const int64_t* amounts,
+                           size_t categoryCount) {
+    ColumnSums sums;
+    AggregateColumns(rows, types, categories, amounts, categoryCount, sums);
+
+    income = sums.income;
+    expense = sums.expense;
+    byCategory[0].assign(sums.byCategory.begin(), sums.byCategory.begin() + categoryCount);
+    byCategory[1].assign(sums.byCategory.begin() + categoryCount, sums.byCategory.end());
+}
+
+Money LedgerTotals::Category(TransactionType type, uint16_t category) const {
+    const std::vector<int64_t>& totals = byCategory[static_cast<size_t>(type)];
+    return Money::FromMinor(category < totals.size() ? totals[category] : 0);
+}
+
+bool LedgerTotals::operator==(const LedgerTotals& other) const {
+    if (income != other.income || expense != other.expense) return false;
+
+    // Trailing zero slots do not make two totals different
+    for (size_t t = 0; t < 2; ++t) {
+        const std::vector<int64_t>& a = byCategory[t];
+        const std::vector<int64_t>& b = other.byCategory[t];
+        size_t n = a.size() > b.size() ? a.size() : b.size();
+        for (size_t i = 0; i < n; ++i) {
+            int64_t x = i < a.size() ? a[i] : 0;
+            int64_t y = i < b.size() ? b[i] : 0;
+            if (x != y) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Income, expense and per-category totals kept up to date by delta as rows
+// are added, changed and removed, so reading them never rescans the ledger.
+
+#include "LedgerTypes.h"
+#include "Money.h"
+
+#include <cstdint>
+#include <vector>
+
+class LedgerTotals {
+public:
+    void Clear();
+
+    void Add(TransactionType type, uint16_t category, Money amount);
+    void Remove(TransactionType type, uint16_t category, Money amount);
+
+    // Recomputes everything from columns (amounts in minor units) in one
+    // aggregation pass; ids are below categoryCount
+    void Rebuild(size_t rows, const uint8_t* types, const uint16_t* categories, const int64_t* amounts,
+                 size_t categoryCount);
+
+    Money Income() const { return Money::FromMinor(income); }
+    Money Expense() const { return Money::FromMinor(expense); }
+    Money Net() const { return Money::FromMinor(income - expense); }
+
+    // Per-category totals for one type; zero for categories never used
+    Money Category(TransactionType type, uint16_t category) const;
+
+    bool operator==(const LedgerTotals& other) const;
+    bool operator!=(const LedgerTotals& other) const { return !(*this == other); }
+
+private:
+    int64_t income = 0;
+    int64_t expense = 0;
+    std::vector<int64_t> byCategory[2];
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+// Small value types shared by the ledger storage formats.
+
+#include <cstdint>
+#include <string_view>
+
+enum class TransactionType : uint8_t {
+    Income = 0,
+    Expense = 1
+};
+
+// Anything that is not "Income" counts as an expense, as in UpdateSummary
+inline TransactionType TypeFromName(std::string_view name) {
+    return name == "Income" ? TransactionType::Income : TransactionType::Expense;
+}
+
+inline std::string_view TypeName(TransactionType type) {
+    return type == TransactionType::Income ? "Income" : "Expense";
+}
@@ -0,0 +1,99 @@
+#include "LiveSet.h"
+
+#include <bitset>
+
+static size_t CountBits(uint64_t word) {
+    return std::bitset<64>(word).count();
+}
+
+void LiveSet::Clear() {
+    words.clear();
+    tree.assign(1, 0);
+    slots = 0;
+    live = 0;
+}
+
+void LiveSet::Assign(size_t count) {
+    slots = count;
+    live = count;
+    words.assign((count + 63) / 64, ~uint64_t(0));
+    if (count % 64 != 0) words.back() = (uint64_t(1) << (count % 64)) - 1;
+
+    // Linear-time Fenwick build: each node passes its sum to its parent
+    tree.assign(words.size() + 1, 0);
+    for (size_t i = 1; i < tree.size(); ++i) {
+        tree[i] += static_cast<uint32_t>(CountBits(words[i - 1]));
+        size_t parent = i + (i & (0 - i));
+        if (parent < tree.size()) tree[parent] += tree[i];
+    }
+}
+
+void LiveSet::PushBack() {
+    if (slots % 64 == 0) {
+        // A new, empty word; its node covers the words before it down to
+        // the next lower power-of-two boundary
+        words.push_back(0);
+        size_t i = words.size();
+        tree.push_back(static_cast<uint32_t>(Prefix(i - 1) - Prefix(i - (i & (0 - i)))));
+    }
+    words[slots >> 6] |= uint64_t(1) << (slots & 63);
+    AddToWord(slots >> 6, 1);
+    ++slots;
+    ++live;
+}
+
+void LiveSet::Erase(size_t slot) {
+    if (!Test(slot)) return;
+    words[slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+    AddToWord(slot >> 6, -1);
+    --live;
+}
+
+void LiveSet::AddToWord(size_t word, int32_t delta) {
+    for (size_t i = word + 1; i < tree.size(); i += i & (0 - i)) {
+        tree[i] += static_cast<uint32_t>(delta);
+    }
+}
+
+size_t LiveSet::Prefix(size_t wordCount) const {
+    size_t sum = 0;
+    for (size_t i = wordCount; i > 0; i -= i & (0 - i)) sum += tree[i];
+    return sum;
+}
+
+size_t LiveSet::Select(size_t rank) const {
+    // Descend the tree to the word holding the live slot
+    size_t word = 0;
+    size_t step = 1;
+    while (step * 2 < tree.size()) step *= 2;
+    for (; step > 0; step /= 2) {
+        if (word + step < tree.size() && tree[word + step] <= rank) {
+            word += step;
+            rank -= tree[word];
+        }
+    }
+
+    // Then the bit inside it, a byte at a time
+    uint64_t bits = words[word];
+    size_t slot = word * 64;
+    for (;;) {
+        size_t count = CountBits(bits & 0xFF);
+        if (rank < count) break;
+        rank -= count;
+        bits >>= 8;
+        slot += 8;
+    }
+    for (;; bits >>= 1, ++slot) {
+        if ((bits & 1) && rank-- == 0) return slot;
+    }
+}
+
+size_t LiveSet::Rank(size_t slot) const {
+    size_t word = slot >> 6;
+    uint64_t below = (uint64_t(1) << (slot & 63)) - 1;
+    return Prefix(word) + (word < words.size() ? CountBits(words[word] & below) : 0);
+}
+
+size_t LiveSet::MemoryUsage() const {
+    return words.capacity() * sizeof(uint64_t) + tree.capacity() * sizeof(uint32_t);
+}
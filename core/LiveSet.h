@@ -0,0 +1,49 @@
+#pragma once
+
+// Which store slots hold a live row. Deleting a row only clears its bit, so
+// the columns never shift. A Fenwick tree over the number of live slots in
+// each 64-slot word finds the k-th live slot (the row a table shows at
+// position k) and a slot's position in O(log n).
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class LiveSet {
+public:
+    void Clear();
+
+    // slots slots, all live
+    void Assign(size_t slots);
+
+    // Adds one live slot at the end
+    void PushBack();
+
+    // Marks a slot dead; does nothing if it already is
+    void Erase(size_t slot);
+
+    bool Test(size_t slot) const { return (words[slot >> 6] >> (slot & 63)) & 1; }
+
+    size_t Slots() const { return slots; }
+    size_t Count() const { return live; }
+
+    // Slot of the live row at position rank; rank must be below Count()
+    size_t Select(size_t rank) const;
+
+    // Live slots before slot
+    size_t Rank(size_t slot) const;
+
+    // One bit per slot, lowest bit first
+    const uint64_t* Words() const { return words.data(); }
+
+    size_t MemoryUsage() const;
+
+private:
+    void AddToWord(size_t word, int32_t delta);
+    size_t Prefix(size_t wordCount) const;
+
+    std::vector<uint64_t> words;
+    std::vector<uint32_t> tree = std::vector<uint32_t>(1, 0);   // 1-based; tree[0] unused
+    size_t slots = 0;
+    size_t live = 0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+// One fixed-width store column that can start out as a view into a mapped
+// snapshot. Reads go straight to the mapping; the first write that changes
+// a value copies the column into memory the column owns, and only then
+// does it let go of the mapping. A freshly opened ledger that is only
+// looked at never copies its rows, and an edit copies only the columns it
+// changes.
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+template <typename T>
+class MappedColumn {
+public:
+    // Reads size values at data, which owner keeps mapped
+    void View(const T* data, size_t size, std::shared_ptr<const void> owner) {
+        values.clear();
+        values.shrink_to_fit();
+        view = data;
+        viewSize = size;
+        mapping = std::move(owner);
+    }
+
+    MappedColumn& operator=(std::vector<T>&& owned) {
+        Release();
+        values = std::move(owned);
+        return *this;
+    }
+
+    bool Mapped() const { return view != nullptr; }
+
+    const T* data() const { return view != nullptr ? view : values.data(); }
+    size_t size() const { return view != nullptr ? viewSize : values.size(); }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    // Bytes this column allocated; a mapped column's pages belong to the file
+    size_t capacity() const { return values.capacity(); }
+
+    void clear() {
+        Release();
+        values.clear();
+    }
+
+    // Writes that leave a mapped value as it is do not copy the column
+    void Set(size_t i, const T& value) {
+        if (view != nullptr && view[i] == value) return;
+        Owned()[i] = value;
+    }
+
+    void push_back(const T& value) { Owned().push_back(value); }
+
+    template <typename It>
+    void Append(It first, It last) {
+        std::vector<T>& owned = Owned();
+        owned.insert(owned.end(), first, last);
+    }
+
+    void reserve(size_t count) { Owned().reserve(count); }
+
+    // The values as owned memory, copying them out of the mapping first
+    std::vector<T>& Owned() {
+        if (view != nullptr) {
+            values.assign(view, view + viewSize);
+            Release();
+        }
+        return values;
+    }
+
+private:
+    void Release() {
+        view = nullptr;
+        viewSize = 0;
+        mapping.reset();
+    }
+
+    std::vector<T> values;
+    const T* view = nullptr;
+    size_t viewSize = 0;
+    std::shared_ptr<const void> mapping;
+};
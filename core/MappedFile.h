@@ -0,0 +1,34 @@
+#pragma once
+
+// Read-only memory mapping of a whole file (mmap / CreateFileMapping), and
+// the matching durable-write helper.
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Flushes f's buffers and forces the data to disk (fsync / _commit)
+bool SyncFile(std::FILE* f);
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,108 @@
+#include "Money.h"
+
+bool Money::Parse(std::string_view text, Money& out, const Currency& currency) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t')) --end;
+
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // Significant digits, leading zeros dropped; value = digits * 10^exponent
+    char digits[40];
+    int count = 0;
+    int exponent = 0;
+    bool sawDigit = false;
+    bool sawPoint = false;
+    for (; p < end; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            sawDigit = true;
+            if (sawPoint) --exponent;
+            if (count == 0 && *p == '0') continue;
+            if (count == sizeof(digits)) return false;
+            digits[count++] = *p;
+        } else if (*p == '.' && !sawPoint) {
+            sawPoint = true;
+        } else {
+            break;
+        }
+    }
+    if (!sawDigit) return false;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        if (p == end) return false;
+        int value = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+            if (value > 1000) return false;
+            value = value * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+    if (p != end) return false;
+
+    // Number of digits that land left of the minor-unit point
+    int keep = count + exponent + currency.scale;
+    if (keep > 19) return false;
+
+    uint64_t value = 0;
+    for (int i = 0; i < keep; ++i) {
+        uint64_t digit = i < count ? static_cast<uint64_t>(digits[i] - '0') : 0;
+        if (value > (UINT64_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    if (keep >= 0 && keep < count && digits[keep] >= '5') ++value;
+
+    // The negative range reaches one further, to INT64_MIN
+    if (value > static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0)) return false;
+    if (negative) {
+        out = Money(value == 0 ? 0 : -static_cast<int64_t>(value - 1) - 1);
+    } else {
+        out = Money(static_cast<int64_t>(value));
+    }
+    return true;
+}
+
+template <typename Char>
+static size_t FormatMinor(int64_t minor, int scale, Char* out) {
+    Char digits[24];
+    int count = 0;
+    bool negative = minor < 0;
+    uint64_t value = negative ? 0 - static_cast<uint64_t>(minor) : static_cast<uint64_t>(minor);
+    do {
+        digits[count++] = static_cast<Char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0 || count <= scale);
+
+    size_t length = 0;
+    if (negative) out[length++] = static_cast<Char>('-');
+    while (count > scale) out[length++] = digits[--count];
+    if (scale > 0) {
+        out[length++] = static_cast<Char>('.');
+        while (count > 0) out[length++] = digits[--count];
+    }
+    return length;
+}
+
+size_t Money::Format(char* out, const Currency& currency) const {
+    return FormatMinor(minor, currency.scale, out);
+}
+
+size_t Money::Format(wchar_t* out, const Currency& currency) const {
+    return FormatMinor(minor, currency.scale, out);
+}
+
+double Money::ToDouble(const Currency& currency) const {
+    double divisor = 1;
+    for (int i = 0; i < currency.scale; ++i) divisor *= 10;
+    return static_cast<double>(minor) / divisor;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Fixed-point money: a signed 64-bit count of the currency's minor unit
+// (centavos for the peso). Parsing and formatting work on plain decimal
+// text without locales or floating point, so amounts round-trip exactly.
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+struct Currency {
+    std::string_view code;
+    int scale;              // digits after the decimal point
+};
+
+constexpr Currency kPeso = { "PHP", 2 };
+
+class Money {
+public:
+    constexpr Money() : minor(0) {}
+
+    static constexpr Money FromMinor(int64_t minor) { return Money(minor); }
+    constexpr int64_t Minor() const { return minor; }
+
+    // Parses "1234", "1234.5", "-0.75", "+3" and the exponent form
+    // ("1.23457e+06") that old versions wrote. Extra fraction digits are
+    // rounded half away from zero. Fails on anything else or on overflow.
+    static bool Parse(std::string_view text, Money& out, const Currency& currency = kPeso);
+
+    // Writes e.g. "1234.50" (no terminator) and returns its length. out
+    // needs room for maxFormattedLength characters.
+    size_t Format(char* out, const Currency& currency = kPeso) const;
+    size_t Format(wchar_t* out, const Currency& currency = kPeso) const;
+    static constexpr size_t maxFormattedLength = 24;
+
+    // For ratios and percentages only
+    double ToDouble(const Currency& currency = kPeso) const;
+
+    constexpr Money operator+(Money other) const { return Money(minor + other.minor); }
+    constexpr Money operator-(Money other) const { return Money(minor - other.minor); }
+    constexpr Money operator-() const { return Money(-minor); }
+    Money& operator+=(Money other) { minor += other.minor; return *this; }
+    Money& operator-=(Money other) { minor -= other.minor; return *this; }
+
+    constexpr bool operator==(Money other) const { return minor == other.minor; }
+    constexpr bool operator!=(Money other) const { return minor != other.minor; }
+    constexpr bool operator<(Money other) const { return minor < other.minor; }
+    constexpr bool operator>(Money other) const { return minor > other.minor; }
+    constexpr bool operator<=(Money other) const { return minor <= other.minor; }
+    constexpr bool operator>=(Money other) const { return minor >= other.minor; }
+
+private:
+    constexpr explicit Money(int64_t minor) : minor(minor) {}
+
+    int64_t minor;
+};
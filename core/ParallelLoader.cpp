@@ -0,0 +1,118 @@
+#include "ParallelLoader.h"
+
+#include "CategoryDictionary.h"
+#include "Date.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Small chunks keep every worker busy to the end; large ones keep the
+// per-chunk overhead (a category table, four vectors) negligible
+static constexpr size_t minChunkBytes = 1 << 20;
+static constexpr size_t chunksPerThread = 4;
+
+namespace {
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+
+    TransactionColumns columns;
+    CategoryDictionary categories;   // ids local to the chunk
+    LedgerLoadStats stats;
+};
+
+}
+
+static void ParseChunk(Chunk& chunk) {
+    TransactionColumns& columns = chunk.columns;
+    size_t estimate = (chunk.end - chunk.begin) / 32;
+    columns.types.reserve(estimate);
+    columns.amounts.reserve(estimate);
+    columns.categories.reserve(estimate);
+    columns.days.reserve(estimate);
+
+    chunk.stats = ParseLedgerLines(chunk.begin, chunk.end, [&](const LedgerRow& row) {
+        int32_t day;
+        if (!ParseDate(row.date, day)) day = kNoDate;
+
+        columns.types.push_back(static_cast<uint8_t>(TypeFromName(row.type)));
+        columns.amounts.push_back(row.amount.Minor());
+        columns.categories.push_back(chunk.categories.Intern(row.category));
+        columns.days.push_back(day);
+    });
+}
+
+// Splits [begin, end) into about count pieces, each ending just after a '\n'
+static std::vector<Chunk> SplitChunks(const char* begin, const char* end, size_t count) {
+    std::vector<Chunk> chunks;
+    size_t target = std::max(minChunkBytes, static_cast<size_t>(end - begin) / count + 1);
+
+    for (const char* p = begin; p < end;) {
+        const char* cut = end;
+        if (static_cast<size_t>(end - p) > target) {
+            const char* eol = static_cast<const char*>(std::memchr(p + target, '\n', end - (p + target)));
+            if (eol != nullptr) cut = eol + 1;
+        }
+
+        chunks.emplace_back();
+        chunks.back().begin = p;
+        chunks.back().end = cut;
+        p = cut;
+    }
+    return chunks;
+}
+
+LedgerLoadStats ParallelLoad(const char* data, size_t size, TransactionStore& store, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const char* begin = SkipByteOrderMark(data, size);
+    std::vector<Chunk> chunks = SplitChunks(begin, data + size, threads * chunksPerThread);
+
+    // Workers take the next unparsed chunk until none are left
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < chunks.size();) ParseChunk(chunks[i]);
+    };
+
+    size_t workers = std::min<size_t>(threads, chunks.size());
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; ++i) pool.emplace_back(work);
+    work();
+    for (std::thread& thread : pool) thread.join();
+
+    // Merge in file order. Interning each chunk's names in the order they
+    // first appeared gives the ids a sequential load would have assigned.
+    LedgerLoadStats stats;
+    stats.bytes = size;
+    size_t rows = 0;
+    for (const Chunk& chunk : chunks) rows += chunk.stats.rows;
+
+    TransactionColumns merged;
+    merged.types.reserve(rows);
+    merged.amounts.reserve(rows);
+    merged.categories.reserve(rows);
+    merged.days.reserve(rows);
+
+    std::vector<uint16_t> remap;
+    for (Chunk& chunk : chunks) {
+        remap.resize(chunk.categories.Size());
+        for (size_t id = 0; id < remap.size(); ++id) {
+            remap[id] = store.InternCategory(chunk.categories.Name(static_cast<uint16_t>(id)));
+        }
+
+        TransactionColumns& columns = chunk.columns;
+        merged.types.insert(merged.types.end(), columns.types.begin(), columns.types.end());
+        merged.amounts.insert(merged.amounts.end(), columns.amounts.begin(), columns.amounts.end());
+        merged.days.insert(merged.days.end(), columns.days.begin(), columns.days.end());
+        for (uint16_t id : columns.categories) merged.categories.push_back(remap[id]);
+
+        stats.rows += chunk.stats.rows;
+        stats.skipped += chunk.stats.skipped;
+        columns = TransactionColumns();
+    }
+
+    store.AppendColumns(std::move(merged));
+    return stats;
+}
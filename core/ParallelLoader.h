@@ -0,0 +1,14 @@
+#pragma once
+
+// Multi-threaded transactions.txt loading. The text is cut into
+// newline-aligned chunks. Worker threads parse the chunks into per-chunk
+// columns, each with its own category table. The chunks are then merged in
+// file order, so rows, indices and category ids come out exactly as with
+// the sequential ForEachRow + MakeRow loop.
+
+#include "LedgerLoader.h"
+#include "TransactionStore.h"
+
+// Appends every well-formed row of [data, data + size) to store. threads 0
+// uses one per hardware thread; 1 parses on the calling thread.
+LedgerLoadStats ParallelLoad(const char* data, size_t size, TransactionStore& store, unsigned threads = 0);
@@ -0,0 +1,147 @@
+#include "Report.h"
+
+#include "Date.h"
+
+#include <cstdio>
+#include <vector>
+
+static void AppendMoney(std::string& out, Money amount) {
+    char text[Money::maxFormattedLength];
+    out += u8"₱";
+    out.append(text, amount.Format(text));
+}
+
+static void AppendLine(std::string& out, const char* label, Money amount) {
+    out += label;
+    AppendMoney(out, amount);
+    out += '\n';
+}
+
+static void AppendPeriod(std::string& out, const RollupCube& rollups, RollupLevel level, int32_t period) {
+    Money income = Money::FromMinor(rollups.Total(level, period, TransactionType::Income).amount);
+    Money expense = Money::FromMinor(rollups.Total(level, period, TransactionType::Expense).amount);
+    AppendLine(out, "Income:    ", income);
+    AppendLine(out, "Expenses:  ", expense);
+    AppendLine(out, "Net:       ", income - expense);
+}
+
+// Last day of a month, for closing balances
+static int32_t MonthEnd(int year, unsigned month) {
+    return month == 12 ? DaysFromCivil(year + 1, 1, 1) - 1 : DaysFromCivil(year, month + 1, 1) - 1;
+}
+
+// Categories with expenses, by dictionary id, with their share of total
+static void AppendCategories(std::string& out, const TransactionStore& store, const std::vector<Money>& byCategory,
+                             Money total) {
+    for (size_t id = 0; id < byCategory.size(); ++id) {
+        Money categoryTotal = byCategory[id];
+        if (categoryTotal > Money()) {
+            double percentage = (total > Money()) ? (categoryTotal.ToDouble() / total.ToDouble() * 100) : 0;
+            char share[32];
+            std::snprintf(share, sizeof(share), " (%.1f%%)", percentage);
+
+            out += '\n';
+            out += store.CategoryName(static_cast<uint16_t>(id));
+            out += ": ";
+            AppendMoney(out, categoryTotal);
+            out += share;
+        }
+    }
+}
+
+std::string FormatReport(const TransactionStore& store, int year, unsigned month) {
+    const LedgerTotals& totals = store.Totals();
+    Money totalIncome = totals.Income(), totalExpense = totals.Expense();
+
+    std::string report;
+    report += u8"💰 FINANCIAL REPORT 💰\n\n";
+    report += u8"═══════════════════════════════\n";
+    AppendLine(report, "Total Income:    ", totalIncome);
+    AppendLine(report, "Total Expenses:  ", totalExpense);
+    report += u8"───────────────────────────────\n";
+    AppendLine(report, "Net Savings:     ", totalIncome - totalExpense);
+    report += u8"═══════════════════════════════\n\n";
+
+    // Month totals are two cells of the rollup cube
+    int32_t period = RollupCube::MonthPeriod(year, month);
+    char heading[64];
+    std::snprintf(heading, sizeof(heading), u8"📅 MONTH %02u/%04d:\n", month, year);
+    report += heading;
+    AppendPeriod(report, store.Rollups(), RollupLevel::Month, period);
+    AppendLine(report, "Balance:   ", store.Balances().AsOf(MonthEnd(year, month)));
+    report += '\n';
+
+    std::vector<Money> byCategory(store.CategoryCount());
+    for (size_t id = 0; id < store.CategoryCount(); ++id) {
+        byCategory[id] = totals.Category(TransactionType::Expense, static_cast<uint16_t>(id));
+    }
+    report += u8"📊 EXPENSES BY CATEGORY:\n";
+    AppendCategories(report, store, byCategory, totalExpense);
+    return report;
+}
+
+std::string FormatYearReport(const TransactionStore& store, int year) {
+    const RollupCube& rollups = store.Rollups();
+    Money expense = Money::FromMinor(rollups.Total(RollupLevel::Year, year, TransactionType::Expense).amount);
+
+    std::string report;
+    char heading[64];
+    std::snprintf(heading, sizeof(heading), u8"💰 FINANCIAL REPORT %04d 💰\n\n", year);
+    report += heading;
+    report += u8"═══════════════════════════════\n";
+    AppendPeriod(report, rollups, RollupLevel::Year, year);
+    AppendLine(report, "Balance:   ", store.Balances().AsOf(MonthEnd(year, 12)));
+    report += u8"═══════════════════════════════\n\n";
+
+    report += u8"📅 BY MONTH:\n";
+    for (unsigned month = 1; month <= 12; ++month) {
+        int32_t period = RollupCube::MonthPeriod(year, month);
+        RollupCell in = rollups.Total(RollupLevel::Month, period, TransactionType::Income);
+        RollupCell out = rollups.Total(RollupLevel::Month, period, TransactionType::Expense);
+        if (in.rows + out.rows == 0) continue;
+
+        std::snprintf(heading, sizeof(heading), "%02u/%04d  ", month, year);
+        report += heading;
+        report += "Income ";
+        AppendMoney(report, Money::FromMinor(in.amount));
+        report += "  Expenses ";
+        AppendMoney(report, Money::FromMinor(out.amount));
+        report += "  Net ";
+        AppendMoney(report, Money::FromMinor(in.amount - out.amount));
+        report += "  Balance ";
+        AppendMoney(report, store.Balances().AsOf(MonthEnd(year, month)));
+        report += '\n';
+    }
+    report += '\n';
+
+    // One year cell per category
+    std::vector<Money> byCategory(store.CategoryCount());
+    rollups.ForEachCell(RollupLevel::Year, year, year,
+                        [&](int32_t, TransactionType type, uint16_t category, const RollupCell& cell) {
+        if (type == TransactionType::Expense && category < byCategory.size()) byCategory[category] = Money::FromMinor(cell.amount);
+    });
+    report += u8"📊 EXPENSES BY CATEGORY:\n";
+    AppendCategories(report, store, byCategory, expense);
+    return report;
+}
+
+std::string FormatSummary(const TransactionStore& store) {
+    const LedgerTotals& totals = store.Totals();
+
+    std::string summary = "Transactions: " + std::to_string(store.Size()) + "\n";
+    summary += "Categories:   " + std::to_string(store.CategoryCount()) + "\n";
+    AppendLine(summary, "Income:       ", totals.Income());
+    AppendLine(summary, "Expenses:     ", totals.Expense());
+    AppendLine(summary, "Net:          ", totals.Net());
+
+    int32_t first, last;
+    if (store.Dates().DayRange(first, last)) {
+        char from[16], to[16];
+        summary += "Dates:        ";
+        summary.append(from, FormatDate(first, from));
+        summary += " - ";
+        summary.append(to, FormatDate(last, to));
+        summary += '\n';
+    }
+    return summary;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Plain-text (UTF-8) reports over a ledger, shared by the Win32 app and
+// finsync-cli so both print the same figures. Period figures come from the
+// store's rollup cube, so a report costs periods x categories, not rows;
+// closing balances are Fenwick queries on its running balance.
+
+#include "TransactionStore.h"
+
+#include <string>
+
+// Totals, the given month with its closing balance and expenses by
+// category with percentages
+std::string FormatReport(const TransactionStore& store, int year, unsigned month);
+
+// The year's totals, each month's with its closing balance and the year's
+// expenses by category
+std::string FormatYearReport(const TransactionStore& store, int year);
+
+// Row count, totals and the date range covered, one item per line
+std::string FormatSummary(const TransactionStore& store);
@@ -0,0 +1,247 @@
+#include "RollupCube.h"
+
+#include "Date.h"
+
+#include <algorithm>
+#include <cstring>
+
+// One saved day cell
+struct RollupRecord {
+    int32_t day;
+    uint16_t category;
+    uint8_t type;
+    uint8_t reserved;
+    uint64_t rows;
+    int64_t amount;
+};
+static_assert(sizeof(RollupRecord) == 24, "RollupRecord is saved as is");
+
+// Build accumulates into a flat days x types x categories array up to this
+// many cells, and adds the rows one at a time beyond it
+static constexpr size_t maxDenseCells = size_t(1) << 22;
+
+void RollupCube::Clear() {
+    for (auto& periods : levels) periods.clear();
+}
+
+int32_t RollupCube::PeriodOf(RollupLevel level, int32_t day) {
+    if (level == RollupLevel::Day) return day;
+    if (level == RollupLevel::Week) return WeekPeriod(day);
+
+    int year;
+    unsigned month, dayOfMonth;
+    CivilFromDays(day, year, month, dayOfMonth);
+    return level == RollupLevel::Month ? MonthPeriod(year, month) : year;
+}
+
+void RollupCube::AddTo(std::vector<Entry>& cells, int32_t period, uint8_t type, uint16_t category, int64_t amount,
+                       int64_t rows) {
+    auto it = std::lower_bound(cells.begin(), cells.end(), period, [type, category](const Entry& entry, int32_t key) {
+        return Before(entry, key, type, category);
+    });
+    if (it == cells.end() || it->period != period || it->type != type || it->category != category) {
+        it = cells.insert(it, Entry{ period, category, type, RollupCell() });
+    }
+    it->cell.amount += amount;
+    it->cell.rows += static_cast<uint64_t>(rows);
+
+    // A cell whose last row went is dropped, as a rebuild would have it
+    if (it->cell.rows == 0) cells.erase(it);
+}
+
+void RollupCube::Apply(int32_t day, TransactionType type, uint16_t category, int64_t amount, int64_t rows) {
+    if (day == kNoDate) return;
+
+    int year;
+    unsigned month, dayOfMonth;
+    CivilFromDays(day, year, month, dayOfMonth);
+    const int32_t keys[4] = { day, WeekPeriod(day), MonthPeriod(year, month), year };
+
+    for (size_t level = 0; level < 4; ++level) {
+        AddTo(levels[level], keys[level], static_cast<uint8_t>(type), category, amount, rows);
+    }
+}
+
+void RollupCube::Add(int32_t day, TransactionType type, uint16_t category, Money amount) {
+    Apply(day, type, category, amount.Minor(), 1);
+}
+
+void RollupCube::Remove(int32_t day, TransactionType type, uint16_t category, Money amount) {
+    Apply(day, type, category, -amount.Minor(), -1);
+}
+
+void RollupCube::Build(size_t rows, const int32_t* days, const uint8_t* types, const uint16_t* categories,
+                       const int64_t* amounts, const LiveSet* live) {
+    Clear();
+
+    int32_t first = INT32_MAX;
+    int32_t last = INT32_MIN;
+    size_t categoryCount = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        if (days[row] == kNoDate || (live != nullptr && !live->Test(row))) continue;
+        first = std::min(first, days[row]);
+        last = std::max(last, days[row]);
+        categoryCount = std::max(categoryCount, static_cast<size_t>(categories[row]) + 1);
+    }
+    if (first > last) return;
+
+    size_t span = static_cast<size_t>(static_cast<int64_t>(last) - first) + 1;
+    size_t width = 2 * categoryCount;
+    if (span > maxDenseCells / width) {
+        for (size_t row = 0; row < rows; ++row) {
+            if (live != nullptr && !live->Test(row)) continue;
+            Apply(days[row], static_cast<TransactionType>(types[row]), categories[row], amounts[row], 1);
+        }
+        return;
+    }
+
+    std::vector<RollupCell> dense(span * width);
+    size_t used = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        if (days[row] == kNoDate || (live != nullptr && !live->Test(row))) continue;
+        RollupCell& cell = dense[static_cast<size_t>(days[row] - first) * width + types[row] * categoryCount + categories[row]];
+        cell.amount += amounts[row];
+        used += cell.rows++ == 0;
+    }
+
+    // The dense array is in period, type, category order already
+    std::vector<Entry>& byDay = levels[static_cast<size_t>(RollupLevel::Day)];
+    byDay.reserve(used);
+    for (size_t i = 0; i < dense.size(); ++i) {
+        if (dense[i].rows == 0) continue;
+        size_t slot = i % width;
+        byDay.push_back(Entry{ first + static_cast<int32_t>(i / width), static_cast<uint16_t>(slot % categoryCount),
+                               static_cast<uint8_t>(slot / categoryCount), dense[i] });
+    }
+    RollUp();
+}
+
+void RollupCube::RollUp() {
+    const std::vector<Entry>& byDay = levels[static_cast<size_t>(RollupLevel::Day)];
+    size_t categoryCount = 0;
+    for (const Entry& entry : byDay) categoryCount = std::max(categoryCount, static_cast<size_t>(entry.category) + 1);
+    size_t width = 2 * categoryCount;
+
+    // Days come in order, so each coarser period's days are consecutive;
+    // a period is summed in a dense row of cells and written out once done
+    std::vector<RollupCell> sums(width);
+    auto rollUp = [&](RollupLevel level, auto periodOf) {
+        std::vector<Entry>& cells = levels[static_cast<size_t>(level)];
+        cells.clear();
+        auto flush = [&](int32_t period) {
+            for (size_t slot = 0; slot < width; ++slot) {
+                if (sums[slot].rows == 0) continue;
+                cells.push_back(Entry{ period, static_cast<uint16_t>(slot % categoryCount),
+                                       static_cast<uint8_t>(slot / categoryCount), sums[slot] });
+                sums[slot] = RollupCell();
+            }
+        };
+        for (size_t i = 0; i < byDay.size(); ++i) {
+            int32_t period = periodOf(byDay[i].period);
+            RollupCell& sum = sums[byDay[i].type * categoryCount + byDay[i].category];
+            sum.amount += byDay[i].cell.amount;
+            sum.rows += byDay[i].cell.rows;
+            if (i + 1 == byDay.size() || periodOf(byDay[i + 1].period) != period) flush(period);
+        }
+        cells.shrink_to_fit();
+    };
+    rollUp(RollupLevel::Week, [](int32_t day) { return WeekPeriod(day); });
+    rollUp(RollupLevel::Month, [](int32_t day) { return PeriodOf(RollupLevel::Month, day); });
+    rollUp(RollupLevel::Year, [](int32_t day) { return PeriodOf(RollupLevel::Year, day); });
+}
+
+RollupCell RollupCube::Cell(RollupLevel level, int32_t period, TransactionType type, uint16_t category) const {
+    const std::vector<Entry>& cells = levels[static_cast<size_t>(level)];
+    uint8_t t = static_cast<uint8_t>(type);
+    auto it = std::lower_bound(cells.begin(), cells.end(), period, [t, category](const Entry& entry, int32_t key) {
+        return Before(entry, key, t, category);
+    });
+    bool found = it != cells.end() && it->period == period && it->type == t && it->category == category;
+    return found ? it->cell : RollupCell();
+}
+
+RollupCell RollupCube::Total(RollupLevel level, int32_t period, TransactionType type) const {
+    const std::vector<Entry>& cells = levels[static_cast<size_t>(level)];
+    uint8_t t = static_cast<uint8_t>(type);
+    auto it = std::lower_bound(cells.begin(), cells.end(), period, [t](const Entry& entry, int32_t key) {
+        return Before(entry, key, t, 0);
+    });
+    RollupCell total;
+    for (; it != cells.end() && it->period == period && it->type == t; ++it) {
+        total.amount += it->cell.amount;
+        total.rows += it->cell.rows;
+    }
+    return total;
+}
+
+size_t RollupCube::PeriodCount(RollupLevel level) const {
+    const std::vector<Entry>& cells = levels[static_cast<size_t>(level)];
+    size_t count = 0;
+    for (size_t i = 0; i < cells.size(); ++i) count += i == 0 || cells[i].period != cells[i - 1].period;
+    return count;
+}
+
+std::string RollupCube::Serialize() const {
+    const std::vector<Entry>& byDay = levels[static_cast<size_t>(RollupLevel::Day)];
+    std::string out(byDay.size() * sizeof(RollupRecord), '\0');
+    for (size_t i = 0; i < byDay.size(); ++i) {
+        const Entry& entry = byDay[i];
+        RollupRecord record = { entry.period, entry.category, entry.type, 0, entry.cell.rows, entry.cell.amount };
+        std::memcpy(&out[i * sizeof(record)], &record, sizeof(record));
+    }
+    return out;
+}
+
+bool RollupCube::Load(std::string_view bytes, size_t categoryCount) {
+    Clear();
+    if (bytes.size() % sizeof(RollupRecord) != 0) return false;
+
+    std::vector<Entry>& byDay = levels[static_cast<size_t>(RollupLevel::Day)];
+    byDay.reserve(bytes.size() / sizeof(RollupRecord));
+    for (size_t offset = 0; offset < bytes.size(); offset += sizeof(RollupRecord)) {
+        RollupRecord record;
+        std::memcpy(&record, bytes.data() + offset, sizeof(record));
+        if (record.day == kNoDate || record.type > 1 || record.category >= categoryCount || record.rows == 0) {
+            Clear();
+            return false;
+        }
+        byDay.push_back(Entry{ record.day, record.category, record.type, RollupCell{ record.amount, record.rows } });
+    }
+
+    // Saved in order; anything else is sorted and repeated cells merged
+    auto less = [](const Entry& a, const Entry& b) { return Before(a, b.period, b.type, b.category); };
+    if (!std::is_sorted(byDay.begin(), byDay.end(), less)) std::stable_sort(byDay.begin(), byDay.end(), less);
+    size_t kept = 0;
+    for (size_t i = 0; i < byDay.size(); ++i) {
+        if (kept > 0 && !less(byDay[kept - 1], byDay[i])) {
+            byDay[kept - 1].cell.amount += byDay[i].cell.amount;
+            byDay[kept - 1].cell.rows += byDay[i].cell.rows;
+        } else {
+            byDay[kept++] = byDay[i];
+        }
+    }
+    byDay.resize(kept);
+    RollUp();
+    return true;
+}
+
+size_t RollupCube::MemoryUsage() const {
+    size_t bytes = 0;
+    for (const auto& cells : levels) bytes += cells.capacity() * sizeof(Entry);
+    return bytes;
+}
+
+bool RollupCube::operator==(const RollupCube& other) const {
+    for (size_t level = 0; level < 4; ++level) {
+        const std::vector<Entry>& a = levels[level];
+        const std::vector<Entry>& b = other.levels[level];
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].period != b[i].period || a[i].type != b[i].type || a[i].category != b[i].category ||
+                !(a[i].cell == b[i].cell)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
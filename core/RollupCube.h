@@ -0,0 +1,119 @@
+#pragma once
+
+// Amount and row count per (period, type, category) at day, week, month
+// and year granularity, kept up to date by delta like LedgerTotals. A
+// weekly, monthly or yearly report reads the cells of its periods (periods
+// x categories) instead of the rows.
+//
+// Periods are keyed by day number, by the day number of the week's Monday
+// (weeks run Monday to Sunday, as ISO weeks do), by year * 12 + month - 1
+// (as DateIndex::MonthKey) and by year. Rows without a date belong to no
+// period and are left out. Only the day cells are saved; weeks, months and
+// years are summed from them on load, which is far fewer cells than rows.
+
+#include "LedgerTypes.h"
+#include "LiveSet.h"
+#include "Money.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class RollupLevel : uint8_t {
+    Day,
+    Week,
+    Month,
+    Year
+};
+
+struct RollupCell {
+    int64_t amount = 0;     // minor units
+    uint64_t rows = 0;
+
+    bool Empty() const { return rows == 0 && amount == 0; }
+    bool operator==(const RollupCell& other) const { return amount == other.amount && rows == other.rows; }
+};
+
+class RollupCube {
+public:
+    void Clear();
+
+    void Add(int32_t day, TransactionType type, uint16_t category, Money amount);
+    void Remove(int32_t day, TransactionType type, uint16_t category, Money amount);
+
+    // Recomputes every cell from columns; slots not in live, if given, are
+    // left out
+    void Build(size_t rows, const int32_t* days, const uint8_t* types, const uint16_t* categories,
+               const int64_t* amounts, const LiveSet* live = nullptr);
+
+    static int32_t PeriodOf(RollupLevel level, int32_t day);
+    static int32_t MonthPeriod(int year, unsigned month) { return year * 12 + static_cast<int32_t>(month) - 1; }
+    static int32_t WeekPeriod(int32_t day) {
+        // Day 0, 1970-01-01, was a Thursday
+        return day - ((day % 7 + 10) % 7);
+    }
+
+    // One cell, and one period's total over all categories; empty if unused
+    RollupCell Cell(RollupLevel level, int32_t period, TransactionType type, uint16_t category) const;
+    RollupCell Total(RollupLevel level, int32_t period, TransactionType type) const;
+
+    // Calls onCell(int32_t period, TransactionType type, uint16_t category,
+    // const RollupCell& cell) for the non-empty cells of periods
+    // first..last, in period order
+    template <typename Fn>
+    void ForEachCell(RollupLevel level, int32_t first, int32_t last, Fn&& onCell) const;
+
+    // Periods with at least one row
+    size_t PeriodCount(RollupLevel level) const;
+
+    // The day cells as fixed-size records, for the snapshot
+    std::string Serialize() const;
+
+    // Replaces the cube with saved day cells. Fails, leaving it empty, on
+    // malformed data or a category id not below categoryCount.
+    bool Load(std::string_view bytes, size_t categoryCount);
+
+    size_t MemoryUsage() const;
+
+    // Same non-empty cells
+    bool operator==(const RollupCube& other) const;
+    bool operator!=(const RollupCube& other) const { return !(*this == other); }
+
+private:
+    // One non-empty cell. Each level keeps its cells in one vector sorted by
+    // period, type and category, so a sparse ledger costs a record per
+    // cell in use rather than a period with every category.
+    struct Entry {
+        int32_t period;
+        uint16_t category;
+        uint8_t type;
+        RollupCell cell;
+    };
+
+    static bool Before(const Entry& entry, int32_t period, uint8_t type, uint16_t category) {
+        if (entry.period != period) return entry.period < period;
+        return entry.type != type ? entry.type < type : entry.category < category;
+    }
+
+    static void AddTo(std::vector<Entry>& cells, int32_t period, uint8_t type, uint16_t category, int64_t amount,
+                      int64_t rows);
+    void Apply(int32_t day, TransactionType type, uint16_t category, int64_t amount, int64_t rows);
+
+    // Sums the day cells into weeks, months and years
+    void RollUp();
+
+    std::vector<Entry> levels[4];
+};
+
+template <typename Fn>
+void RollupCube::ForEachCell(RollupLevel level, int32_t first, int32_t last, Fn&& onCell) const {
+    const std::vector<Entry>& cells = levels[static_cast<size_t>(level)];
+    auto it = std::lower_bound(cells.begin(), cells.end(), first,
+                               [](const Entry& entry, int32_t period) { return entry.period < period; });
+    for (; it != cells.end() && it->period <= last; ++it) {
+        onCell(it->period, static_cast<TransactionType>(it->type), it->category, it->cell);
+    }
+}
@@ -0,0 +1,26 @@
+#include "RowSet.h"
+
+#include <bitset>
+
+void RowSet::Assign(size_t count, bool full) {
+    slots = count;
+    words.assign((count + 63) / 64, full ? ~uint64_t(0) : 0);
+    if (full && count % 64 != 0) words.back() = (uint64_t(1) << (count % 64)) - 1;
+}
+
+void RowSet::And(const uint64_t* other) {
+    for (size_t w = 0; w < words.size(); ++w) words[w] &= other[w];
+}
+
+size_t RowSet::Count() const {
+    size_t count = 0;
+    for (uint64_t word : words) count += std::bitset<64>(word).count();
+    return count;
+}
+
+std::vector<uint32_t> RowSet::ToSlots() const {
+    std::vector<uint32_t> out;
+    out.reserve(Count());
+    ForEach([&out](size_t slot) { out.push_back(static_cast<uint32_t>(slot)); });
+    return out;
+}
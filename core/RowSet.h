@@ -0,0 +1,63 @@
+#pragma once
+
+// A set of store slots as a bitmap, one bit per slot. Query clauses each
+// produce one and are combined a word at a time.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit; bits must not be zero
+inline unsigned LowestBit(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+class RowSet {
+public:
+    // slots slots, none set (or all set, with full)
+    void Assign(size_t slots, bool full = false);
+
+    void Set(size_t slot) { words[slot >> 6] |= uint64_t(1) << (slot & 63); }
+    void Reset(size_t slot) { words[slot >> 6] &= ~(uint64_t(1) << (slot & 63)); }
+    bool Test(size_t slot) const { return (words[slot >> 6] >> (slot & 63)) & 1; }
+
+    // Keeps only slots also set in other (words over the same slots)
+    void And(const RowSet& other) { And(other.words.data()); }
+    void And(const uint64_t* other);
+
+    size_t Slots() const { return slots; }
+    size_t Count() const;
+
+    // Calls onSlot(size_t slot) for every set slot, in order
+    template <typename Fn>
+    void ForEach(Fn&& onSlot) const;
+
+    std::vector<uint32_t> ToSlots() const;
+
+    const uint64_t* Words() const { return words.data(); }
+    uint64_t* Words() { return words.data(); }
+    size_t MemoryUsage() const { return words.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> words;
+    size_t slots = 0;
+};
+
+template <typename Fn>
+void RowSet::ForEach(Fn&& onSlot) const {
+    for (size_t w = 0; w < words.size(); ++w) {
+        for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+            onSlot(w * 64 + LowestBit(bits));
+        }
+    }
+}
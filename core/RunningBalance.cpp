@@ -0,0 +1,163 @@
+#include "RunningBalance.h"
+
+#include "Date.h"
+
+#include <algorithm>
+
+// Build sums into a flat array over the date range when the range has at
+// most this many days, or no more days than rows
+static constexpr size_t minDenseDays = size_t(1) << 16;
+
+static int64_t Signed(TransactionType type, int64_t amount) {
+    return type == TransactionType::Income ? amount : -amount;
+}
+
+void RunningBalance::Clear() {
+    dates.clear();
+    tree.clear();
+    undated = 0;
+}
+
+void RunningBalance::Apply(int32_t day, int64_t delta) {
+    if (day == kNoDate) {
+        undated += delta;
+        return;
+    }
+
+    auto at = std::lower_bound(dates.begin(), dates.end(), day);
+    size_t index = static_cast<size_t>(at - dates.begin());
+    if (at == dates.end()) {
+        // tree[n] covers the days (n & (n + 1))..n, all but day n already in
+        size_t n = dates.size();
+        int64_t covered = Prefix(n) - Prefix(n & (n + 1));
+        dates.push_back(day);
+        tree.push_back(delta + covered);
+        return;
+    }
+    if (*at != day) {
+        std::vector<int64_t> amounts = DayAmounts();
+        amounts.insert(amounts.begin() + static_cast<ptrdiff_t>(index), 0);
+        dates.insert(at, day);
+        Assign(std::move(amounts));
+    }
+    for (size_t i = index; i < tree.size(); i |= i + 1) tree[i] += delta;
+}
+
+void RunningBalance::Add(int32_t day, TransactionType type, Money amount) {
+    Apply(day, Signed(type, amount.Minor()));
+}
+
+void RunningBalance::Remove(int32_t day, TransactionType type, Money amount) {
+    Apply(day, -Signed(type, amount.Minor()));
+}
+
+void RunningBalance::Build(size_t rows, const int32_t* days, const uint8_t* types, const int64_t* amounts,
+                           const LiveSet* live) {
+    Clear();
+
+    int32_t first = INT32_MAX;
+    int32_t last = INT32_MIN;
+    for (size_t row = 0; row < rows; ++row) {
+        if (days[row] == kNoDate || (live != nullptr && !live->Test(row))) continue;
+        first = std::min(first, days[row]);
+        last = std::max(last, days[row]);
+    }
+
+    // Sums over every day from first to last when that is no bigger than
+    // the rows, then keeps the days that had rows; sorts the days otherwise
+    size_t span = first <= last ? static_cast<size_t>(static_cast<int64_t>(last) - first) + 1 : 0;
+    bool dense = span <= std::max(rows, minDenseDays);
+    std::vector<int64_t> byDay(dense ? span : 0);
+    std::vector<uint8_t> used(dense ? span : 0);
+    for (size_t row = 0; row < rows; ++row) {
+        if (live != nullptr && !live->Test(row)) continue;
+        int64_t amount = Signed(static_cast<TransactionType>(types[row]), amounts[row]);
+        if (days[row] == kNoDate) {
+            undated += amount;
+        } else if (dense) {
+            byDay[static_cast<size_t>(days[row] - first)] += amount;
+            used[static_cast<size_t>(days[row] - first)] = 1;
+        } else {
+            dates.push_back(days[row]);
+        }
+    }
+
+    std::vector<int64_t> net;
+    if (dense) {
+        for (size_t i = 0; i < span; ++i) {
+            if (!used[i]) continue;
+            dates.push_back(first + static_cast<int32_t>(i));
+            net.push_back(byDay[i]);
+        }
+    } else {
+        std::sort(dates.begin(), dates.end());
+        dates.erase(std::unique(dates.begin(), dates.end()), dates.end());
+        net.resize(dates.size());
+        for (size_t row = 0; row < rows; ++row) {
+            if (days[row] == kNoDate || (live != nullptr && !live->Test(row))) continue;
+            auto at = std::lower_bound(dates.begin(), dates.end(), days[row]);
+            net[static_cast<size_t>(at - dates.begin())] += Signed(static_cast<TransactionType>(types[row]), amounts[row]);
+        }
+    }
+    dates.shrink_to_fit();
+    Assign(std::move(net));
+}
+
+void RunningBalance::Assign(std::vector<int64_t>&& amounts) {
+    // Each node passes its sum up to its parent: O(days)
+    tree = std::move(amounts);
+    for (size_t i = 0; i < tree.size(); ++i) {
+        size_t parent = i | (i + 1);
+        if (parent < tree.size()) tree[parent] += tree[i];
+    }
+}
+
+std::vector<int64_t> RunningBalance::DayAmounts() const {
+    // Assign run backwards
+    std::vector<int64_t> amounts = tree;
+    for (size_t i = amounts.size(); i-- > 0;) {
+        size_t parent = i | (i + 1);
+        if (parent < amounts.size()) amounts[parent] -= amounts[i];
+    }
+    return amounts;
+}
+
+int64_t RunningBalance::Prefix(size_t count) const {
+    // tree[i] covers the days (i & (i + 1))..i
+    int64_t sum = 0;
+    for (size_t i = count; i > 0; i &= i - 1) sum += tree[i - 1];
+    return sum;
+}
+
+Money RunningBalance::AsOf(int32_t day) const {
+    if (day == kNoDate) return Money::FromMinor(undated);
+    size_t count = static_cast<size_t>(std::upper_bound(dates.begin(), dates.end(), day) - dates.begin());
+    return Money::FromMinor(undated + Prefix(count));
+}
+
+Money RunningBalance::Before(int32_t day) const {
+    if (day == kNoDate) return Money();
+    return AsOf(day - 1);
+}
+
+bool RunningBalance::operator==(const RunningBalance& other) const {
+    if (undated != other.undated) return false;
+
+    // Either may still hold days whose rows have all gone; those are zero
+    std::vector<int64_t> a = DayAmounts();
+    std::vector<int64_t> b = other.DayAmounts();
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (i < a.size() && a[i] == 0) {
+            ++i;
+        } else if (j < b.size() && b[j] == 0) {
+            ++j;
+        } else if (i == a.size() || j == b.size() || dates[i] != other.dates[j] || a[i] != b[j]) {
+            return false;
+        } else {
+            ++i;
+            ++j;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// The running balance (income minus expense) in date order, behind the
+// table's Balance column and the reports' closing balances. A Fenwick tree
+// over the days that have rows holds each day's net amount, so a change to a
+// row on a known date and the balance as of any date both cost O(log days),
+// where redoing the prefix sum over the rows would cost O(n) per edit. A new
+// latest date is appended in O(log days); a new date before it rebuilds the
+// tree, O(days), which is far fewer than the rows.
+//
+// Rows are ordered by day, then by slot, as DateIndex keeps them. Rows
+// without a date come before every dated row, so the balance after the last
+// row is the ledger's net. TransactionStore::BalanceAfter gives one row's
+// balance by adding its same-day predecessors to the balance before its day.
+
+#include "LedgerTypes.h"
+#include "LiveSet.h"
+#include "Money.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RunningBalance {
+public:
+    void Clear();
+
+    void Add(int32_t day, TransactionType type, Money amount);
+    void Remove(int32_t day, TransactionType type, Money amount);
+
+    // Recomputes the tree from columns; slots not in live, if given, are
+    // left out
+    void Build(size_t rows, const int32_t* days, const uint8_t* types, const int64_t* amounts,
+               const LiveSet* live = nullptr);
+
+    // Balance after every row dated day or earlier, undated rows included
+    Money AsOf(int32_t day) const;
+
+    // Balance after the rows dated before day; zero before undated rows
+    Money Before(int32_t day) const;
+
+    // Net of the undated rows, and of every row
+    Money Undated() const { return Money::FromMinor(undated); }
+    Money Total() const { return dates.empty() ? Undated() : AsOf(dates.back()); }
+
+    size_t MemoryUsage() const { return dates.capacity() * sizeof(int32_t) + tree.capacity() * sizeof(int64_t); }
+
+    // Same net amount on every day
+    bool operator==(const RunningBalance& other) const;
+    bool operator!=(const RunningBalance& other) const { return !(*this == other); }
+
+private:
+    void Apply(int32_t day, int64_t delta);
+
+    // Sum of the first count days' net amounts
+    int64_t Prefix(size_t count) const;
+
+    // Net amounts in the order of dates
+    std::vector<int64_t> DayAmounts() const;
+    void Assign(std::vector<int64_t>&& amounts);
+
+    std::vector<int32_t> dates;     // days with rows, sorted
+    std::vector<int64_t> tree;      // Fenwick tree over dates
+    int64_t undated = 0;
+};
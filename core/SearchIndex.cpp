@@ -0,0 +1,234 @@
+#include "SearchIndex.h"
+
+#include <algorithm>
+#include <iterator>
+
+// A clause whose rows outnumber the candidates by this much is checked on
+// the columns for each candidate instead of being turned into a bitmap
+static constexpr size_t probeRatio = 16;
+
+bool SearchQuery::Empty() const {
+    return !byType && !byAmount && !byDate && SearchTerms(text).empty();
+}
+
+static bool IsWordByte(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+std::vector<std::string> SearchTerms(std::string_view text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (IsWordByte(c)) {
+            word.push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : ch);
+        } else if (!word.empty()) {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) words.push_back(std::move(word));
+    return words;
+}
+
+void SearchIndex::IndexCategories(const TransactionStore& store) {
+    size_t count = store.CategoryCount();
+    for (size_t id = categoriesIndexed; id < count; ++id) {
+        for (std::string& term : SearchTerms(store.CategoryName(static_cast<uint16_t>(id)))) {
+            std::vector<uint16_t>& ids = terms[std::move(term)];
+            if (ids.empty() || ids.back() != id) ids.push_back(static_cast<uint16_t>(id));
+        }
+    }
+    categoriesIndexed = count;
+    postings.resize(count);
+}
+
+void SearchIndex::Build(const TransactionStore& store) {
+    terms.clear();
+    categoriesIndexed = 0;
+    postings.clear();
+    IndexCategories(store);
+
+    size_t slots = store.SlotCount();
+    categoryOf.assign(store.Categories(), store.Categories() + slots);
+    for (size_t slot = 0; slot < slots; ++slot) {
+        if (store.IsLive(slot)) postings[categoryOf[slot]].push_back(static_cast<uint32_t>(slot));
+    }
+    amounts.Build(store, SortKey::Amount);
+
+    built = true;
+    layout = store.Layout();
+    slotsSeen = slots;
+}
+
+void SearchIndex::Sync(const TransactionStore& store) {
+    if (!built) return;
+    if (layout != store.Layout()) {
+        Build(store);
+        return;
+    }
+
+    IndexCategories(store);
+    if (store.SlotCount() > slotsSeen) {
+        categoryOf.insert(categoryOf.end(), store.Categories() + slotsSeen, store.Categories() + store.SlotCount());
+        for (size_t slot = slotsSeen; slot < store.SlotCount(); ++slot) {
+            if (store.IsLive(slot)) postings[categoryOf[slot]].push_back(static_cast<uint32_t>(slot));
+        }
+        slotsSeen = store.SlotCount();
+    }
+    amounts.Sync(store);
+}
+
+void SearchIndex::Update(const TransactionStore& store, size_t slot) {
+    uint64_t before = layout;
+    Sync(store);
+    if (!built || layout != before || slot >= categoryOf.size() || !store.IsLive(slot)) return;
+
+    uint16_t category = store.Categories()[slot];
+    if (category != categoryOf[slot]) {
+        uint32_t target = static_cast<uint32_t>(slot);
+        std::vector<uint32_t>& from = postings[categoryOf[slot]];
+        auto at = std::lower_bound(from.begin(), from.end(), target);
+        if (at != from.end() && *at == target) from.erase(at);
+
+        std::vector<uint32_t>& to = postings[category];
+        to.insert(std::lower_bound(to.begin(), to.end(), target), target);
+        categoryOf[slot] = category;
+    }
+    amounts.Update(store, slot);
+}
+
+std::vector<uint16_t> SearchIndex::MatchCategories(std::string_view text) const {
+    std::vector<uint16_t> result;
+    bool first = true;
+    for (const std::string& word : SearchTerms(text)) {
+        std::vector<uint16_t> matched;
+        for (auto it = terms.lower_bound(word); it != terms.end() && it->first.compare(0, word.size(), word) == 0; ++it) {
+            matched.insert(matched.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(matched.begin(), matched.end());
+        matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+
+        if (first) {
+            result.swap(matched);
+            first = false;
+        } else {
+            std::vector<uint16_t> both;
+            std::set_intersection(result.begin(), result.end(), matched.begin(), matched.end(), std::back_inserter(both));
+            result.swap(both);
+        }
+        if (result.empty()) break;
+    }
+    return result;
+}
+
+RowSet SearchIndex::Find(const TransactionStore& store, const SearchQuery& query) const {
+    enum class Clause { Text, Amount, Date };
+    struct Estimate {
+        Clause clause;
+        size_t rows;
+    };
+    std::vector<Estimate> estimates;
+
+    // Text with no words does not filter
+    bool byText = !SearchTerms(query.text).empty();
+    std::vector<uint16_t> categories;
+    std::vector<bool> wanted;
+    if (byText) {
+        categories = MatchCategories(query.text);
+        wanted.assign(store.CategoryCount(), false);
+        size_t rows = 0;
+        for (uint16_t id : categories) {
+            wanted[id] = true;
+            rows += postings[id].size();
+        }
+        estimates.push_back({ Clause::Text, rows });
+    }
+
+    size_t amountFirst = 0;
+    size_t amountLast = 0;
+    if (query.byAmount) {
+        if (query.minAmount <= query.maxAmount) {
+            amounts.KeyRange(SortPermutation::AmountKey(query.minAmount), SortPermutation::AmountKey(query.maxAmount),
+                             amountFirst, amountLast);
+        }
+        estimates.push_back({ Clause::Amount, amountLast - amountFirst });
+    }
+    if (query.byDate) {
+        estimates.push_back({ Clause::Date, store.TotalsBetween(query.firstDay, query.lastDay).rows });
+    }
+    std::stable_sort(estimates.begin(), estimates.end(),
+                     [](const Estimate& a, const Estimate& b) { return a.rows < b.rows; });
+
+    auto mark = [&](Clause clause, RowSet& rows) {
+        switch (clause) {
+            case Clause::Text:
+                for (uint16_t id : categories) {
+                    for (uint32_t slot : postings[id]) rows.Set(slot);
+                }
+                break;
+            case Clause::Amount:
+                for (size_t position = amountFirst; position < amountLast; ++position) rows.Set(amounts.SlotAt(position));
+                break;
+            case Clause::Date:
+                store.Dates().ForEachInRange(query.firstDay, query.lastDay,
+                                             [&rows](size_t slot, int32_t) { rows.Set(slot); });
+                break;
+        }
+    };
+
+    RowSet result;
+    size_t slots = store.SlotCount();
+    if (estimates.empty()) {
+        result.Assign(slots, true);
+    } else {
+        result.Assign(slots);
+        mark(estimates.front().clause, result);
+    }
+    result.And(store.Live().Words());
+
+    // Intersect bitmaps while the clauses are about as large as the result
+    size_t next = estimates.empty() ? 0 : 1;
+    size_t count = result.Count();
+    for (; next < estimates.size() && count * probeRatio >= estimates[next].rows; ++next) {
+        RowSet rows;
+        rows.Assign(slots);
+        mark(estimates[next].clause, rows);
+        result.And(rows);
+        count = result.Count();
+    }
+
+    // The rest, and the type, are checked row by row
+    bool checkText = false;
+    bool checkAmount = false;
+    bool checkDate = false;
+    for (; next < estimates.size(); ++next) {
+        switch (estimates[next].clause) {
+            case Clause::Text: checkText = true; break;
+            case Clause::Amount: checkAmount = true; break;
+            case Clause::Date: checkDate = true; break;
+        }
+    }
+    if (!checkText && !checkAmount && !checkDate && !query.byType) return result;
+
+    const uint8_t* types = store.Types();
+    const int64_t* amountColumn = store.Amounts();
+    const uint16_t* categoryColumn = store.Categories();
+    const int32_t* days = store.Days();
+    uint8_t type = static_cast<uint8_t>(query.type);
+    result.ForEach([&](size_t slot) {
+        bool keep = (!query.byType || types[slot] == type) &&
+                    (!checkText || wanted[categoryColumn[slot]]) &&
+                    (!checkAmount || (amountColumn[slot] >= query.minAmount && amountColumn[slot] <= query.maxAmount)) &&
+                    (!checkDate || (days[slot] >= query.firstDay && days[slot] <= query.lastDay));
+        if (!keep) result.Reset(slot);
+    });
+    return result;
+}
+
+size_t SearchIndex::MemoryUsage() const {
+    size_t bytes = categoryOf.capacity() * sizeof(uint16_t) + amounts.MemoryUsage();
+    for (const auto& [term, ids] : terms) bytes += term.capacity() + ids.capacity() * sizeof(uint16_t);
+    for (const std::vector<uint32_t>& slots : postings) bytes += slots.capacity() * sizeof(uint32_t);
+    return bytes;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+// Indexes behind the filter bar. A query ANDs up to four clauses: words
+// matched against category names, a type, an amount range and a date range.
+//
+// Category names are split into lower-case terms for an inverted index
+// (term -> categories), and each category keeps a posting list of its
+// slots. Amount ranges are binary searches in an amount-sorted
+// SortPermutation; date ranges come from the store's DateIndex. A query
+// estimates each indexed clause, starts a RowSet from the most selective
+// one and ANDs the next ones in while they still have a comparable number
+// of rows. Once the candidates are far fewer, the remaining clauses and the
+// type are checked on the columns for those rows only.
+//
+// Rows carry no free-text description, so category names are the only
+// text indexed.
+
+#include "RowSet.h"
+#include "SortPermutation.h"
+#include "TransactionStore.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SearchQuery {
+    std::string text;                  // every word must start a category term
+
+    bool byType = false;
+    TransactionType type = TransactionType::Expense;
+
+    bool byAmount = false;
+    int64_t minAmount = INT64_MIN;     // minor units, inclusive
+    int64_t maxAmount = INT64_MAX;
+
+    bool byDate = false;
+    int32_t firstDay = INT32_MIN;      // inclusive
+    int32_t lastDay = INT32_MAX;
+
+    bool Empty() const;
+};
+
+// Lower-cased words of text: runs of ASCII letters and digits and of
+// non-ASCII bytes
+std::vector<std::string> SearchTerms(std::string_view text);
+
+class SearchIndex {
+public:
+    void Build(const TransactionStore& store);
+
+    // Picks up rows appended or deleted since the last call
+    void Sync(const TransactionStore& store);
+
+    // Re-indexes a row whose values changed; syncs first
+    void Update(const TransactionStore& store, size_t slot);
+
+    bool Built() const { return built; }
+
+    // Live slots matching query; the index must be in sync with store
+    RowSet Find(const TransactionStore& store, const SearchQuery& query) const;
+
+    // Categories with a term starting with each word of text
+    std::vector<uint16_t> MatchCategories(std::string_view text) const;
+
+    size_t MemoryUsage() const;
+
+private:
+    void IndexCategories(const TransactionStore& store);
+
+    std::map<std::string, std::vector<uint16_t>, std::less<>> terms;
+    size_t categoriesIndexed = 0;
+
+    // By category id, in slot order; deleted slots stay until a rebuild
+    std::vector<std::vector<uint32_t>> postings;
+    std::vector<uint16_t> categoryOf;          // by slot, as indexed
+
+    SortPermutation amounts;
+
+    bool built = false;
+    uint64_t layout = 0;
+    size_t slotsSeen = 0;
+};
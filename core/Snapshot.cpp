@@ -0,0 +1,406 @@
+#include "Snapshot.h"
+
+#include "Date.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+static const uint32_t* Crc32Table() {
+    static uint32_t table[256];
+    static bool ready = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+uint32_t Crc32(const void* data, size_t size, uint32_t crc) {
+    const uint32_t* table = Crc32Table();
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc ^= 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static size_t Align8(size_t n) {
+    return (n + 7) & ~size_t(7);
+}
+
+void SnapshotBuilder::Reserve(size_t rows) {
+    types.reserve(rows);
+    cents.reserve(rows);
+    categoryIds.reserve(rows);
+    days.reserve(rows);
+}
+
+void SnapshotBuilder::Add(TransactionType type, Money amount, std::string_view category, int32_t day) {
+    types.push_back(static_cast<uint8_t>(type));
+    cents.push_back(amount.Minor());
+    categoryIds.push_back(categories.Intern(category));
+    days.push_back(day);
+}
+
+void SnapshotBuilder::AddRow(const LedgerRow& row) {
+    int32_t day;
+    if (!ParseDate(row.date, day)) day = kNoDate;
+    Add(TypeFromName(row.type), row.amount, row.category, day);
+}
+
+std::string SnapshotBuilder::Finish() const {
+    return WriteSnapshot(types.size(), types.data(), cents.data(), categoryIds.data(), days.data(), nullptr, 0, categories);
+}
+
+static std::string DictionaryPayload(const CategoryDictionary& categories) {
+    std::string dictionary;
+    uint32_t count = static_cast<uint32_t>(categories.Size());
+    dictionary.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    uint32_t offset = 0;
+    dictionary.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    for (uint32_t id = 0; id < count; ++id) {
+        offset += static_cast<uint32_t>(categories.Name(static_cast<uint16_t>(id)).size());
+        dictionary.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    }
+    for (uint32_t id = 0; id < count; ++id) dictionary += categories.Name(static_cast<uint16_t>(id));
+    return dictionary;
+}
+
+static SnapshotHeader MakeHeader(uint64_t rows, const std::vector<SnapshotBlock>& blocks) {
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.blockCount = static_cast<uint32_t>(blocks.size());
+    header.rowCount = rows;
+    header.directoryChecksum = Crc32(blocks.data(), blocks.size() * sizeof(SnapshotBlock));
+    return header;
+}
+
+std::string WriteSnapshot(size_t rows, const uint8_t* types, const int64_t* cents,
+                          const uint16_t* categoryIds, const int32_t* days, const uint64_t* ids,
+                          uint64_t nextId, const CategoryDictionary& categories, std::string_view rollups) {
+    std::string dictionary = DictionaryPayload(categories);
+    std::string idPayload;
+    if (nextId != 0) {
+        if (rows > 0) idPayload.assign(reinterpret_cast<const char*>(ids), rows * sizeof(uint64_t));
+        idPayload.append(reinterpret_cast<const char*>(&nextId), sizeof(nextId));
+    }
+
+    struct Payload {
+        SnapshotColumn column;
+        const void* data;
+        size_t size;
+    };
+    std::vector<Payload> payloads = {
+        { SnapshotColumn::Type, types, rows * sizeof(uint8_t) },
+        { SnapshotColumn::Amount, cents, rows * sizeof(int64_t) },
+        { SnapshotColumn::Category, categoryIds, rows * sizeof(uint16_t) },
+        { SnapshotColumn::Date, days, rows * sizeof(int32_t) },
+        { SnapshotColumn::Categories, dictionary.data(), dictionary.size() },
+    };
+    if (nextId != 0) payloads.push_back({ SnapshotColumn::Id, idPayload.data(), idPayload.size() });
+    if (!rollups.empty()) payloads.push_back({ SnapshotColumn::Rollups, rollups.data(), rollups.size() });
+    const size_t blockCount = payloads.size();
+
+    std::vector<SnapshotBlock> blocks(blockCount);
+    size_t position = Align8(sizeof(SnapshotHeader) + blockCount * sizeof(SnapshotBlock));
+    for (size_t i = 0; i < blockCount; ++i) {
+        blocks[i] = SnapshotBlock();
+        blocks[i].column = static_cast<uint32_t>(payloads[i].column);
+        blocks[i].checksum = Crc32(payloads[i].data, payloads[i].size);
+        blocks[i].offset = position;
+        blocks[i].size = payloads[i].size;
+        position = Align8(position + payloads[i].size);
+    }
+
+    SnapshotHeader header = MakeHeader(rows, blocks);
+
+    std::string out(position, '\0');
+    std::memcpy(&out[0], &header, sizeof(header));
+    std::memcpy(&out[sizeof(header)], blocks.data(), blocks.size() * sizeof(SnapshotBlock));
+    for (size_t i = 0; i < blockCount; ++i) {
+        if (payloads[i].size > 0) {
+            std::memcpy(&out[blocks[i].offset], payloads[i].data, payloads[i].size);
+        }
+    }
+    return out;
+}
+
+// The row columns, the optional Id and Rollups blocks and the dictionary
+static constexpr size_t streamedBlocks = 7;
+
+SnapshotFileWriter::~SnapshotFileWriter() {
+    if (file != nullptr) std::fclose(file);
+}
+
+bool SnapshotFileWriter::Open(const std::string& path, uint64_t rows) {
+    if (file != nullptr) std::fclose(file);
+    file = std::fopen(path.c_str(), "wb");
+    this->rows = rows;
+    blocks.clear();
+    ok = file != nullptr;
+
+    // The header and directory are written last; reserve their space
+    position = 0;
+    return ok && Pad(Align8(sizeof(SnapshotHeader) + streamedBlocks * sizeof(SnapshotBlock)));
+}
+
+bool SnapshotFileWriter::Pad(uint64_t offset) {
+    static const char zeros[8] = {};
+    while (ok && position < offset) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(offset - position, sizeof(zeros)));
+        ok = std::fwrite(zeros, 1, n, file) == n;
+        position += n;
+    }
+    return ok;
+}
+
+bool SnapshotFileWriter::EndBlock() {
+    if (blocks.empty()) return ok;
+    blocks.back().size = position - blocks.back().offset;
+    return Pad(Align8(position));
+}
+
+bool SnapshotFileWriter::BeginColumn(SnapshotColumn column) {
+    if (!EndBlock()) return false;
+    SnapshotBlock block = SnapshotBlock();
+    block.column = static_cast<uint32_t>(column);
+    block.offset = position;
+    blocks.push_back(block);
+    return ok;
+}
+
+bool SnapshotFileWriter::Append(const void* data, size_t size) {
+    if (!ok || blocks.empty()) return false;
+    blocks.back().checksum = Crc32(data, size, blocks.back().checksum);
+    ok = std::fwrite(data, 1, size, file) == size;
+    position += size;
+    return ok;
+}
+
+bool SnapshotFileWriter::Finish(const CategoryDictionary& categories) {
+    std::string dictionary = DictionaryPayload(categories);
+    if (!BeginColumn(SnapshotColumn::Categories) || !Append(dictionary.data(), dictionary.size()) || !EndBlock()) {
+        return false;
+    }
+    if (blocks.size() < streamedBlocks - 2 || blocks.size() > streamedBlocks) return ok = false;
+
+    SnapshotHeader header = MakeHeader(rows, blocks);
+    ok = std::fseek(file, 0, SEEK_SET) == 0 &&
+         std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+         std::fwrite(blocks.data(), sizeof(SnapshotBlock), blocks.size(), file) == blocks.size() &&
+         SyncFile(file);
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool WriteSnapshotFile(const std::string& path, size_t rows, const uint8_t* types, const int64_t* cents,
+                       const uint16_t* categoryIds, const int32_t* days, const uint64_t* ids,
+                       uint64_t nextId, const CategoryDictionary& categories, std::string_view rollups,
+                       const SnapshotProgress& progress) {
+    // Progress is reported once per chunk
+    static constexpr size_t chunkBytes = size_t(4) << 20;
+
+    struct Payload {
+        SnapshotColumn column;
+        const char* data;
+        size_t size;
+    };
+    const Payload payloads[] = {
+        { SnapshotColumn::Type, reinterpret_cast<const char*>(types), rows * sizeof(uint8_t) },
+        { SnapshotColumn::Amount, reinterpret_cast<const char*>(cents), rows * sizeof(int64_t) },
+        { SnapshotColumn::Category, reinterpret_cast<const char*>(categoryIds), rows * sizeof(uint16_t) },
+        { SnapshotColumn::Date, reinterpret_cast<const char*>(days), rows * sizeof(int32_t) },
+        { SnapshotColumn::Id, reinterpret_cast<const char*>(ids), rows * sizeof(uint64_t) },
+    };
+    const size_t payloadCount = sizeof(payloads) / sizeof(payloads[0]) - (nextId == 0 ? 1 : 0);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < payloadCount; ++i) total += payloads[i].size;
+    uint64_t written = 0;
+
+    SnapshotFileWriter writer;
+    if (!writer.Open(path, rows)) return false;
+    for (size_t i = 0; i < payloadCount; ++i) {
+        const Payload& payload = payloads[i];
+        if (!writer.BeginColumn(payload.column)) return false;
+        for (size_t offset = 0; offset < payload.size; offset += chunkBytes) {
+            size_t size = std::min(chunkBytes, payload.size - offset);
+            if (!writer.Append(payload.data + offset, size)) return false;
+            written += size;
+            if (progress) progress(written, total);
+        }
+    }
+    if (nextId != 0 && !writer.Append(&nextId, sizeof(nextId))) return false;
+    if (!rollups.empty() && (!writer.BeginColumn(SnapshotColumn::Rollups) || !writer.Append(rollups.data(), rollups.size()))) {
+        return false;
+    }
+    return writer.Finish(categories);
+}
+
+bool SnapshotReader::Open(const std::string& path, bool verify) {
+    // A new mapping each time: the old one may still back a store's columns
+    auto mapped = std::make_shared<MappedFile>();
+    if (!mapped->Open(path) || !Attach(mapped->Data(), mapped->Size(), verify)) return false;
+    file = std::move(mapped);
+    return true;
+}
+
+bool SnapshotReader::VerifyChecksums() const {
+    for (const SnapshotBlock& block : blocks) {
+        if (Crc32(base + block.offset, block.size) != block.checksum) return false;
+    }
+    return true;
+}
+
+bool SnapshotReader::Attach(const char* data, size_t size, bool verify) {
+    file.reset();
+    blocks.clear();
+    base = data;
+    rows = 0;
+    types = nullptr;
+    cents = nullptr;
+    categoryIds = nullptr;
+    days = nullptr;
+    ids = nullptr;
+    nextId = 0;
+    rollups = std::string_view();
+    categoryNames.clear();
+
+    SnapshotHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0) return false;
+    if (header.version != kSnapshotVersion) return false;
+
+    size_t directorySize = header.blockCount * sizeof(SnapshotBlock);
+    if (header.blockCount > 64 || header.rowCount > size || size < sizeof(header) + directorySize) return false;
+    const char* directory = data + sizeof(header);
+    if (Crc32(directory, directorySize) != header.directoryChecksum) return false;
+
+    const char* typeData = nullptr;
+    const char* amountData = nullptr;
+    const char* categoryData = nullptr;
+    const char* dateData = nullptr;
+    const char* idData = nullptr;
+    const char* dictionaryData = nullptr;
+    size_t dictionarySize = 0;
+    std::string_view rollupData;
+
+    for (uint32_t i = 0; i < header.blockCount; ++i) {
+        SnapshotBlock block;
+        std::memcpy(&block, directory + i * sizeof(SnapshotBlock), sizeof(block));
+        if (block.offset % 8 != 0 || block.offset > size || block.size > size - block.offset) return false;
+
+        const char* payload = data + block.offset;
+        if (verify && Crc32(payload, block.size) != block.checksum) return false;
+        blocks.push_back(block);
+
+        size_t expected = 0;
+        switch (static_cast<SnapshotColumn>(block.column)) {
+            case SnapshotColumn::Type:
+                typeData = payload;
+                expected = header.rowCount * sizeof(uint8_t);
+                break;
+            case SnapshotColumn::Amount:
+                amountData = payload;
+                expected = header.rowCount * sizeof(int64_t);
+                break;
+            case SnapshotColumn::Category:
+                categoryData = payload;
+                expected = header.rowCount * sizeof(uint16_t);
+                break;
+            case SnapshotColumn::Date:
+                dateData = payload;
+                expected = header.rowCount * sizeof(int32_t);
+                break;
+            case SnapshotColumn::Id:
+                idData = payload;
+                expected = (header.rowCount + 1) * sizeof(uint64_t);
+                break;
+            case SnapshotColumn::Categories:
+                dictionaryData = payload;
+                dictionarySize = block.size;
+                continue;
+            case SnapshotColumn::Rollups:
+                // Checked by the cube when it loads them
+                rollupData = std::string_view(payload, block.size);
+                continue;
+            default:
+                // Unknown blocks from newer writers are skipped
+                continue;
+        }
+        if (block.size != expected) return false;
+    }
+    if (!typeData || !amountData || !categoryData || !dateData || !dictionaryData) return false;
+
+    // Category dictionary
+    uint32_t count;
+    if (dictionarySize < sizeof(count)) return false;
+    std::memcpy(&count, dictionaryData, sizeof(count));
+    size_t tableSize = (static_cast<size_t>(count) + 1) * sizeof(uint32_t);
+    if (dictionarySize - sizeof(count) < tableSize) return false;
+    const char* table = dictionaryData + sizeof(count);
+    const char* names = table + tableSize;
+    size_t namesSize = dictionarySize - sizeof(count) - tableSize;
+
+    // Names are unique; ids are positions in this table
+    std::unordered_set<std::string_view> seen;
+    categoryNames.reserve(count);
+    uint32_t begin;
+    std::memcpy(&begin, table, sizeof(begin));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t end;
+        std::memcpy(&end, table + (i + 1) * sizeof(uint32_t), sizeof(end));
+        if (end < begin || end > namesSize) return false;
+        categoryNames.emplace_back(names + begin, end - begin);
+        if (!seen.insert(categoryNames.back()).second) return false;
+        begin = end;
+    }
+
+    types = reinterpret_cast<const uint8_t*>(typeData);
+    cents = reinterpret_cast<const int64_t*>(amountData);
+    categoryIds = reinterpret_cast<const uint16_t*>(categoryData);
+    days = reinterpret_cast<const int32_t*>(dateData);
+    ids = reinterpret_cast<const uint64_t*>(idData);
+    rows = header.rowCount;
+    if (ids != nullptr) std::memcpy(&nextId, ids + rows, sizeof(nextId));
+    rollups = rollupData;
+
+    // Everything indexes by these, so they are checked with or without
+    // verify; a running maximum keeps the pass branch-free
+    uint8_t maxType = 0;
+    uint16_t maxCategory = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        maxType = std::max(maxType, types[i]);
+        maxCategory = std::max(maxCategory, categoryIds[i]);
+    }
+    if (rows > 0 && (maxCategory >= categoryNames.size() || maxType > 1)) {
+        rows = 0;
+        return false;
+    }
+    return true;
+}
+
+std::string ImportCsv(const LedgerLoader& loader) {
+    SnapshotBuilder builder;
+    builder.Reserve(loader.Size() / 32);
+    loader.ForEachRow([&](const LedgerRow& row) { builder.AddRow(row); });
+    return builder.Finish();
+}
+
+void ExportCsv(const SnapshotReader& reader, std::string& out) {
+    char date[16];
+    for (size_t i = 0; i < reader.Rows(); ++i) {
+        size_t length = FormatDate(reader.Day(i), date);
+        AppendLedgerRow(out, TypeName(reader.Type(i)), reader.Amount(i),
+                        reader.CategoryName(reader.CategoryId(i)), std::string_view(date, length));
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+// Versioned binary columnar snapshot of the ledger (*.fsnap).
+//
+// Layout (little-endian):
+//   SnapshotHeader
+//   SnapshotBlock[blockCount]          block directory
+//   block payloads, each 8-byte aligned
+//
+// Blocks:
+//   Type        uint8_t   per row (TransactionType)
+//   Amount      int64_t   per row, in centavos
+//   Category    uint16_t  per row, index into the Categories block
+//   Date        int32_t   per row, day number (kNoDate if unknown)
+//   Categories  uint32_t count, uint32_t offsets[count + 1], then the
+//               concatenated UTF-8 names
+//   Id          uint64_t  per row, stable transaction id, then the next
+//               unused id; optional, rows of files without it are
+//               numbered 1..n
+//   Rollups     day cells of the RollupCube, 24-byte records; optional,
+//               rebuilt from the rows when missing
+//
+// Each block carries a CRC-32 of its payload and the header carries one of
+// the block directory. Opening maps the file and points straight into it;
+// it checks the header, the directory and the values rows index by, and
+// leaves the block checksums, a pass over every byte, to VerifyChecksums
+// or to opening with verify set.
+
+#include "CategoryDictionary.h"
+#include "LedgerLoader.h"
+#include "LedgerTypes.h"
+#include "MappedFile.h"
+#include "Money.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class SnapshotColumn : uint32_t {
+    Type = 1,
+    Amount = 2,
+    Category = 3,
+    Date = 4,
+    Categories = 5,
+    Id = 6,
+    Rollups = 7
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockCount;
+    uint64_t rowCount;
+    uint32_t directoryChecksum;
+    uint32_t reserved;
+};
+
+struct SnapshotBlock {
+    uint32_t column;
+    uint32_t checksum;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t reserved;
+};
+
+constexpr char kSnapshotMagic[8] = { 'F', 'I', 'N', 'S', 'N', 'A', 'P', '\0' };
+constexpr uint32_t kSnapshotVersion = 1;
+
+// Pass the previous result as crc to continue a checksum over more data
+uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0);
+
+// Serializes ready-made columns; categoryIds index into the dictionary.
+// nextId 0 leaves out the Id block (ids is then not read; it may be null
+// for no rows either way), and rollups (from RollupCube::Serialize) empty
+// leaves out the Rollups block.
+std::string WriteSnapshot(size_t rows, const uint8_t* types, const int64_t* cents,
+                          const uint16_t* categoryIds, const int32_t* days, const uint64_t* ids,
+                          uint64_t nextId, const CategoryDictionary& categories,
+                          std::string_view rollups = std::string_view());
+
+// Reports bytes written so far out of the total
+using SnapshotProgress = std::function<void(uint64_t written, uint64_t total)>;
+
+// Streams the same file straight to path, in chunks, without building it in
+// memory first; the file is synced to disk before this returns
+bool WriteSnapshotFile(const std::string& path, size_t rows, const uint8_t* types, const int64_t* cents,
+                       const uint16_t* categoryIds, const int32_t* days, const uint64_t* ids,
+                       uint64_t nextId, const CategoryDictionary& categories,
+                       std::string_view rollups = std::string_view(),
+                       const SnapshotProgress& progress = nullptr);
+
+// Collects rows column by column and serializes them
+class SnapshotBuilder {
+public:
+    void Reserve(size_t rows);
+    void Add(TransactionType type, Money amount, std::string_view category, int32_t day);
+
+    // Adds a transactions.txt row. Unparseable dates become kNoDate.
+    void AddRow(const LedgerRow& row);
+
+    size_t Rows() const { return types.size(); }
+
+    // Returns the complete file contents
+    std::string Finish() const;
+
+private:
+    std::vector<uint8_t> types;
+    std::vector<int64_t> cents;
+    std::vector<uint16_t> categoryIds;
+    std::vector<int32_t> days;
+    CategoryDictionary categories;
+};
+
+// Writes a snapshot file one column at a time, for ledgers too large to
+// hold in memory. Columns go in file order (Type, Amount, Category, Date,
+// then optionally Id and Rollups), each through any number of Append calls
+// that together cover every row.
+// Finish adds the category dictionary, goes back to fill in the header and
+// block directory, and syncs the file.
+class SnapshotFileWriter {
+public:
+    SnapshotFileWriter() = default;
+    ~SnapshotFileWriter();
+
+    SnapshotFileWriter(const SnapshotFileWriter&) = delete;
+    SnapshotFileWriter& operator=(const SnapshotFileWriter&) = delete;
+
+    bool Open(const std::string& path, uint64_t rows);
+    bool BeginColumn(SnapshotColumn column);
+    bool Append(const void* data, size_t size);
+    bool Finish(const CategoryDictionary& categories);
+
+private:
+    bool EndBlock();
+    bool Pad(uint64_t offset);
+
+    std::FILE* file = nullptr;
+    uint64_t rows = 0;
+    uint64_t position = 0;
+    std::vector<SnapshotBlock> blocks;
+    bool ok = false;
+};
+
+class SnapshotReader {
+public:
+    // Maps the file and validates the header, the block directory, the
+    // category dictionary and each row's type and category id. With verify
+    // set, every block checksum is checked as well.
+    bool Open(const std::string& path, bool verify = false);
+
+    // Same, over bytes owned by the caller
+    bool Attach(const char* data, size_t size, bool verify = false);
+
+    // Checks every block against its checksum
+    bool VerifyChecksums() const;
+
+    // The mapping the columns point into, for holding on to it past the
+    // reader; null over bytes owned by the caller
+    std::shared_ptr<const MappedFile> Mapping() const { return file; }
+
+    size_t Rows() const { return rows; }
+    TransactionType Type(size_t row) const { return static_cast<TransactionType>(types[row]); }
+    Money Amount(size_t row) const { return Money::FromMinor(cents[row]); }
+    uint16_t CategoryId(size_t row) const { return categoryIds[row]; }
+    int32_t Day(size_t row) const { return days[row]; }
+
+    const uint8_t* TypeColumn() const { return types; }
+    const int64_t* AmountColumn() const { return cents; }
+    const uint16_t* CategoryColumn() const { return categoryIds; }
+    const int32_t* DateColumn() const { return days; }
+
+    // Null for files written without ids; NextId is then 0
+    const uint64_t* IdColumn() const { return ids; }
+    uint64_t NextId() const { return nextId; }
+
+    // Saved rollup cells; empty for files written without them
+    std::string_view Rollups() const { return rollups; }
+
+    size_t CategoryCount() const { return categoryNames.size(); }
+    std::string_view CategoryName(uint16_t id) const { return categoryNames[id]; }
+
+private:
+    std::shared_ptr<MappedFile> file;
+    std::vector<SnapshotBlock> blocks;
+    const char* base = nullptr;
+    size_t rows = 0;
+    const uint8_t* types = nullptr;
+    const int64_t* cents = nullptr;
+    const uint16_t* categoryIds = nullptr;
+    const int32_t* days = nullptr;
+    const uint64_t* ids = nullptr;
+    uint64_t nextId = 0;
+    std::string_view rollups;
+    std::vector<std::string_view> categoryNames;
+};
+
+// Converts a transactions.txt ledger into snapshot bytes
+std::string ImportCsv(const LedgerLoader& loader);
+
+// Appends the snapshot's rows as transactions.txt text
+void ExportCsv(const SnapshotReader& reader, std::string& out);
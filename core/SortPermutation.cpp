@@ -0,0 +1,191 @@
+#include "SortPermutation.h"
+
+#include <algorithm>
+#include <numeric>
+
+// Fewer appended rows than this are binary-inserted one by one
+static constexpr size_t maxSingleInserts = 64;
+
+const char* SortKeyName(SortKey key) {
+    switch (key) {
+        case SortKey::Type: return "type";
+        case SortKey::Amount: return "amount";
+        case SortKey::Category: return "category";
+        case SortKey::Date: return "date";
+    }
+    return "unknown";
+}
+
+void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values) {
+    size_t n = keys.size();
+    if (n < 2) return;
+
+    // One pass counts the digits of all eight bytes
+    std::vector<size_t> counts(8 * 256, 0);
+    for (uint64_t k : keys) {
+        for (size_t digit = 0; digit < 8; ++digit) ++counts[digit * 256 + ((k >> (digit * 8)) & 0xFF)];
+    }
+
+    std::vector<uint64_t> keyBuffer(n);
+    std::vector<uint32_t> valueBuffer(n);
+    for (size_t digit = 0; digit < 8; ++digit) {
+        size_t* count = &counts[digit * 256];
+        size_t shift = digit * 8;
+
+        // A byte every key shares would leave the order as it is
+        if (count[(keys[0] >> shift) & 0xFF] == n) continue;
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < 256; ++bucket) {
+            size_t c = count[bucket];
+            count[bucket] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size_t to = count[(keys[i] >> shift) & 0xFF]++;
+            keyBuffer[to] = keys[i];
+            valueBuffer[to] = values[i];
+        }
+        keys.swap(keyBuffer);
+        values.swap(valueBuffer);
+    }
+}
+
+void SortPermutation::Clear() {
+    order.clear();
+    keys.clear();
+    categoryRank.clear();
+    built = false;
+    slotsSeen = 0;
+}
+
+void SortPermutation::RankCategories(const TransactionStore& store) {
+    std::vector<uint16_t> ids(store.CategoryCount());
+    std::iota(ids.begin(), ids.end(), uint16_t(0));
+    std::sort(ids.begin(), ids.end(), [&](uint16_t a, uint16_t b) {
+        return store.CategoryName(a) < store.CategoryName(b);
+    });
+
+    categoryRank.assign(ids.size(), 0);
+    for (size_t rank = 0; rank < ids.size(); ++rank) categoryRank[ids[rank]] = static_cast<uint16_t>(rank);
+}
+
+uint64_t SortPermutation::KeyOf(const TransactionStore& store, size_t slot) const {
+    uint64_t value = 0;
+    switch (key) {
+        case SortKey::Type:
+            // By name: Expense before Income
+            value = store.Types()[slot] == static_cast<uint8_t>(TransactionType::Expense) ? 0 : 1;
+            break;
+        case SortKey::Amount:
+            value = AmountKey(store.Amounts()[slot]);
+            break;
+        case SortKey::Category:
+            value = categoryRank[store.Categories()[slot]];
+            break;
+        case SortKey::Date:
+            // Undated rows (kNoDate, the smallest day) come first
+            value = DateKey(store.Days()[slot]);
+            break;
+    }
+    return descending ? ~value : value;
+}
+
+void SortPermutation::Build(const TransactionStore& store, SortKey key, bool descending) {
+    this->key = key;
+    this->descending = descending;
+    if (key == SortKey::Category) RankCategories(store);
+
+    keys.assign(store.SlotCount(), 0);
+    std::vector<uint64_t> sortKeys;
+    order.clear();
+    sortKeys.reserve(store.Size());
+    order.reserve(store.Size());
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (!store.IsLive(slot)) continue;
+        keys[slot] = KeyOf(store, slot);
+        sortKeys.push_back(keys[slot]);
+        order.push_back(static_cast<uint32_t>(slot));
+    }
+    RadixSort(sortKeys, order);
+
+    built = true;
+    layout = store.Layout();
+    slotsSeen = store.SlotCount();
+}
+
+void SortPermutation::Insert(uint32_t slot) {
+    auto at = std::upper_bound(order.begin(), order.end(), slot,
+                               [this](uint32_t a, uint32_t b) { return Less(a, b); });
+    order.insert(at, slot);
+}
+
+void SortPermutation::Sync(const TransactionStore& store) {
+    if (!built) return;
+    if (layout != store.Layout() || (key == SortKey::Category && categoryRank.size() != store.CategoryCount())) {
+        Build(store, key, descending);
+        return;
+    }
+
+    // Appended rows
+    if (store.SlotCount() > slotsSeen) {
+        keys.resize(store.SlotCount());
+        std::vector<uint64_t> addedKeys;
+        std::vector<uint32_t> added;
+        for (size_t slot = slotsSeen; slot < store.SlotCount(); ++slot) {
+            if (!store.IsLive(slot)) continue;
+            keys[slot] = KeyOf(store, slot);
+            addedKeys.push_back(keys[slot]);
+            added.push_back(static_cast<uint32_t>(slot));
+        }
+
+        if (added.size() < maxSingleInserts) {
+            for (uint32_t slot : added) Insert(slot);
+        } else {
+            RadixSort(addedKeys, added);
+            std::vector<uint32_t> merged(order.size() + added.size());
+            std::merge(order.begin(), order.end(), added.begin(), added.end(), merged.begin(),
+                       [this](uint32_t a, uint32_t b) { return Less(a, b); });
+            order.swap(merged);
+        }
+        slotsSeen = store.SlotCount();
+    }
+
+    // Every slot in order was live when it went in, so a surplus means deletes
+    if (order.size() != store.Size()) {
+        order.erase(std::remove_if(order.begin(), order.end(),
+                                   [&store](uint32_t slot) { return !store.IsLive(slot); }),
+                    order.end());
+    }
+}
+
+void SortPermutation::Update(const TransactionStore& store, size_t slot) {
+    uint64_t before = layout;
+    Sync(store);
+    if (!built || layout != before || slot >= keys.size() || !store.IsLive(slot)) return;
+
+    uint64_t newKey = KeyOf(store, slot);
+    if (newKey == keys[slot]) return;
+
+    uint32_t target = static_cast<uint32_t>(slot);
+    auto at = std::lower_bound(order.begin(), order.end(), target,
+                               [this](uint32_t a, uint32_t b) { return Less(a, b); });
+    if (at != order.end() && *at == target) order.erase(at);
+    keys[slot] = newKey;
+    Insert(target);
+}
+
+void SortPermutation::KeyRange(uint64_t low, uint64_t high, size_t& first, size_t& last) const {
+    auto begin = std::lower_bound(order.begin(), order.end(), low,
+                                  [this](uint32_t slot, uint64_t k) { return keys[slot] < k; });
+    auto end = std::upper_bound(begin, order.end(), high,
+                                [this](uint64_t k, uint32_t slot) { return k < keys[slot]; });
+    first = begin - order.begin();
+    last = end - order.begin();
+    if (last < first) last = first;
+}
+
+size_t SortPermutation::MemoryUsage() const {
+    return order.capacity() * sizeof(uint32_t) + keys.capacity() * sizeof(uint64_t) +
+           categoryRank.capacity() * sizeof(uint16_t);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// The store's live slots in the order of one table column, for click-to-sort
+// on a virtual list view. Each row's column value is turned into a 64-bit
+// key whose unsigned order is the display order, and the slots are sorted
+// by (key, slot) with an LSD radix sort that skips the key bytes all rows
+// share. Ties keep insertion order in both directions.
+//
+// The keys are kept per slot, so the permutation follows the store without
+// resorting: appended rows are binary-inserted (or, in bulk, radix-sorted
+// and merged), deleted ones filtered out in one pass, and an edited row is
+// found under its old key and moved. A store relayout (load, compaction)
+// or a new category name rebuilds it.
+
+#include "TransactionStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class SortKey {
+    Type,
+    Amount,
+    Category,
+    Date
+};
+
+const char* SortKeyName(SortKey key);
+
+// Stable sort of values by keys, both reordered; values.size() == keys.size()
+void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values);
+
+class SortPermutation {
+public:
+    void Build(const TransactionStore& store, SortKey key, bool descending = false);
+    void Clear();
+
+    // Picks up rows appended or deleted since the last call
+    void Sync(const TransactionStore& store);
+
+    // Moves a row whose values changed; syncs first
+    void Update(const TransactionStore& store, size_t slot);
+
+    bool Built() const { return built; }
+    SortKey Key() const { return key; }
+    bool Descending() const { return descending; }
+
+    size_t Size() const { return order.size(); }
+    size_t SlotAt(size_t position) const { return order[position]; }
+    const std::vector<uint32_t>& Order() const { return order; }
+
+    // Sort key of every slot, as last computed; dead slots keep theirs
+    const std::vector<uint64_t>& Keys() const { return keys; }
+
+    // Positions [first, last) of the rows with low <= key <= high, in an
+    // ascending permutation; the keys come from the helpers below
+    void KeyRange(uint64_t low, uint64_t high, size_t& first, size_t& last) const;
+
+    static uint64_t AmountKey(int64_t minor) { return static_cast<uint64_t>(minor) ^ (uint64_t(1) << 63); }
+    static uint64_t DateKey(int32_t day) { return static_cast<uint32_t>(day) ^ 0x80000000u; }
+
+    size_t MemoryUsage() const;
+
+private:
+    uint64_t KeyOf(const TransactionStore& store, size_t slot) const;
+    void RankCategories(const TransactionStore& store);
+    void Insert(uint32_t slot);
+    bool Less(uint32_t a, uint32_t b) const {
+        return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> keys;
+    std::vector<uint16_t> categoryRank;   // by category id, for SortKey::Category
+
+    SortKey key = SortKey::Date;
+    bool descending = false;
+    bool built = false;
+    uint64_t layout = 0;
+    size_t slotsSeen = 0;
+};
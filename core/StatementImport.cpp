@@ -0,0 +1,945 @@
+#include "StatementImport.h"
+
+#include "CategoryDictionary.h"
+#include "Date.h"
+#include "LedgerLoader.h"
+#include "Money.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+
+// Bytes read per block; a record longer than this grows the buffer
+static constexpr size_t blockBytes = size_t(4) << 20;
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool IsLetter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static char Lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static bool IsBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string_view Trim(std::string_view text) {
+    while (!text.empty() && IsBlank(text.front())) text.remove_prefix(1);
+    while (!text.empty() && IsBlank(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+static bool EqualsIgnoringCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (Lower(a[i]) != Lower(b[i])) return false;
+    }
+    return true;
+}
+
+static bool StartsWithIgnoringCase(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && EqualsIgnoringCase(text.substr(0, prefix.size()), prefix);
+}
+
+// Dates
+
+static bool MakeDay(int year, int month, int day, int32_t& out) {
+    if (year < 1 || year > 9999 || month < 1 || month > 12 || day < 1 || day > 31) return false;
+    int32_t days = DaysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+
+    // Rejects 31/02 and the like, which the day count would roll over
+    int y;
+    unsigned m, d;
+    CivilFromDays(days, y, m, d);
+    if (y != year || static_cast<int>(m) != month || static_cast<int>(d) != day) return false;
+    out = days;
+    return true;
+}
+
+static int MonthFromName(std::string_view name) {
+    static const char* const names[] = { "jan", "feb", "mar", "apr", "may", "jun",
+                                         "jul", "aug", "sep", "oct", "nov", "dec" };
+    if (name.size() < 3) return 0;
+    for (int month = 0; month < 12; ++month) {
+        if (EqualsIgnoringCase(name.substr(0, 3), names[month])) return month + 1;
+    }
+    return 0;
+}
+
+static int FullYear(int year, int width) {
+    if (width > 2) return year;
+    return year + (year < 70 ? 2000 : 1900);
+}
+
+bool ParseStatementDate(std::string_view text, DateOrder order, int32_t& day) {
+    text = Trim(text);
+
+    size_t digits = 0;
+    while (digits < text.size() && IsDigit(text[digits])) ++digits;
+    if (digits >= 8) {
+        auto number = [&](size_t at, size_t width) {
+            int value = 0;
+            for (size_t i = at; i < at + width; ++i) value = value * 10 + (text[i] - '0');
+            return value;
+        };
+        return MakeDay(number(0, 4), number(4, 2), number(6, 2), day);
+    }
+
+    // Up to three fields; anything after them, such as a time, is ignored
+    int numbers[3];
+    int widths[3];
+    size_t count = 0;
+    int month = 0;
+    for (size_t i = 0; i < text.size() && count + (month != 0) < 3;) {
+        char c = text[i];
+        if (IsDigit(c)) {
+            int value = 0, width = 0;
+            while (i < text.size() && IsDigit(text[i])) {
+                if (++width > 4) return false;
+                value = value * 10 + (text[i++] - '0');
+            }
+            numbers[count] = value;
+            widths[count++] = width;
+        } else if (IsLetter(c)) {
+            size_t start = i;
+            while (i < text.size() && IsLetter(text[i])) ++i;
+            if (month != 0 || (month = MonthFromName(text.substr(start, i - start))) == 0) return false;
+        } else if (c == '/' || c == '-' || c == '.' || c == '\'' || c == ',' || c == ' ') {
+            ++i;
+        } else {
+            return false;
+        }
+    }
+
+    if (month != 0) {
+        if (count != 2) return false;
+        // 2024-Jan-05, otherwise 05-Jan-2024 and Jan 5, 2024
+        bool yearFirst = widths[0] == 4;
+        int year = yearFirst ? numbers[0] : FullYear(numbers[1], widths[1]);
+        return MakeDay(year, month, yearFirst ? numbers[1] : numbers[0], day);
+    }
+    if (count != 3) return false;
+
+    // A four-digit first field is ISO order whatever the statement's order
+    if (widths[0] == 4) order = DateOrder::YearMonthDay;
+    switch (order) {
+        case DateOrder::DayMonthYear:
+            return MakeDay(FullYear(numbers[2], widths[2]), numbers[1], numbers[0], day);
+        case DateOrder::MonthDayYear:
+            return MakeDay(FullYear(numbers[2], widths[2]), numbers[0], numbers[1], day);
+        case DateOrder::YearMonthDay:
+            return MakeDay(FullYear(numbers[0], widths[0]), numbers[1], numbers[2], day);
+    }
+    return false;
+}
+
+// Amounts
+
+bool ParseStatementAmount(std::string_view text, int64_t& minor) {
+    // Digits and separators only; currency names, symbols and digit
+    // grouping spaces fall away
+    char raw[32];
+    size_t length = 0;
+    bool negative = false;
+    bool digits = false;
+    for (char c : text) {
+        if (IsDigit(c) || c == '.' || c == ',') {
+            if (length == sizeof(raw)) return false;
+            raw[length++] = c;
+            digits = digits || IsDigit(c);
+        } else if (c == '-' || c == '(') {
+            negative = true;
+        }
+    }
+    if (!digits) return false;
+
+    // The decimal separator is the last of '.' and ',' when both appear; a
+    // lone ',' is one only with one or two digits after it
+    const char* lastDot = nullptr;
+    const char* lastComma = nullptr;
+    size_t dots = 0, commas = 0;
+    for (const char* p = raw; p < raw + length; ++p) {
+        if (*p == '.') {
+            lastDot = p;
+            ++dots;
+        } else if (*p == ',') {
+            lastComma = p;
+            ++commas;
+        }
+    }
+    const char* decimal = nullptr;
+    if (dots > 0 && commas > 0) {
+        decimal = std::max(lastDot, lastComma);
+    } else if (dots == 1) {
+        decimal = lastDot;
+    } else if (commas == 1 && raw + length - lastComma - 1 <= 2 && raw + length - lastComma - 1 > 0) {
+        decimal = lastComma;
+    }
+
+    char number[40];
+    size_t n = 0;
+    if (negative) number[n++] = '-';
+    for (const char* p = raw; p < raw + length; ++p) {
+        if (IsDigit(*p)) {
+            number[n++] = *p;
+        } else if (p == decimal) {
+            number[n++] = '.';
+        } else if (decimal != nullptr && *p == *decimal) {
+            return false;       // a second decimal separator
+        }
+    }
+
+    Money amount;
+    if (!Money::Parse(std::string_view(number, n), amount)) return false;
+    minor = amount.Minor();
+    return true;
+}
+
+// Column mapping
+
+bool StatementColumns::Parse(std::string_view text, StatementColumns& columns, std::string& error) {
+    columns = StatementColumns();
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view pair = Trim(text.substr(0, comma));
+        text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+        if (pair.empty()) continue;
+
+        size_t equals = pair.find('=');
+        if (equals == std::string_view::npos) {
+            error = "expected name=column in \"" + std::string(pair) + "\"";
+            return false;
+        }
+        std::string_view key = Trim(pair.substr(0, equals));
+        std::string value(Trim(pair.substr(equals + 1)));
+        if (value.empty()) {
+            error = "no column given for " + std::string(key);
+            return false;
+        }
+        if (value[0] == '#' && (value.size() == 1 || std::atoi(value.c_str() + 1) < 1)) {
+            error = "column numbers count from #1";
+            return false;
+        }
+
+        if (EqualsIgnoringCase(key, "date")) {
+            columns.date = value;
+        } else if (EqualsIgnoringCase(key, "amount")) {
+            columns.amount = value;
+        } else if (EqualsIgnoringCase(key, "debit")) {
+            columns.debit = value;
+        } else if (EqualsIgnoringCase(key, "credit")) {
+            columns.credit = value;
+        } else if (EqualsIgnoringCase(key, "description")) {
+            columns.description = value;
+        } else if (EqualsIgnoringCase(key, "category")) {
+            columns.category = value;
+        } else if (EqualsIgnoringCase(key, "type")) {
+            columns.type = value;
+        } else if (EqualsIgnoringCase(key, "delimiter")) {
+            if (EqualsIgnoringCase(value, "tab")) {
+                columns.delimiter = '\t';
+            } else if (EqualsIgnoringCase(value, "comma")) {
+                columns.delimiter = ',';
+            } else if (EqualsIgnoringCase(value, "semicolon")) {
+                columns.delimiter = ';';
+            } else if (value.size() == 1 && value[0] != '"' && value[0] != '\n') {
+                columns.delimiter = value[0];
+            } else {
+                error = "a delimiter is one character, or tab, comma or semicolon";
+                return false;
+            }
+        } else if (EqualsIgnoringCase(key, "header")) {
+            columns.header = !(EqualsIgnoringCase(value, "no") || EqualsIgnoringCase(value, "false") || value == "0");
+        } else {
+            error = "unknown field " + std::string(key);
+            return false;
+        }
+    }
+    return true;
+}
+
+// CSV
+
+namespace {
+
+class CsvReader {
+public:
+    CsvReader(const StatementColumns& spec, DateOrder dates) : spec(spec), dates(dates), delimiter(spec.delimiter) {}
+
+    char* Parse(char* p, char* end, bool final, std::vector<StatementRow>& rows, StatementStats& stats);
+    const std::string& Error() const { return error; }
+
+private:
+    void Split(char* begin, char* end);
+    bool Resolve();
+    bool Find(const std::string& name, int& column);
+    void Guess(int& column, std::initializer_list<std::string_view> names) const;
+    bool Row(StatementRow& row) const;
+
+    const StatementColumns& spec;
+    DateOrder dates;
+    char delimiter;
+    bool started = false;
+    std::vector<std::string_view> fields;
+    std::string error;
+
+    int date = -1, amount = -1, debit = -1, credit = -1, description = -1, category = -1, type = -1;
+    size_t width = 0;       // fields a row needs
+    bool firstIsData = false;
+};
+
+}  // namespace
+
+// The end of the record starting at p: the first line break outside quotes
+static char* RecordEnd(char* p, char* end) {
+    bool quoted = false;
+    for (char* q = p; q < end;) {
+        char* eol = static_cast<char*>(std::memchr(q, '\n', end - q));
+        char* stop = eol != nullptr ? eol : end;
+        quoted ^= (std::count(q, stop, '"') & 1) != 0;
+        if (eol == nullptr) return nullptr;
+        if (!quoted) return eol;
+        q = eol + 1;
+    }
+    return nullptr;
+}
+
+static char GuessDelimiter(std::string_view line) {
+    size_t best = 0;
+    char delimiter = ',';
+    for (char candidate : { ',', ';', '\t', '|' }) {
+        size_t count = 0;
+        bool quoted = false;
+        for (char c : line) {
+            if (c == '"') quoted = !quoted;
+            else if (c == candidate && !quoted) ++count;
+        }
+        if (count > best) {
+            best = count;
+            delimiter = candidate;
+        }
+    }
+    return delimiter;
+}
+
+void CsvReader::Split(char* begin, char* end) {
+    if (end > begin && end[-1] == '\r') --end;
+    fields.clear();
+    for (char* q = begin;;) {
+        if (q < end && *q == '"') {
+            // Unquoted in place: "" becomes " and the field shrinks
+            char* out = q;
+            char* start = out;
+            char* in = q + 1;
+            while (in < end) {
+                if (*in == '"') {
+                    if (in + 1 < end && in[1] == '"') {
+                        *out++ = '"';
+                        in += 2;
+                        continue;
+                    }
+                    ++in;
+                    break;
+                }
+                *out++ = *in++;
+            }
+            fields.emplace_back(start, out - start);
+            while (in < end && *in != delimiter) ++in;
+            q = in;
+        } else {
+            char* start = q;
+            while (q < end && *q != delimiter) ++q;
+            fields.push_back(Trim(std::string_view(start, q - start)));
+        }
+        if (q >= end) return;
+        ++q;
+    }
+}
+
+bool CsvReader::Find(const std::string& name, int& column) {
+    if (name.empty()) return true;
+    if (name[0] == '#') {
+        column = std::atoi(name.c_str() + 1) - 1;
+        return true;
+    }
+    if (!spec.header) {
+        error = "the statement has no header to find \"" + name + "\" in";
+        return false;
+    }
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (EqualsIgnoringCase(fields[i], name)) {
+            column = static_cast<int>(i);
+            return true;
+        }
+    }
+    error = "the statement has no column named \"" + name + "\"";
+    return false;
+}
+
+void CsvReader::Guess(int& column, std::initializer_list<std::string_view> names) const {
+    if (column >= 0) return;
+    for (std::string_view name : names) {
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (EqualsIgnoringCase(fields[i], name)) {
+                column = static_cast<int>(i);
+                return;
+            }
+        }
+    }
+}
+
+bool CsvReader::Resolve() {
+    if (!Find(spec.date, date) || !Find(spec.amount, amount) || !Find(spec.debit, debit) ||
+        !Find(spec.credit, credit) || !Find(spec.description, description) || !Find(spec.category, category) ||
+        !Find(spec.type, type)) {
+        return false;
+    }
+
+    if (spec.header) {
+        Guess(date, { "date", "posted date", "posting date", "post date", "transaction date", "trans date",
+                      "value date", "booking date", "txn date" });
+        if (debit < 0 && credit < 0) Guess(amount, { "amount", "transaction amount", "value" });
+        if (amount < 0) {
+            Guess(debit, { "debit", "debits", "debit amount", "withdrawal", "withdrawals", "money out", "paid out" });
+            Guess(credit, { "credit", "credits", "credit amount", "deposit", "deposits", "money in", "paid in" });
+        }
+        Guess(description, { "description", "payee", "name", "merchant", "details", "narrative", "particulars",
+                             "transaction description", "memo", "reference" });
+        Guess(category, { "category" });
+        Guess(type, { "type", "transaction type", "dr/cr", "debit/credit" });
+    }
+
+    if (date < 0 && amount < 0 && debit < 0 && credit < 0 && fields.size() == 4 &&
+        (fields[0] == "Income" || fields[0] == "Expense")) {
+        // transactions.txt: Type,Amount,Category,Date without a header
+        type = 0;
+        amount = 1;
+        category = 2;
+        date = 3;
+        firstIsData = true;
+    }
+    firstIsData = firstIsData || !spec.header;
+
+    if (date < 0) {
+        error = "cannot tell which column holds the date; map it with date=";
+        return false;
+    }
+    if (amount < 0 && debit < 0 && credit < 0) {
+        error = "cannot tell which column holds the amount; map it with amount= or debit= and credit=";
+        return false;
+    }
+    for (int column : { date, amount, debit, credit, description, category, type }) {
+        width = std::max(width, static_cast<size_t>(column + 1));
+    }
+    return true;
+}
+
+bool CsvReader::Row(StatementRow& row) const {
+    if (fields.size() < width || !ParseStatementDate(fields[date], dates, row.day)) return false;
+
+    if (amount >= 0) {
+        if (!ParseStatementAmount(fields[amount], row.amount)) return false;
+    } else {
+        // Either column may be empty; both are taken as positive
+        int64_t out = 0, in = 0;
+        bool any = false;
+        if (debit >= 0 && !Trim(fields[debit]).empty()) {
+            if (!ParseStatementAmount(fields[debit], out)) return false;
+            any = true;
+        }
+        if (credit >= 0 && !Trim(fields[credit]).empty()) {
+            if (!ParseStatementAmount(fields[credit], in)) return false;
+            any = true;
+        }
+        if (!any) return false;
+        row.amount = (in < 0 ? -in : in) - (out < 0 ? -out : out);
+    }
+
+    if (type >= 0) {
+        std::string_view kind = Trim(fields[type]);
+        int64_t magnitude = row.amount < 0 ? -row.amount : row.amount;
+        for (std::string_view in : { "income", "credit", "cr", "deposit" }) {
+            if (EqualsIgnoringCase(kind, in)) row.amount = magnitude;
+        }
+        for (std::string_view out : { "expense", "debit", "dr", "withdrawal", "payment" }) {
+            if (EqualsIgnoringCase(kind, out)) row.amount = -magnitude;
+        }
+    }
+
+    row.description = description >= 0 ? fields[description] : std::string_view();
+    row.category = category >= 0 ? fields[category] : std::string_view();
+    return true;
+}
+
+char* CsvReader::Parse(char* p, char* end, bool final, std::vector<StatementRow>& rows, StatementStats& stats) {
+    while (p < end) {
+        char* eol = RecordEnd(p, end);
+        if (eol == nullptr && !final) return p;
+        char* stop = eol != nullptr ? eol : end;
+        char* next = eol != nullptr ? eol + 1 : end;
+
+        if (Trim(std::string_view(p, stop - p)).empty()) {
+            p = next;
+            continue;
+        }
+        if (delimiter == '\0') delimiter = GuessDelimiter(std::string_view(p, stop - p));
+        Split(p, stop);
+        p = next;
+
+        if (!started) {
+            started = true;
+            if (!Resolve()) return nullptr;
+            if (!firstIsData) continue;
+        }
+
+        StatementRow row;
+        if (Row(row)) {
+            rows.push_back(row);
+        } else {
+            ++stats.skipped;
+        }
+    }
+    return p;
+}
+
+// OFX
+
+namespace {
+
+class OfxReader {
+public:
+    char* Parse(char* p, char* end, bool final, std::vector<StatementRow>& rows, StatementStats& stats);
+    const std::string& Error() const { return error; }
+
+private:
+    std::string error;
+};
+
+}  // namespace
+
+// Decodes the XML entities OFX 2 may use, in place
+static std::string_view DecodeEntities(char* begin, char* end) {
+    if (std::memchr(begin, '&', end - begin) == nullptr) return std::string_view(begin, end - begin);
+
+    static const std::pair<std::string_view, char> entities[] = {
+        { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+    };
+    char* out = begin;
+    for (char* in = begin; in < end;) {
+        bool decoded = false;
+        if (*in == '&') {
+            for (const auto& [name, c] : entities) {
+                if (static_cast<size_t>(end - in) >= name.size() && std::string_view(in, name.size()) == name) {
+                    *out++ = c;
+                    in += name.size();
+                    decoded = true;
+                    break;
+                }
+            }
+        }
+        if (!decoded) *out++ = *in++;
+    }
+    return std::string_view(begin, out - begin);
+}
+
+static std::string_view TrimmedValue(char* begin, char* end) {
+    while (begin < end && IsBlank(*begin)) ++begin;
+    while (end > begin && IsBlank(end[-1])) --end;
+    return DecodeEntities(begin, end);
+}
+
+char* OfxReader::Parse(char* p, char* end, bool final, std::vector<StatementRow>& rows, StatementStats& stats) {
+    static constexpr std::string_view open = "<STMTTRN>", close = "</STMTTRN>";
+    for (;;) {
+        std::string_view rest(p, end - p);
+        size_t start = rest.find(open);
+        if (start == std::string_view::npos) {
+            // Keeps a tag cut in half by the block boundary
+            if (final) return end;
+            return rest.size() > open.size() ? end - open.size() : p;
+        }
+        size_t stop = rest.find(close, start);
+        if (stop == std::string_view::npos) {
+            if (!final) return p + start;
+            stop = rest.size();
+        }
+
+        // Elements are <TAG>value, closed or not (SGML leaves them open)
+        std::string_view posted, amount, name, memo;
+        char* recordEnd = p + stop;
+        for (char* q = p + start + open.size(); q < recordEnd;) {
+            char* lt = static_cast<char*>(std::memchr(q, '<', recordEnd - q));
+            if (lt == nullptr) break;
+            char* gt = static_cast<char*>(std::memchr(lt, '>', recordEnd - lt));
+            if (gt == nullptr) break;
+            char* value = gt + 1;
+            char* next = static_cast<char*>(std::memchr(value, '<', recordEnd - value));
+            if (next == nullptr) next = recordEnd;
+
+            std::string_view tag(lt + 1, gt - lt - 1);
+            if (tag == "DTPOSTED") posted = TrimmedValue(value, next);
+            else if (tag == "TRNAMT") amount = TrimmedValue(value, next);
+            else if (tag == "NAME") name = TrimmedValue(value, next);
+            else if (tag == "MEMO") memo = TrimmedValue(value, next);
+            q = next;
+        }
+
+        StatementRow row;
+        if (ParseStatementDate(posted, DateOrder::YearMonthDay, row.day) && ParseStatementAmount(amount, row.amount)) {
+            row.description = name.empty() ? memo : name;
+            row.category = std::string_view();
+            rows.push_back(row);
+        } else {
+            ++stats.skipped;
+        }
+        p += std::min(rest.size(), stop + close.size());
+    }
+}
+
+// QIF
+
+namespace {
+
+class QifReader {
+public:
+    explicit QifReader(DateOrder dates) : dates(dates) {}
+
+    char* Parse(char* p, char* end, bool final, std::vector<StatementRow>& rows, StatementStats& stats);
+    const std::string& Error() const { return error; }
+
+private:
+    void Clear() { date = amount = payee = memo = category = std::string_view(); }
+    void Emit(std::vector<StatementRow>& rows, StatementStats& stats);
+
+    DateOrder dates;
+    bool transactions = true;       // in a section of bank-style records
+    std::string_view date, amount, payee, memo, category;
+    std::string error;
+};
+
+}  // namespace
+
+void QifReader::Emit(std::vector<StatementRow>& rows, StatementStats& stats) {
+    bool empty = date.empty() && amount.empty() && payee.empty() && memo.empty() && category.empty();
+    if (transactions && !empty) {
+        StatementRow row;
+        if (ParseStatementDate(date, dates, row.day) && ParseStatementAmount(amount, row.amount)) {
+            row.description = payee.empty() ? memo : payee;
+            // [Account] is a transfer, not a category
+            row.category = !category.empty() && category[0] == '[' ? std::string_view() : category;
+            rows.push_back(row);
+        } else {
+            ++stats.skipped;
+        }
+    }
+    Clear();
+}
+
+char* QifReader::Parse(char* p, char* end, bool final, std::vector<StatementRow>& rows, StatementStats& stats) {
+    // A record is reread from its first line if the block ends inside it
+    char* record = p;
+    Clear();
+    while (p < end) {
+        char* eol = static_cast<char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr && !final) return record;
+        char* next = eol != nullptr ? eol + 1 : end;
+        std::string_view line = Trim(std::string_view(p, (eol != nullptr ? eol : end) - p));
+        p = next;
+        if (line.empty()) continue;
+
+        std::string_view value = Trim(line.substr(1));
+        switch (line[0]) {
+            case '!':
+                if (StartsWithIgnoringCase(line, "!Type:")) {
+                    std::string_view kind = Trim(line.substr(6));
+                    transactions = false;
+                    for (std::string_view bank : { "Bank", "Cash", "CCard", "Oth A", "Oth L" }) {
+                        transactions = transactions || EqualsIgnoringCase(kind, bank);
+                    }
+                } else if (StartsWithIgnoringCase(line, "!Account")) {
+                    transactions = false;
+                }
+                Clear();
+                record = p;
+                break;
+            case '^':
+                Emit(rows, stats);
+                record = p;
+                break;
+            case 'D': date = value; break;
+            case 'T': amount = value; break;
+            case 'U': if (amount.empty()) amount = value; break;
+            case 'P': payee = value; break;
+            case 'M': memo = value; break;
+            case 'L': category = value; break;
+            default: break;
+        }
+    }
+    if (final) {
+        Emit(rows, stats);
+        return end;
+    }
+    return record;
+}
+
+// Reading
+
+template <typename Reader>
+static bool Stream(std::FILE* f, Reader& reader, const StatementBatch& onBatch, StatementStats& stats) {
+    std::vector<char> buffer;
+    std::vector<StatementRow> rows;
+    size_t filled = 0;
+    bool first = true;
+    for (;;) {
+        buffer.resize(filled + blockBytes);
+        size_t read = std::fread(buffer.data() + filled, 1, blockBytes, f);
+        if (std::ferror(f)) {
+            stats.error = "cannot read the statement";
+            return false;
+        }
+        filled += read;
+        stats.bytes += read;
+        bool final = read < blockBytes;
+
+        char* begin = buffer.data();
+        char* end = begin + filled;
+        if (first) begin = const_cast<char*>(SkipByteOrderMark(begin, filled));
+        first = false;
+
+        rows.clear();
+        char* stop = reader.Parse(begin, end, final, rows, stats);
+        if (stop == nullptr) {
+            stats.error = reader.Error();
+            return false;
+        }
+        stats.rows += rows.size();
+        if (!rows.empty()) onBatch(rows);
+        if (final) return true;
+
+        // The unfinished record moves to the front for the next block
+        filled = static_cast<size_t>(end - stop);
+        std::memmove(buffer.data(), stop, filled);
+    }
+}
+
+bool ReadStatement(const std::string& path, const StatementOptions& options, const StatementBatch& onBatch,
+                   StatementStats& stats) {
+    stats = StatementStats();
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        stats.error = "cannot open " + path;
+        return false;
+    }
+
+    bool ok = false;
+    switch (options.format) {
+        case StatementFormat::Csv: {
+            CsvReader reader(options.columns, options.dates);
+            ok = Stream(f, reader, onBatch, stats);
+            break;
+        }
+        case StatementFormat::Ofx: {
+            OfxReader reader;
+            ok = Stream(f, reader, onBatch, stats);
+            break;
+        }
+        case StatementFormat::Qif: {
+            QifReader reader(options.dates);
+            ok = Stream(f, reader, onBatch, stats);
+            break;
+        }
+    }
+    std::fclose(f);
+    return ok;
+}
+
+bool DetectStatementFormat(const std::string& path, StatementFormat& format) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) return false;
+    char head[1024];
+    size_t size = std::fread(head, 1, sizeof(head), f);
+    std::fclose(f);
+
+    const char* begin = SkipByteOrderMark(head, size);
+    std::string_view text = Trim(std::string_view(begin, head + size - begin));
+    if (text.find("OFXHEADER") != std::string_view::npos || text.find("<OFX>") != std::string_view::npos) {
+        format = StatementFormat::Ofx;
+        return true;
+    }
+    for (std::string_view start : { "!Type:", "!Account", "!Option", "!Clear" }) {
+        if (StartsWithIgnoringCase(text, start)) {
+            format = StatementFormat::Qif;
+            return true;
+        }
+    }
+
+    size_t dot = path.find_last_of("./\\");
+    std::string_view extension = dot != std::string::npos && path[dot] == '.' ? std::string_view(path).substr(dot) : "";
+    if (EqualsIgnoringCase(extension, ".ofx") || EqualsIgnoringCase(extension, ".qfx")) {
+        format = StatementFormat::Ofx;
+    } else if (EqualsIgnoringCase(extension, ".qif")) {
+        format = StatementFormat::Qif;
+    } else {
+        format = StatementFormat::Csv;
+    }
+    return true;
+}
+
+// Normalizing
+
+uint16_t StatementImport::Category(std::string_view name, TransactionType type) {
+    name = Trim(name);
+    if (!name.empty() && !CategoryDictionary::IsValidName(name)) {
+        // Cut to the longest name allowed, not inside a UTF-8 sequence, and
+        // with the separators the ledger format reserves blanked
+        size_t length = name.size();
+        if (length > CategoryDictionary::maxNameLength) {
+            length = CategoryDictionary::maxNameLength;
+            while (length > 0 && (static_cast<unsigned char>(name[length]) & 0xC0) == 0x80) --length;
+        }
+        scratch.assign(name.substr(0, length));
+        for (char& c : scratch) {
+            if (c == ',' || c == '\r' || c == '\n') c = ' ';
+        }
+        name = Trim(scratch);
+    }
+    if (name.empty()) name = type == TransactionType::Income ? "N/A" : "Other";
+    return ledger.InternCategory(name);
+}
+
+uint16_t StatementImport::RuleCategory(size_t rule) {
+    if (ruleCategories.size() != rules->Size()) ruleCategories.assign(rules->Size(), -1);
+    if (ruleCategories[rule] < 0) ruleCategories[rule] = ledger.InternCategory(rules->Category(rule));
+    return static_cast<uint16_t>(ruleCategories[rule]);
+}
+
+void StatementImport::Add(const std::vector<StatementRow>& rows) {
+    size_t first = columns.Size();
+    size_t size = first + rows.size();
+    columns.types.resize(size);
+    columns.amounts.resize(size);
+    columns.categories.resize(size);
+    columns.days.resize(size);
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const StatementRow& row = rows[i];
+        TransactionType type = row.amount < 0 ? TransactionType::Expense : TransactionType::Income;
+        columns.types[first + i] = static_cast<uint8_t>(type);
+        columns.amounts[first + i] = row.amount < 0 ? -row.amount : row.amount;
+        size_t rule = CategoryRules::noRule;
+        if (rules != nullptr && Trim(row.category).empty()) {
+            rule = rules->Match(row.description, type, columns.amounts[first + i], row.day, ruleScratch);
+        }
+        columns.categories[first + i] = rule != CategoryRules::noRule ? RuleCategory(rule) : Category(row.category, type);
+        columns.days[first + i] = row.day;
+        descriptions.push_back(DescriptionHash(row.description));
+    }
+}
+
+// The amount of a pending row as the statement had it
+static int64_t SignedAmount(const TransactionColumns& columns, size_t row) {
+    return columns.types[row] == static_cast<uint8_t>(TransactionType::Expense) ? -columns.amounts[row]
+                                                                               : columns.amounts[row];
+}
+
+void StatementImport::MarkDuplicates(const ImportIndex& index, std::vector<uint8_t>& duplicate) {
+    const TransactionStore& store = ledger.Transactions();
+    std::unordered_set<uint64_t> taken;
+    std::vector<ImportEntry> found;
+
+    // An earlier row not matched yet and still in the ledger as imported
+    auto available = [&](const ImportEntry& entry, size_t row) {
+        size_t slot;
+        if (taken.count(entry.id) != 0 || !store.FindId(entry.id, slot)) return false;
+        TransactionStore::Row existing = store.Get(slot);
+        return static_cast<uint8_t>(existing.type) == columns.types[row] &&
+               existing.amount.Minor() == columns.amounts[row];
+    };
+
+    // Same day first, so a shifted match never takes the row another one
+    // matches exactly; then the nearest day within the window
+    int32_t window = std::clamp(duplicateDays, 0, ImportIndex::maxWindowDays);
+    for (int32_t pass = 0; pass < (window > 0 ? 2 : 1); ++pass) {
+        for (size_t row = 0; row < columns.Size(); ++row) {
+            if (duplicate[row]) continue;
+            int32_t day = columns.days[row];
+            found.clear();
+            index.Find(descriptions[row], SignedAmount(columns, row), day, pass == 0 ? 0 : window, found);
+
+            const ImportEntry* best = nullptr;
+            for (const ImportEntry& entry : found) {
+                if (available(entry, row) && (best == nullptr || std::abs(entry.day - day) < std::abs(best->day - day))) {
+                    best = &entry;
+                }
+            }
+            if (best != nullptr) {
+                duplicate[row] = 1;
+                taken.insert(best->id);
+            }
+        }
+    }
+}
+
+size_t StatementImport::Commit() {
+    duplicates = 0;
+    const TransactionStore& store = ledger.Transactions();
+    ImportIndex index;
+    if (!index.Open(ledger.SnapshotPath())) index.Fold(store);
+
+    if (skipDuplicates && index.Size() > 0) {
+        std::vector<uint8_t> duplicate(columns.Size(), 0);
+        MarkDuplicates(index, duplicate);
+
+        size_t kept = 0;
+        for (size_t row = 0; row < columns.Size(); ++row) {
+            if (duplicate[row]) continue;
+            columns.types[kept] = columns.types[row];
+            columns.amounts[kept] = columns.amounts[row];
+            columns.categories[kept] = columns.categories[row];
+            columns.days[kept] = columns.days[row];
+            descriptions[kept] = descriptions[row];
+            ++kept;
+        }
+        duplicates = columns.Size() - kept;
+        columns.types.resize(kept);
+        columns.amounts.resize(kept);
+        columns.categories.resize(kept);
+        columns.days.resize(kept);
+        descriptions.resize(kept);
+    }
+
+    // The rows are numbered here so the index can name them
+    size_t rows = columns.Size();
+    std::vector<ImportEntry> entries(rows);
+    columns.ids.resize(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        uint64_t id = store.NextId() + row;
+        columns.ids[row] = id;
+        entries[row] = ImportEntry{ ImportIndex::Key(descriptions[row], SignedAmount(columns, row), columns.days[row]),
+                                    id, columns.days[row] };
+    }
+    if (rows > 0) {
+        ledger.AddColumns(std::move(columns));
+        index.Add(entries, store);
+    }
+    columns = TransactionColumns();
+    descriptions.clear();
+    return rows;
+}
+
+bool ImportStatement(Ledger& ledger, const std::string& path, const StatementOptions& options, StatementStats& stats) {
+    StatementImport import(ledger, options);
+    if (!ReadStatement(path, options, [&import](const std::vector<StatementRow>& rows) { import.Add(rows); }, stats)) {
+        return false;
+    }
+    import.Commit();
+    stats.duplicates = import.Duplicates();
+    return true;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+// Bank statement import. Statements are read as a stream, a block at a
+// time, so a file of any size only needs a block in memory:
+//
+//   CSV  any delimited export. StatementColumns says which columns hold the
+//        date, the amount (one signed column, or debit and credit columns)
+//        and optionally the description, category and type; by default
+//        they are found from the header. Quoted fields may hold
+//        delimiters, doubled quotes and line breaks. The ledger's own
+//        transactions.txt layout is recognized without a header.
+//   OFX  the <STMTTRN> records of OFX 1.x (SGML) and 2.x (XML), from any
+//        number of accounts in the file: DTPOSTED, TRNAMT, NAME or MEMO.
+//   QIF  the records of !Type:Bank, Cash, CCard, Oth A and Oth L sections:
+//        D, T (or U), P, M and L. Account lists, category lists and
+//        memorized payees are skipped.
+//
+// Each block's rows reach the caller as one batch. StatementImport
+// normalizes a batch into ledger columns (the sign of the amount decides
+// income or expense; a missing category becomes N/A for income and Other
+// for expenses) and adds everything to the ledger in one bulk insert at the
+// end, so the indexes and totals are rebuilt once, not per row. Rows the
+// statement gives no category take the one of the first CategoryRules rule
+// that holds for them, matched as the batch is normalized.
+//
+// Rows imported before are left out: each row is looked up in the
+// ledger's ImportIndex by description, amount and date, first on its own
+// day and then, for the rows still unmatched, within duplicateDays of it,
+// nearest first, as banks may post a transaction a day or two after it
+// was made. An earlier row matches one new row at most, and only while it
+// is still in the ledger with the same amount; rows repeated within one
+// statement are all kept. The ledger keeps no description, so only the
+// index remembers it.
+
+#include "CategoryRules.h"
+#include "ImportIndex.h"
+#include "Ledger.h"
+#include "TransactionStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class StatementFormat : uint8_t { Csv, Ofx, Qif };
+
+// From the first bytes of the file, then its extension; CSV when neither
+// says otherwise. False if the file cannot be read.
+bool DetectStatementFormat(const std::string& path, StatementFormat& format);
+
+enum class DateOrder : uint8_t { DayMonthYear, MonthDayYear, YearMonthDay };
+
+// The order a format's dates usually come in: month first for QIF, which
+// Quicken writes US style, day first otherwise
+inline DateOrder UsualDateOrder(StatementFormat format) {
+    return format == StatementFormat::Qif ? DateOrder::MonthDayYear : DateOrder::DayMonthYear;
+}
+
+// Three numbers in the given order, separated by any of "/-. '" (QIF's
+// 1/ 5'24 included), or a month name in place of the month ("05-Jan-2024",
+// "Jan 5, 2024"), or YYYYMMDD followed by anything (OFX's
+// 20240105120000[-5:EST]). Two-digit years below 70 are 20xx.
+bool ParseStatementDate(std::string_view text, DateOrder order, int32_t& day);
+
+// Minor units from bank amount text: "1,234.56", "-45", "(45.00)",
+// "45.00-", "PHP 1 234.50", "12,50" (a decimal comma when it is the only
+// separator and two digits follow it)
+bool ParseStatementAmount(std::string_view text, int64_t& minor);
+
+// Where a CSV statement keeps each field: a header name (matched without
+// regard to case) or "#n" for the n-th column, counting from 1. Empty
+// fields are looked for in the header under their usual names.
+struct StatementColumns {
+    std::string date;
+    std::string amount;         // signed; or debit and credit, both positive
+    std::string debit;
+    std::string credit;
+    std::string description;
+    std::string category;
+    std::string type;           // Income/Expense, Credit/Debit, CR/DR
+    char delimiter = '\0';      // guessed from the first line when '\0'
+    bool header = true;
+
+    // "date=Posted Date,amount=#4,description=Payee"; also delimiter=; and
+    // header=no
+    static bool Parse(std::string_view text, StatementColumns& columns, std::string& error);
+};
+
+struct StatementOptions {
+    StatementFormat format = StatementFormat::Csv;
+    StatementColumns columns;   // CSV only
+    DateOrder dates = DateOrder::DayMonthYear;   // CSV and QIF; OFX is YYYYMMDD
+    bool skipDuplicates = true;
+    int32_t duplicateDays = 3;  // at most ImportIndex::maxWindowDays
+    const CategoryRules* rules = nullptr;
+};
+
+// One statement row. The views point into the reader's block and stay valid
+// until the batch callback returns.
+struct StatementRow {
+    int32_t day;
+    int64_t amount;             // minor units; negative is money out
+    std::string_view description;
+    std::string_view category;  // empty when the statement has none
+};
+
+struct StatementStats {
+    size_t rows = 0;
+    size_t skipped = 0;         // records without a valid date or amount
+    size_t duplicates = 0;      // rows imported before, left out
+    uint64_t bytes = 0;
+    std::string error;          // why reading failed, if it did
+};
+
+using StatementBatch = std::function<void(const std::vector<StatementRow>& rows)>;
+
+// Streams the statement at path, calling onBatch with each block's rows.
+// False, with stats.error set, if the file cannot be read or its columns
+// cannot be found; batches already delivered stay delivered.
+bool ReadStatement(const std::string& path, const StatementOptions& options, const StatementBatch& onBatch,
+                   StatementStats& stats);
+
+// Turns statement batches into ledger rows
+class StatementImport {
+public:
+    explicit StatementImport(Ledger& ledger, const StatementOptions& options = StatementOptions())
+        : ledger(ledger), skipDuplicates(options.skipDuplicates), duplicateDays(options.duplicateDays),
+          rules(options.rules) {}
+
+    // Normalizes a batch into the pending rows
+    void Add(const std::vector<StatementRow>& rows);
+    size_t Pending() const { return columns.Size(); }
+
+    // Leaves out the pending rows imported before, adds the rest to the
+    // ledger in one bulk insert and records them in the import index.
+    // Returns how many rows were added.
+    size_t Commit();
+
+    // Rows the last Commit left out
+    size_t Duplicates() const { return duplicates; }
+
+private:
+    uint16_t Category(std::string_view name, TransactionType type);
+    uint16_t RuleCategory(size_t rule);
+    void MarkDuplicates(const ImportIndex& index, std::vector<uint8_t>& duplicate);
+
+    Ledger& ledger;
+    bool skipDuplicates;
+    int32_t duplicateDays;
+    const CategoryRules* rules;
+    CategoryRules::Scratch ruleScratch;
+    std::vector<int32_t> ruleCategories;    // store id per rule, -1 until used
+    TransactionColumns columns;
+    std::vector<uint64_t> descriptions;     // DescriptionHash per pending row
+    std::string scratch;
+    size_t duplicates = 0;
+};
+
+// ReadStatement into a StatementImport, committed only if the whole file
+// was read; returns false, adding nothing, otherwise
+bool ImportStatement(Ledger& ledger, const std::string& path, const StatementOptions& options, StatementStats& stats);
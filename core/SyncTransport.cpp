@@ -0,0 +1,296 @@
+#include "SyncTransport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mutex>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Messages larger than this are refused rather than allocated
+static constexpr uint32_t maxMessageBytes = 1u << 30;
+
+bool SyncTransport::Request(const std::string& request, std::string& reply) {
+    bytesSent += request.size();
+    ++exchanges;
+    if (!Exchange(request, reply)) return false;
+    bytesReceived += reply.size();
+    return true;
+}
+
+// Directory transport
+
+static bool ReadWholeFile(const fs::path& path, std::string& out) {
+    std::FILE* f = std::fopen(path.string().c_str(), "rb");
+    if (f == nullptr) return false;
+    out.clear();
+    char buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) out.append(buffer, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+// Written under a temporary name and renamed, so the other side never
+// reads half a message
+static bool PublishFile(const fs::path& path, const std::string& bytes) {
+    fs::path temp = path;
+    temp += ".tmp";
+    std::FILE* f = std::fopen(temp.string().c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = std::fclose(f) == 0 && ok;
+
+    std::error_code ec;
+    if (ok) fs::rename(temp, path, ec);
+    if (!ok || ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+DirectoryTransport::DirectoryTransport(std::string directory, int timeoutMs)
+    : directory(std::move(directory)), timeoutMs(timeoutMs) {
+    std::random_device device;
+    uint64_t token = (static_cast<uint64_t>(device()) << 32) ^ device() ^
+                     static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(token));
+    session = text;
+}
+
+bool DirectoryTransport::Exchange(const std::string& request, std::string& reply) {
+    std::string name = session + "-" + std::to_string(sequence++);
+    fs::path requestPath = fs::path(directory) / (name + ".request");
+    fs::path replyPath = fs::path(directory) / (name + ".reply");
+    if (!PublishFile(requestPath, request)) return false;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::error_code ec;
+    while (!fs::exists(replyPath, ec)) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            fs::remove(requestPath, ec);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool ok = ReadWholeFile(replyPath, reply);
+    fs::remove(replyPath, ec);
+    return ok;
+}
+
+size_t ServeDirectory(const std::string& directory, const SyncHandler& handler) {
+    // Oldest first within a session, by sequence number
+    std::vector<fs::path> requests;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == ".request") requests.push_back(it->path());
+    }
+    std::sort(requests.begin(), requests.end(), [](const fs::path& a, const fs::path& b) {
+        std::string x = a.stem().string(), y = b.stem().string();
+        return x.size() != y.size() ? x.size() < y.size() : x < y;
+    });
+
+    size_t served = 0;
+    for (const fs::path& path : requests) {
+        std::string request;
+        if (!ReadWholeFile(path, request)) continue;
+        fs::path replyPath = path;
+        replyPath.replace_extension(".reply");
+        PublishFile(replyPath, handler(request));
+        fs::remove(path, ec);
+        ++served;
+    }
+    return served;
+}
+
+// Sockets
+
+#ifdef _WIN32
+
+using NativeSocket = SOCKET;
+static const NativeSocket invalidSocket = INVALID_SOCKET;
+
+static bool StartSockets() {
+    static std::once_flag once;
+    static bool started = false;
+    std::call_once(once, [] {
+        WSADATA data;
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    });
+    return started;
+}
+
+static void CloseSocket(NativeSocket s) {
+    closesocket(s);
+}
+
+#else
+
+using NativeSocket = int;
+static const NativeSocket invalidSocket = -1;
+
+static bool StartSockets() {
+    return true;
+}
+
+static void CloseSocket(NativeSocket s) {
+    ::close(s);
+}
+
+#endif
+
+static NativeSocket Native(intptr_t s) {
+    return static_cast<NativeSocket>(s);
+}
+
+static bool SendAll(NativeSocket s, const char* data, size_t size) {
+    while (size > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+        int sent = static_cast<int>(::send(s, data, chunk, 0));
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+static bool ReceiveAll(NativeSocket s, char* data, size_t size) {
+    while (size > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+        int received = static_cast<int>(::recv(s, data, chunk, 0));
+        if (received <= 0) return false;
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+static bool SendFrame(NativeSocket s, const std::string& message) {
+    if (message.size() > maxMessageBytes) return false;
+    uint32_t length = static_cast<uint32_t>(message.size());
+    unsigned char header[4] = { static_cast<unsigned char>(length), static_cast<unsigned char>(length >> 8),
+                                static_cast<unsigned char>(length >> 16), static_cast<unsigned char>(length >> 24) };
+    return SendAll(s, reinterpret_cast<const char*>(header), 4) && SendAll(s, message.data(), message.size());
+}
+
+static bool ReceiveFrame(NativeSocket s, std::string& message) {
+    unsigned char header[4];
+    if (!ReceiveAll(s, reinterpret_cast<char*>(header), 4)) return false;
+    uint32_t length = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<uint32_t>(header[3]) << 24);
+    if (length > maxMessageBytes) return false;
+    message.resize(length);
+    return ReceiveAll(s, message.data(), length);
+}
+
+// Requests are small and answered one at a time; without this every
+// exchange would wait on delayed acknowledgements
+static void SetNoDelay(NativeSocket s) {
+    int on = 1;
+    ::setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+}
+
+SocketTransport::~SocketTransport() {
+    Close();
+}
+
+bool SocketTransport::Connect(const std::string& host, uint16_t port) {
+    Close();
+    if (!StartSockets()) return false;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(), &address.sin_addr) != 1) return false;
+
+    NativeSocket s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == invalidSocket) return false;
+    if (::connect(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        CloseSocket(s);
+        return false;
+    }
+    SetNoDelay(s);
+    socket = static_cast<intptr_t>(s);
+    return true;
+}
+
+void SocketTransport::Close() {
+    if (socket != -1) CloseSocket(Native(socket));
+    socket = -1;
+}
+
+bool SocketTransport::Exchange(const std::string& request, std::string& reply) {
+    if (socket == -1) return false;
+    if (SendFrame(Native(socket), request) && ReceiveFrame(Native(socket), reply)) return true;
+    Close();
+    return false;
+}
+
+SocketServer::~SocketServer() {
+    Close();
+}
+
+bool SocketServer::Listen(uint16_t requestedPort, bool loopbackOnly) {
+    Close();
+    if (!StartSockets()) return false;
+
+    NativeSocket s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == invalidSocket) return false;
+    int on = 1;
+    ::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(requestedPort);
+    address.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+    socklen_t length = sizeof(address);
+    if (::bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(s, 4) != 0 ||
+        ::getsockname(s, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        CloseSocket(s);
+        return false;
+    }
+    socket = static_cast<intptr_t>(s);
+    port = ntohs(address.sin_port);
+    return true;
+}
+
+bool SocketServer::ServeOne(const SyncHandler& handler) {
+    if (socket == -1) return false;
+    NativeSocket client = ::accept(Native(socket), nullptr, nullptr);
+    if (client == invalidSocket) return false;
+    SetNoDelay(client);
+
+    std::string request;
+    while (ReceiveFrame(client, request)) {
+        if (!SendFrame(client, handler(request))) break;
+    }
+    CloseSocket(client);
+    return true;
+}
+
+void SocketServer::Close() {
+    if (socket != -1) CloseSocket(Native(socket));
+    socket = -1;
+    port = 0;
+}
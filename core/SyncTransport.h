@@ -0,0 +1,105 @@
+#pragma once
+
+// How sync messages travel between two copies of a ledger. LedgerSync only
+// needs request and reply exchanges, so a transport is anything that can
+// deliver a request to the peer and bring its reply back:
+//
+//   SocketTransport     a TCP connection, normally to a SocketServer on the
+//                       same machine or network; each message is a 4-byte
+//                       little-endian length followed by the bytes
+//   DirectoryTransport  request and reply files in a shared directory,
+//                       answered by whoever runs ServeDirectory on it; for
+//                       tests, and for machines that only share a folder
+//
+// Both count the bytes that cross them, which is what a sync costs.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class SyncTransport {
+public:
+    virtual ~SyncTransport() = default;
+
+    // Sends request and waits for the reply. False when the peer cannot be
+    // reached or does not answer.
+    bool Request(const std::string& request, std::string& reply);
+
+    uint64_t BytesSent() const { return bytesSent; }
+    uint64_t BytesReceived() const { return bytesReceived; }
+    size_t Exchanges() const { return exchanges; }
+
+protected:
+    virtual bool Exchange(const std::string& request, std::string& reply) = 0;
+
+private:
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    size_t exchanges = 0;
+};
+
+// Turns a request into its reply, on the answering side
+using SyncHandler = std::function<std::string(const std::string& request)>;
+
+class DirectoryTransport : public SyncTransport {
+public:
+    // Gives up on a request after timeoutMs without a reply
+    explicit DirectoryTransport(std::string directory, int timeoutMs = 30000);
+
+protected:
+    bool Exchange(const std::string& request, std::string& reply) override;
+
+private:
+    std::string directory;
+    std::string session;        // names this transport's files apart from others'
+    uint64_t sequence = 0;
+    int timeoutMs;
+};
+
+// Answers every request waiting in directory and returns how many there
+// were; call it in a loop to serve
+size_t ServeDirectory(const std::string& directory, const SyncHandler& handler);
+
+class SocketTransport : public SyncTransport {
+public:
+    SocketTransport() = default;
+    ~SocketTransport() override;
+
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+
+    // host is a numeric IPv4 address or "localhost"
+    bool Connect(const std::string& host, uint16_t port);
+    void Close();
+
+protected:
+    bool Exchange(const std::string& request, std::string& reply) override;
+
+private:
+    intptr_t socket = -1;
+};
+
+class SocketServer {
+public:
+    SocketServer() = default;
+    ~SocketServer();
+
+    SocketServer(const SocketServer&) = delete;
+    SocketServer& operator=(const SocketServer&) = delete;
+
+    // Listens on the loopback interface, or on every interface when
+    // loopbackOnly is false. Port 0 picks a free one; see Port.
+    bool Listen(uint16_t port, bool loopbackOnly = true);
+    uint16_t Port() const { return port; }
+
+    // Accepts one connection and answers its requests until the peer
+    // closes it. False if no connection could be accepted.
+    bool ServeOne(const SyncHandler& handler);
+
+    void Close();
+
+private:
+    intptr_t socket = -1;
+    uint16_t port = 0;
+};
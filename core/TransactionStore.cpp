@@ -0,0 +1,401 @@
+#include "TransactionStore.h"
+
+#include "Date.h"
+#include "Snapshot.h"
+
+#include <stdexcept>
+
+// Calls onRun(first, count) for each run of live slots, whole words at a time
+template <typename Fn>
+static void ForEachLiveRun(const LiveSet& live, Fn&& onRun) {
+    const uint64_t* words = live.Words();
+    size_t runStart = 0;
+    size_t runLength = 0;
+    for (size_t slot = 0; slot < live.Slots();) {
+        uint64_t word = words[slot >> 6];
+        if ((slot & 63) == 0 && word == ~uint64_t(0) && slot + 64 <= live.Slots()) {
+            if (runLength == 0) runStart = slot;
+            runLength += 64;
+            slot += 64;
+            continue;
+        }
+        if ((slot & 63) == 0 && word == 0) {
+            if (runLength > 0) onRun(runStart, runLength);
+            runLength = 0;
+            slot += 64;
+            continue;
+        }
+        if ((word >> (slot & 63)) & 1) {
+            if (runLength == 0) runStart = slot;
+            ++runLength;
+        } else if (runLength > 0) {
+            onRun(runStart, runLength);
+            runLength = 0;
+        }
+        ++slot;
+    }
+    if (runLength > 0) onRun(runStart, runLength);
+}
+
+template <typename T>
+static std::vector<T> CopyLive(const MappedColumn<T>& column, const LiveSet& live) {
+    if (live.Count() == live.Slots()) return std::vector<T>(column.begin(), column.end());
+
+    std::vector<T> out;
+    out.reserve(live.Count());
+    ForEachLiveRun(live, [&](size_t first, size_t count) {
+        out.insert(out.end(), column.begin() + first, column.begin() + first + count);
+    });
+    return out;
+}
+
+void TransactionStore::Reserve(size_t rows) {
+    amounts.reserve(rows);
+    types.reserve(rows);
+    categoryIds.reserve(rows);
+    days.reserve(rows);
+    ids.reserve(rows);
+}
+
+void TransactionStore::Clear() {
+    amounts.clear();
+    types.clear();
+    categoryIds.clear();
+    days.clear();
+    ids.clear();
+    live.Clear();
+    index.Clear();
+    totals.Clear();
+    dates.Clear();
+    rollups.Clear();
+    balances.Clear();
+    nextId = 1;
+    ++version;
+    ++layout;
+}
+
+size_t TransactionStore::Append(const Row& row) {
+    return Append(row, nextId);
+}
+
+size_t TransactionStore::Append(const Row& row, uint64_t id) {
+    size_t slot = SlotCount();
+    amounts.push_back(row.amount.Minor());
+    types.push_back(static_cast<uint8_t>(row.type));
+    categoryIds.push_back(row.category);
+    days.push_back(row.day);
+    ids.push_back(id);
+    if (id >= nextId) nextId = id + 1;
+
+    live.PushBack();
+    index.Insert(slot, ids.data());
+    totals.Add(row.type, row.category, row.amount);
+    dates.Insert(slot, row.day, row.type, row.amount);
+    rollups.Add(row.day, row.type, row.category, row.amount);
+    balances.Add(row.day, row.type, row.amount);
+    ++version;
+    CheckTotals();
+    return slot;
+}
+
+void TransactionStore::AppendColumns(TransactionColumns&& columns) {
+    size_t first = SlotCount();
+    size_t rows = columns.Size();
+
+    if (columns.ids.empty()) {
+        columns.ids.resize(rows);
+        for (size_t i = 0; i < rows; ++i) columns.ids[i] = nextId + i;
+    }
+    for (uint64_t id : columns.ids) {
+        if (id >= nextId) nextId = id + 1;
+    }
+
+    if (first == 0) {
+        amounts = std::move(columns.amounts);
+        types = std::move(columns.types);
+        categoryIds = std::move(columns.categories);
+        days = std::move(columns.days);
+        ids = std::move(columns.ids);
+        live.Assign(rows);
+    } else {
+        amounts.Append(columns.amounts.begin(), columns.amounts.end());
+        types.Append(columns.types.begin(), columns.types.end());
+        categoryIds.Append(columns.categories.begin(), columns.categories.end());
+        days.Append(columns.days.begin(), columns.days.end());
+        ids.Append(columns.ids.begin(), columns.ids.end());
+        for (size_t i = 0; i < rows; ++i) live.PushBack();
+    }
+
+    if (rows >= first) {
+        RebuildIndexes();
+        RebuildRollups();
+    } else {
+        for (size_t slot = first; slot < SlotCount(); ++slot) {
+            Row row = Get(slot);
+            index.Insert(slot, ids.data());
+            totals.Add(row.type, row.category, row.amount);
+            dates.Insert(slot, row.day, row.type, row.amount);
+            rollups.Add(row.day, row.type, row.category, row.amount);
+            balances.Add(row.day, row.type, row.amount);
+        }
+    }
+    ++version;
+    CheckTotals();
+}
+
+void TransactionStore::RebuildIndexes() {
+    // Dead slots hold a zero amount, so the totals can take every slot
+    totals.Rebuild(SlotCount(), types.data(), categoryIds.data(), amounts.data(), CategoryCount());
+    dates.Build(SlotCount(), days.data(), types.data(), amounts.data(), &live);
+    index.Build(ids.data(), live);
+    balances.Build(SlotCount(), days.data(), types.data(), amounts.data(), &live);
+}
+
+void TransactionStore::RebuildRollups() {
+    rollups.Build(SlotCount(), days.data(), types.data(), categoryIds.data(), amounts.data(), &live);
+}
+
+void TransactionStore::Update(size_t slot, const Row& row) {
+    if (slot >= SlotCount() || !live.Test(slot)) return;
+    totals.Remove(static_cast<TransactionType>(types[slot]), categoryIds[slot], Money::FromMinor(amounts[slot]));
+    totals.Add(row.type, row.category, row.amount);
+    dates.Update(slot, days[slot], static_cast<TransactionType>(types[slot]), Money::FromMinor(amounts[slot]),
+                 row.day, row.type, row.amount);
+    rollups.Remove(days[slot], static_cast<TransactionType>(types[slot]), categoryIds[slot], Money::FromMinor(amounts[slot]));
+    rollups.Add(row.day, row.type, row.category, row.amount);
+    balances.Remove(days[slot], static_cast<TransactionType>(types[slot]), Money::FromMinor(amounts[slot]));
+    balances.Add(row.day, row.type, row.amount);
+
+    amounts.Set(slot, row.amount.Minor());
+    types.Set(slot, static_cast<uint8_t>(row.type));
+    categoryIds.Set(slot, row.category);
+    days.Set(slot, row.day);
+    ++version;
+    CheckTotals();
+}
+
+void TransactionStore::Kill(size_t slot) {
+    totals.Remove(static_cast<TransactionType>(types[slot]), categoryIds[slot], Money::FromMinor(amounts[slot]));
+    rollups.Remove(days[slot], static_cast<TransactionType>(types[slot]), categoryIds[slot], Money::FromMinor(amounts[slot]));
+    balances.Remove(days[slot], static_cast<TransactionType>(types[slot]), Money::FromMinor(amounts[slot]));
+    index.Erase(ids[slot], ids.data());
+    amounts.Set(slot, 0);
+}
+
+void TransactionStore::Erase(size_t slot) {
+    if (slot >= SlotCount() || !live.Test(slot)) return;
+    dates.Remove(slot, days[slot], static_cast<TransactionType>(types[slot]), Money::FromMinor(amounts[slot]));
+    live.Erase(slot);
+    Kill(slot);
+    ++version;
+    CheckTotals();
+}
+
+size_t TransactionStore::Erase(const std::vector<size_t>& slots) {
+    std::vector<uint32_t> removed;
+    removed.reserve(slots.size());
+    for (size_t slot : slots) {
+        if (slot >= SlotCount() || !live.Test(slot)) continue;
+        live.Erase(slot);
+        removed.push_back(static_cast<uint32_t>(slot));
+    }
+    if (removed.empty()) return 0;
+
+    // The date buckets read the amounts, so they go before the rows are zeroed
+    dates.Remove(removed, days.data(), types.data(), amounts.data());
+    for (uint32_t slot : removed) Kill(slot);
+    ++version;
+    CheckTotals();
+    return removed.size();
+}
+
+TransactionStore::Compaction TransactionStore::PrepareCompaction() const {
+    Compaction compaction;
+    compaction.version = version;
+
+    std::vector<uint32_t> newSlot(SlotCount(), UINT32_MAX);
+    uint32_t next = 0;
+    ForEachLiveRun(live, [&](size_t first, size_t count) {
+        for (size_t slot = first; slot < first + count; ++slot) newSlot[slot] = next++;
+    });
+
+    TransactionColumns& columns = compaction.columns;
+    columns.types = CopyLive(types, live);
+    columns.amounts = CopyLive(amounts, live);
+    columns.categories = CopyLive(categoryIds, live);
+    columns.days = CopyLive(days, live);
+    columns.ids = CopyLive(ids, live);
+
+    // Live rows keep their order, so both indexes only need renumbering
+    compaction.index = index;
+    compaction.index.Renumber(newSlot);
+    compaction.dates = dates;
+    compaction.dates.Renumber(newSlot);
+    return compaction;
+}
+
+bool TransactionStore::InstallCompaction(Compaction&& compaction) {
+    if (compaction.version != version) return false;
+
+    TransactionColumns& columns = compaction.columns;
+    amounts = std::move(columns.amounts);
+    types = std::move(columns.types);
+    categoryIds = std::move(columns.categories);
+    days = std::move(columns.days);
+    ids = std::move(columns.ids);
+    live.Assign(amounts.size());
+    index = std::move(compaction.index);
+    dates = std::move(compaction.dates);
+    ++version;
+    ++layout;
+    CheckTotals();
+    return true;
+}
+
+void TransactionStore::Compact() {
+    if (DeadCount() > 0) InstallCompaction(PrepareCompaction());
+}
+
+bool TransactionStore::VerifyTotals() const {
+    LedgerTotals recomputed;
+    recomputed.Rebuild(SlotCount(), types.data(), categoryIds.data(), amounts.data(), CategoryCount());
+
+    DateIndex reindexed;
+    reindexed.Build(SlotCount(), days.data(), types.data(), amounts.data(), &live);
+    RollupCube rolledUp;
+    rolledUp.Build(SlotCount(), days.data(), types.data(), categoryIds.data(), amounts.data(), &live);
+    RunningBalance rebalanced;
+    rebalanced.Build(SlotCount(), days.data(), types.data(), amounts.data(), &live);
+    if (!(recomputed == totals) || !(reindexed == dates) || rolledUp != rollups || rebalanced != balances ||
+        index.Size() != live.Count()) {
+        return false;
+    }
+
+    for (size_t slot = 0; slot < SlotCount(); ++slot) {
+        size_t found;
+        if (live.Test(slot) ? !FindId(ids[slot], found) || found != slot : amounts[slot] != 0) return false;
+    }
+    return true;
+}
+
+Money TransactionStore::BalanceAfter(size_t slot) const {
+    int64_t balance = balances.Before(days[slot]).Minor();
+    dates.ForEachEarlierOnDay(days[slot], slot, [&](size_t row) {
+        balance += types[row] == static_cast<uint8_t>(TransactionType::Income) ? amounts[row] : -amounts[row];
+    });
+    balance += types[slot] == static_cast<uint8_t>(TransactionType::Income) ? amounts[slot] : -amounts[slot];
+    return Money::FromMinor(balance);
+}
+
+void TransactionStore::CheckTotals() const {
+    if (verifyTotals && !VerifyTotals()) {
+        throw std::logic_error("TransactionStore totals out of sync");
+    }
+}
+
+TransactionStore::Row TransactionStore::MakeRow(const LedgerRow& row) {
+    int32_t day;
+    if (!ParseDate(row.date, day)) day = kNoDate;
+    return Row{ TypeFromName(row.type), row.amount, InternCategory(row.category), day };
+}
+
+void TransactionStore::LoadSnapshot(const SnapshotReader& snapshot) {
+    Clear();
+    categories.Clear();
+
+    // Snapshot ids are kept as they are; the writer never stores a name twice
+    for (size_t id = 0; id < snapshot.CategoryCount(); ++id) {
+        categories.Intern(snapshot.CategoryName(static_cast<uint16_t>(id)));
+    }
+
+    // A mapped file stays open as long as any column still reads from it
+    size_t rows = snapshot.Rows();
+    std::shared_ptr<const MappedFile> mapping = snapshot.Mapping();
+    if (mapping) {
+        types.View(snapshot.TypeColumn(), rows, mapping);
+        amounts.View(snapshot.AmountColumn(), rows, mapping);
+        categoryIds.View(snapshot.CategoryColumn(), rows, mapping);
+        days.View(snapshot.DateColumn(), rows, mapping);
+    } else {
+        types = std::vector<uint8_t>(snapshot.TypeColumn(), snapshot.TypeColumn() + rows);
+        amounts = std::vector<int64_t>(snapshot.AmountColumn(), snapshot.AmountColumn() + rows);
+        categoryIds = std::vector<uint16_t>(snapshot.CategoryColumn(), snapshot.CategoryColumn() + rows);
+        days = std::vector<int32_t>(snapshot.DateColumn(), snapshot.DateColumn() + rows);
+    }
+
+    // Files from before ids number their rows in order
+    if (snapshot.IdColumn() == nullptr) {
+        std::vector<uint64_t> numbered(rows);
+        for (size_t i = 0; i < rows; ++i) numbered[i] = i + 1;
+        ids = std::move(numbered);
+    } else if (mapping) {
+        ids.View(snapshot.IdColumn(), rows, mapping);
+        nextId = snapshot.NextId();
+    } else {
+        ids = std::vector<uint64_t>(snapshot.IdColumn(), snapshot.IdColumn() + rows);
+        nextId = snapshot.NextId();
+    }
+    for (uint64_t id : ids) {
+        if (id >= nextId) nextId = id + 1;
+    }
+
+    live.Assign(rows);
+    RebuildIndexes();
+
+    // Saved cells spare the pass over the rows; older files rebuild them
+    if (snapshot.Rollups().empty() || !rollups.Load(snapshot.Rollups(), CategoryCount())) RebuildRollups();
+}
+
+void TransactionStore::OwnColumns() {
+    amounts.Owned();
+    types.Owned();
+    categoryIds.Owned();
+    days.Owned();
+    ids.Owned();
+}
+
+TransactionStore::Image TransactionStore::CopyImage() const {
+    Image image;
+    image.columns.types = CopyLive(types, live);
+    image.columns.amounts = CopyLive(amounts, live);
+    image.columns.categories = CopyLive(categoryIds, live);
+    image.columns.days = CopyLive(days, live);
+    image.columns.ids = CopyLive(ids, live);
+    image.categories = categories;
+    image.nextId = nextId;
+    image.rollups = rollups.Serialize();
+    return image;
+}
+
+std::string TransactionStore::BuildSnapshot() const {
+    if (DeadCount() == 0) {
+        return WriteSnapshot(SlotCount(), types.data(), amounts.data(), categoryIds.data(), days.data(), ids.data(),
+                             nextId, categories, rollups.Serialize());
+    }
+    Image image = CopyImage();
+    const TransactionColumns& columns = image.columns;
+    return WriteSnapshot(columns.Size(), columns.types.data(), columns.amounts.data(), columns.categories.data(),
+                         columns.days.data(), columns.ids.data(), nextId, categories, image.rollups);
+}
+
+std::string TransactionStore::BuildCsv() const {
+    std::string out;
+    char date[16];
+    for (size_t slot = 0; slot < SlotCount(); ++slot) {
+        if (!live.Test(slot)) continue;
+        Row row = Get(slot);
+        size_t length = FormatDate(row.day, date);
+        AppendLedgerRow(out, TypeName(row.type), row.amount, CategoryName(row.category), std::string_view(date, length));
+    }
+    return out;
+}
+
+size_t TransactionStore::MemoryUsage() const {
+    size_t bytes = amounts.capacity() * sizeof(int64_t) +
+                   types.capacity() * sizeof(uint8_t) +
+                   categoryIds.capacity() * sizeof(uint16_t) +
+                   days.capacity() * sizeof(int32_t) +
+                   ids.capacity() * sizeof(uint64_t);
+    return bytes + categories.MemoryUsage() + dates.MemoryUsage() + rollups.MemoryUsage() + balances.MemoryUsage() +
+           live.MemoryUsage() + index.MemoryUsage();
+}
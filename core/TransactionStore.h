@@ -0,0 +1,219 @@
+#pragma once
+
+// In-memory ledger kept as parallel columns (struct of arrays): amount in
+// minor units, type, category id, day number and stable id, 23 bytes per
+// row. Scans such as the summary and report totals walk contiguous arrays
+// instead of chasing three heap strings per transaction.
+//
+// Rows live in slots. Deleting a row only marks its slot dead and zeroes
+// its amount, so the column scans stay exact without checking liveness and
+// no later row moves; Compact drops the dead slots in one pass. Callers
+// hold on to ids, which never change, or to positions (the n-th live row),
+// which is what a table shows.
+
+#include "CategoryDictionary.h"
+#include "DateIndex.h"
+#include "IdIndex.h"
+#include "LedgerLoader.h"
+#include "LedgerTotals.h"
+#include "LedgerTypes.h"
+#include "LiveSet.h"
+#include "MappedColumn.h"
+#include "Money.h"
+#include "RollupCube.h"
+#include "RunningBalance.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SnapshotReader;
+
+// Rows in column form for bulk appends; categories are store ids. ids may
+// be left empty for the store to number the rows.
+struct TransactionColumns {
+    std::vector<uint8_t> types;
+    std::vector<int64_t> amounts;
+    std::vector<uint16_t> categories;
+    std::vector<int32_t> days;
+    std::vector<uint64_t> ids;
+
+    size_t Size() const { return amounts.size(); }
+};
+
+class TransactionStore {
+public:
+    struct Row {
+        TransactionType type;
+        Money amount;
+        uint16_t category;
+        int32_t day;
+    };
+
+    // Live rows
+    size_t Size() const { return live.Count(); }
+    bool Empty() const { return live.Count() == 0; }
+
+    // Live and dead slots; the columns are this long
+    size_t SlotCount() const { return amounts.size(); }
+    size_t DeadCount() const { return SlotCount() - Size(); }
+    bool IsLive(size_t slot) const { return live.Test(slot); }
+
+    // Slot of the live row at position, and back
+    size_t SlotAt(size_t position) const { return live.Select(position); }
+    size_t PositionOf(size_t slot) const { return live.Rank(slot); }
+
+    uint64_t Id(size_t slot) const { return ids[slot]; }
+    bool FindId(uint64_t id, size_t& slot) const { return index.Find(id, ids.data(), slot); }
+
+    // The id Append gives the next row; above every id ever used
+    uint64_t NextId() const { return nextId; }
+
+    // Changes with every mutation and with compaction, which moves slots
+    uint64_t Version() const { return version; }
+
+    // Changes only when rows move to other slots (Clear, load, compaction);
+    // slots held elsewhere stay valid while it does not
+    uint64_t Layout() const { return layout; }
+
+    void Reserve(size_t rows);
+    void Clear();
+
+    // Return the new row's slot. Without an id the next unused one is taken.
+    size_t Append(const Row& row);
+    size_t Append(const Row& row, uint64_t id);
+
+    // Same as calling Append for every row. Into an empty store the columns
+    // are moved rather than copied, and large batches rebuild the totals and
+    // the indexes in one pass instead of row by row.
+    void AppendColumns(TransactionColumns&& columns);
+
+    // Replaces a live row; a dead or out-of-range slot is left alone
+    void Update(size_t slot, const Row& row);
+
+    // Marks rows dead. The batch form takes each date bucket once; slots
+    // already dead or out of range are skipped. Returns how many rows were
+    // removed.
+    void Erase(size_t slot);
+    size_t Erase(const std::vector<size_t>& slots);
+
+    Row Get(size_t slot) const {
+        return Row{ static_cast<TransactionType>(types[slot]), Money::FromMinor(amounts[slot]), categoryIds[slot], days[slot] };
+    }
+    Row operator[](size_t slot) const { return Get(slot); }
+
+    // Column access for aggregation, SlotCount() long; amounts are in minor
+    // units and zero in dead slots
+    const int64_t* Amounts() const { return amounts.data(); }
+    const uint8_t* Types() const { return types.data(); }
+    const uint16_t* Categories() const { return categoryIds.data(); }
+    const int32_t* Days() const { return days.data(); }
+    const uint64_t* Ids() const { return ids.data(); }
+    const LiveSet& Live() const { return live; }
+
+    // Category names are interned once; rows only carry the id. The
+    // dictionary is saved with the snapshot, user-defined names included.
+    uint16_t InternCategory(std::string_view name) { return categories.Intern(name); }
+    bool FindCategory(std::string_view name, uint16_t& id) const { return categories.Find(name, id); }
+    std::string_view CategoryName(uint16_t id) const { return categories.Name(id); }
+    size_t CategoryCount() const { return categories.Size(); }
+
+    // Totals maintained on every mutation
+    const LedgerTotals& Totals() const { return totals; }
+
+    // Rows by date, maintained on every mutation
+    const DateIndex& Dates() const { return dates; }
+
+    // Amounts and row counts by day, month and year, type and category,
+    // maintained on every mutation and saved with the snapshot
+    const RollupCube& Rollups() const { return rollups; }
+
+    // Running balance by date, maintained on every mutation
+    const RunningBalance& Balances() const { return balances; }
+
+    // Balance after a live row, in the order of RunningBalance: the balance
+    // before its day plus its earlier rows on that day
+    Money BalanceAfter(size_t slot) const;
+
+    // Income and expense for the days first..last (inclusive)
+    PeriodTotals TotalsBetween(int32_t first, int32_t last) const {
+        return dates.Totals(first, last, types.data(), amounts.data());
+    }
+
+    // Recomputes the totals, the rollups, the balances and the indexes from
+    // scratch and compares them with the maintained ones. With verification
+    // on, every mutation does this and throws std::logic_error on a
+    // mismatch; meant for tests.
+    bool VerifyTotals() const;
+    void SetVerifyTotals(bool enabled) { verifyTotals = enabled; }
+
+    // Converts a parsed transactions.txt / journal row
+    Row MakeRow(const LedgerRow& row);
+
+    // Columns of a snapshot opened from a file stay in its mapping until
+    // the first write that changes them; bytes attached by the caller are
+    // copied
+    void LoadSnapshot(const SnapshotReader& snapshot);
+
+    // Copies any columns still in a snapshot's mapping into memory, so the
+    // file can be replaced
+    void OwnColumns();
+    std::string BuildSnapshot() const;
+
+    // A copy of the live rows and category names that stays fixed while the
+    // store keeps changing, for saving on another thread
+    struct Image {
+        TransactionColumns columns;
+        CategoryDictionary categories;
+        uint64_t nextId = 1;
+        std::string rollups;        // RollupCube::Serialize
+    };
+    Image CopyImage() const;
+
+    // Dropping dead slots, in two steps so the expensive one can run on
+    // another thread: PrepareCompaction only reads the store and must not
+    // overlap a mutation; InstallCompaction swaps the result in and fails
+    // if the store changed since.
+    struct Compaction {
+        TransactionColumns columns;
+        IdIndex index;
+        DateIndex dates;
+        uint64_t version = 0;
+    };
+    Compaction PrepareCompaction() const;
+    bool InstallCompaction(Compaction&& compaction);
+    void Compact();
+
+    // The rows as transactions.txt text
+    std::string BuildCsv() const;
+
+    // Bytes held by the columns, the category table and the indexes;
+    // columns still in a snapshot's mapping are the file's, not counted
+    size_t MemoryUsage() const;
+
+private:
+    MappedColumn<int64_t> amounts;
+    MappedColumn<uint8_t> types;
+    MappedColumn<uint16_t> categoryIds;
+    MappedColumn<int32_t> days;
+    MappedColumn<uint64_t> ids;
+
+    CategoryDictionary categories;
+
+    void CheckTotals() const;
+    void RebuildIndexes();
+    void RebuildRollups();
+    void Kill(size_t slot);
+
+    LiveSet live;
+    IdIndex index;
+    LedgerTotals totals;
+    DateIndex dates;
+    RollupCube rollups;
+    RunningBalance balances;
+    uint64_t nextId = 1;
+    uint64_t version = 0;
+    uint64_t layout = 0;
+    bool verifyTotals = false;
+};
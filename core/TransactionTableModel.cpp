@@ -0,0 +1,249 @@
+#include "TransactionTableModel.h"
+
+#include "Date.h"
+
+std::wstring Utf8ToWide(std::string_view text) {
+    std::wstring result;
+    result.reserve(text.size());
+
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        uint32_t code;
+        size_t extra;
+        if (c < 0x80) { code = c; extra = 0; }
+        else if ((c & 0xE0) == 0xC0) { code = c & 0x1F; extra = 1; }
+        else if ((c & 0xF0) == 0xE0) { code = c & 0x0F; extra = 2; }
+        else if ((c & 0xF8) == 0xF0) { code = c & 0x07; extra = 3; }
+        else { code = 0xFFFD; extra = 0; }
+
+        ++i;
+        for (size_t k = 0; k < extra; ++k, ++i) {
+            if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+                code = 0xFFFD;
+                break;
+            }
+            code = (code << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+        }
+
+        if (sizeof(wchar_t) == 2 && code >= 0x10000) {
+            code -= 0x10000;
+            result += static_cast<wchar_t>(0xD800 + (code >> 10));
+            result += static_cast<wchar_t>(0xDC00 + (code & 0x3FF));
+        } else {
+            result += static_cast<wchar_t>(code);
+        }
+    }
+    return result;
+}
+
+static size_t CopyText(const wchar_t* text, size_t length, wchar_t* out, size_t capacity) {
+    if (capacity == 0) return 0;
+    if (length >= capacity) length = capacity - 1;
+    for (size_t i = 0; i < length; ++i) out[i] = text[i];
+    out[length] = L'\0';
+    return length;
+}
+
+static size_t TextLength(const wchar_t* text) {
+    size_t length = 0;
+    while (text[length] != L'\0') ++length;
+    return length;
+}
+
+const std::wstring& TransactionTableModel::CategoryText(uint16_t id) {
+    // Category names are widened once per id
+    if (id >= categoryText.size()) {
+        size_t first = categoryText.size();
+        categoryText.resize(store.CategoryCount());
+        for (size_t i = first; i < categoryText.size(); ++i) {
+            categoryText[i] = Utf8ToWide(store.CategoryName(static_cast<uint16_t>(i)));
+            if (categoryText[i].empty()) categoryText[i] = L"N/A";
+        }
+    }
+    return categoryText[id];
+}
+
+void TransactionTableModel::FormatRow(size_t row, CachedRow& cached) const {
+    size_t slot = ShownSlot(row);
+    TransactionStore::Row data = store.Get(slot);
+    cached.amount[data.amount.Format(cached.amount)] = L'\0';
+    cached.balance[store.BalanceAfter(slot).Format(cached.balance)] = L'\0';
+
+    char date[16];
+    size_t length = FormatDate(data.day, date);
+    for (size_t i = 0; i < length; ++i) cached.date[i] = static_cast<wchar_t>(date[i]);
+    cached.date[length] = L'\0';
+    cached.valid = true;
+}
+
+size_t TransactionTableModel::CellText(size_t row, int column, wchar_t* out, size_t capacity) {
+    FollowLayout();
+    if (row >= ShownCount()) return CopyText(L"", 0, out, capacity);
+
+    switch (static_cast<TableColumn>(column)) {
+        case TableColumn::Index: {
+            wchar_t digits[24];
+            size_t count = 0;
+            size_t value = row + 1;
+            do {
+                digits[count++] = static_cast<wchar_t>(L'0' + value % 10);
+                value /= 10;
+            } while (value > 0);
+
+            wchar_t text[24];
+            for (size_t i = 0; i < count; ++i) text[i] = digits[count - 1 - i];
+            return CopyText(text, count, out, capacity);
+        }
+
+        case TableColumn::Type: {
+            const wchar_t* text = store.Get(SlotAt(row)).type == TransactionType::Income ? L"Income" : L"Expense";
+            return CopyText(text, TextLength(text), out, capacity);
+        }
+
+        case TableColumn::Category: {
+            const std::wstring& text = CategoryText(store.Get(SlotAt(row)).category);
+            return CopyText(text.c_str(), text.size(), out, capacity);
+        }
+
+        case TableColumn::Amount:
+        case TableColumn::Date:
+        case TableColumn::Balance: {
+            CachedRow local;
+            CachedRow* cached = &local;
+            if (row >= cacheFrom && row - cacheFrom < cache.size()) {
+                cached = &cache[row - cacheFrom];
+            } else {
+                local.valid = false;
+            }
+            if (!cached->valid) FormatRow(row, *cached);
+
+            const wchar_t* text = column == static_cast<int>(TableColumn::Amount) ? cached->amount
+                                : column == static_cast<int>(TableColumn::Date) ? cached->date : cached->balance;
+            return CopyText(text, TextLength(text), out, capacity);
+        }
+
+        default:
+            return CopyText(L"", 0, out, capacity);
+    }
+}
+
+void TransactionTableModel::CacheHint(size_t from, size_t to) {
+    FollowLayout();
+    if (to < from) return;
+    if (to - from + 1 > maxCachedRows) to = from + maxCachedRows - 1;
+    if (to >= RowCount()) {
+        if (from >= RowCount()) return;
+        to = RowCount() - 1;
+    }
+
+    // Keep rows that are still in the new window
+    std::vector<CachedRow> next(to - from + 1);
+    for (size_t row = from; row <= to; ++row) {
+        CachedRow& slot = next[row - from];
+        if (row >= cacheFrom && row - cacheFrom < cache.size() && cache[row - cacheFrom].valid) {
+            slot = cache[row - cacheFrom];
+        } else {
+            FormatRow(row, slot);
+        }
+    }
+    cache.swap(next);
+    cacheFrom = from;
+}
+
+void TransactionTableModel::InvalidateRow(size_t row) {
+    if (row >= cacheFrom && row - cacheFrom < cache.size()) {
+        cache[row - cacheFrom].valid = false;
+    }
+}
+
+void TransactionTableModel::FollowLayout() {
+    if (layout == store.Layout()) return;
+
+    // Every slot moved; the rows keep their order, so the table shows the
+    // same transactions once the permutation and the filter are rebuilt
+    layout = store.Layout();
+    for (auto& cached : cache) cached.valid = false;
+    sort.Sync(store);
+    if (filtering) {
+        search.Sync(store);
+        ApplyFilter();
+    }
+}
+
+void TransactionTableModel::Invalidate() {
+    layout = store.Layout();
+    for (auto& cached : cache) cached.valid = false;
+    categoryText.clear();
+    sort.Sync(store);
+    if (filtering) {
+        search.Sync(store);
+        ApplyFilter();
+    }
+}
+
+void TransactionTableModel::RowChanged(size_t slot) {
+    sort.Update(store, slot);
+    search.Update(store, slot);
+}
+
+void TransactionTableModel::SetFilter(const SearchQuery& query, const FilterProgram& expression) {
+    FollowLayout();
+    if (query.Empty() && expression.Empty()) {
+        ClearFilter();
+        return;
+    }
+    if (search.Built()) {
+        search.Sync(store);
+    } else if (!query.Empty()) {
+        search.Build(store);
+    }
+    filter = query;
+    this->expression = expression;
+    filtering = true;
+    ApplyFilter();
+}
+
+void TransactionTableModel::ClearFilter() {
+    filtering = false;
+    filtered.clear();
+    for (auto& cached : cache) cached.valid = false;
+}
+
+void TransactionTableModel::ApplyFilter() {
+    // An expression alone scans the columns and needs no index
+    RowSet rows;
+    if (filter.Empty()) {
+        rows = expression.Evaluate(store);
+    } else {
+        rows = search.Find(store, filter);
+        if (!expression.Empty()) rows.And(expression.Evaluate(store));
+    }
+    if (sort.Built()) {
+        filtered.clear();
+        filtered.reserve(rows.Count());
+        for (uint32_t slot : sort.Order()) {
+            if (rows.Test(slot)) filtered.push_back(slot);
+        }
+    } else {
+        filtered = rows.ToSlots();
+    }
+    for (auto& cached : cache) cached.valid = false;
+}
+
+void TransactionTableModel::SortBy(TableColumn column, bool descending) {
+    FollowLayout();
+    sortColumn = column;
+    switch (column) {
+        case TableColumn::Type: sort.Build(store, SortKey::Type, descending); break;
+        case TableColumn::Amount: sort.Build(store, SortKey::Amount, descending); break;
+        case TableColumn::Category: sort.Build(store, SortKey::Category, descending); break;
+        case TableColumn::Date:
+        case TableColumn::Balance: sort.Build(store, SortKey::Date, descending); break;
+        default:
+            sortColumn = TableColumn::Index;
+            sort.Clear();
+            break;
+    }
+    if (filtering) ApplyFilter();
+    for (auto& cached : cache) cached.valid = false;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+// Maps transaction table rows and columns to display text straight from the
+// TransactionStore, for a virtual (owner-data) list view. Text for the rows
+// the view reports as visible is formatted once and cached. Table rows are
+// positions among the live rows, in insertion order or sorted by a column;
+// deleted slots never show. A filter narrows them to the rows a SearchIndex
+// query and a compiled filter expression both return, keeping the order.
+// The Balance column is the running balance after each row in date order,
+// whatever order the table shows; it sorts as the Date column does.
+
+#include "FilterProgram.h"
+#include "SearchIndex.h"
+#include "SortPermutation.h"
+#include "TransactionStore.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum class TableColumn {
+    Index = 0,
+    Type,
+    Amount,
+    Category,
+    Date,
+    Balance,
+    Count
+};
+
+class TransactionTableModel {
+public:
+    explicit TransactionTableModel(const TransactionStore& store) : store(store), layout(store.Layout()) {}
+
+    // These follow a store relayout (load, row compaction) on their own,
+    // re-sorting and re-filtering the moved slots; other changes wait for
+    // Invalidate
+    size_t RowCount() {
+        FollowLayout();
+        return ShownCount();
+    }
+
+    // Store slot shown at a table row
+    size_t SlotAt(size_t row) {
+        FollowLayout();
+        return ShownSlot(row);
+    }
+
+    // Orders the rows by a column; TableColumn::Index restores insertion order
+    void SortBy(TableColumn column, bool descending);
+    TableColumn SortColumn() const { return sortColumn; }
+    bool SortDescending() const { return sort.Built() && sort.Descending(); }
+
+    // Shows only the rows matching query and expression; with both empty
+    // every row shows. The search index is built on first use and then kept
+    // in step with the store by Invalidate and RowChanged.
+    void SetFilter(const SearchQuery& query, const FilterProgram& expression = FilterProgram());
+    void ClearFilter();
+    bool Filtered() const { return filtering; }
+
+    // Copies the cell text into out (NUL-terminated, truncated to capacity)
+    // and returns its length
+    size_t CellText(size_t row, int column, wchar_t* out, size_t capacity);
+
+    // The view is about to ask for rows [from, to]
+    void CacheHint(size_t from, size_t to);
+
+    // Call after the store changes. Appends need no invalidation in
+    // insertion order; a sorted table picks them up in Invalidate.
+    void InvalidateRow(size_t row);
+    void Invalidate();
+
+    // Call after a row's values changed, before Invalidate, so a sorted
+    // table moves it and the search index re-indexes it
+    void RowChanged(size_t slot);
+
+    // Largest window the cache will hold
+    static constexpr size_t maxCachedRows = 1024;
+
+private:
+    struct CachedRow {
+        bool valid;
+        wchar_t amount[Money::maxFormattedLength + 1];
+        wchar_t date[16];
+        wchar_t balance[Money::maxFormattedLength + 1];
+    };
+
+    size_t ShownCount() const {
+        if (filtering) return filtered.size();
+        return sort.Built() ? sort.Size() : store.Size();
+    }
+    size_t ShownSlot(size_t row) const {
+        if (filtering) return filtered[row];
+        return sort.Built() ? sort.SlotAt(row) : store.SlotAt(row);
+    }
+
+    const std::wstring& CategoryText(uint16_t id);
+    void FormatRow(size_t row, CachedRow& cached) const;
+    void ApplyFilter();
+    void FollowLayout();
+
+    const TransactionStore& store;
+    SortPermutation sort;
+    TableColumn sortColumn = TableColumn::Index;
+
+    SearchIndex search;
+    SearchQuery filter;
+    FilterProgram expression;
+    bool filtering = false;
+    std::vector<uint32_t> filtered;    // slots in display order
+    uint64_t layout = 0;               // store layout they refer to
+
+    size_t cacheFrom = 0;
+    std::vector<CachedRow> cache;
+    std::vector<std::wstring> categoryText;
+};
+
+// UTF-8 category names to display text
+std::wstring Utf8ToWide(std::string_view text);
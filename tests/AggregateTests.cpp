@@ -0,0 +1,87 @@
+#include "Test.h"
+
+#include "core/Aggregate.h"
+
+#include <cstdio>
+#include <random>
+
+static const AggregateKernel kernels[] = { AggregateKernel::Scalar, AggregateKernel::Sse2, AggregateKernel::Avx2 };
+
+// Random columns with amounts up to 2^40 minor units either way, so the
+// 64-bit lanes carry high bits and negative values
+struct Columns {
+    std::vector<uint8_t> types;
+    std::vector<uint16_t> categories;
+    std::vector<int64_t> amounts;
+};
+
+static Columns RandomColumns(size_t rows, size_t categoryCount, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    Columns columns;
+    for (size_t i = 0; i < rows; ++i) {
+        columns.types.push_back(static_cast<uint8_t>(random() & 1));
+        columns.categories.push_back(static_cast<uint16_t>(random() % categoryCount));
+        columns.amounts.push_back(static_cast<int64_t>(random() % (uint64_t(1) << 41)) - (int64_t(1) << 40));
+    }
+    return columns;
+}
+
+FINSYNC_TEST(AggregateKernelsMatchScalarReference) {
+    const size_t categoryCount = 9;
+    Columns columns = RandomColumns(5000, categoryCount, 3);
+
+    // Lengths around the 8- and 16-row steps and the block size, from
+    // unaligned starts
+    for (size_t rows : { 0, 1, 7, 8, 15, 16, 17, 31, 2047, 2048, 2049, 4999 }) {
+        for (size_t offset : { 0, 1, 3 }) {
+            if (offset + rows > columns.amounts.size()) continue;
+            const uint8_t* types = columns.types.data() + offset;
+            const uint16_t* categories = columns.categories.data() + offset;
+            const int64_t* amounts = columns.amounts.data() + offset;
+
+            int64_t income = 0, expense = 0;
+            std::vector<int64_t> byCategory(categoryCount * 2, 0);
+            for (size_t i = 0; i < rows; ++i) {
+                (types[i] == 0 ? income : expense) += amounts[i];
+                byCategory[types[i] * categoryCount + categories[i]] += amounts[i];
+            }
+
+            for (AggregateKernel kernel : kernels) {
+                ColumnSums sums;
+                AggregateColumns(kernel, rows, types, categories, amounts, categoryCount, sums);
+                bool exact = sums.income == income && sums.expense == expense && sums.byCategory == byCategory;
+                if (!exact) std::fprintf(stderr, "  %s: %zu rows from %zu\n", AggregateKernelName(kernel), rows, offset);
+                CHECK(exact);
+
+                int64_t kernelIncome = -1, kernelExpense = -1;
+                SumIncomeExpense(kernel, rows, types, amounts, kernelIncome, kernelExpense);
+                CHECK(kernelIncome == income && kernelExpense == expense);
+            }
+        }
+    }
+}
+
+FINSYNC_TEST(AggregateMatchesMaintainedTotals) {
+    TransactionStore store;
+    FillStore(store, 20000);
+    std::vector<size_t> doomed;
+    for (size_t slot = 0; slot < store.SlotCount(); slot += 5) doomed.push_back(slot);
+    store.Erase(doomed);
+
+    for (AggregateKernel kernel : kernels) {
+        ColumnSums sums;
+        AggregateColumns(kernel, store.SlotCount(), store.Types(), store.Categories(), store.Amounts(),
+                         store.CategoryCount(), sums);
+        CHECK(sums.income == store.Totals().Income().Minor());
+        CHECK(sums.expense == store.Totals().Expense().Minor());
+        bool categoriesMatch = true;
+        for (size_t id = 0; id < store.CategoryCount(); ++id) {
+            for (TransactionType type : { TransactionType::Income, TransactionType::Expense }) {
+                categoriesMatch = categoriesMatch &&
+                                  sums.byCategory[static_cast<size_t>(type) * store.CategoryCount() + id] ==
+                                  store.Totals().Category(type, static_cast<uint16_t>(id)).Minor();
+            }
+        }
+        CHECK(categoriesMatch);
+    }
+}
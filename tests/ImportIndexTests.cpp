@@ -0,0 +1,64 @@
+#include "Test.h"
+
+#include "core/ImportIndex.h"
+
+#include <filesystem>
+
+static std::vector<ImportEntry> EntriesFor(const TransactionStore& store) {
+    std::vector<ImportEntry> entries;
+    for (uint32_t slot : LiveSlots(store)) {
+        std::string description = "ROW " + std::to_string(slot);
+        entries.push_back({ ImportIndex::Key(DescriptionHash(description), store.Amounts()[slot], store.Days()[slot]),
+                            store.Id(slot), store.Days()[slot] });
+    }
+    return entries;
+}
+
+static bool FindsRow(const ImportIndex& index, const TransactionStore& store, uint32_t slot) {
+    std::vector<ImportEntry> found;
+    index.Find(DescriptionHash("row " + std::to_string(slot)), store.Amounts()[slot], store.Days()[slot], 0, found);
+    return found.size() == 1 && found[0].id == store.Id(slot);
+}
+
+FINSYNC_TEST(ImportIndexFoldsAndReopens) {
+    TransactionStore store;
+    FillStore(store, 2000);
+    std::string path = ScratchPath("ledger.fsnap");
+    ImportIndex index;
+    index.Open(path);
+    CHECK(index.Add(EntriesFor(store), store));
+    CHECK(index.Size() == 2000 && index.LogSize() == 2000);
+    CHECK(index.Fold(store));
+    CHECK(index.Size() == 2000 && index.LogSize() == 0);
+
+    ImportIndex reopened;
+    CHECK(reopened.Open(path));
+    CHECK(reopened.Size() == 2000);
+    CHECK(FindsRow(reopened, store, 0) && FindsRow(reopened, store, 1999));
+}
+
+// A fold whose new base cannot be written keeps every entry, in memory and
+// in the log on disk
+FINSYNC_TEST(ImportIndexKeepsEntriesWhenFoldFails) {
+    TransactionStore store;
+    FillStore(store, 70000);
+    std::string path = ScratchPath("ledger.fsnap");
+    std::filesystem::create_directories(path + ".imported.tmp");
+
+    ImportIndex index;
+    index.Open(path);
+    std::vector<ImportEntry> entries = EntriesFor(store);
+    CHECK(!index.Add(entries, store));
+    CHECK(index.Size() == entries.size());
+    CHECK(FindsRow(index, store, 0) && FindsRow(index, store, 69999));
+
+    ImportIndex reopened;
+    CHECK(reopened.Open(path));
+    CHECK(reopened.Size() == entries.size());
+    CHECK(FindsRow(reopened, store, 12345));
+
+    std::filesystem::remove(path + ".imported.tmp");
+    CHECK(index.Fold(store));
+    CHECK(index.Size() == entries.size() && index.LogSize() == 0);
+    CHECK(FindsRow(index, store, 69999));
+}
@@ -0,0 +1,164 @@
+#include "Test.h"
+
+#include "core/Ledger.h"
+
+#include <filesystem>
+
+static void AddRows(Ledger& ledger, size_t count, int64_t amount) {
+    for (size_t i = 0; i < count; ++i) {
+        ledger.Add({ TransactionType::Expense, Money::FromMinor(amount + static_cast<int64_t>(i)),
+                     ledger.InternCategory("Food"), 19000 + static_cast<int32_t>(i) });
+    }
+}
+
+FINSYNC_TEST(LedgerReplaysJournalAfterReopen) {
+    std::string path = ScratchPath("ledger.fsnap");
+    std::vector<uint64_t> ids;
+    {
+        Ledger ledger(path);
+        ledger.Load();
+        for (int i = 0; i < 10; ++i) {
+            ids.push_back(ledger.Add({ TransactionType::Income, Money::FromMinor(100 * i), ledger.InternCategory("N/A"),
+                                       19000 + i }));
+        }
+        ledger.Update(ids[3], { TransactionType::Expense, Money::FromMinor(555), ledger.InternCategory("Rent"), 19003 });
+        ledger.Erase(ids[4]);
+        ledger.Close();
+    }
+
+    Ledger reloaded(path);
+    reloaded.Load();
+    const TransactionStore& store = reloaded.Transactions();
+    size_t slot;
+    CHECK(store.Size() == 9);
+    CHECK(!store.FindId(ids[4], slot));
+    CHECK(store.FindId(ids[3], slot) && store.Get(slot).amount == Money::FromMinor(555) &&
+          store.CategoryName(store.Get(slot).category) == "Rent");
+    CHECK(store.VerifyTotals());
+    reloaded.Close();
+}
+
+FINSYNC_TEST(LedgerImportsLegacyLedger) {
+    std::string legacy = ScratchPath("transactions.txt");
+    CHECK(WriteWholeFile(legacy, ReadWholeFile(FixturePath("legacy_transactions.txt"))));
+    Ledger ledger(ScratchPath("transactions.fsnap"));
+    LedgerLoadResult result = ledger.Load(legacy);
+    ledger.WaitForSave();
+    CHECK(result.imported && !result.fromSnapshot);
+    CHECK(ledger.Transactions().BuildCsv() == ReadWholeFile(FixturePath("legacy_transactions.txt.expected")));
+    ledger.Close();
+
+    Ledger reloaded(ScratchPath("transactions.fsnap"));
+    CHECK(reloaded.Load(legacy).fromSnapshot);
+    CHECK(reloaded.Transactions().Size() == 5);
+    reloaded.Close();
+}
+
+FINSYNC_TEST(LedgerMovesDamagedSnapshotAside) {
+    std::string path = ScratchPath("ledger.fsnap");
+    CHECK(WriteWholeFile(path, "FINSNAP\0garbage"));
+    Ledger ledger(path);
+    LedgerLoadResult result = ledger.Load();
+    CHECK(result.damaged);
+    CHECK(std::filesystem::exists(path + ".bad"));
+    ledger.Close();
+}
+
+FINSYNC_TEST(FailedCompactionKeepsRecords) {
+    std::string path = ScratchPath("failing.fsnap");
+    Journal journal(path);
+    journal.Open();
+    journal.LogRemove(1);
+    journal.LogRemove(2);
+    journal.Flush();
+
+    CHECK(journal.StartCompaction([](const std::string&) { return false; }));
+    journal.WaitForCompaction();
+    CHECK(journal.RecordCount() == 2);
+    CHECK(journal.LastCompactionFailed());
+
+    CHECK(journal.StartCompaction([](const std::string& tmp) { return WriteWholeFile(tmp, std::string()); }));
+    journal.WaitForCompaction();
+    CHECK(journal.RecordCount() == 0);
+    CHECK(!journal.LastCompactionFailed());
+    journal.Close();
+}
+
+FINSYNC_TEST(LedgerSavesAfterRowCompaction) {
+    std::string path = ScratchPath("ledger.fsnap");
+    Ledger ledger(path);
+    ledger.Load();
+    AddRows(ledger, 6000, 100);
+    std::vector<uint64_t> doomed;
+    for (size_t slot = 0; slot < 4000; ++slot) doomed.push_back(ledger.Transactions().Id(slot));
+    CHECK(ledger.Erase(doomed) == 4000);
+    CHECK(ledger.Save());
+    ledger.Close();
+
+    Ledger reloaded(path);
+    CHECK(reloaded.Load().fromSnapshot);
+    CHECK(reloaded.Transactions().Size() == 2000);
+    CHECK(reloaded.Transactions().VerifyTotals());
+    reloaded.Close();
+}
+
+// Ids are never handed out twice, even after every row is deleted and the
+// empty ledger is saved and reopened
+FINSYNC_TEST(LedgerKeepsNextIdWhenEmpty) {
+    std::string path = ScratchPath("ledger.fsnap");
+    uint64_t nextId;
+    {
+        Ledger ledger(path);
+        ledger.Load();
+        AddRows(ledger, 50, 100);
+        nextId = ledger.Transactions().NextId();
+        std::vector<uint64_t> everything;
+        for (uint32_t slot : LiveSlots(ledger.Transactions())) everything.push_back(ledger.Transactions().Id(slot));
+        CHECK(ledger.Erase(everything) == 50);
+        CHECK(ledger.Save());
+        ledger.WaitForSave();
+        ledger.Close();
+    }
+
+    Ledger reloaded(path);
+    CHECK(reloaded.Load().fromSnapshot);
+    CHECK(reloaded.Transactions().Size() == 0);
+    CHECK(reloaded.Transactions().NextId() == nextId);
+    CHECK(reloaded.Add({ TransactionType::Income, Money::FromMinor(1), reloaded.InternCategory("N/A"), 19000 }) == nextId);
+    reloaded.Close();
+}
+
+// A snapshot that cannot be renamed into place takes its checkpoint back,
+// so a later failed attempt cannot leave a checkpoint without its tmp file
+// and Recover keeps the journals for replay
+FINSYNC_TEST(FailedRenameDropsCheckpoint) {
+    std::string path = ScratchPath("blocked.fsnap");
+    std::filesystem::create_directories(path);
+    CHECK(WriteWholeFile(path + "/in-the-way", "x"));
+    {
+        Journal journal(path);
+        journal.Open();
+        journal.LogRemove(1);
+        journal.LogRemove(2);
+        journal.Flush();
+
+        CHECK(journal.StartCompaction([](const std::string& tmp) { return WriteWholeFile(tmp, "snapshot"); }));
+        journal.WaitForCompaction();
+        CHECK(journal.LastCompactionFailed());
+        CHECK(journal.RecordCount() == 2);
+        std::string rotated = ReadWholeFile(path + ".journal.1");
+        CHECK(!rotated.empty() && rotated.back() != 'C' && rotated.find("\nC\n") == std::string::npos);
+
+        CHECK(journal.StartCompaction([](const std::string&) { return false; }));
+        journal.WaitForCompaction();
+        CHECK(!std::filesystem::exists(path + ".tmp"));
+        journal.Close();
+    }
+
+    std::filesystem::remove_all(path);
+    Journal reopened(path);
+    reopened.Recover();
+    size_t replayed = 0;
+    reopened.Replay([&replayed](const JournalRecord&) { ++replayed; });
+    CHECK(replayed == 2);
+}
@@ -0,0 +1,51 @@
+#include "Test.h"
+
+#include "core/LedgerLoader.h"
+#include "core/ParallelLoader.h"
+
+#include <cstring>
+
+FINSYNC_TEST(LoaderReadsLegacyLedger) {
+    LedgerLoader loader;
+    CHECK(loader.Open(FixturePath("legacy_transactions.txt")));
+    TransactionStore store;
+    LedgerLoadStats stats = loader.ForEachRow([&](const LedgerRow& row) { store.Append(store.MakeRow(row)); });
+    CHECK(stats.rows == 5);
+    CHECK(stats.skipped == 2);
+    CHECK(store.BuildCsv() == ReadWholeFile(FixturePath("legacy_transactions.txt.expected")));
+}
+
+FINSYNC_TEST(LoaderCsvRoundTrip) {
+    TransactionStore store;
+    FillStore(store, 5000);
+    std::string csv = store.BuildCsv();
+
+    TransactionStore loaded;
+    ParseLedger(csv.data(), csv.size(), [&](const LedgerRow& row) { loaded.Append(loaded.MakeRow(row)); });
+    CHECK(loaded.BuildCsv() == csv);
+    CHECK(loaded.Totals().Income() == store.Totals().Income());
+    CHECK(loaded.Totals().Expense() == store.Totals().Expense());
+}
+
+FINSYNC_TEST(ParallelLoadMatchesSequential) {
+    TransactionStore store;
+    FillStore(store, 20000);
+    std::string csv = "\xEF\xBB\xBF" + store.BuildCsv() + "garbage line\nIncome,1,N/A,01/01/2024";
+
+    TransactionStore sequential;
+    LedgerLoadStats expected = ParseLedger(csv.data(), csv.size(), [&](const LedgerRow& row) {
+        sequential.Append(sequential.MakeRow(row));
+    });
+    for (unsigned threads : { 1u, 2u, 3u, 8u, 64u }) {
+        TransactionStore parallel;
+        LedgerLoadStats stats = ParallelLoad(csv.data(), csv.size(), parallel, threads);
+        CHECK(stats.rows == expected.rows);
+        CHECK(stats.skipped == expected.skipped);
+        CHECK(SameLiveRows(parallel, sequential));
+        CHECK(parallel.CategoryCount() == sequential.CategoryCount());
+        for (size_t id = 0; id < parallel.CategoryCount(); ++id) {
+            CHECK(parallel.CategoryName(static_cast<uint16_t>(id)) == sequential.CategoryName(static_cast<uint16_t>(id)));
+        }
+        CHECK(std::memcmp(parallel.Categories(), sequential.Categories(), parallel.SlotCount() * sizeof(uint16_t)) == 0);
+    }
+}
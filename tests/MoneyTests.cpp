@@ -0,0 +1,82 @@
+#include "Test.h"
+
+#include "core/Money.h"
+
+#include <limits>
+#include <string>
+
+static bool ParsesTo(const char* text, int64_t minor) {
+    Money money;
+    return Money::Parse(text, money) && money.Minor() == minor;
+}
+
+static bool Rejects(const char* text) {
+    Money money;
+    return !Money::Parse(text, money);
+}
+
+static std::string Formatted(int64_t minor) {
+    char text[Money::maxFormattedLength];
+    return std::string(text, Money::FromMinor(minor).Format(text));
+}
+
+static bool RoundTrips(int64_t minor) {
+    Money parsed;
+    return Money::Parse(Formatted(minor), parsed) && parsed.Minor() == minor;
+}
+
+FINSYNC_TEST(MoneyInt64Limits) {
+    const int64_t largest = std::numeric_limits<int64_t>::max();
+    const int64_t smallest = std::numeric_limits<int64_t>::min();
+    CHECK(ParsesTo("92233720368547758.07", largest));
+    CHECK(ParsesTo("-92233720368547758.08", smallest));
+    CHECK(Formatted(largest) == "92233720368547758.07");
+    CHECK(Formatted(smallest) == "-92233720368547758.08");
+    CHECK(RoundTrips(largest));
+    CHECK(RoundTrips(smallest));
+    CHECK(RoundTrips(0));
+    CHECK(RoundTrips(-1));
+    CHECK(RoundTrips(99));
+}
+
+FINSYNC_TEST(MoneyRejectsOverflow) {
+    CHECK(Rejects("92233720368547758.08"));
+    CHECK(Rejects("-92233720368547758.09"));
+    CHECK(Rejects("92233720368547758.075"));
+    CHECK(Rejects("100000000000000000000"));
+    CHECK(Rejects("1e17"));
+    CHECK(Rejects("1e100000"));
+}
+
+FINSYNC_TEST(MoneyNegativeZero) {
+    CHECK(ParsesTo("-0.00", 0));
+    CHECK(ParsesTo("-0", 0));
+    CHECK(ParsesTo("-0.004", 0));
+    Money zero;
+    CHECK(Money::Parse("-0.00", zero) && Formatted(zero.Minor()) == "0.00");
+    CHECK(Formatted(-1) == "-0.01");
+}
+
+FINSYNC_TEST(MoneyExponentAndMalformedInput) {
+    CHECK(ParsesTo("1.23457e+06", 123457000));
+    CHECK(ParsesTo("-2.5E-1", -25));
+    CHECK(ParsesTo("1e2", 10000));
+    CHECK(ParsesTo("12345678e-8", 12));
+    CHECK(Rejects("1e"));
+    CHECK(Rejects("e5"));
+    CHECK(Rejects("1.2.3"));
+    CHECK(Rejects("12abc"));
+    CHECK(Rejects(""));
+    CHECK(Rejects("-"));
+}
+
+FINSYNC_TEST(MoneyRoundsThirdDigit) {
+    CHECK(ParsesTo("0.125", 13));
+    CHECK(ParsesTo("-0.125", -13));
+    CHECK(ParsesTo("0.124", 12));
+    CHECK(ParsesTo("0.1249999", 12));
+    CHECK(ParsesTo("0.995", 100));
+    CHECK(ParsesTo("19.999", 2000));
+    CHECK(ParsesTo("  7.5  ", 750));
+    CHECK(ParsesTo("+3", 300));
+}
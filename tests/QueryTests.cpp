@@ -0,0 +1,117 @@
+#include "Test.h"
+
+#include "core/Date.h"
+#include "core/FilterProgram.h"
+#include "core/SearchIndex.h"
+#include "core/SortPermutation.h"
+
+#include <algorithm>
+
+static std::vector<SearchQuery> Queries() {
+    std::vector<SearchQuery> queries(5);
+    queries[0].text = "food";
+    queries[1].byAmount = true;
+    queries[1].minAmount = 10000;
+    queries[1].maxAmount = 20000;
+    queries[2].byDate = true;
+    queries[2].firstDay = DaysFromCivil(2024, 3, 1);
+    queries[2].lastDay = DaysFromCivil(2024, 3, 31);
+    queries[3] = queries[2];
+    queries[3].text = "food";
+    queries[3].byType = true;
+    queries[3].type = TransactionType::Expense;
+    queries[3].byAmount = true;
+    queries[3].minAmount = 50000;
+    queries[4].text = "trans";
+    queries[4].byType = true;
+    queries[4].type = TransactionType::Income;
+    return queries;
+}
+
+static void EditSome(TransactionStore& store, size_t count, std::vector<size_t>& touched) {
+    for (size_t i = 0; i < count; ++i) {
+        size_t slot = store.SlotAt((i * 7919) % store.Size());
+        TransactionStore::Row row = store.Get(slot);
+        row.amount = Money::FromMinor(static_cast<int64_t>(i) * 137 - 5000);
+        row.day += static_cast<int32_t>(i % 11);
+        store.Update(slot, row);
+        touched.push_back(slot);
+    }
+    store.Erase(std::vector<size_t>{ 3, 30, 300 });
+    store.Append(store.Get(store.SlotAt(0)));
+}
+
+FINSYNC_TEST(SortMatchesStdSort) {
+    TransactionStore store;
+    FillStore(store, 8000);
+    store.Erase(std::vector<size_t>{ 1, 10, 100 });
+    for (SortKey key : { SortKey::Type, SortKey::Amount, SortKey::Category, SortKey::Date }) {
+        SortPermutation permutation;
+        permutation.Build(store, key);
+        const std::vector<uint64_t>& keys = permutation.Keys();
+        std::vector<uint32_t> order = LiveSlots(store);
+        std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) {
+            return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+        });
+        CHECK(order == permutation.Order());
+    }
+}
+
+FINSYNC_TEST(SortFollowsEdits) {
+    TransactionStore store;
+    FillStore(store, 5000);
+    SortPermutation byAmount;
+    byAmount.Build(store, SortKey::Amount);
+
+    std::vector<size_t> touched;
+    EditSome(store, 200, touched);
+    byAmount.Sync(store);
+    for (size_t slot : touched) byAmount.Update(store, slot);
+
+    SortPermutation fresh;
+    fresh.Build(store, SortKey::Amount);
+    CHECK(byAmount.Order() == fresh.Order());
+}
+
+FINSYNC_TEST(SearchMatchesScan) {
+    TransactionStore store;
+    FillStore(store, 8000);
+    SearchIndex search;
+    search.Build(store);
+    for (const SearchQuery& query : Queries()) CHECK(search.Find(store, query).ToSlots() == ScanQuery(store, query));
+
+    std::vector<size_t> touched;
+    EditSome(store, 200, touched);
+    search.Sync(store);
+    for (size_t slot : touched) search.Update(store, slot);
+    for (const SearchQuery& query : Queries()) CHECK(search.Find(store, query).ToSlots() == ScanQuery(store, query));
+}
+
+FINSYNC_TEST(FilterMatchesRowByRow) {
+    TransactionStore store;
+    FillStore(store, 6000);
+    store.Erase(std::vector<size_t>{ 2, 20, 200 });
+    const char* expressions[] = {
+        "type=Expense and category in (Food,Transportation) and date>=01/01/2024 and amount>1000",
+        "not (category=Rent or type=Income) and (amount<=500 or date<01/06/2021)",
+        "category != \"Food\" and amount >= 0.01",
+    };
+    for (const char* text : expressions) {
+        FilterProgram program;
+        std::string error;
+        CHECK(FilterProgram::Compile(text, program, error));
+        std::vector<uint32_t> naive;
+        for (uint32_t slot : LiveSlots(store)) {
+            if (program.MatchesRow(store, slot)) naive.push_back(slot);
+        }
+        CHECK(program.Evaluate(store).ToSlots() == naive);
+    }
+}
+
+FINSYNC_TEST(FilterReportsErrors) {
+    FilterProgram program;
+    std::string error;
+    CHECK(!FilterProgram::Compile("amount >", program, error) && !error.empty());
+    CHECK(!FilterProgram::Compile("date>=31/02/2024", program, error));
+    CHECK(!FilterProgram::Compile("(type=Income", program, error));
+}
@@ -0,0 +1,164 @@
+#include "Test.h"
+
+#include "core/Date.h"
+#include "core/RollupCube.h"
+#include "core/RunningBalance.h"
+
+#include <algorithm>
+#include <map>
+
+static void Mutate(TransactionStore& store) {
+    for (size_t i = 0; i < 300; ++i) {
+        size_t slot = store.SlotAt((i * 104729) % store.Size());
+        TransactionStore::Row row = store.Get(slot);
+        row.day -= static_cast<int32_t>(400 + i);
+        row.amount += Money::FromMinor(7);
+        store.Update(slot, row);
+    }
+    std::vector<size_t> doomed;
+    for (size_t slot = 0; slot < store.SlotCount(); slot += 9) doomed.push_back(slot);
+    store.Erase(doomed);
+}
+
+FINSYNC_TEST(RollupsMatchRowsAfterChanges) {
+    TransactionStore store;
+    FillStore(store, 6000);
+    Mutate(store);
+
+    RollupCube rebuilt;
+    rebuilt.Build(store.SlotCount(), store.Days(), store.Types(), store.Categories(), store.Amounts(), &store.Live());
+    CHECK(rebuilt == store.Rollups());
+
+    // Every month's totals against summing its rows
+    for (int year = 2019; year <= 2025; ++year) {
+        for (unsigned month = 1; month <= 12; ++month) {
+            int64_t sums[2] = { 0, 0 };
+            for (uint32_t slot : LiveSlots(store)) {
+                int rowYear;
+                unsigned rowMonth, day;
+                if (store.Days()[slot] == kNoDate) continue;
+                CivilFromDays(store.Days()[slot], rowYear, rowMonth, day);
+                if (rowYear == year && rowMonth == month) sums[store.Types()[slot]] += store.Amounts()[slot];
+            }
+            for (size_t type = 0; type < 2; ++type) {
+                CHECK(store.Rollups().Total(RollupLevel::Month, RollupCube::MonthPeriod(year, month),
+                                            static_cast<TransactionType>(type)).amount == sums[type]);
+            }
+        }
+    }
+    CHECK(store.VerifyTotals());
+}
+
+FINSYNC_TEST(RollupsSerializeRoundTrip) {
+    TransactionStore store;
+    FillStore(store, 4000);
+    RollupCube loaded;
+    CHECK(loaded.Load(store.Rollups().Serialize(), store.CategoryCount()));
+    CHECK(loaded == store.Rollups());
+
+    RollupCube rejected;
+    CHECK(!rejected.Load(store.Rollups().Serialize(), 1));
+    CHECK(!rejected.Load("short", store.CategoryCount()));
+}
+
+FINSYNC_TEST(RunningBalanceMatchesPrefixSum) {
+    TransactionStore store;
+    FillStore(store, 5000);
+    Mutate(store);
+
+    // Rows in date order, ties in slot order, as the Balance column shows
+    std::vector<int64_t> expected(store.SlotCount(), 0);
+    int32_t first, last;
+    CHECK(store.Dates().DayRange(first, last));
+    int64_t balance = 0;
+    store.Dates().ForEachInRange(kNoDate, last, [&](size_t slot, int32_t) {
+        balance += store.Types()[slot] == static_cast<uint8_t>(TransactionType::Income) ? store.Amounts()[slot]
+                                                                                      : -store.Amounts()[slot];
+        expected[slot] = balance;
+    });
+    for (uint32_t slot : LiveSlots(store)) CHECK(store.BalanceAfter(slot).Minor() == expected[slot]);
+    CHECK(store.Balances().Total() == store.Totals().Net());
+
+    RunningBalance rebuilt;
+    rebuilt.Build(store.SlotCount(), store.Days(), store.Types(), store.Amounts(), &store.Live());
+    CHECK(rebuilt == store.Balances());
+}
+
+FINSYNC_TEST(RunningBalanceAddsDaysInAnyOrder) {
+    // Days spread far wider than the rows, added out of order
+    const int32_t dayList[] = { 20000, 500, 90000, 20000, -40000, 150000, 90001, 499, 150000 };
+    const size_t count = sizeof(dayList) / sizeof(dayList[0]);
+    std::vector<uint8_t> types(count);
+    std::vector<int64_t> amounts(count);
+    RunningBalance balance;
+    for (size_t i = 0; i < count; ++i) {
+        types[i] = static_cast<uint8_t>(i % 3 == 0 ? TransactionType::Expense : TransactionType::Income);
+        amounts[i] = 100 * static_cast<int64_t>(i + 1);
+        balance.Add(dayList[i], static_cast<TransactionType>(types[i]), Money::FromMinor(amounts[i]));
+    }
+
+    for (int32_t day : { -50000, -40000, 0, 499, 500, 20000, 89999, 90000, 90001, 150000, 200000 }) {
+        int64_t expected = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (dayList[i] <= day) expected += i % 3 == 0 ? -amounts[i] : amounts[i];
+        }
+        CHECK(balance.AsOf(day).Minor() == expected);
+    }
+
+    RunningBalance rebuilt;
+    rebuilt.Build(count, dayList, types.data(), amounts.data());
+    CHECK(rebuilt == balance);
+    CHECK(rebuilt.Total() == balance.Total());
+
+    // A day whose rows all went compares as no day at all
+    balance.Remove(dayList[4], static_cast<TransactionType>(types[4]), Money::FromMinor(amounts[4]));
+    std::vector<int32_t> keptDays(dayList, dayList + count);
+    keptDays.erase(keptDays.begin() + 4);
+    types.erase(types.begin() + 4);
+    amounts.erase(amounts.begin() + 4);
+    rebuilt.Build(count - 1, keptDays.data(), types.data(), amounts.data());
+    CHECK(rebuilt == balance);
+    CHECK(balance.AsOf(-40000).Minor() == 0);
+}
+
+FINSYNC_TEST(RollupWeeksStartOnMonday) {
+    CHECK(RollupCube::WeekPeriod(DaysFromCivil(2024, 1, 1)) == DaysFromCivil(2024, 1, 1));
+    CHECK(RollupCube::WeekPeriod(DaysFromCivil(2024, 1, 7)) == DaysFromCivil(2024, 1, 1));
+    CHECK(RollupCube::WeekPeriod(DaysFromCivil(2024, 1, 8)) == DaysFromCivil(2024, 1, 8));
+    CHECK(RollupCube::WeekPeriod(DaysFromCivil(2023, 1, 1)) == DaysFromCivil(2022, 12, 26));
+    CHECK(RollupCube::WeekPeriod(DaysFromCivil(1970, 1, 1)) == DaysFromCivil(1969, 12, 29));
+    CHECK(RollupCube::WeekPeriod(DaysFromCivil(1969, 12, 28)) == DaysFromCivil(1969, 12, 22));
+    CHECK(RollupCube::PeriodOf(RollupLevel::Week, DaysFromCivil(2025, 3, 13)) == DaysFromCivil(2025, 3, 10));
+}
+
+FINSYNC_TEST(RollupWeeksMatchRows) {
+    TransactionStore store;
+    FillStore(store, 6000);
+    Mutate(store);
+
+    std::map<int32_t, int64_t> sums[2];
+    for (uint32_t slot : LiveSlots(store)) {
+        if (store.Days()[slot] == kNoDate) continue;
+        sums[store.Types()[slot]][RollupCube::WeekPeriod(store.Days()[slot])] += store.Amounts()[slot];
+    }
+    size_t cells = 0;
+    bool match = true;
+    for (size_t type = 0; type < 2; ++type) {
+        for (const auto& [monday, amount] : sums[type]) {
+            match = match && store.Rollups().Total(RollupLevel::Week, monday, static_cast<TransactionType>(type)).amount == amount;
+        }
+    }
+    store.Rollups().ForEachCell(RollupLevel::Week, INT32_MIN, INT32_MAX,
+                                [&](int32_t monday, TransactionType, uint16_t, const RollupCell&) {
+        match = match && RollupCube::WeekPeriod(monday) == monday;
+        ++cells;
+    });
+    CHECK(match);
+    CHECK(cells > 0);
+    CHECK(store.Rollups().PeriodCount(RollupLevel::Week) >= std::max(sums[0].size(), sums[1].size()));
+
+    // Weeks come back from the saved day cells
+    RollupCube loaded;
+    CHECK(loaded.Load(store.Rollups().Serialize(), store.CategoryCount()));
+    CHECK(loaded == store.Rollups());
+}
@@ -0,0 +1,169 @@
+#include "Test.h"
+
+#include "core/Snapshot.h"
+
+FINSYNC_TEST(SnapshotRoundTrip) {
+    TransactionStore store;
+    FillStore(store, 3000);
+    store.Erase(std::vector<size_t>{ 5, 6, 700 });
+    std::string path = ScratchPath("ledger.fsnap");
+    CHECK(WriteWholeFile(path, store.BuildSnapshot()));
+
+    SnapshotReader reader;
+    CHECK(reader.Open(path));
+    CHECK(reader.Rows() == store.Size());
+    CHECK(!reader.Rollups().empty());
+    TransactionStore loaded;
+    loaded.LoadSnapshot(reader);
+    CHECK(SameLiveRows(loaded, store));
+    CHECK(loaded.NextId() == store.NextId());
+    CHECK(loaded.Rollups() == store.Rollups());
+    CHECK(loaded.Balances() == store.Balances());
+    CHECK(loaded.VerifyTotals());
+}
+
+FINSYNC_TEST(SnapshotFileWriterMatchesBuilder) {
+    TransactionStore store;
+    FillStore(store, 2000);
+    TransactionStore::Image image = store.CopyImage();
+    const TransactionColumns& columns = image.columns;
+    std::string path = ScratchPath("streamed.fsnap");
+    CHECK(WriteSnapshotFile(path, columns.Size(), columns.types.data(), columns.amounts.data(),
+                            columns.categories.data(), columns.days.data(), columns.ids.data(), image.nextId,
+                            image.categories, image.rollups));
+
+    // The streamed file orders its blocks differently; the rows must agree
+    SnapshotReader reader;
+    CHECK(reader.Open(path));
+    TransactionStore loaded;
+    loaded.LoadSnapshot(reader);
+    CHECK(SameLiveRows(loaded, store));
+    CHECK(loaded.NextId() == store.NextId());
+    CHECK(loaded.Rollups() == store.Rollups());
+}
+
+FINSYNC_TEST(SnapshotKeepsNextIdWithNoRows) {
+    TransactionStore store;
+    FillStore(store, 20);
+    std::vector<uint32_t> live = LiveSlots(store);
+    std::vector<size_t> everything(live.begin(), live.end());
+    store.Erase(everything);
+    CHECK(store.InstallCompaction(store.PrepareCompaction()));
+    CHECK(store.SlotCount() == 0);
+
+    std::string built = ScratchPath("built.fsnap");
+    std::string streamed = ScratchPath("streamed.fsnap");
+    CHECK(WriteWholeFile(built, store.BuildSnapshot()));
+    TransactionStore::Image image = store.CopyImage();
+    CHECK(WriteSnapshotFile(streamed, 0, nullptr, nullptr, nullptr, nullptr, nullptr, image.nextId, image.categories,
+                            image.rollups));
+    for (const std::string& path : { built, streamed }) {
+        SnapshotReader reader;
+        CHECK(reader.Open(path));
+        CHECK(reader.Rows() == 0 && reader.NextId() == store.NextId());
+        TransactionStore loaded;
+        loaded.LoadSnapshot(reader);
+        CHECK(loaded.NextId() == store.NextId());
+    }
+}
+
+FINSYNC_TEST(SnapshotRejectsDamage) {
+    TransactionStore store;
+    FillStore(store, 1000);
+    std::string bytes = store.BuildSnapshot();
+    std::string path = ScratchPath("damaged.fsnap");
+
+    // A flipped payload byte gets past the header and directory checks; the
+    // block checksums catch it
+    std::string flipped = bytes;
+    flipped[flipped.size() / 2] ^= 0x40;
+    CHECK(WriteWholeFile(path, flipped));
+    SnapshotReader reader;
+    CHECK(!reader.Open(path, true));
+    CHECK(!reader.Open(path) || !reader.VerifyChecksums());
+
+    CHECK(WriteWholeFile(path, bytes.substr(0, bytes.size() - 9)));
+    CHECK(!reader.Open(path));
+}
+
+FINSYNC_TEST(SnapshotChecksRowValuesWithoutChecksums) {
+    TransactionStore store;
+    FillStore(store, 500);
+    std::string bytes = store.BuildSnapshot();
+    std::string path = ScratchPath("values.fsnap");
+
+    SnapshotReader reader;
+    CHECK(reader.Attach(bytes.data(), bytes.size()));
+    size_t amountAt = reinterpret_cast<const char*>(reader.AmountColumn()) - bytes.data();
+    size_t categoryAt = reinterpret_cast<const char*>(reader.CategoryColumn()) - bytes.data();
+
+    // An amount is only caught by its block's checksum
+    std::string damaged = bytes;
+    damaged[amountAt + 3] ^= 0x10;
+    CHECK(WriteWholeFile(path, damaged));
+    CHECK(reader.Open(path));
+    CHECK(!reader.VerifyChecksums());
+    CHECK(!reader.Open(path, true));
+
+    // A category id out of the dictionary is refused either way
+    damaged = bytes;
+    damaged[categoryAt + 1] = '\x7f';
+    CHECK(WriteWholeFile(path, damaged));
+    CHECK(!reader.Open(path));
+
+    CHECK(WriteWholeFile(path, bytes));
+    CHECK(reader.Open(path));
+    CHECK(reader.VerifyChecksums());
+}
+
+FINSYNC_TEST(SnapshotColumnsStayMappedUntilWritten) {
+    TransactionStore store;
+    FillStore(store, 3000);
+    std::string path = ScratchPath("mapped.fsnap");
+    CHECK(WriteWholeFile(path, store.BuildSnapshot()));
+
+    TransactionStore loaded;
+    const int64_t* mappedAmounts;
+    const uint8_t* mappedTypes;
+    {
+        SnapshotReader reader;
+        CHECK(reader.Open(path));
+        loaded.LoadSnapshot(reader);
+        mappedAmounts = reader.AmountColumn();
+        mappedTypes = reader.TypeColumn();
+        CHECK(loaded.Amounts() == mappedAmounts && loaded.Types() == mappedTypes);
+        CHECK(loaded.Days() == reader.DateColumn() && loaded.Ids() == reader.IdColumn());
+    }
+
+    // The columns outlive the reader, and are not counted as the store's
+    CHECK(SameLiveRows(loaded, store));
+    CHECK(loaded.MemoryUsage() < store.MemoryUsage() - store.SlotCount() * 20);
+
+    // Writing a value that is already there copies nothing
+    size_t slot = loaded.SlotAt(10);
+    TransactionStore::Row row = loaded.Get(slot);
+    loaded.Update(slot, row);
+    CHECK(loaded.Amounts() == mappedAmounts);
+
+    // A new amount copies the amount column alone
+    row.amount += Money::FromMinor(250);
+    loaded.Update(slot, row);
+    CHECK(loaded.Amounts() != mappedAmounts && loaded.Types() == mappedTypes);
+    CHECK(loaded.Get(slot).amount == row.amount);
+    CHECK(loaded.VerifyTotals());
+
+    loaded.Erase(loaded.SlotAt(20));
+    loaded.Append(row);
+    CHECK(loaded.Types() != mappedTypes);
+    CHECK(loaded.Size() == store.Size());
+    CHECK(loaded.VerifyTotals());
+
+    // Bytes the caller owns are copied, since the store cannot keep them
+    std::string bytes = store.BuildSnapshot();
+    SnapshotReader attached;
+    CHECK(attached.Attach(bytes.data(), bytes.size()));
+    TransactionStore copied;
+    copied.LoadSnapshot(attached);
+    CHECK(copied.Amounts() != attached.AmountColumn());
+    CHECK(SameLiveRows(copied, store));
+}
@@ -0,0 +1,154 @@
+#include "Test.h"
+
+#include "core/CategoryRules.h"
+#include "core/Date.h"
+#include "core/StatementImport.h"
+
+#include <cstdio>
+#include <random>
+
+static const char* statementFixtures[] = { "header.csv", "debit_credit.csv", "ledger.csv", "sgml.ofx", "accounts.qif" };
+
+FINSYNC_TEST(StatementFixturesImport) {
+    for (const char* name : statementFixtures) {
+        std::string path = FixturePath(name);
+        StatementOptions options;
+        CHECK(DetectStatementFormat(path, options.format));
+        options.dates = UsualDateOrder(options.format);
+
+        Ledger ledger(ScratchPath(std::string(name) + ".fsnap"));
+        ledger.Load();
+        StatementStats stats;
+        bool imported = ImportStatement(ledger, path, options, stats);
+        if (!imported) std::fprintf(stderr, "  %s: %s\n", name, stats.error.c_str());
+        CHECK(imported);
+        bool matches = ledger.Transactions().BuildCsv() == ReadWholeFile(path + ".expected");
+        if (!matches) std::fprintf(stderr, "  %s: rows differ from %s.expected\n", name, name);
+        CHECK(matches);
+        ledger.Close();
+    }
+}
+
+FINSYNC_TEST(StatementFormatsDetected) {
+    StatementFormat format;
+    CHECK(DetectStatementFormat(FixturePath("sgml.ofx"), format) && format == StatementFormat::Ofx);
+    CHECK(DetectStatementFormat(FixturePath("accounts.qif"), format) && format == StatementFormat::Qif);
+    CHECK(DetectStatementFormat(FixturePath("header.csv"), format) && format == StatementFormat::Csv);
+    CHECK(!DetectStatementFormat(ScratchPath("missing.csv"), format));
+}
+
+FINSYNC_TEST(StatementDatesAndAmounts) {
+    int32_t day;
+    CHECK(ParseStatementDate("05-Jan-2024", DateOrder::DayMonthYear, day) && day == DaysFromCivil(2024, 1, 5));
+    CHECK(ParseStatementDate("Jan 5, 2024", DateOrder::DayMonthYear, day) && day == DaysFromCivil(2024, 1, 5));
+    CHECK(ParseStatementDate("1/ 5'24", DateOrder::MonthDayYear, day) && day == DaysFromCivil(2024, 1, 5));
+    CHECK(ParseStatementDate("20240105120000[-5:EST]", DateOrder::DayMonthYear, day) && day == DaysFromCivil(2024, 1, 5));
+    CHECK(!ParseStatementDate("31/02/2024", DateOrder::DayMonthYear, day));
+
+    int64_t minor;
+    CHECK(ParseStatementAmount("1,234.56", minor) && minor == 123456);
+    CHECK(ParseStatementAmount("(45.00)", minor) && minor == -4500);
+    CHECK(ParseStatementAmount("45.00-", minor) && minor == -4500);
+    CHECK(ParseStatementAmount("PHP 1 234.50", minor) && minor == 123450);
+    CHECK(ParseStatementAmount("12,50", minor) && minor == 1250);
+    CHECK(!ParseStatementAmount("abc", minor));
+}
+
+FINSYNC_TEST(StatementReimportAddsOnlyNewRows) {
+    std::string path = ScratchPath("dedup.fsnap");
+    int32_t day = DaysFromCivil(2024, 5, 1);
+    std::vector<StatementRow> first = {
+        { day, -24550, "JOLLIBEE SM NORTH", "" },
+        { day, -24550, "JOLLIBEE SM NORTH", "" },
+        { day + 1, 2500000, "SALARY", "" },
+        { day + 2, -99900, "MERALCO BILL", "Utilities" },
+    };
+    {
+        Ledger ledger(path);
+        ledger.Load();
+        StatementImport import(ledger);
+        import.Add(first);
+        CHECK(import.Commit() == 4);
+        ledger.Close();
+    }
+
+    // The same rows again, one posted two days later, plus a new one
+    std::vector<StatementRow> second = first;
+    second[2].day += 2;
+    second.push_back({ day + 5, -5000, "GRAB RIDE", "" });
+    Ledger ledger(path);
+    ledger.Load();
+    StatementImport import(ledger);
+    import.Add(second);
+    CHECK(import.Commit() == 1);
+    CHECK(import.Duplicates() == 4);
+    CHECK(ledger.Transactions().Size() == 5);
+
+    // A deleted row is no longer a duplicate
+    ledger.Erase(ledger.Transactions().Id(ledger.Transactions().SlotAt(0)));
+    StatementImport afterDelete(ledger);
+    afterDelete.Add(first);
+    CHECK(afterDelete.Commit() == 1);
+    ledger.Close();
+}
+
+FINSYNC_TEST(RulesCategorizeImportedRows) {
+    CategoryRules rules;
+    std::string error;
+    CHECK(CategoryRules::Load(FixturePath("rules.txt"), rules, error));
+    CHECK(rules.Size() == 5);
+
+    int32_t day = DaysFromCivil(2024, 5, 15);
+    std::vector<StatementRow> rows = {
+        { day, -24550, "POS JOLLIBEE MANILA", "" },
+        { day, -30000, "GRAB RIDE", "" },
+        { day, -80000, "GRAB RIDE", "" },
+        { day, -99900, "MERALCO BILL PAYMENT", "" },
+        { day, -99900, "MERALCO", "" },
+        { day, -150000, "LANDLORD", "" },
+        { day, -150000, "JOLLIBEE", "Entertainment" },
+    };
+    const char* expected[] = { "Food", "Transportation", "Other", "Utilities", "Other", "Rent", "Entertainment" };
+
+    Ledger ledger(ScratchPath("rules.fsnap"));
+    ledger.Load();
+    StatementOptions options;
+    options.rules = &rules;
+    StatementImport import(ledger, options);
+    import.Add(rows);
+    CHECK(import.Commit() == rows.size());
+    const TransactionStore& store = ledger.Transactions();
+    for (size_t i = 0; i < rows.size(); ++i) {
+        CHECK(store.CategoryName(store.Get(store.SlotAt(i)).category) == expected[i]);
+    }
+    ledger.Close();
+
+    CategoryRules broken;
+    CHECK(!CategoryRules::Compile("description contains -> Food", broken, error) && !error.empty());
+}
+
+FINSYNC_TEST(RulesMatchRuleByRule) {
+    std::mt19937_64 random(7);
+    std::vector<std::string> words;
+    std::string text;
+    for (size_t i = 0; i < 500; ++i) {
+        std::string word;
+        for (size_t length = 3 + random() % 5; word.size() < length;) word += static_cast<char>('A' + random() % 26);
+        words.push_back(word);
+        text += i % 5 == 4 ? "type=Expense and description contains " + word + " and amount<500 -> Food\n"
+                           : "description contains " + word + " -> Other\n";
+    }
+    CategoryRules rules;
+    std::string error;
+    CHECK(CategoryRules::Compile(text, rules, error));
+
+    CategoryRules::Scratch scratch;
+    for (size_t i = 0; i < 3000; ++i) {
+        std::string description = "POS " + words[random() % words.size()] + " " + words[random() % words.size()] +
+                                  " #" + std::to_string(random() % 1000);
+        TransactionType type = i % 3 == 0 ? TransactionType::Income : TransactionType::Expense;
+        int64_t amount = static_cast<int64_t>(random() % 1000);
+        int32_t day = 19000 + static_cast<int32_t>(i);
+        CHECK(rules.Match(description, type, amount, day, scratch) == rules.MatchRuleByRule(description, type, amount, day));
+    }
+}
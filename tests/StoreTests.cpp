@@ -0,0 +1,131 @@
+#include "Test.h"
+
+#include "core/Aggregate.h"
+#include "core/Date.h"
+
+#include <vector>
+
+FINSYNC_TEST(StoreTotalsFollowMutations) {
+    TransactionStore store;
+    store.SetVerifyTotals(true);
+    FillStore(store, 3000);
+    CHECK(store.VerifyTotals());
+
+    for (size_t i = 0; i < 200; ++i) {
+        size_t slot = store.SlotAt((i * 7919) % store.Size());
+        TransactionStore::Row row = store.Get(slot);
+        row.amount += Money::FromMinor(101);
+        row.day -= static_cast<int32_t>(i % 40);
+        store.Update(slot, row);
+    }
+    std::vector<size_t> doomed;
+    for (size_t slot = 0; slot < store.SlotCount(); slot += 7) doomed.push_back(slot);
+    size_t before = store.Size();
+    size_t removed = store.Erase(doomed);
+    CHECK(removed == doomed.size());
+    CHECK(store.Size() == before - removed);
+    CHECK(store.VerifyTotals());
+
+    ColumnSums sums;
+    AggregateColumns(store.SlotCount(), store.Types(), store.Categories(), store.Amounts(), store.CategoryCount(), sums);
+    CHECK(sums.income == store.Totals().Income().Minor());
+    CHECK(sums.expense == store.Totals().Expense().Minor());
+}
+
+FINSYNC_TEST(StoreIgnoresDeadAndOutOfRangeSlots) {
+    TransactionStore store;
+    FillStore(store, 500);
+    size_t slot = 17;
+    store.Erase(slot);
+    LedgerTotals before = store.Totals();
+    size_t size = store.Size();
+
+    TransactionStore::Row row = store.Get(slot);
+    row.amount = Money::FromMinor(99999);
+    store.Update(slot, row);
+    store.Erase(slot);
+    store.Update(store.SlotCount(), row);
+    store.Erase(store.SlotCount());
+    CHECK(store.Erase(std::vector<size_t>{ slot, store.SlotCount() + 5 }) == 0);
+
+    CHECK(!store.IsLive(slot));
+    CHECK(store.Amounts()[slot] == 0);
+    CHECK(store.Totals() == before);
+    CHECK(store.Size() == size);
+    CHECK(store.VerifyTotals());
+}
+
+FINSYNC_TEST(StoreCompactionKeepsIdsAndOrder) {
+    TransactionStore store;
+    FillStore(store, 4000);
+    std::vector<size_t> doomed;
+    for (size_t slot = 0; slot < store.SlotCount(); slot += 3) doomed.push_back(slot);
+    store.Erase(doomed);
+
+    TransactionStore::Image expected = store.CopyImage();
+    uint64_t layout = store.Layout();
+    CHECK(store.InstallCompaction(store.PrepareCompaction()));
+    CHECK(store.Layout() != layout);
+    CHECK(store.DeadCount() == 0);
+    CHECK(store.SlotCount() == expected.columns.Size());
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        size_t found;
+        CHECK(store.Id(slot) == expected.columns.ids[slot]);
+        CHECK(store.FindId(expected.columns.ids[slot], found) && found == slot);
+        CHECK(store.Amounts()[slot] == expected.columns.amounts[slot]);
+    }
+    CHECK(store.VerifyTotals());
+}
+
+FINSYNC_TEST(StoreCompactionFailsAfterChange) {
+    TransactionStore store;
+    FillStore(store, 100);
+    store.Erase(std::vector<size_t>{ 1, 2, 3 });
+    TransactionStore::Compaction compaction = store.PrepareCompaction();
+    store.Append(store.Get(0));
+    CHECK(!store.InstallCompaction(std::move(compaction)));
+    CHECK(store.DeadCount() == 3);
+}
+
+FINSYNC_TEST(StoreBulkAppendMatchesRowByRow) {
+    TransactionStore generated;
+    FillStore(generated, 5000);
+
+    TransactionStore bulk, single;
+    TransactionColumns columns;
+    for (size_t slot = 0; slot < generated.SlotCount(); ++slot) {
+        TransactionStore::Row row = generated.Get(slot);
+        uint16_t category = bulk.InternCategory(generated.CategoryName(row.category));
+        single.InternCategory(generated.CategoryName(row.category));
+        columns.types.push_back(static_cast<uint8_t>(row.type));
+        columns.amounts.push_back(row.amount.Minor());
+        columns.categories.push_back(category);
+        columns.days.push_back(row.day);
+        single.Append(TransactionStore::Row{ row.type, row.amount, category, row.day });
+    }
+    bulk.AppendColumns(std::move(columns));
+    CHECK(SameLiveRows(bulk, single));
+    CHECK(bulk.Totals() == single.Totals());
+    CHECK(bulk.Rollups() == single.Rollups());
+    CHECK(bulk.Balances() == single.Balances());
+    CHECK(bulk.VerifyTotals());
+}
+
+FINSYNC_TEST(StoreMemorySizedToRows) {
+    // A row of wstrings cost over 200 bytes; the store stays well under
+    TransactionStore store;
+    FillStore(store, 1000);
+    CHECK(store.MemoryUsage() < 150 * store.Size());
+
+    // Dates a century apart cost nothing for the days between them
+    TransactionStore sparse;
+    uint16_t category = sparse.InternCategory("Rent");
+    sparse.Append(TransactionStore::Row{ TransactionType::Expense, Money::FromMinor(500), category,
+                                         DaysFromCivil(1925, 6, 1) });
+    sparse.Append(TransactionStore::Row{ TransactionType::Income, Money::FromMinor(900), category,
+                                         DaysFromCivil(2025, 6, 1) });
+    CHECK(sparse.Balances().MemoryUsage() < 64);
+    CHECK(sparse.Rollups().MemoryUsage() < 1024);
+    CHECK(sparse.Balances().AsOf(DaysFromCivil(2000, 1, 1)).Minor() == -500);
+    CHECK(sparse.Balances().Total().Minor() == 400);
+}
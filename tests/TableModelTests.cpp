@@ -0,0 +1,148 @@
+#include "Test.h"
+
+#include "core/Date.h"
+#include "core/TransactionTableModel.h"
+
+#include <algorithm>
+
+// The table shows the given slots in order, every cell as formatted
+// straight from the store
+static bool TableShows(TransactionTableModel& model, const TransactionStore& store,
+                       const std::vector<uint32_t>& slots) {
+    if (model.RowCount() != slots.size()) return false;
+    for (size_t row = 0; row < slots.size(); ++row) {
+        size_t slot = slots[row];
+        if (model.SlotAt(row) != slot) return false;
+
+        TransactionStore::Row data = store.Get(slot);
+        wchar_t amount[Money::maxFormattedLength + 1], balance[Money::maxFormattedLength + 1];
+        amount[data.amount.Format(amount)] = L'\0';
+        balance[store.BalanceAfter(slot).Format(balance)] = L'\0';
+        char date[16];
+        std::string dateText(date, FormatDate(data.day, date));
+        std::wstring category = Utf8ToWide(store.CategoryName(data.category));
+
+        const std::wstring expected[] = {
+            std::to_wstring(row + 1),
+            data.type == TransactionType::Income ? L"Income" : L"Expense",
+            amount,
+            category.empty() ? L"N/A" : category,
+            std::wstring(dateText.begin(), dateText.end()),
+            balance,
+        };
+        for (int column = 0; column < static_cast<int>(TableColumn::Count); ++column) {
+            wchar_t text[64];
+            size_t length = model.CellText(row, column, text, 64);
+            if (std::wstring(text, length) != expected[column]) return false;
+        }
+    }
+    return true;
+}
+
+static std::vector<uint32_t> ByAmount(const TransactionStore& store) {
+    std::vector<uint32_t> slots = LiveSlots(store);
+    std::stable_sort(slots.begin(), slots.end(), [&store](uint32_t a, uint32_t b) {
+        return store.Amounts()[a] < store.Amounts()[b];
+    });
+    return slots;
+}
+
+FINSYNC_TEST(TableSortsAndFilters) {
+    TransactionStore store;
+    FillStore(store, 3000);
+    TransactionTableModel view(store);
+    view.CacheHint(0, 39);
+    CHECK(TableShows(view, store, LiveSlots(store)));
+
+    std::vector<uint32_t> byAmount = ByAmount(store);
+    view.SortBy(TableColumn::Amount, false);
+    view.CacheHint(0, 39);
+    CHECK(TableShows(view, store, byAmount));
+
+    SearchQuery food;
+    food.text = "food";
+    std::vector<uint32_t> matches = ScanQuery(store, food);
+    std::vector<uint32_t> shown;
+    for (uint32_t slot : byAmount) {
+        if (std::binary_search(matches.begin(), matches.end(), slot)) shown.push_back(slot);
+    }
+    view.SetFilter(food);
+    view.CacheHint(0, 39);
+    CHECK(view.Filtered());
+    CHECK(TableShows(view, store, shown));
+
+    view.ClearFilter();
+    view.SortBy(TableColumn::Index, false);
+    CHECK(TableShows(view, store, LiveSlots(store)));
+}
+
+FINSYNC_TEST(TableFollowsEdits) {
+    TransactionStore store;
+    FillStore(store, 3000);
+    TransactionTableModel view(store);
+    view.CacheHint(0, 39);
+    CHECK(TableShows(view, store, LiveSlots(store)));
+
+    size_t slot = store.SlotAt(5);
+    TransactionStore::Row row = store.Get(slot);
+    row.amount += Money::FromMinor(12345);
+    row.day -= 30;
+    store.Update(slot, row);
+    view.RowChanged(slot);
+    view.Invalidate();
+    CHECK(TableShows(view, store, LiveSlots(store)));
+
+    std::vector<size_t> doomed;
+    for (size_t dead = 0; dead < store.SlotCount(); dead += 3) doomed.push_back(dead);
+    store.Erase(doomed);
+    view.Invalidate();
+    view.CacheHint(0, 39);
+    CHECK(TableShows(view, store, LiveSlots(store)));
+}
+
+FINSYNC_TEST(TableKeepsOrderThroughCompaction) {
+    TransactionStore store;
+    FillStore(store, 3000);
+    TransactionTableModel view(store);
+    std::vector<size_t> doomed;
+    for (size_t dead = 0; dead < store.SlotCount(); dead += 3) doomed.push_back(dead);
+    store.Erase(doomed);
+    view.Invalidate();
+    view.CacheHint(0, 39);
+
+    std::vector<uint64_t> idsShown;
+    for (size_t row = 0; row < view.RowCount(); ++row) idsShown.push_back(store.Id(view.SlotAt(row)));
+    CHECK(store.InstallCompaction(store.PrepareCompaction()));
+    view.Invalidate();
+    CHECK(store.DeadCount() == 0);
+    CHECK(TableShows(view, store, LiveSlots(store)));
+    CHECK(view.RowCount() == idsShown.size());
+    bool sameIds = true;
+    for (size_t row = 0; sameIds && row < view.RowCount(); ++row) sameIds = store.Id(view.SlotAt(row)) == idsShown[row];
+    CHECK(sameIds);
+}
+
+// A compaction installed behind the table's back (a save, a load) moves the
+// slots a sorted or filtered table holds; the next call must not hand out
+// the old ones
+FINSYNC_TEST(TableFollowsRelayoutWithoutInvalidate) {
+    TransactionStore store;
+    FillStore(store, 8000);
+    TransactionTableModel sorted(store);
+    sorted.SortBy(TableColumn::Amount, false);
+    sorted.CacheHint(0, 39);
+    TransactionTableModel filtered(store);
+    SearchQuery food;
+    food.text = "food";
+    filtered.SetFilter(food);
+    filtered.CacheHint(0, 39);
+
+    std::vector<size_t> doomed;
+    for (size_t slot = 0; slot < store.SlotCount(); slot += 2) doomed.push_back(slot);
+    store.Erase(doomed);
+    CHECK(store.InstallCompaction(store.PrepareCompaction()));
+    CHECK(store.SlotCount() == 4000);
+
+    CHECK(TableShows(sorted, store, ByAmount(store)));
+    CHECK(TableShows(filtered, store, ScanQuery(store, food)));
+}
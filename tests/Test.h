@@ -0,0 +1,50 @@
+#pragma once
+
+// finsync-tests: a small self-registering test runner over finsync_core.
+//
+//   finsync-tests <fixtures directory> [name filter]
+//
+// Each test gets an empty scratch directory of its own. CHECK records a
+// failure and carries on, so one run reports every broken expectation; the
+// exit code is 1 if any test failed.
+
+#include "core/SearchIndex.h"
+#include "core/TransactionStore.h"
+
+#include <cstdint>
+#include <string>
+
+using TestFunction = void (*)();
+
+struct TestRegistration {
+    TestRegistration(const char* name, TestFunction run);
+};
+
+#define FINSYNC_TEST(name)                                              \
+    static void name();                                                 \
+    static TestRegistration name##Registration(#name, name);            \
+    static void name()
+
+#define CHECK(condition) CheckThat((condition), #condition, __FILE__, __LINE__)
+
+void CheckThat(bool passed, const char* expression, const char* file, int line);
+
+// A checked-in fixture file, and a path inside the running test's scratch
+// directory
+std::string FixturePath(const std::string& name);
+std::string ScratchPath(const std::string& name);
+
+std::string ReadWholeFile(const std::string& path);
+bool WriteWholeFile(const std::string& path, const std::string& bytes);
+
+// rows generated rows with the given seed, appended to store
+void FillStore(TransactionStore& store, size_t rows, uint64_t seed = 1);
+
+// Same live rows in the same order, with the same ids and category names
+bool SameLiveRows(const TransactionStore& a, const TransactionStore& b);
+
+// Slots of the live rows, in slot order
+std::vector<uint32_t> LiveSlots(const TransactionStore& store);
+
+// The filter bar's query answered from the columns, with no index
+std::vector<uint32_t> ScanQuery(const TransactionStore& store, const SearchQuery& query);
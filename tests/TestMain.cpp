@@ -0,0 +1,145 @@
+#include "Test.h"
+
+#include "core/LedgerGenerator.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct TestCase {
+    const char* name;
+    TestFunction run;
+};
+
+std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+fs::path fixtureDir;
+fs::path scratchDir;
+size_t failedChecks = 0;
+
+}
+
+TestRegistration::TestRegistration(const char* name, TestFunction run) {
+    Registry().push_back(TestCase{ name, run });
+}
+
+void CheckThat(bool passed, const char* expression, const char* file, int line) {
+    if (passed) return;
+    ++failedChecks;
+    std::fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, expression);
+}
+
+std::string FixturePath(const std::string& name) {
+    return (fixtureDir / name).string();
+}
+
+std::string ScratchPath(const std::string& name) {
+    return (scratchDir / name).string();
+}
+
+std::string ReadWholeFile(const std::string& path) {
+    std::string bytes;
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) return bytes;
+    char buffer[65536];
+    size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), f)) > 0) bytes.append(buffer, read);
+    std::fclose(f);
+    return bytes;
+}
+
+bool WriteWholeFile(const std::string& path, const std::string& bytes) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+void FillStore(TransactionStore& store, size_t rows, uint64_t seed) {
+    GeneratorOptions options;
+    options.rows = rows;
+    options.seed = seed;
+    LedgerGenerator generator(options);
+    generator.Fill(store);
+}
+
+bool SameLiveRows(const TransactionStore& a, const TransactionStore& b) {
+    if (a.Size() != b.Size()) return false;
+    for (size_t x = 0, y = 0;; ++x, ++y) {
+        while (x < a.SlotCount() && !a.IsLive(x)) ++x;
+        while (y < b.SlotCount() && !b.IsLive(y)) ++y;
+        if (x == a.SlotCount() || y == b.SlotCount()) return x == a.SlotCount() && y == b.SlotCount();
+
+        TransactionStore::Row r = a[x], s = b[y];
+        if (a.Id(x) != b.Id(y) || r.type != s.type || r.amount != s.amount || r.day != s.day ||
+            a.CategoryName(r.category) != b.CategoryName(s.category)) {
+            return false;
+        }
+    }
+}
+
+std::vector<uint32_t> LiveSlots(const TransactionStore& store) {
+    std::vector<uint32_t> slots;
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (store.IsLive(slot)) slots.push_back(static_cast<uint32_t>(slot));
+    }
+    return slots;
+}
+
+std::vector<uint32_t> ScanQuery(const TransactionStore& store, const SearchQuery& query) {
+    std::vector<std::string> words = SearchTerms(query.text);
+    std::vector<uint32_t> slots;
+    for (uint32_t slot : LiveSlots(store)) {
+        TransactionStore::Row row = store.Get(slot);
+        std::vector<std::string> terms = SearchTerms(store.CategoryName(row.category));
+        bool named = true;
+        for (const std::string& word : words) {
+            bool found = false;
+            for (const std::string& term : terms) found = found || term.compare(0, word.size(), word) == 0;
+            named = named && found;
+        }
+        if (!named) continue;
+        if (query.byType && row.type != query.type) continue;
+        if (query.byAmount && (row.amount.Minor() < query.minAmount || row.amount.Minor() > query.maxAmount)) continue;
+        if (query.byDate && (row.day < query.firstDay || row.day > query.lastDay)) continue;
+        slots.push_back(slot);
+    }
+    return slots;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: finsync-tests <fixtures directory> [name filter]\n");
+        return 2;
+    }
+    fixtureDir = argv[1];
+    std::string filter = argc > 2 ? argv[2] : "";
+
+    std::error_code ec;
+    fs::path root = fs::temp_directory_path(ec) / "finsync-tests";
+    size_t failedTests = 0, run = 0;
+    for (const TestCase& test : Registry()) {
+        if (std::string(test.name).find(filter) == std::string::npos) continue;
+        scratchDir = root / test.name;
+        fs::remove_all(scratchDir, ec);
+        fs::create_directories(scratchDir, ec);
+
+        size_t before = failedChecks;
+        test.run();
+        ++run;
+        bool passed = failedChecks == before;
+        if (!passed) ++failedTests;
+        std::printf("[%s] %s\n", passed ? "  ok  " : " FAIL ", test.name);
+        if (passed) fs::remove_all(scratchDir, ec);
+    }
+
+    std::printf("%zu of %zu tests passed\n", run - failedTests, run);
+    return failedTests == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,1389 @@
+// finsync-bench: times the app's load, save, summary, report, list and edit
+// paths over generated ledgers and prints the results as JSON.
+//
+//   finsync-bench [--sizes 1000,10000,...] [--threads 1,2,4,...] [--seed N] [--out file.json]
+//
+// Every result carries the wall time per operation and the peak resident
+// set size reached during that step. Checks compare the fast paths with
+// their reference implementations (SIMD aggregation kernels against the
+// scalar one and the maintained totals, the parallel loader against the
+// sequential one); the exit code is 1 if any check fails.
+
+#include "core/Aggregate.h"
+#include "core/CategoryRules.h"
+#include "core/Date.h"
+#include "core/FilterProgram.h"
+#include "core/Ledger.h"
+#include "core/LedgerGenerator.h"
+#include "core/LedgerLoader.h"
+#include "core/LedgerSync.h"
+#include "core/ParallelLoader.h"
+#include "core/Report.h"
+#include "core/RollupCube.h"
+#include "core/RunningBalance.h"
+#include "core/SearchIndex.h"
+#include "core/Snapshot.h"
+#include "core/SortPermutation.h"
+#include "core/StatementImport.h"
+#include "core/TransactionStore.h"
+#include "core/TransactionTableModel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Peak RSS for one step: Linux can reset the high-water mark, elsewhere
+// this is the peak of the whole process so far
+static void ResetPeakRss() {
+#ifdef __linux__
+    std::FILE* f = std::fopen("/proc/self/clear_refs", "w");
+    if (f != nullptr) {
+        std::fputs("5", f);
+        std::fclose(f);
+    }
+#endif
+}
+
+static long PeakRssKb() {
+#if defined(__linux__)
+    std::FILE* f = std::fopen("/proc/self/status", "r");
+    if (f != nullptr) {
+        char line[256];
+        long kb = -1;
+        while (std::fgets(line, sizeof(line), f) != nullptr) {
+            if (std::strncmp(line, "VmHWM:", 6) == 0) kb = std::strtol(line + 6, nullptr, 10);
+        }
+        std::fclose(f);
+        if (kb >= 0) return kb;
+    }
+#endif
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+    }
+    return -1;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+}
+
+static std::vector<size_t> ParseList(const char* text) {
+    std::vector<size_t> values;
+    for (const char* p = text; *p != '\0';) {
+        char* end;
+        values.push_back(std::strtoull(p, &end, 10));
+        p = *end == ',' ? end + 1 : end;
+        if (end == p && *p != '\0') break;
+    }
+    return values;
+}
+
+class Bench {
+public:
+    struct Result {
+        std::string name;
+        size_t rows;
+        unsigned threads;       // 0 when not applicable
+        double ms;              // per operation
+        size_t operations;
+        size_t scannedRows;     // rows each operation walks, 0 for point operations
+        long peakRssKb;
+        double bytes;           // input or output size, 0 if not applicable
+    };
+
+    struct Check {
+        std::string name;
+        size_t rows;
+        bool passed;
+    };
+
+    struct Memory {
+        std::string name;
+        size_t rows;
+        size_t bytes;
+    };
+
+    // Runs fn once and records it; the result may be amended until the next step
+    Result& Once(const std::string& name, size_t rows, const std::function<void()>& fn,
+              double bytes = 0, unsigned threads = 0) {
+        ResetPeakRss();
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        results.push_back(Result{ name, rows, threads, ms, 1, rows, PeakRssKb(), bytes });
+        return results.back();
+    }
+
+    // Repeats a short operation for at least minMs (or maxOperations times)
+    // and records the mean
+    void Repeat(const std::string& name, size_t rows, const std::function<void(size_t)>& fn,
+                size_t maxOperations = 100000, double minMs = 50, size_t scannedRows = 0) {
+        ResetPeakRss();
+        auto start = std::chrono::steady_clock::now();
+        size_t operations = 0;
+        double ms = 0;
+        do {
+            fn(operations++);
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        } while (ms < minMs && operations < maxOperations);
+        results.push_back(Result{ name, rows, 0, ms / operations, operations, scannedRows, PeakRssKb(), 0 });
+    }
+
+    // Records what a structure holding rows rows takes
+    void Footprint(const std::string& name, size_t rows, size_t bytes) {
+        memory.push_back(Memory{ name, rows, bytes });
+    }
+
+    void Verify(const std::string& name, size_t rows, bool passed) {
+        checks.push_back(Check{ name, rows, passed });
+        if (!passed) std::fprintf(stderr, "finsync-bench: check %s failed at %zu rows\n", name.c_str(), rows);
+    }
+
+    bool Passed() const {
+        for (const Check& check : checks) {
+            if (!check.passed) return false;
+        }
+        return true;
+    }
+
+    std::string Json(uint64_t seed) const {
+        std::string out = "{\n";
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "  \"benchmark\": \"finsync-bench\",\n  \"seed\": %llu,\n  \"hardwareThreads\": %u,\n"
+                      "  \"aggregateKernel\": \"%s\",\n  \"results\": [\n",
+                      static_cast<unsigned long long>(seed), std::thread::hardware_concurrency(),
+                      AggregateKernelName(DetectAggregateKernel()));
+        out += line;
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            double seconds = r.ms / 1000.0;
+            double operationsPerSecond = seconds > 0 ? 1 / seconds : 0;
+            std::snprintf(line, sizeof(line),
+                          "    {\"name\": \"%s\", \"rows\": %zu, \"threads\": %u, \"ms\": %.4f, \"operations\": %zu, "
+                          "\"operationsPerSecond\": %.1f, \"rowsPerSecond\": %.0f, \"mbPerSecond\": %.2f, \"peakRssKb\": %ld}%s\n",
+                          r.name.c_str(), r.rows, r.threads, r.ms, r.operations, operationsPerSecond,
+                          r.scannedRows * operationsPerSecond, r.bytes / (1024.0 * 1024.0) * operationsPerSecond,
+                          r.peakRssKb, i + 1 < results.size() ? "," : "");
+            out += line;
+        }
+        out += "  ],\n  \"memory\": [\n";
+
+        for (size_t i = 0; i < memory.size(); ++i) {
+            const Memory& m = memory[i];
+            std::snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"rows\": %zu, \"bytes\": %zu, \"bytesPerRow\": %.1f}%s\n",
+                          m.name.c_str(), m.rows, m.bytes, m.rows > 0 ? static_cast<double>(m.bytes) / m.rows : 0.0,
+                          i + 1 < memory.size() ? "," : "");
+            out += line;
+        }
+        out += "  ],\n  \"checks\": [\n";
+
+        for (size_t i = 0; i < checks.size(); ++i) {
+            std::snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"rows\": %zu, \"passed\": %s}%s\n",
+                          checks[i].name.c_str(), checks[i].rows, checks[i].passed ? "true" : "false",
+                          i + 1 < checks.size() ? "," : "");
+            out += line;
+        }
+        out += "  ]\n}\n";
+        return out;
+    }
+
+private:
+    std::vector<Result> results;
+    std::vector<Check> checks;
+    std::vector<Memory> memory;
+};
+
+// Same live rows with the same ids, in the same order. Stores without dead
+// slots must also have the same date index; elsewhere its slot numbers
+// differ with the layout.
+static bool SameStore(const TransactionStore& a, const TransactionStore& b) {
+    size_t n = a.Size();
+    if (n != b.Size() || a.CategoryCount() != b.CategoryCount()) return false;
+    for (size_t id = 0; id < a.CategoryCount(); ++id) {
+        if (a.CategoryName(static_cast<uint16_t>(id)) != b.CategoryName(static_cast<uint16_t>(id))) return false;
+    }
+    if (!(a.Totals() == b.Totals()) || a.Rollups() != b.Rollups()) return false;
+
+    if (a.DeadCount() == 0 && b.DeadCount() == 0) {
+        return std::memcmp(a.Amounts(), b.Amounts(), n * sizeof(int64_t)) == 0 &&
+               std::memcmp(a.Types(), b.Types(), n * sizeof(uint8_t)) == 0 &&
+               std::memcmp(a.Categories(), b.Categories(), n * sizeof(uint16_t)) == 0 &&
+               std::memcmp(a.Days(), b.Days(), n * sizeof(int32_t)) == 0 &&
+               std::memcmp(a.Ids(), b.Ids(), n * sizeof(uint64_t)) == 0 &&
+               a.Dates() == b.Dates();
+    }
+    for (size_t x = 0, y = 0;; ++x, ++y) {
+        while (x < a.SlotCount() && !a.IsLive(x)) ++x;
+        while (y < b.SlotCount() && !b.IsLive(y)) ++y;
+        if (x == a.SlotCount() || y == b.SlotCount()) return x == a.SlotCount() && y == b.SlotCount();
+
+        TransactionStore::Row r = a[x], s = b[y];
+        if (a.Id(x) != b.Id(y) || r.type != s.type || r.amount != s.amount || r.category != s.category ||
+            r.day != s.day) {
+            return false;
+        }
+    }
+}
+
+// Same columns as an image of the live rows
+static bool SameColumns(const TransactionStore& store, const TransactionColumns& columns) {
+    size_t n = columns.Size();
+    return store.SlotCount() == n &&
+           std::memcmp(store.Amounts(), columns.amounts.data(), n * sizeof(int64_t)) == 0 &&
+           std::memcmp(store.Types(), columns.types.data(), n * sizeof(uint8_t)) == 0 &&
+           std::memcmp(store.Categories(), columns.categories.data(), n * sizeof(uint16_t)) == 0 &&
+           std::memcmp(store.Days(), columns.days.data(), n * sizeof(int32_t)) == 0 &&
+           std::memcmp(store.Ids(), columns.ids.data(), n * sizeof(uint64_t)) == 0;
+}
+
+// Same rows with the same category names; ids may differ because the CSV
+// parser interns names in the order it meets them
+static bool SameRows(const TransactionStore& a, const TransactionStore& b) {
+    if (a.Size() != b.Size()) return false;
+    for (size_t i = 0; i < a.Size(); ++i) {
+        TransactionStore::Row x = a[i], y = b[i];
+        if (x.type != y.type || x.amount != y.amount || x.day != y.day ||
+            a.CategoryName(x.category) != b.CategoryName(y.category)) {
+            return false;
+        }
+    }
+    return a.Totals().Income() == b.Totals().Income() && a.Totals().Expense() == b.Totals().Expense() &&
+           a.Dates() == b.Dates();
+}
+
+// Same live rows under the same ids, category names compared; slots and
+// category ids may differ, as between two synced copies
+static bool SameIds(const TransactionStore& a, const TransactionStore& b) {
+    if (a.Size() != b.Size()) return false;
+    for (size_t x = 0; x < a.SlotCount(); ++x) {
+        size_t y;
+        if (!a.IsLive(x)) continue;
+        if (!b.FindId(a.Id(x), y)) return false;
+        TransactionStore::Row r = a[x], s = b[y];
+        if (r.type != s.type || r.amount != s.amount || r.day != s.day ||
+            a.CategoryName(r.category) != b.CategoryName(s.category)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A year's income and expense per month, then its amounts per type and
+// category, summed from the rows
+static std::vector<int64_t> ScanYear(const TransactionStore& store, int year) {
+    size_t categories = store.CategoryCount();
+    std::vector<int64_t> sums(24 + 2 * categories, 0);
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (!store.IsLive(slot) || store.Days()[slot] == kNoDate) continue;
+        int rowYear;
+        unsigned month, day;
+        CivilFromDays(store.Days()[slot], rowYear, month, day);
+        if (rowYear != year) continue;
+        size_t type = store.Types()[slot];
+        sums[(month - 1) * 2 + type] += store.Amounts()[slot];
+        sums[24 + type * categories + store.Categories()[slot]] += store.Amounts()[slot];
+    }
+    return sums;
+}
+
+// The same figures read from the rollup cube
+static std::vector<int64_t> RollupYear(const TransactionStore& store, int year) {
+    size_t categories = store.CategoryCount();
+    std::vector<int64_t> sums(24 + 2 * categories, 0);
+    const RollupCube& rollups = store.Rollups();
+    for (unsigned month = 1; month <= 12; ++month) {
+        for (size_t type = 0; type < 2; ++type) {
+            sums[(month - 1) * 2 + type] =
+                rollups.Total(RollupLevel::Month, RollupCube::MonthPeriod(year, month), static_cast<TransactionType>(type)).amount;
+        }
+    }
+    rollups.ForEachCell(RollupLevel::Year, year, year,
+                        [&](int32_t, TransactionType type, uint16_t category, const RollupCell& cell) {
+        sums[24 + static_cast<size_t>(type) * categories + category] = cell.amount;
+    });
+    return sums;
+}
+
+// The balance after every slot by a prefix sum over the rows in date order,
+// as the Balance column would be redone after an edit without the tree;
+// dead slots are left at zero
+static std::vector<int64_t> PrefixBalances(const TransactionStore& store) {
+    std::vector<int64_t> balances(store.SlotCount(), 0);
+    int32_t first, last;
+    if (!store.Dates().DayRange(first, last)) last = kNoDate;
+    int64_t balance = 0;
+    store.Dates().ForEachInRange(kNoDate, last, [&](size_t slot, int32_t) {
+        balance += store.Types()[slot] == static_cast<uint8_t>(TransactionType::Income) ? store.Amounts()[slot]
+                                                                                      : -store.Amounts()[slot];
+        balances[slot] = balance;
+    });
+    return balances;
+}
+
+// The filter bar's query answered row by row from the columns, with no index
+static std::vector<uint32_t> ScanQuery(const TransactionStore& store, const SearchQuery& query) {
+    std::vector<std::string> words = SearchTerms(query.text);
+    std::vector<bool> wanted(store.CategoryCount(), true);
+    for (size_t id = 0; id < wanted.size(); ++id) {
+        std::vector<std::string> terms = SearchTerms(store.CategoryName(static_cast<uint16_t>(id)));
+        for (const std::string& word : words) {
+            bool found = false;
+            for (const std::string& term : terms) found = found || term.compare(0, word.size(), word) == 0;
+            if (!found) wanted[id] = false;
+        }
+    }
+
+    std::vector<uint32_t> slots;
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (!store.IsLive(slot)) continue;
+        TransactionStore::Row row = store.Get(slot);
+        if (!wanted[row.category]) continue;
+        if (query.byType && row.type != query.type) continue;
+        if (query.byAmount && (row.amount.Minor() < query.minAmount || row.amount.Minor() > query.maxAmount)) continue;
+        if (query.byDate && (row.day < query.firstDay || row.day > query.lastDay)) continue;
+        slots.push_back(static_cast<uint32_t>(slot));
+    }
+    return slots;
+}
+
+// A row as the app kept it before TransactionStore
+struct LegacyTransaction {
+    std::wstring type;
+    double amount;
+    std::wstring category;
+    std::wstring date;
+};
+
+// Heap bytes behind a string; short strings live inside the object
+static size_t HeapBytes(const std::wstring& text) {
+    const char* data = reinterpret_cast<const char*>(text.data());
+    const char* self = reinterpret_cast<const char*>(&text);
+    if (data >= self && data < self + sizeof(text)) return 0;
+    return (text.capacity() + 1) * sizeof(wchar_t);
+}
+
+static std::vector<LegacyTransaction> LegacyRows(const TransactionStore& store) {
+    std::vector<LegacyTransaction> rows;
+    rows.reserve(store.Size());
+    char date[16];
+    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+        if (!store.IsLive(slot)) continue;
+        TransactionStore::Row row = store.Get(slot);
+        std::string dateText(date, FormatDate(row.day, date));
+        rows.push_back(LegacyTransaction{ row.type == TransactionType::Income ? L"Income" : L"Expense",
+                                          row.amount.ToDouble(), Utf8ToWide(store.CategoryName(row.category)),
+                                          std::wstring(dateText.begin(), dateText.end()) });
+    }
+    return rows;
+}
+
+static size_t LegacyMemoryUsage(const std::vector<LegacyTransaction>& rows) {
+    size_t bytes = rows.capacity() * sizeof(LegacyTransaction);
+    for (const LegacyTransaction& row : rows) {
+        bytes += HeapBytes(row.type) + HeapBytes(row.category) + HeapBytes(row.date);
+    }
+    return bytes;
+}
+
+static bool WriteFile(const std::string& path, const std::string& bytes) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+// A year of statements from four accounts, the generated rows dealt out in
+// turn: a signed-amount CSV, a semicolon CSV with debit and credit columns,
+// OFX and QIF. Returns the files and the bytes written.
+static std::vector<std::string> WriteStatements(const fs::path& dir, const GeneratorOptions& options, double& bytes) {
+    LedgerGenerator generator(options);
+    std::string csv = "Date,Description,Category,Amount\n";
+    std::string semicolon = "Posting Date;Payee;Withdrawal;Deposit;Category\n";
+    std::string ofx = "OFXHEADER:100\nDATA:OFXSGML\n\n<OFX><BANKMSGSRSV1><STMTTRNRS><STMTRS><BANKTRANLIST>\n";
+    std::string qif = "!Type:Bank\n";
+
+    TransactionStore::Row row;
+    char amount[Money::maxFormattedLength];
+    char line[256];
+    for (size_t i = 0; generator.Next(row); ++i) {
+        int year;
+        unsigned month, day;
+        CivilFromDays(row.day, year, month, day);
+        std::string_view category = generator.Categories().Name(row.category);
+        bool expense = row.type == TransactionType::Expense;
+        size_t length = row.amount.Format(amount);
+        int n = static_cast<int>(length);
+
+        switch (i % 4) {
+            case 0:
+                std::snprintf(line, sizeof(line), "%02u/%02u/%04d,\"%.*s #%zu\",%.*s,%s%.*s\n", day, month, year,
+                              static_cast<int>(category.size()), category.data(), i, static_cast<int>(category.size()),
+                              category.data(), expense ? "-" : "", n, amount);
+                csv += line;
+                break;
+            case 1:
+                std::snprintf(line, sizeof(line), "%02u/%02u/%04d;%.*s %zu;%.*s;%.*s;%.*s\n", day, month, year,
+                              static_cast<int>(category.size()), category.data(), i, expense ? n : 0, amount,
+                              expense ? 0 : n, amount, static_cast<int>(category.size()), category.data());
+                semicolon += line;
+                break;
+            case 2:
+                std::snprintf(line, sizeof(line),
+                              "<STMTTRN><TRNTYPE>%s<DTPOSTED>%04d%02u%02u120000<TRNAMT>%s%.*s<FITID>%zu<NAME>%.*s</STMTTRN>\n",
+                              expense ? "DEBIT" : "CREDIT", year, month, day, expense ? "-" : "", n, amount, i,
+                              static_cast<int>(category.size()), category.data());
+                ofx += line;
+                break;
+            default:
+                std::snprintf(line, sizeof(line), "D%02u/%02u/%04d\nT%s%.*s\nP%.*s\nL%.*s\n^\n", month, day, year,
+                              expense ? "-" : "", n, amount, static_cast<int>(category.size()), category.data(),
+                              static_cast<int>(category.size()), category.data());
+                qif += line;
+                break;
+        }
+    }
+    ofx += "</BANKTRANLIST></STMTRS></STMTTRNRS></BANKMSGSRSV1></OFX>\n";
+
+    std::vector<std::string> paths;
+    bytes = 0;
+    for (const auto& [name, text] : { std::make_pair("checking.csv", &csv), std::make_pair("savings.csv", &semicolon),
+                                      std::make_pair("card.ofx", &ofx), std::make_pair("wallet.qif", &qif) }) {
+        paths.push_back((dir / name).string());
+        WriteFile(paths.back(), *text);
+        bytes += static_cast<double>(text->size());
+    }
+    return paths;
+}
+
+// A statement row that owns its description
+struct StatementImportRow {
+    int32_t day;
+    int64_t amount;
+    std::string description;
+    std::string category;
+};
+
+static std::vector<StatementRow> AsStatementRows(const std::vector<StatementImportRow>& rows) {
+    std::vector<StatementRow> out;
+    out.reserve(rows.size());
+    for (const StatementImportRow& row : rows) out.push_back(StatementRow{ row.day, row.amount, row.description, row.category });
+    return out;
+}
+
+// count generated rows as statement rows from one of a few thousand
+// merchants per category, added to import in batches; those from keepFrom
+// on are also kept
+static void ImportRows(LedgerGenerator& generator, size_t count, const char* merchant, size_t keepFrom,
+                       StatementImport& import, std::vector<StatementImportRow>& kept) {
+    std::vector<StatementImportRow> batch;
+    TransactionStore::Row row;
+    for (size_t i = 0; i < count && generator.Next(row); ++i) {
+        int64_t amount = row.type == TransactionType::Expense ? -row.amount.Minor() : row.amount.Minor();
+        std::string category(generator.Categories().Name(row.category));
+        batch.push_back(StatementImportRow{ row.day, amount, category + " " + merchant + " #" + std::to_string(i % 4093),
+                                            category });
+        if (i >= keepFrom) kept.push_back(batch.back());
+        if (batch.size() == 65536 || i + 1 == count) {
+            import.Add(AsStatementRows(batch));
+            batch.clear();
+        }
+    }
+}
+
+// A long rule list as a user might keep one: most rules look for a merchant
+// word, some also need an amount or a second word, and a few go by amount
+// and day only. words gets the merchant word of each rule.
+static std::string SynthesizeRules(size_t count, uint64_t seed, std::vector<std::string>& words) {
+    static const char* categories[] = { "Food", "Rent", "Entertainment", "Transportation", "Utilities", "Other" };
+    std::mt19937_64 random(seed);
+    std::string text = "# generated\n";
+    for (size_t i = 0; i < count; ++i) {
+        std::string word;
+        for (size_t length = 4 + random() % 6; word.size() < length;) word += static_cast<char>('A' + random() % 26);
+        words.push_back(word);
+        std::string category = categories[i % 6];
+        switch (i % 10) {
+            case 7:
+                text += "type=Expense and description contains " + word + " and amount<500 -> " + category;
+                break;
+            case 8:
+                text += "amount=" + std::to_string(100 + i % 900) + " and day=" + std::to_string(1 + i % 28) +
+                        " -> " + category;
+                break;
+            case 9:
+                text += "description contains \"" + word + "\" and description contains " + words[i / 2] + " -> " +
+                        category;
+                break;
+            default:
+                text += "description contains " + word + " -> " + category;
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+static void RunSize(Bench& bench, size_t rows, const std::vector<size_t>& threadCounts, uint64_t seed,
+                    const fs::path& dir) {
+    GeneratorOptions options;
+    options.rows = rows;
+    options.seed = seed;
+    LedgerGenerator generator(options);
+
+    TransactionStore store;
+    bench.Once("generate", rows, [&] { generator.Fill(store); });
+
+    // The store's columns and indexes against the rows of wstrings the app
+    // kept before, in bytes per row (allocator overhead not counted) and in
+    // the time of UpdateSummary's income/expense scan. The old layout is
+    // only built up to a million rows.
+    bench.Footprint("store", rows, store.MemoryUsage());
+    bench.Footprint("store_columns", rows, store.SlotCount() * (sizeof(int64_t) + sizeof(uint8_t) + sizeof(uint16_t) +
+                                                              sizeof(int32_t) + sizeof(uint64_t)));
+    int64_t income = 0, expense = 0;
+    bench.Repeat("totals_scan_store", rows, [&](size_t) {
+        SumIncomeExpense(store.SlotCount(), store.Types(), store.Amounts(), income, expense);
+    }, 1000, 50, rows);
+    bench.Verify("totals_scan_store_exact", rows,
+                 income == store.Totals().Income().Minor() && expense == store.Totals().Expense().Minor());
+    if (rows <= 1000000) {
+        std::vector<LegacyTransaction> legacy = LegacyRows(store);
+        size_t legacyBytes = LegacyMemoryUsage(legacy);
+        bench.Footprint("legacy_wstring_rows", rows, legacyBytes);
+
+        // The indexes are sized to the days and cells in use, so even a small
+        // ledger stays well under the rows it replaced
+        bench.Verify("store_below_legacy", rows, store.MemoryUsage() * 5 < legacyBytes * 3);
+        double legacyIncome = 0, legacyExpense = 0;
+        bench.Repeat("totals_scan_legacy", rows, [&](size_t) {
+            legacyIncome = legacyExpense = 0;
+            for (const LegacyTransaction& t : legacy) {
+                if (t.type == L"Income") {
+                    legacyIncome += t.amount;
+                } else {
+                    legacyExpense += t.amount;
+                }
+            }
+        }, 1000, 50, rows);
+        bench.Verify("totals_scan_legacy_close", rows,
+                     std::abs(legacyIncome - store.Totals().Income().ToDouble()) < 0.01 * (1 + rows / 1000) &&
+                     std::abs(legacyExpense - store.Totals().Expense().ToDouble()) < 0.01 * (1 + rows / 1000));
+    }
+
+    // SaveData: the snapshot written by compaction, and the CSV export
+    std::string snapshotPath = (dir / "ledger.fsnap").string();
+    std::string csvPath = (dir / "ledger.txt").string();
+    double snapshotBytes = 0, csvBytes = 0;
+    Bench::Result& saveSnapshot = bench.Once("save_snapshot", rows, [&] {
+        std::string snapshot = store.BuildSnapshot();
+        WriteFile(snapshotPath, snapshot);
+        snapshotBytes = static_cast<double>(snapshot.size());
+    });
+    saveSnapshot.bytes = snapshotBytes;
+    Bench::Result& saveCsv = bench.Once("save_csv", rows, [&] {
+        std::string csv = store.BuildCsv();
+        WriteFile(csvPath, csv);
+        csvBytes = static_cast<double>(csv.size());
+    });
+    saveCsv.bytes = csvBytes;
+
+    // LoadData from the legacy CSV: the sequential parser, then the parallel one
+    LedgerLoader loader;
+    loader.Open(csvPath);
+    TransactionStore sequential;
+    bench.Once("load_csv_sequential", rows, [&] {
+        loader.ForEachRow([&](const LedgerRow& row) { sequential.Append(sequential.MakeRow(row)); });
+    }, csvBytes, 1);
+    bench.Verify("csv_round_trip", rows, SameRows(sequential, store));
+
+    for (size_t threads : threadCounts) {
+        TransactionStore parallel;
+        bench.Once("load_csv_parallel", rows, [&] {
+            ParallelLoad(loader.Data(), loader.Size(), parallel, static_cast<unsigned>(threads));
+        }, csvBytes, static_cast<unsigned>(threads));
+        bench.Verify("parallel_load_deterministic_" + std::to_string(threads), rows, SameStore(parallel, sequential));
+    }
+    sequential = TransactionStore();
+    loader = LedgerLoader();
+
+    // Amount text to a total: Money::Parse into integer minor units against
+    // wcstod into doubles, which is what the app did before Money
+    {
+        std::vector<std::string> amountText(rows);
+        std::vector<std::wstring> wideText(rows);
+        int64_t expectedSum = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            char text[Money::maxFormattedLength];
+            size_t length = Money::FromMinor(store.Amounts()[i]).Format(text);
+            amountText[i].assign(text, length);
+            wideText[i].assign(text, text + length);
+            expectedSum += store.Amounts()[i];
+        }
+
+        int64_t moneySum = 0;
+        bool parsed = true;
+        bench.Repeat("parse_sum_money", rows, [&](size_t) {
+            moneySum = 0;
+            for (const std::string& text : amountText) {
+                Money amount;
+                parsed = Money::Parse(text, amount) && parsed;
+                moneySum += amount.Minor();
+            }
+        }, 1000, 50, rows);
+        double doubleSum = 0;
+        bench.Repeat("parse_sum_double", rows, [&](size_t) {
+            doubleSum = 0;
+            for (const std::wstring& text : wideText) doubleSum += std::wcstod(text.c_str(), nullptr);
+        }, 1000, 50, rows);
+        bench.Verify("parse_sum_money_exact", rows, parsed && moneySum == expectedSum);
+    }
+
+    // LoadData from the snapshot, journal included
+    fs::remove(dir / "ledger.fsnap.journal");
+    Ledger ledger(snapshotPath);
+    bench.Once("load_snapshot", rows, [&] { ledger.Load(); }, snapshotBytes);
+    const TransactionStore& loaded = ledger.Transactions();
+    bench.Verify("snapshot_round_trip", rows, SameStore(loaded, store));
+
+    // Opening alone checks the header, directory and row values; the block
+    // checksums are a pass over every byte on top
+    bool opened = true;
+    bench.Repeat("snapshot_open", rows, [&](size_t) {
+        SnapshotReader reader;
+        opened = reader.Open(snapshotPath) && opened;
+    }, 1000, 50, rows);
+    bench.Repeat("snapshot_open_verified", rows, [&](size_t) {
+        SnapshotReader reader;
+        opened = reader.Open(snapshotPath, true) && opened;
+    }, 1000, 50, rows);
+    bench.Verify("snapshot_open_checked", rows, opened);
+
+    // Aggregation kernels, each checked against the scalar one, and the
+    // best against the totals maintained row by row
+    ColumnSums reference;
+    AggregateColumns(AggregateKernel::Scalar, rows, store.Types(), store.Categories(), store.Amounts(),
+                     store.CategoryCount(), reference);
+    for (AggregateKernel kernel : { AggregateKernel::Scalar, AggregateKernel::Sse2, AggregateKernel::Avx2 }) {
+        ColumnSums kernelSums;
+        bench.Repeat(std::string("aggregate_") + AggregateKernelName(kernel), rows, [&](size_t) {
+            AggregateColumns(kernel, rows, store.Types(), store.Categories(), store.Amounts(),
+                             store.CategoryCount(), kernelSums);
+        }, 20, 50, rows);
+        int64_t kernelIncome = 0, kernelExpense = 0;
+        bench.Repeat(std::string("totals_") + AggregateKernelName(kernel), rows, [&](size_t) {
+            SumIncomeExpense(kernel, rows, store.Types(), store.Amounts(), kernelIncome, kernelExpense);
+        }, 20, 50, rows);
+        bench.Verify(std::string("aggregate_exact_") + AggregateKernelName(kernel), rows,
+                     kernelSums.income == reference.income && kernelSums.expense == reference.expense &&
+                     kernelSums.byCategory == reference.byCategory && kernelIncome == reference.income &&
+                     kernelExpense == reference.expense);
+    }
+    ColumnSums sums;
+    AggregateColumns(rows, store.Types(), store.Categories(), store.Amounts(), store.CategoryCount(), sums);
+    bool sumsExact = sums.income == store.Totals().Income().Minor() &&
+                     sums.expense == store.Totals().Expense().Minor();
+    for (size_t id = 0; id < store.CategoryCount(); ++id) {
+        for (TransactionType type : { TransactionType::Income, TransactionType::Expense }) {
+            sumsExact = sumsExact && sums.byCategory[static_cast<size_t>(type) * store.CategoryCount() + id] ==
+                                     store.Totals().Category(type, static_cast<uint16_t>(id)).Minor();
+        }
+    }
+    bench.Verify("aggregate_exact", rows, sumsExact);
+    bench.Verify("totals_maintained", rows, store.VerifyTotals());
+
+    // Bulk delete of 1% of the rows, then compacting the dead slots away
+    if (rows > 0) {
+        std::vector<size_t> doomed;
+        uint64_t state = seed;
+        for (size_t i = 0; i < std::max<size_t>(1, rows / 100); ++i) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            doomed.push_back(static_cast<size_t>((state >> 33) % rows));
+        }
+        size_t removed = 0;
+        bench.Once("delete_bulk_store", rows, [&] { removed = store.Erase(doomed); });
+        bench.Verify("totals_after_bulk_delete", rows, store.VerifyTotals() && store.Size() == rows - removed);
+
+        TransactionStore::Image expected = store.CopyImage();
+        TransactionStore::Compaction compaction;
+        bool installed = false;
+        bench.Once("compact_prepare", rows, [&] { compaction = store.PrepareCompaction(); });
+        bench.Once("compact_install", rows, [&] { installed = store.InstallCompaction(std::move(compaction)); });
+
+        size_t slot;
+        bool idsKept = store.FindId(expected.columns.ids.front(), slot) && slot == 0 &&
+                       store.FindId(expected.columns.ids.back(), slot) && slot == store.Size() - 1;
+        bench.Verify("compaction_consistent", rows, installed && store.DeadCount() == 0 && idsKept &&
+                     SameColumns(store, expected.columns) && store.VerifyTotals());
+    }
+
+    // UpdateSummary formats the three maintained totals
+    bench.Repeat("update_summary", rows, [&](size_t) {
+        char text[Money::maxFormattedLength * 3];
+        const LedgerTotals& totals = loaded.Totals();
+        size_t length = totals.Income().Format(text);
+        length += totals.Expense().Format(text + length);
+        totals.Net().Format(text + length);
+    });
+
+    bench.Repeat("generate_report", rows, [&](size_t) { FormatReport(loaded, 2025, 6); }, 10000);
+
+    // Period rollups: building the cube from the rows against loading its
+    // saved cells, and a year's figures from it against rescanning
+    RollupCube cube;
+    bench.Once("rollup_build", rows, [&] {
+        cube.Build(loaded.SlotCount(), loaded.Days(), loaded.Types(), loaded.Categories(), loaded.Amounts(), &loaded.Live());
+    });
+    std::string cells = loaded.Rollups().Serialize();
+    RollupCube reloadedCube;
+    bool cellsLoaded = false;
+    bench.Once("rollup_load", rows, [&] { cellsLoaded = reloadedCube.Load(cells, loaded.CategoryCount()); },
+               static_cast<double>(cells.size()));
+    bench.Verify("rollup_round_trip", rows, cellsLoaded && reloadedCube == loaded.Rollups() && cube == loaded.Rollups());
+
+    bench.Repeat("report_year", rows, [&](size_t) { FormatYearReport(loaded, 2024); }, 10000);
+    std::vector<int64_t> yearFromRows;
+    bench.Repeat("report_year_scan", rows, [&](size_t) { yearFromRows = ScanYear(loaded, 2024); }, 1000, 50, rows);
+    bench.Verify("rollup_matches_scan", rows, yearFromRows == RollupYear(loaded, 2024));
+
+    // Running balance: back-dated edits and as-of-date queries on the
+    // Fenwick tree against redoing the prefix sum, which is what every edit
+    // would cost without it; per-row balances are checked against it
+    std::vector<int64_t> prefix;
+    bench.Repeat("balance_recompute_naive", rows, [&](size_t) { prefix = PrefixBalances(loaded); }, 1000, 50, rows);
+    RunningBalance balance;
+    bench.Once("balance_build", rows, [&] {
+        balance.Build(loaded.SlotCount(), loaded.Days(), loaded.Types(), loaded.Amounts(), &loaded.Live());
+    });
+    bool balanceMatches = balance == loaded.Balances() && balance.Total() == loaded.Totals().Net();
+    if (rows > 0) {
+        bench.Repeat("balance_edit_backdated", rows, [&](size_t i) {
+            size_t slot = loaded.SlotAt((i * 7919) % rows);
+            TransactionType type = static_cast<TransactionType>(loaded.Types()[slot]);
+            Money amount = Money::FromMinor(loaded.Amounts()[slot]);
+            balance.Remove(loaded.Days()[slot], type, amount);
+            balance.Add(loaded.Days()[slot] - 400, type, amount + Money::FromMinor(100));
+            balance.Remove(loaded.Days()[slot] - 400, type, amount + Money::FromMinor(100));
+            balance.Add(loaded.Days()[slot], type, amount);
+        });
+        int32_t first = 0, last = 0;
+        loaded.Dates().DayRange(first, last);
+        bench.Repeat("balance_as_of", rows, [&](size_t i) {
+            balance.AsOf(first + static_cast<int32_t>((i * 7919) % (static_cast<size_t>(last - first) + 1)));
+        });
+        bench.Repeat("balance_after_row", rows, [&](size_t i) { loaded.BalanceAfter(loaded.SlotAt((i * 7919) % rows)); });
+
+        for (size_t i = 0; i < std::min<size_t>(rows, 1000); ++i) {
+            size_t slot = loaded.SlotAt((i * 104729) % rows);
+            if (loaded.BalanceAfter(slot).Minor() != prefix[slot]) balanceMatches = false;
+        }
+    }
+    bench.Verify("balance_matches_prefix_sum", rows, balanceMatches && balance == loaded.Balances());
+
+    // List refresh: invalidate, then one screen of cells at a spread of scroll positions
+    TransactionTableModel model(loaded);
+    bench.Repeat("list_refresh", rows, [&](size_t i) {
+        size_t first = rows > 40 ? (i * 7919) % (rows - 40) : 0;
+        size_t last = std::min(rows, first + 40);
+        wchar_t text[64];
+        model.Invalidate();
+        model.CacheHint(first, last == 0 ? 0 : last - 1);
+        for (size_t row = first; row < last; ++row) {
+            for (int column = 0; column < static_cast<int>(TableColumn::Count); ++column) {
+                model.CellText(row, column, text, 64);
+            }
+        }
+    });
+
+    // Column sorts: radix-built permutations against std::sort on the same keys
+    for (SortKey key : { SortKey::Type, SortKey::Amount, SortKey::Category, SortKey::Date }) {
+        std::string name = SortKeyName(key);
+        SortPermutation permutation;
+        bench.Once("sort_" + name + "_radix", rows, [&] { permutation.Build(loaded, key); });
+
+        const std::vector<uint64_t>& keys = permutation.Keys();
+        std::vector<uint32_t> order(loaded.SlotCount());
+        for (size_t slot = 0; slot < order.size(); ++slot) order[slot] = static_cast<uint32_t>(slot);
+        bench.Once("sort_" + name + "_std", rows, [&] {
+            std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) {
+                return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+            });
+        });
+        bench.Verify("sort_matches_std_" + name, rows, order == permutation.Order());
+    }
+
+    // Filter bar queries through the search index, against a plain scan
+    SearchIndex search;
+    bench.Once("search_index_build", rows, [&] { search.Build(loaded); });
+
+    std::vector<std::pair<std::string, SearchQuery>> queries(4);
+    queries[0].first = "category";
+    queries[0].second.text = "food";
+    queries[1].first = "amount_range";
+    queries[1].second.byAmount = true;
+    queries[1].second.minAmount = 10000;
+    queries[1].second.maxAmount = 20000;
+    queries[2].first = "date_range";
+    queries[2].second.byDate = true;
+    queries[2].second.firstDay = DaysFromCivil(2024, 3, 1);
+    queries[2].second.lastDay = DaysFromCivil(2024, 3, 31);
+    queries[3].first = "combined";
+    queries[3].second = queries[2].second;
+    queries[3].second.text = "food";
+    queries[3].second.byType = true;
+    queries[3].second.type = TransactionType::Expense;
+    queries[3].second.byAmount = true;
+    queries[3].second.minAmount = 50000;
+
+    for (const auto& [name, query] : queries) {
+        RowSet found;
+        bench.Repeat("search_" + name, rows, [&](size_t) { found = search.Find(loaded, query); }, 1000);
+        std::vector<uint32_t> scanned;
+        bench.Repeat("search_" + name + "_scan", rows, [&](size_t) { scanned = ScanQuery(loaded, query); },
+                     1000, 50, rows);
+        bench.Verify("search_matches_scan_" + name, rows, found.ToSlots() == scanned);
+    }
+
+    // Filter expressions: the compiled block evaluation against interpreting
+    // the program row by row
+    const std::pair<const char*, const char*> expressions[] = {
+        { "example", "type=Expense and category in (Food,Transportation) and date>=01/01/2024 and amount>1000" },
+        { "nested", "not (category=Rent or type=Income) and (amount<=500 or date<01/06/2021)" },
+    };
+    for (const auto& [name, text] : expressions) {
+        FilterProgram program;
+        std::string error;
+        bench.Repeat(std::string("filter_compile_") + name, rows, [&](size_t) {
+            FilterProgram::Compile(text, program, error);
+        }, 1000);
+
+        RowSet compiled;
+        bench.Repeat(std::string("filter_eval_") + name, rows, [&](size_t) { compiled = program.Evaluate(loaded); },
+                     1000, 50, rows);
+        std::vector<uint32_t> naive;
+        bench.Repeat(std::string("filter_naive_") + name, rows, [&](size_t) {
+            naive.clear();
+            for (size_t slot = 0; slot < loaded.SlotCount(); ++slot) {
+                if (program.MatchesRow(loaded, slot)) naive.push_back(static_cast<uint32_t>(slot));
+            }
+        }, 1000, 50, rows);
+        bench.Verify(std::string("filter_matches_naive_") + name, rows, error.empty() && compiled.ToSlots() == naive);
+    }
+
+    // Edit and delete at random positions, journaled as in the app
+    if (rows > 0) {
+        LedgerGenerator edits(options);
+        size_t operations = std::min<size_t>(100, rows / 2);
+        const double forever = std::numeric_limits<double>::infinity();
+        uint64_t state = seed;
+        auto position = [&](size_t size) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            return static_cast<size_t>((state >> 33) % size);
+        };
+
+        std::vector<uint64_t> edited;
+        bench.Repeat("edit_random", rows, [&](size_t) {
+            TransactionStore::Row row;
+            if (!edits.Next(row)) {
+                edits.Reset();
+                edits.Next(row);
+            }
+            row.category = ledger.InternCategory(edits.Categories().Name(row.category));
+            edited.push_back(loaded.Id(loaded.SlotAt(position(loaded.Size()))));
+            ledger.Update(edited.back(), row);
+        }, operations, forever);
+        bench.Repeat("delete_random", rows, [&](size_t) {
+            ledger.Erase(loaded.Id(loaded.SlotAt(position(loaded.Size()))));
+        }, operations, forever);
+        bench.Verify("totals_after_edits", rows, loaded.VerifyTotals());
+
+        // A multi-row delete from the table, journaled
+        std::vector<uint64_t> ids;
+        for (size_t i = 0; i < std::max<size_t>(1, loaded.Size() / 100); ++i) {
+            ids.push_back(loaded.Id(loaded.SlotAt(position(loaded.Size()))));
+        }
+        SortPermutation byAmount;
+        byAmount.Build(loaded, SortKey::Amount);
+        bench.Once("delete_bulk", rows, [&] { ledger.Erase(ids); });
+        bench.Verify("totals_after_bulk_delete_journaled", rows, loaded.VerifyTotals());
+
+        // The sorted table following those changes without a full resort
+        bench.Once("sort_sync_after_delete", rows, [&] { byAmount.Sync(loaded); });
+        bench.Repeat("sort_sync_after_add", rows, [&](size_t) {
+            TransactionStore::Row row;
+            if (!edits.Next(row)) {
+                edits.Reset();
+                edits.Next(row);
+            }
+            row.category = ledger.InternCategory(edits.Categories().Name(row.category));
+            ledger.Add(row);
+            byAmount.Sync(loaded);
+        }, operations, forever);
+        bench.Repeat("sort_update_after_edit", rows, [&](size_t i) {
+            size_t slot = loaded.SlotAt(position(loaded.Size()));
+            TransactionStore::Row row = loaded.Get(slot);
+            row.amount = Money::FromMinor(static_cast<int64_t>(i) * 137 - 5000);
+            uint64_t id = loaded.Id(slot);
+            ledger.Update(id, row);
+            edited.push_back(id);
+            if (loaded.FindId(id, slot)) byAmount.Update(loaded, slot);
+        }, operations, forever);
+
+        SortPermutation fresh;
+        fresh.Build(loaded, SortKey::Amount);
+        bench.Verify("sort_incremental_consistent", rows, byAmount.Order() == fresh.Order());
+
+        // The search index after the same edits, deletes and adds
+        bench.Once("search_index_sync", rows, [&] {
+            search.Sync(loaded);
+            for (uint64_t id : edited) {
+                size_t slot;
+                if (loaded.FindId(id, slot)) search.Update(loaded, slot);
+            }
+        });
+        bool searchConsistent = true;
+        for (const auto& [name, query] : queries) {
+            searchConsistent = searchConsistent && search.Find(loaded, query).ToSlots() == ScanQuery(loaded, query);
+        }
+        bench.Verify("search_incremental_consistent", rows, searchConsistent);
+
+        // SaveData: what the UI thread pays, then the writer thread's part
+        bench.Once("save_ui_thread", rows, [&] { ledger.Save(); });
+        bench.Once("save_background", rows, [&] { ledger.WaitForSave(); }, snapshotBytes);
+
+        SnapshotReader saved;
+        TransactionStore reloaded;
+        if (saved.Open(snapshotPath)) reloaded.LoadSnapshot(saved);
+        bench.Verify("background_save_round_trip", rows, SameStore(reloaded, loaded));
+        bench.Verify("snapshot_keeps_rollups", rows, saved.Rollups().size() > 0);
+    }
+    ledger.Close();
+
+    // Delta sync between two copies of the saved ledger: rows added on both
+    // sides, one edited and one deleted, first through a directory served on
+    // another thread (its time is mostly the 1 ms polling of each
+    // exchange), then over a loopback socket
+    if (rows > 0) {
+        std::error_code ec;
+        fs::path syncDir = dir / "sync";
+        fs::remove_all(syncDir, ec);
+        fs::create_directories(syncDir / "peer", ec);
+        fs::create_directories(syncDir / "inbox", ec);
+        fs::copy_file(snapshotPath, syncDir / "ledger.fsnap", ec);
+        fs::copy_file(snapshotPath, syncDir / "peer" / "ledger.fsnap", ec);
+
+        Ledger mine((syncDir / "ledger.fsnap").string());
+        Ledger theirs((syncDir / "peer" / "ledger.fsnap").string());
+        mine.Load();
+        theirs.Load();
+
+        SyncServer server(theirs);
+        SyncHandler handler = [&server](const std::string& request) { return server.Handle(request); };
+        std::atomic<bool> serving{true};
+        std::thread peer([&] {
+            while (serving) {
+                if (ServeDirectory((syncDir / "inbox").string(), handler) == 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+        });
+
+        LedgerGenerator changes(options);
+        auto change = [&](Ledger& ledger, size_t added, size_t step) {
+            TransactionStore::Row row;
+            for (size_t i = 0; i < added; ++i) {
+                if (!changes.Next(row)) {
+                    changes.Reset();
+                    changes.Next(row);
+                }
+                row.category = ledger.InternCategory(changes.Categories().Name(row.category));
+                ledger.Add(row);
+            }
+            const TransactionStore& store = ledger.Transactions();
+            size_t slot = store.SlotAt((step * 7919) % store.Size());
+            row = store.Get(slot);
+            row.amount = Money::FromMinor(row.amount.Minor() + 1);
+            ledger.Update(store.Id(slot), row);
+            ledger.Erase(store.Id(store.SlotAt((step * 104729) % store.Size())));
+        };
+
+        std::string error;
+        SyncStats stats;
+        DirectoryTransport directory((syncDir / "inbox").string());
+        bool ok = true;
+        bench.Once("sync_first", rows, [&] { ok = SyncLedger(mine, directory, stats, error); });
+        change(mine, 5, 1);
+        change(theirs, 3, 2);
+        Bench::Result& delta = bench.Once("sync_directory", rows, [&] {
+            ok = SyncLedger(mine, directory, stats, error) && ok;
+        });
+        delta.bytes = static_cast<double>(stats.bytesSent + stats.bytesReceived);
+        serving = false;
+        peer.join();
+        bench.Verify("sync_converged", rows, ok && SameIds(mine.Transactions(), theirs.Transactions()));
+        bench.Verify("sync_moves_kilobytes", rows, ok && delta.bytes < 64 * 1024 && stats.conflicts == 3);
+
+        SocketServer listener;
+        SocketTransport socket;
+        ok = listener.Listen(0);
+        std::thread answer([&] { listener.ServeOne(handler); });
+        ok = socket.Connect("localhost", listener.Port()) && ok;
+        change(mine, 2, 3);
+        change(theirs, 2, 4);
+        Bench::Result& overSocket = bench.Once("sync_socket", rows, [&] {
+            ok = SyncLedger(mine, socket, stats, error) && ok;
+        });
+        overSocket.bytes = static_cast<double>(stats.bytesSent + stats.bytesReceived);
+        bench.Once("sync_unchanged", rows, [&] { ok = SyncLedger(mine, socket, stats, error) && ok; });
+        socket.Close();
+        answer.join();
+        bench.Verify("sync_socket_converged", rows, ok && stats.exchanges == 2 &&
+                     SameIds(mine.Transactions(), theirs.Transactions()) && mine.Transactions().VerifyTotals());
+        if (!error.empty()) std::fprintf(stderr, "finsync-bench: sync: %s\n", error.c_str());
+
+        mine.Close();
+        theirs.Close();
+    }
+
+    // Statement import: a year of statements from four accounts, read and
+    // added in one bulk insert
+    if (rows > 0) {
+        std::error_code ec;
+        fs::path importDir = dir / "import";
+        fs::remove_all(importDir, ec);
+        fs::create_directories(importDir, ec);
+
+        GeneratorOptions year = options;
+        year.firstDay = DaysFromCivil(2025, 1, 1);
+        year.lastDay = DaysFromCivil(2025, 12, 31);
+        double statementBytes = 0;
+        std::vector<std::string> statements = WriteStatements(importDir, year, statementBytes);
+
+        Ledger imported((importDir / "statements.fsnap").string());
+        imported.Load();
+        bool ok = true;
+        size_t skipped = 0;
+        bench.Once("import_statements", rows, [&] {
+            StatementImport import(imported);
+            for (const std::string& path : statements) {
+                StatementOptions statementOptions;
+                StatementStats stats;
+                ok = DetectStatementFormat(path, statementOptions.format) && ok;
+                statementOptions.dates = UsualDateOrder(statementOptions.format);
+                ok = ReadStatement(path, statementOptions, [&import](const std::vector<StatementRow>& batch) {
+                    import.Add(batch);
+                }, stats) && ok;
+                skipped += stats.skipped;
+            }
+            import.Commit();
+        }, statementBytes);
+
+        // The statements' rows account by account; OFX has no categories
+        TransactionStore expected;
+        for (size_t account = 0; account < 4; ++account) {
+            LedgerGenerator generator(year);
+            TransactionStore::Row row;
+            for (size_t i = 0; generator.Next(row); ++i) {
+                if (i % 4 != account) continue;
+                std::string_view category = generator.Categories().Name(row.category);
+                if (account == 2) category = row.type == TransactionType::Expense ? "Other" : "N/A";
+                row.category = expected.InternCategory(category);
+                expected.Append(row);
+            }
+        }
+        const TransactionStore& got = imported.Transactions();
+        bench.Verify("import_matches_generated", rows,
+                     ok && skipped == 0 && SameRows(got, expected) && got.VerifyTotals());
+        imported.Close();
+
+        // The same statements parsed once, then added from the parsed rows
+        // in one bulk insert against one journaled add per row as the
+        // dialogs do, so the two differ only in how the rows reach the
+        // ledger; the row-by-row path is capped, as it is the slow one
+        std::vector<StatementImportRow> parsed;
+        bench.Once("parse_statements", rows, [&] {
+            for (const std::string& path : statements) {
+                StatementOptions statementOptions;
+                StatementStats stats;
+                DetectStatementFormat(path, statementOptions.format);
+                statementOptions.dates = UsualDateOrder(statementOptions.format);
+                ReadStatement(path, statementOptions, [&parsed](const std::vector<StatementRow>& batch) {
+                    for (const StatementRow& row : batch) {
+                        parsed.push_back(StatementImportRow{ row.day, row.amount, std::string(row.description),
+                                                             std::string(row.category) });
+                    }
+                }, stats);
+            }
+        }, statementBytes);
+        std::vector<StatementRow> parsedRows = AsStatementRows(parsed);
+
+        fs::remove(importDir / "bulk.fsnap", ec);
+        Ledger bulk((importDir / "bulk.fsnap").string());
+        bulk.Load();
+        bench.Once("import_bulk_parsed", rows, [&] {
+            StatementImport import(bulk);
+            import.Add(parsedRows);
+            import.Commit();
+        });
+        if (rows <= 100000) {
+            fs::remove(importDir / "one-by-one.fsnap", ec);
+            Ledger oneByOne((importDir / "one-by-one.fsnap").string());
+            oneByOne.Load();
+            bench.Once("import_row_by_row", rows, [&] {
+                for (const StatementRow& parsedRow : parsedRows) {
+                    TransactionStore::Row row;
+                    row.type = parsedRow.amount < 0 ? TransactionType::Expense : TransactionType::Income;
+                    row.amount = Money::FromMinor(parsedRow.amount < 0 ? -parsedRow.amount : parsedRow.amount);
+                    std::string_view category = parsedRow.category;
+                    if (category.empty()) category = row.type == TransactionType::Expense ? "Other" : "N/A";
+                    row.category = oneByOne.InternCategory(category);
+                    row.day = parsedRow.day;
+                    oneByOne.Add(row);
+                }
+            });
+            bench.Verify("import_row_by_row_matches_bulk", rows,
+                         SameRows(oneByOne.Transactions(), bulk.Transactions()));
+            oneByOne.Close();
+        }
+        bulk.Close();
+
+        // Duplicate detection: every row of the ledger imported, then a
+        // statement of up to 100K rows of which half were imported before
+        // (every fourth of those posted a day later) and half are new
+        size_t overlap = std::min<size_t>(rows, 100000);
+        std::string dedupPath = (importDir / "dedup.fsnap").string();
+        std::vector<StatementImportRow> statement;
+        {
+            Ledger seeded(dedupPath);
+            seeded.Load();
+            StatementImport import(seeded);
+            LedgerGenerator generator(options);
+            ImportRows(generator, rows, "STORE", rows - overlap / 2, import, statement);
+            import.Commit();
+            seeded.Close();
+
+            GeneratorOptions fresh = options;
+            fresh.seed = options.seed + 1;
+            LedgerGenerator newRows(fresh);
+            std::vector<StatementImportRow> added;
+            ImportRows(newRows, overlap - overlap / 2, "NEW", 0, import, added);
+            for (size_t i = 0; i < statement.size(); i += 4) ++statement[i].day;
+            statement.insert(statement.end(), added.begin(), added.end());
+        }
+
+        Ledger ledger(dedupPath);
+        ledger.Load();
+        size_t addedRows = 0, duplicates = 0;
+        bench.Once("import_dedup", rows, [&] {
+            StatementImport import(ledger);
+            import.Add(AsStatementRows(statement));
+            addedRows = import.Commit();
+            duplicates = import.Duplicates();
+        }).scannedRows = statement.size();
+        bench.Verify("dedup_finds_overlap", rows, duplicates == overlap / 2 && addedRows == overlap - overlap / 2 &&
+                     ledger.Transactions().Size() == rows + addedRows);
+        ledger.Close();
+
+        // The index on its own: opening it and looking up every statement row
+        size_t candidates = 0;
+        bench.Once("dedup_index_lookups", rows, [&] {
+            ImportIndex index;
+            index.Open(dedupPath);
+            std::vector<ImportEntry> found;
+            for (const StatementImportRow& row : statement) {
+                found.clear();
+                index.Find(DescriptionHash(row.description), row.amount, row.day, 3, found);
+                candidates += found.size();
+            }
+        }).scannedRows = statement.size();
+        bench.Verify("dedup_index_finds_overlap", rows, candidates >= overlap / 2);
+
+        // Again, from the index as saved: nothing is new
+        Ledger reopened(dedupPath);
+        reopened.Load();
+        StatementImport again(reopened);
+        again.Add(AsStatementRows(statement));
+        size_t addedAgain = again.Commit();
+        bench.Verify("dedup_reimport_adds_nothing", rows, addedAgain == 0 && again.Duplicates() == statement.size());
+
+        // What the index replaces: every statement row compared with every
+        // ledger row, for a thousand statement rows
+        if (rows <= 1000000) {
+            const TransactionStore& store = reopened.Transactions();
+            size_t sample = std::min<size_t>(statement.size(), 1000), found = 0;
+            bench.Once("dedup_pairwise", rows, [&] {
+                for (size_t i = 0; i < sample; ++i) {
+                    const StatementImportRow& row = statement[i];
+                    uint8_t type = static_cast<uint8_t>(row.amount < 0 ? TransactionType::Expense : TransactionType::Income);
+                    int64_t amount = row.amount < 0 ? -row.amount : row.amount;
+                    for (size_t slot = 0; slot < store.SlotCount(); ++slot) {
+                        if (store.Amounts()[slot] == amount && store.Types()[slot] == type &&
+                            store.Days()[slot] == row.day && store.IsLive(slot)) {
+                            ++found;
+                            break;
+                        }
+                    }
+                }
+            }).scannedRows = sample;
+            size_t unshifted = 0;
+            for (size_t i = 0; i < std::min(sample, overlap / 2); ++i) unshifted += i % 4 != 0;
+            bench.Verify("dedup_pairwise_finds_same_day", rows, found >= unshifted);
+        }
+        reopened.Close();
+
+        // Categorization rules: ten thousand of them, over descriptions of
+        // which about seven in ten carry a rule's word, cycling through a
+        // pool of at most a million generated rows
+        std::vector<std::string> words;
+        std::string ruleText = SynthesizeRules(10000, options.seed, words);
+        CategoryRules rules;
+        std::string ruleError;
+        bench.Once("compile_rules", rows, [&] {
+            ok = CategoryRules::Compile(ruleText, rules, ruleError);
+        }, static_cast<double>(ruleText.size())).scannedRows = words.size();
+        bench.Verify("rules_compile", rows, ok && rules.Size() == words.size());
+
+        std::vector<StatementImportRow> described;
+        {
+            std::mt19937_64 random(options.seed + 2);
+            LedgerGenerator generator(options);
+            TransactionStore::Row row;
+            while (described.size() < std::min<size_t>(rows, 1 << 20) && generator.Next(row)) {
+                int64_t amount = row.type == TransactionType::Expense ? -row.amount.Minor() : row.amount.Minor();
+                std::string description = random() % 10 < 7
+                    ? "POS " + words[random() % words.size()] + " MANILA #" + std::to_string(random() % 10000)
+                    : "INSTAPAY TRANSFER REF " + std::to_string(random());
+                described.push_back(StatementImportRow{ row.day, amount, std::move(description), std::string() });
+            }
+        }
+        auto categorize = [&](const StatementImportRow& row, CategoryRules::Scratch& scratch) {
+            TransactionType type = row.amount < 0 ? TransactionType::Expense : TransactionType::Income;
+            return rules.Match(row.description, type, row.amount < 0 ? -row.amount : row.amount, row.day, scratch);
+        };
+        size_t categorized = 0;
+        bench.Once("categorize_rules", rows, [&] {
+            CategoryRules::Scratch scratch;
+            for (size_t i = 0; i < rows; ++i) categorized += categorize(described[i % described.size()], scratch) != CategoryRules::noRule;
+        }).scannedRows = rows;
+
+        // What the automaton replaces: every rule tried in turn, for a
+        // thousand rows
+        size_t sample = std::min<size_t>(described.size(), 1000);
+        std::vector<size_t> reference(sample);
+        bench.Once("categorize_rule_by_rule", rows, [&] {
+            for (size_t i = 0; i < sample; ++i) {
+                const StatementImportRow& row = described[i];
+                TransactionType type = row.amount < 0 ? TransactionType::Expense : TransactionType::Income;
+                reference[i] = rules.MatchRuleByRule(row.description, type, row.amount < 0 ? -row.amount : row.amount,
+                                                     row.day);
+            }
+        }).scannedRows = sample;
+        CategoryRules::Scratch scratch;
+        bool sameRules = categorized > 0;
+        for (size_t i = 0; i < sample; ++i) sameRules = sameRules && categorize(described[i], scratch) == reference[i];
+        bench.Verify("rules_match_reference", rows, sameRules);
+
+        // Through an import: rows without a category take the rule's
+        Ledger ruled((importDir / "rules.fsnap").string());
+        ruled.Load();
+        StatementOptions ruleOptions;
+        ruleOptions.rules = &rules;
+        std::vector<StatementImportRow> sampled(described.begin(), described.begin() + sample);
+        StatementImport withRules(ruled, ruleOptions);
+        withRules.Add(AsStatementRows(sampled));
+        bool ruledImport = withRules.Commit() == sample;
+        const TransactionStore& ruledStore = ruled.Transactions();
+        for (size_t i = 0; i < sample && ruledImport; ++i) {
+            size_t slot;
+            ruledImport = ruledStore.FindId(ruledStore.Id(0) + i, slot) &&
+                (reference[i] == CategoryRules::noRule ||
+                 ruledStore.CategoryName(ruledStore.Get(slot).category) == rules.Category(reference[i]));
+        }
+        bench.Verify("import_applies_rules", rows, ruledImport);
+        ruled.Close();
+    }
+}
+
+static int Usage() {
+    std::fprintf(stderr, "usage: finsync-bench [--sizes 1000,10000,...] [--threads 1,2,4,...] [--seed N] [--out file.json]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = { 1000, 10000, 100000, 1000000, 10000000 };
+    std::vector<size_t> threads = { 1, 2, 4, 8, 16 };
+    uint64_t seed = 1;
+    std::string out;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return Usage();
+        if (arg == "--sizes") {
+            sizes = ParseList(argv[++i]);
+        } else if (arg == "--threads") {
+            threads = ParseList(argv[++i]);
+        } else if (arg == "--seed") {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--out") {
+            out = argv[++i];
+        } else {
+            return Usage();
+        }
+    }
+
+    std::error_code ec;
+    fs::path dir = fs::temp_directory_path(ec) / ("finsync-bench-" + std::to_string(
+#ifdef _WIN32
+        GetCurrentProcessId()
+#else
+        getpid()
+#endif
+    ));
+    fs::create_directories(dir, ec);
+    if (ec) {
+        std::fprintf(stderr, "finsync-bench: cannot create %s\n", dir.string().c_str());
+        return 1;
+    }
+
+    Bench bench;
+    for (size_t rows : sizes) {
+        std::fprintf(stderr, "finsync-bench: %zu rows\n", rows);
+        RunSize(bench, rows, threads, seed, dir);
+    }
+    fs::remove_all(dir, ec);
+
+    std::string json = bench.Json(seed);
+    if (out.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else if (!WriteFile(out, json)) {
+        std::fprintf(stderr, "finsync-bench: cannot write %s\n", out.c_str());
+        return 1;
+    }
+    return bench.Passed() ? 0 : 1;
+}
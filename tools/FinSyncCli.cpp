@@ -0,0 +1,329 @@
+// finsync-cli: works on FinSync ledgers without the Win32 front end.
+//
+//   finsync-cli import <ledger.fsnap> <statement> [--columns <mapping>] [--dates dmy|mdy|ymd]
+//                      [--duplicates <days>|keep] [--rules <file>]
+//   finsync-cli summarize <ledger>
+//   finsync-cli report <ledger> [YYYY-MM | YYYY]
+//   finsync-cli convert <input> <output>
+//   finsync-cli query <ledger> <expression>
+//   finsync-cli sync <ledger.fsnap> <directory | tcp:host:port>
+//   finsync-cli serve <ledger.fsnap> <directory | tcp:port>
+//
+// A <ledger> is either a snapshot (its journal is replayed) or a CSV file in
+// the transactions.txt format. import reads bank statements in CSV, OFX or
+// QIF (see core/StatementImport.h); --columns maps CSV columns, as in
+// "date=Posted,amount=Amount,description=Payee", when the header does not
+// name them in the usual way. Rows imported before are left out, matched
+// within --duplicates days (3 by default) or kept with --duplicates keep.
+// Rows without a category take one from the rules in --rules, by default
+// the .rules file next to the ledger if there is one (see
+// core/CategoryRules.h).
+// convert picks the output format from the extension: .fsnap writes a
+// snapshot, anything else CSV. query prints the rows matching a filter
+// expression (see core/FilterProgram.h) as CSV.
+// sync brings a snapshot and the copy served at the other end to the same
+// rows (see core/LedgerSync.h); serve answers syncs until it is stopped.
+
+#include "core/Date.h"
+#include "core/FilterProgram.h"
+#include "core/Ledger.h"
+#include "core/LedgerLoader.h"
+#include "core/LedgerSync.h"
+#include "core/ParallelLoader.h"
+#include "core/Report.h"
+#include "core/Snapshot.h"
+#include "core/StatementImport.h"
+#include "core/TransactionStore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+
+static int Usage() {
+    std::fprintf(stderr,
+        "usage: finsync-cli import <ledger.fsnap> <statement> [--columns <mapping>] [--dates dmy|mdy|ymd]\n"
+        "                          [--duplicates <days>|keep] [--rules <file>]\n"
+        "       finsync-cli summarize <ledger>\n"
+        "       finsync-cli report <ledger> [YYYY-MM | YYYY]\n"
+        "       finsync-cli convert <input> <output>\n"
+        "       finsync-cli query <ledger> <expression>\n"
+        "       finsync-cli sync <ledger.fsnap> <directory | tcp:host:port>\n"
+        "       finsync-cli serve <ledger.fsnap> <directory | tcp:port>\n");
+    return 2;
+}
+
+static bool EndsWith(const std::string& text, const char* suffix) {
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool WriteFile(const std::string& path, const std::string& bytes) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+static bool IsSnapshot(const std::string& path) {
+    char magic[sizeof(kSnapshotMagic)];
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) return false;
+    bool match = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                 std::memcmp(magic, kSnapshotMagic, sizeof(magic)) == 0;
+    std::fclose(f);
+    return match;
+}
+
+// Loads a snapshot together with its journal, or a CSV file
+class LedgerInput {
+public:
+    bool Open(const std::string& path) {
+        if (IsSnapshot(path)) {
+            ledger = std::make_unique<Ledger>(path);
+            LedgerLoadResult result = ledger->Load();
+            if (!result.fromSnapshot) {
+                std::fprintf(stderr, "finsync-cli: %s is damaged (moved to %s)\n", path.c_str(), result.damagedPath.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        LedgerLoader loader;
+        if (!loader.Open(path)) {
+            std::fprintf(stderr, "finsync-cli: cannot read %s\n", path.c_str());
+            return false;
+        }
+        ParallelLoad(loader.Data(), loader.Size(), store);
+        return true;
+    }
+
+    const TransactionStore& Transactions() const { return ledger ? ledger->Transactions() : store; }
+
+private:
+    std::unique_ptr<Ledger> ledger;
+    TransactionStore store;
+};
+
+static int Import(const std::string& ledgerPath, const std::string& statementPath, int argc, char** argv) {
+    StatementOptions options;
+    if (!DetectStatementFormat(statementPath, options.format)) {
+        std::fprintf(stderr, "finsync-cli: cannot read %s\n", statementPath.c_str());
+        return 1;
+    }
+    options.dates = UsualDateOrder(options.format);
+    std::string rulesPath = RulesPath(ledgerPath);
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string flag = argv[i], value = argv[i + 1];
+        std::string error;
+        if (flag == "--columns") {
+            if (!StatementColumns::Parse(value, options.columns, error)) {
+                std::fprintf(stderr, "finsync-cli: %s\n", error.c_str());
+                return 2;
+            }
+        } else if (flag == "--dates" && (value == "dmy" || value == "mdy" || value == "ymd")) {
+            options.dates = value == "dmy" ? DateOrder::DayMonthYear
+                          : value == "mdy" ? DateOrder::MonthDayYear : DateOrder::YearMonthDay;
+        } else if (flag == "--duplicates" && value == "keep") {
+            options.skipDuplicates = false;
+        } else if (flag == "--duplicates" && !value.empty() && value.size() <= 2 &&
+                   value.find_first_not_of("0123456789") == std::string::npos &&
+                   std::stoi(value) <= ImportIndex::maxWindowDays) {
+            options.duplicateDays = std::stoi(value);
+        } else if (flag == "--rules") {
+            rulesPath = value;
+        } else {
+            return Usage();
+        }
+    }
+    if (argc % 2 != 0) return Usage();
+
+    CategoryRules rules;
+    std::string error;
+    if (!CategoryRules::Load(rulesPath, rules, error)) {
+        std::fprintf(stderr, "finsync-cli: %s: %s\n", rulesPath.c_str(), error.c_str());
+        return 2;
+    }
+    if (!rules.Empty()) options.rules = &rules;
+
+    Ledger ledger(ledgerPath);
+    LedgerLoadResult result = ledger.Load();
+    if (result.damaged) {
+        std::fprintf(stderr, "finsync-cli: %s is damaged (moved to %s)\n", ledgerPath.c_str(), result.damagedPath.c_str());
+        return 1;
+    }
+
+    size_t before = ledger.Transactions().Size();
+    StatementStats stats;
+    if (!ImportStatement(ledger, statementPath, options, stats)) {
+        std::fprintf(stderr, "finsync-cli: %s: %s\n", statementPath.c_str(), stats.error.c_str());
+        return 1;
+    }
+    if (!ledger.Save()) {
+        std::fprintf(stderr, "finsync-cli: cannot write %s\n", ledgerPath.c_str());
+        return 1;
+    }
+    ledger.Close();
+
+    std::printf("Imported %zu transactions into %s (%zu total)", ledger.Transactions().Size() - before,
+                ledgerPath.c_str(), ledger.Transactions().Size());
+    if (stats.duplicates > 0) std::printf("; left out %zu rows imported before", stats.duplicates);
+    if (stats.skipped > 0) std::printf("; skipped %zu rows without a valid date or amount", stats.skipped);
+    std::printf("\n");
+    return 0;
+}
+
+static int Summarize(const std::string& path) {
+    LedgerInput input;
+    if (!input.Open(path)) return 1;
+    std::fputs(FormatSummary(input.Transactions()).c_str(), stdout);
+    return 0;
+}
+
+static int Report(const std::string& path, const char* period) {
+    int year;
+    unsigned month = 0;
+    if (period != nullptr) {
+        // A bare year asks for the yearly report
+        int fields = std::sscanf(period, "%d-%u", &year, &month);
+        if (fields < 1 || (fields == 2 && (month < 1 || month > 12))) return Usage();
+    } else {
+        std::time_t now = std::time(nullptr);
+        std::tm local = *std::localtime(&now);
+        year = local.tm_year + 1900;
+        month = static_cast<unsigned>(local.tm_mon + 1);
+    }
+
+    LedgerInput input;
+    if (!input.Open(path)) return 1;
+    std::puts((month == 0 ? FormatYearReport(input.Transactions(), year) : FormatReport(input.Transactions(), year, month)).c_str());
+    return 0;
+}
+
+static int Convert(const std::string& inputPath, const std::string& outputPath) {
+    LedgerInput input;
+    if (!input.Open(inputPath)) return 1;
+
+    const TransactionStore& store = input.Transactions();
+    std::string bytes = EndsWith(outputPath, ".fsnap") ? store.BuildSnapshot() : store.BuildCsv();
+    if (!WriteFile(outputPath, bytes)) {
+        std::fprintf(stderr, "finsync-cli: cannot write %s\n", outputPath.c_str());
+        return 1;
+    }
+    std::printf("Wrote %zu transactions to %s\n", store.Size(), outputPath.c_str());
+    return 0;
+}
+
+static int Query(const std::string& path, const std::string& text) {
+    FilterProgram expression;
+    std::string error;
+    if (!FilterProgram::Compile(text, expression, error)) {
+        std::fprintf(stderr, "finsync-cli: %s\n", error.c_str());
+        return 2;
+    }
+
+    LedgerInput input;
+    if (!input.Open(path)) return 1;
+
+    const TransactionStore& store = input.Transactions();
+    RowSet rows = expression.Evaluate(store);
+    std::string out;
+    char date[16];
+    rows.ForEach([&](size_t slot) {
+        TransactionStore::Row row = store.Get(slot);
+        size_t length = FormatDate(row.day, date);
+        AppendLedgerRow(out, TypeName(row.type), row.amount, store.CategoryName(row.category), std::string_view(date, length));
+    });
+    std::fputs(out.c_str(), stdout);
+    std::fprintf(stderr, "%zu of %zu transactions match\n", rows.Count(), store.Size());
+    return 0;
+}
+
+static bool OpenLedger(Ledger& ledger) {
+    LedgerLoadResult result = ledger.Load();
+    if (result.damaged) {
+        std::fprintf(stderr, "finsync-cli: %s is damaged (moved to %s)\n", ledger.SnapshotPath().c_str(),
+                     result.damagedPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+static int Sync(const std::string& ledgerPath, const std::string& peer) {
+    Ledger ledger(ledgerPath);
+    if (!OpenLedger(ledger)) return 1;
+
+    std::unique_ptr<SyncTransport> transport;
+    if (peer.compare(0, 4, "tcp:") == 0) {
+        size_t colon = peer.rfind(':');
+        auto socket = std::make_unique<SocketTransport>();
+        if (colon == 3 || !socket->Connect(peer.substr(4, colon - 4), static_cast<uint16_t>(std::atoi(peer.c_str() + colon + 1)))) {
+            std::fprintf(stderr, "finsync-cli: cannot connect to %s\n", peer.c_str() + 4);
+            return 1;
+        }
+        transport = std::move(socket);
+    } else {
+        transport = std::make_unique<DirectoryTransport>(peer);
+    }
+
+    SyncStats stats;
+    std::string error;
+    bool ok = SyncLedger(ledger, *transport, stats, error);
+    ledger.Close();
+    if (!ok) {
+        std::fprintf(stderr, "finsync-cli: sync failed: %s\n", error.c_str());
+        return 1;
+    }
+    std::printf("Synced %s: %zu changes here, %zu sent, %zu conflicts; %llu bytes out, %llu in over %zu exchanges\n",
+                ledgerPath.c_str(), stats.localChanges, stats.peerChanges, stats.conflicts,
+                static_cast<unsigned long long>(stats.bytesSent), static_cast<unsigned long long>(stats.bytesReceived),
+                stats.exchanges);
+    return 0;
+}
+
+static int Serve(const std::string& ledgerPath, const std::string& where) {
+    Ledger ledger(ledgerPath);
+    if (!OpenLedger(ledger)) return 1;
+
+    SyncServer server(ledger);
+    SyncHandler handler = [&server](const std::string& request) { return server.Handle(request); };
+    if (where.compare(0, 4, "tcp:") == 0) {
+        SocketServer socket;
+        if (!socket.Listen(static_cast<uint16_t>(std::atoi(where.c_str() + 4)))) {
+            std::fprintf(stderr, "finsync-cli: cannot listen on port %s\n", where.c_str() + 4);
+            return 1;
+        }
+        std::printf("Serving %s on port %u\n", ledgerPath.c_str(), socket.Port());
+        std::fflush(stdout);
+        while (socket.ServeOne(handler)) ledger.Save();
+        return 1;
+    }
+
+    std::printf("Serving %s in %s\n", ledgerPath.c_str(), where.c_str());
+    std::fflush(stdout);
+    for (;;) {
+        if (ServeDirectory(where, handler) > 0) {
+            ledger.Save();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) return Usage();
+    std::string command = argv[1];
+
+    if (command == "import" && argc >= 4) return Import(argv[2], argv[3], argc - 4, argv + 4);
+    if (command == "summarize" && argc == 3) return Summarize(argv[2]);
+    if (command == "report" && (argc == 3 || argc == 4)) return Report(argv[2], argc == 4 ? argv[3] : nullptr);
+    if (command == "convert" && argc == 4) return Convert(argv[2], argv[3]);
+    if (command == "query" && argc == 4) return Query(argv[2], argv[3]);
+    if (command == "sync" && argc == 4) return Sync(argv[2], argv[3]);
+    if (command == "serve" && argc == 4) return Serve(argv[2], argv[3]);
+    return Usage();
+}
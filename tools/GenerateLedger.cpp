@@ -0,0 +1,158 @@
+// finsync-gen: writes reproducible synthetic ledgers for scale tests.
+//
+//   finsync-gen [options] <output>
+//
+//   --rows N              rows to write (default 1000000)
+//   --seed N              generator seed (default 1)
+//   --from DD/MM/YYYY     first date (default 01/01/2020)
+//   --to DD/MM/YYYY       last date (default 31/12/2025)
+//   --income-percent N    share of income rows (default 15)
+//   --random-dates        draw dates at random instead of in order
+//   --categories LIST     expense categories as Name=weight,Name=weight,...
+//                         (default: the app's categories)
+//
+// The output format follows the extension: .fsnap writes a snapshot, anything
+// else transactions.txt CSV ("-" for stdout). Rows are streamed, so memory use
+// does not grow with the row count.
+
+#include "core/Date.h"
+#include "core/LedgerGenerator.h"
+#include "core/LedgerLoader.h"
+#include "core/Snapshot.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static int Usage() {
+    std::fprintf(stderr,
+        "usage: finsync-gen [--rows N] [--seed N] [--from DD/MM/YYYY] [--to DD/MM/YYYY]\n"
+        "                   [--income-percent N] [--random-dates]\n"
+        "                   [--categories Name=weight,...] <output>\n");
+    return 2;
+}
+
+static bool ParseCategories(const std::string& list, std::vector<GeneratorCategory>& categories) {
+    categories.clear();
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(begin, end - begin);
+
+        size_t equals = item.rfind('=');
+        GeneratorCategory category;
+        category.name = item.substr(0, equals);
+        category.weight = equals == std::string::npos ? 1 : static_cast<unsigned>(std::strtoul(item.c_str() + equals + 1, nullptr, 10));
+        if (!CategoryDictionary::IsValidName(category.name)) return false;
+        categories.push_back(category);
+
+        begin = end + 1;
+    }
+    return !categories.empty();
+}
+
+static bool WriteCsv(LedgerGenerator& generator, std::FILE* out) {
+    const CategoryDictionary& categories = generator.Categories();
+    std::string buffer;
+    buffer.reserve(1 << 20);
+
+    TransactionStore::Row row;
+    char date[16];
+    while (generator.Next(row)) {
+        size_t length = FormatDate(row.day, date);
+        AppendLedgerRow(buffer, TypeName(row.type), row.amount, categories.Name(row.category), std::string_view(date, length));
+        if (buffer.size() >= (1 << 20) - 128) {
+            if (std::fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()) return false;
+            buffer.clear();
+        }
+    }
+    return std::fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+}
+
+// Snapshots are columnar: the generator is replayed once per column and
+// only that column is kept, in blocks
+template <typename T, typename Fn>
+static bool WriteColumn(LedgerGenerator& generator, SnapshotFileWriter& writer, SnapshotColumn column, Fn value) {
+    if (!writer.BeginColumn(column)) return false;
+    generator.Reset();
+
+    std::vector<T> block;
+    block.reserve(65536);
+    TransactionStore::Row row;
+    while (generator.Next(row)) {
+        block.push_back(value(row));
+        if (block.size() == 65536) {
+            if (!writer.Append(block.data(), block.size() * sizeof(T))) return false;
+            block.clear();
+        }
+    }
+    return writer.Append(block.data(), block.size() * sizeof(T));
+}
+
+static bool WriteSnapshotFile(LedgerGenerator& generator, const std::string& path) {
+    SnapshotFileWriter writer;
+    return writer.Open(path, generator.Rows()) &&
+           WriteColumn<uint8_t>(generator, writer, SnapshotColumn::Type,
+                                [](const TransactionStore::Row& row) { return static_cast<uint8_t>(row.type); }) &&
+           WriteColumn<int64_t>(generator, writer, SnapshotColumn::Amount,
+                                [](const TransactionStore::Row& row) { return row.amount.Minor(); }) &&
+           WriteColumn<uint16_t>(generator, writer, SnapshotColumn::Category,
+                                 [](const TransactionStore::Row& row) { return row.category; }) &&
+           WriteColumn<int32_t>(generator, writer, SnapshotColumn::Date,
+                                [](const TransactionStore::Row& row) { return row.day; }) &&
+           writer.Finish(generator.Categories());
+}
+
+int main(int argc, char** argv) {
+    GeneratorOptions options;
+    std::string output;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--rows" && hasValue) {
+            options.rows = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--from" && hasValue) {
+            if (!ParseDate(argv[++i], options.firstDay)) return Usage();
+        } else if (arg == "--to" && hasValue) {
+            if (!ParseDate(argv[++i], options.lastDay)) return Usage();
+        } else if (arg == "--income-percent" && hasValue) {
+            options.incomePercent = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--random-dates") {
+            options.randomDates = true;
+        } else if (arg == "--categories" && hasValue) {
+            if (!ParseCategories(argv[++i], options.categories)) return Usage();
+        } else if (output.empty() && (arg == "-" || arg[0] != '-')) {
+            output = arg;
+        } else {
+            return Usage();
+        }
+    }
+    if (output.empty() || options.incomePercent > 100) return Usage();
+
+    LedgerGenerator generator(options);
+    bool snapshot = output.size() > 6 && output.compare(output.size() - 6, 6, ".fsnap") == 0;
+    bool ok;
+
+    if (snapshot) {
+        ok = WriteSnapshotFile(generator, output);
+    } else if (output == "-") {
+        ok = WriteCsv(generator, stdout) && std::fflush(stdout) == 0;
+    } else {
+        std::FILE* out = std::fopen(output.c_str(), "wb");
+        ok = out != nullptr && WriteCsv(generator, out);
+        if (out != nullptr) ok = std::fclose(out) == 0 && ok;
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "finsync-gen: cannot write %s\n", output.c_str());
+        return 1;
+    }
+    return 0;
+}